@@ -9,6 +9,7 @@
 
 #include <qi/api.hpp>
 #include <boost/function.hpp>
+#include <memory>
 #include <vector>
 
 namespace qi{
@@ -85,13 +86,29 @@ namespace qi {
     std::vector<TypeInterface*> _argumentsType;
   };
 
+  namespace detail
+  {
+    class ArgumentConversionPlans;
+  }
+
   class QI_API FunctionTypeInterface: public TypeInterface, public CallableTypeInterface
   {
   public:
+    FunctionTypeInterface();
+    ~FunctionTypeInterface() override;
+
     /** Call the function func with argument args that must be of the correct type.
     * @return the return value of type resultType(). This value is allocated and must be destroyed.
     */
     virtual void* call(void* storage, void** args, unsigned int argc) = 0;
+
+    /// Conversions to argumentsType() decided by the previous calls through
+    /// AnyFunction, by types of the arguments.
+    detail::ArgumentConversionPlans& conversionPlans();
+
+  private:
+    // C4251
+    std::unique_ptr<detail::ArgumentConversionPlans> _conversionPlans;
   };
 
   template<typename T> FunctionTypeInterface* makeFunctionTypeInterface();
@@ -262,6 +279,10 @@ QI_GEN(genCall)
    * Memory management is the responsibility of the user.
    * If GenericFunctionParameters is obtained throug copy(), convert() or
    * fromBuffer(), it must be cleared by destroy()
+   *
+   * Parameters can also own the referenced values through a storage, shared
+   * by their copies: queued calls and signal emissions then keep the storage
+   * alive instead of copying the values.
    */
   class QI_API GenericFunctionParameters: public AnyReferenceVector
   {
@@ -274,6 +295,17 @@ QI_GEN(genCall)
     GenericFunctionParameters convert(const Signature& sig) const;
     qi::Signature signature(bool dyn) const;
     void destroy(bool notFirst = false);
+
+    /** Give the referenced values to `storage`, which must keep them alive
+     * until it is destroyed. The values must not be modified or destroyed by
+     * anyone else afterwards.
+     */
+    void setStorage(std::shared_ptr<void> storage);
+    /// @return the storage set by setStorage, or null if the values are not owned.
+    const std::shared_ptr<void>& storage() const;
+
+  private:
+    std::shared_ptr<void> _storage;
   };
 
   /// @return the type used by dynamic functions
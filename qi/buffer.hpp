@@ -213,6 +213,7 @@ namespace qi
     bool operator==(const Buffer& b) const;
   private:
     friend class BufferReader;
+    friend class BufferPrivate;
     // CS4251
     boost::shared_ptr<BufferPrivate> _p;
   };
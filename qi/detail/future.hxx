@@ -167,7 +167,7 @@ namespace detail {
     template <typename T>
     FutureBaseTyped<T>::~FutureBaseTyped()
     {
-      boost::recursive_mutex::scoped_lock lock(mutex());
+      FutureMutex::scoped_lock lock(mutex());
       if (_onDestroyed && state() == FutureState_FinishedWithValue)
         _onDestroyed(_value);
     }
@@ -177,7 +177,7 @@ namespace detail {
     {
       CancelCallback onCancel;
       {
-        boost::recursive_mutex::scoped_lock lock(mutex());
+        FutureMutex::scoped_lock lock(mutex());
         if (isFinished())
           return;
         requestCancel();
@@ -195,7 +195,7 @@ namespace detail {
     {
       bool doCancel = false;
       {
-        boost::recursive_mutex::scoped_lock lock(mutex());
+        FutureMutex::scoped_lock lock(mutex());
         _onCancel = onCancel;
         doCancel = isCancelRequested();
       }
@@ -247,7 +247,7 @@ namespace detail {
         // report-ready + onResult() must be Atomic to avoid
         // missing callbacks/double calls in case connect() is invoked at
         // the same time
-        boost::recursive_mutex::scoped_lock lock(mutex());
+        FutureMutex::scoped_lock lock(mutex());
         if (!isRunning())
           throw FutureException(FutureException::ExceptionState_PromiseAlreadySet);
         finishTask();
@@ -307,7 +307,7 @@ namespace detail {
     template <typename T>
     void FutureBaseTyped<T>::setOnDestroyed(boost::function<void(ValueType)> f)
     {
-      boost::recursive_mutex::scoped_lock lock(mutex());
+      FutureMutex::scoped_lock lock(mutex());
       _onDestroyed = f;
     }
 
@@ -321,7 +321,7 @@ namespace detail {
 
       bool ready;
       {
-        boost::recursive_mutex::scoped_lock lock(mutex());
+        FutureMutex::scoped_lock lock(mutex());
         ready = isFinished();
         if (!ready)
           _onResult.push_back(Callback(callback, type));
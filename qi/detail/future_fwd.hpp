@@ -22,6 +22,7 @@
 # include <qi/log.hpp>
 # include <qi/os.hpp>
 # include <qi/tag.hpp>
+# include <qi/perf/detail/instrumentedmutex.hpp>
 
 # include <boost/shared_ptr.hpp>
 # include <boost/make_shared.hpp>
@@ -949,6 +950,9 @@ namespace qi {
   namespace detail
   {
     class FutureBasePrivate;
+    QI_INSTRUMENTATION_LOCK_NAME(FutureLockName, "qi.future");
+    using FutureMutex = InstrumentedMutex<boost::recursive_mutex, FutureLockName>;
+
     class QI_API FutureBase {
     public:
       FutureBase();
@@ -972,7 +976,7 @@ namespace qi {
       void reportError(const std::string &message);
       void requestCancel();
       void reportCanceled();
-      boost::recursive_mutex& mutex();
+      FutureMutex& mutex();
       void notifyFinish();
 
     public:
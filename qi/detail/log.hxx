@@ -16,6 +16,7 @@
 
 // #include <locale>  TODO: Use these includes when they become available on all platforms,
 // #include <codecvt> instead of replaced by boost.locale
+#include <atomic>
 #include <type_traits>
 
 #include <ka/typetraits.hpp>
@@ -126,7 +127,8 @@
 
 // At leas one argument: category. Check for a format argument
 #define _QI_LOG_MESSAGE_STREAM_HASCAT_0_BOUNCE(Type, TypeCased, cat, ...) \
- QI_CAT(_QI_LOG_MESSAGE_STREAM_HASCAT_HASFORMAT_, _QI_LOG_ISEMPTY( __VA_ARGS__))(Type, TypeCased, cat, __VA_ARGS__)
+ ::qi::log::isVisible(cat, ::qi::Type)                                    \
+ && QI_CAT(_QI_LOG_MESSAGE_STREAM_HASCAT_HASFORMAT_, _QI_LOG_ISEMPTY( __VA_ARGS__))(Type, TypeCased, cat, __VA_ARGS__)
 
 
 // No format argument
@@ -219,7 +221,7 @@ namespace qi {
         {}
 
         std::string               name;
-        qi::LogLevel              maxLevel; //max level among all subscribers
+        std::atomic<qi::LogLevel> maxLevel; //max level among all subscribers
         std::vector<qi::LogLevel> levels;   //level by subscribers
 
         void setLevel(SubscriberId sub, qi::LogLevel level);
@@ -246,10 +248,11 @@ namespace qi {
       }
     } // namespace detail
 
-    //inlined for perf
+    //inlined for perf: a single relaxed load, the level is only a hint
+    //that does not order other memory accesses.
     inline bool isVisible(CategoryType category, qi::LogLevel level)
     {
-      return category && level <= category->maxLevel;
+      return category && level <= category->maxLevel.load(std::memory_order_relaxed);
     }
 
     using CategoryType = detail::Category*;
@@ -0,0 +1,242 @@
+#pragma once
+
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#ifndef _QI_DETAIL_LOGDEFERRED_HXX_
+#define _QI_DETAIL_LOGDEFERRED_HXX_
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include <ka/typetraits.hpp>
+
+#if defined(NO_QI_LOG_DETAILED_CONTEXT) || defined(NDEBUG)
+#  define _QI_LOG_DEFERRED(Type, Msg, ...)                                          \
+  do                                                                                \
+  {                                                                                 \
+    if (::qi::log::isVisible(_QI_LOG_CATEGORY_GET(), ::qi::Type))                   \
+    {                                                                               \
+      static const ::qi::log::LogSite _qi_log_site = { ::qi::Type, Msg, "",         \
+                                                       __FUNCTION__, 0 };           \
+      ::qi::log::detail::logDeferred(_qi_log_site, _QI_LOG_CATEGORY_GET(), ##__VA_ARGS__); \
+    }                                                                               \
+  }                                                                                 \
+  while (false)
+#else
+#  define _QI_LOG_DEFERRED(Type, Msg, ...)                                          \
+  do                                                                                \
+  {                                                                                 \
+    if (::qi::log::isVisible(_QI_LOG_CATEGORY_GET(), ::qi::Type))                   \
+    {                                                                               \
+      static const ::qi::log::LogSite _qi_log_site = { ::qi::Type, Msg, __FILE__,   \
+                                                       __FUNCTION__, __LINE__ };    \
+      ::qi::log::detail::logDeferred(_qi_log_site, _QI_LOG_CATEGORY_GET(), ##__VA_ARGS__); \
+    }                                                                               \
+  }                                                                                 \
+  while (false)
+#endif
+
+namespace qi {
+  namespace log {
+    namespace detail {
+
+      /* Arguments of the qiLog*Deferred macros are encoded one after the
+       * other, as a tag followed by the value in native byte order:
+       *   Bool:    1 byte
+       *   Char:    1 byte
+       *   Int:     int64
+       *   UInt:    uint64
+       *   Double:  double
+       *   Pointer: uint64
+       *   String:  uint32 size, then the bytes, without terminating zero
+       */
+      enum DeferredArgTag
+      {
+        DeferredArgTag_Bool = 1,
+        DeferredArgTag_Char,
+        DeferredArgTag_Int,
+        DeferredArgTag_UInt,
+        DeferredArgTag_Double,
+        DeferredArgTag_Pointer,
+        DeferredArgTag_String
+      };
+
+      // Encoded arguments, kept on the stack unless they are large.
+      class DeferredArgs
+      {
+      public:
+        DeferredArgs(const DeferredArgs&) = delete;
+        DeferredArgs& operator=(const DeferredArgs&) = delete;
+
+        DeferredArgs()
+          : _size(0)
+          , _onHeap(false)
+        {
+        }
+
+        void append(const void* data, std::size_t size)
+        {
+          if (!_onHeap && _size + size > sizeof(_stack))
+          {
+            _heap.assign(_stack, _size);
+            _onHeap = true;
+          }
+          if (_onHeap)
+            _heap.append(static_cast<const char*>(data), size);
+          else
+            std::memcpy(_stack + _size, data, size);
+          _size += size;
+        }
+
+        template <typename T>
+        void append(DeferredArgTag tag, T value)
+        {
+          const char t = static_cast<char>(tag);
+          append(&t, 1);
+          append(&value, sizeof(value));
+        }
+
+        void appendString(const char* str, std::size_t size)
+        {
+          append(DeferredArgTag_String, static_cast<std::uint32_t>(size));
+          append(str, size);
+        }
+
+        const char* data() const { return _onHeap ? _heap.data() : _stack; }
+        std::size_t size() const { return _size; }
+
+      private:
+        char        _stack[256];
+        std::string _heap;
+        std::size_t _size;
+        bool        _onHeap;
+      };
+
+      template <typename T>
+      using DeferredArgIsString = std::integral_constant<bool,
+          std::is_convertible<const T&, const char*>::value
+          && !std::is_same<T, std::nullptr_t>::value>;
+
+      template <typename T>
+      using DeferredArgIsPointer = std::integral_constant<bool,
+          std::is_pointer<T>::value && !DeferredArgIsString<T>::value>;
+
+      template <typename T>
+      using DeferredArgIsCopied = std::integral_constant<bool,
+          std::is_arithmetic<T>::value
+          || DeferredArgIsString<T>::value
+          || DeferredArgIsPointer<T>::value
+          || std::is_same<T, std::string>::value>;
+
+      inline void encodeDeferredArg(DeferredArgs& args, bool value)
+      {
+        args.append(DeferredArgTag_Bool, static_cast<char>(value));
+      }
+
+      inline void encodeDeferredArg(DeferredArgs& args, char value)
+      {
+        args.append(DeferredArgTag_Char, value);
+      }
+
+      inline void encodeDeferredArg(DeferredArgs& args, signed char value)
+      {
+        args.append(DeferredArgTag_Char, static_cast<char>(value));
+      }
+
+      inline void encodeDeferredArg(DeferredArgs& args, unsigned char value)
+      {
+        args.append(DeferredArgTag_Char, static_cast<char>(value));
+      }
+
+      inline void encodeDeferredArg(DeferredArgs& args, const std::string& value)
+      {
+        args.appendString(value.data(), value.size());
+      }
+
+      template <typename T>
+      ka::EnableIf<std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) != 1>
+      encodeDeferredArg(DeferredArgs& args, T value)
+      {
+        args.append(DeferredArgTag_Int, static_cast<std::int64_t>(value));
+      }
+
+      template <typename T>
+      ka::EnableIf<std::is_integral<T>::value && std::is_unsigned<T>::value && sizeof(T) != 1
+                   && !std::is_same<T, bool>::value>
+      encodeDeferredArg(DeferredArgs& args, T value)
+      {
+        args.append(DeferredArgTag_UInt, static_cast<std::uint64_t>(value));
+      }
+
+      template <typename T>
+      ka::EnableIf<std::is_floating_point<T>::value>
+      encodeDeferredArg(DeferredArgs& args, T value)
+      {
+        args.append(DeferredArgTag_Double, static_cast<double>(value));
+      }
+
+      template <typename T>
+      ka::EnableIf<DeferredArgIsString<T>::value>
+      encodeDeferredArg(DeferredArgs& args, const T& value)
+      {
+        const char* str = value;
+        if (!str)
+          str = "(null)";
+        args.appendString(str, std::strlen(str));
+      }
+
+      template <typename T>
+      ka::EnableIf<DeferredArgIsPointer<T>::value>
+      encodeDeferredArg(DeferredArgs& args, T value)
+      {
+        args.append(DeferredArgTag_Pointer,
+                    static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value)));
+      }
+
+      // Other types cannot be copied safely: format them right away.
+      template <typename T>
+      ka::EnableIf<!DeferredArgIsCopied<T>::value>
+      encodeDeferredArg(DeferredArgs& args, const T& value)
+      {
+        using ::operator<<;
+        std::ostringstream ss;
+        ss << narrow(value);
+        const std::string str = ss.str();
+        args.appendString(str.data(), str.size());
+      }
+
+      inline void encodeDeferredArgs(DeferredArgs&)
+      {
+      }
+
+      template <typename T, typename... Args>
+      void encodeDeferredArgs(DeferredArgs& args, const T& value, const Args&... others)
+      {
+        encodeDeferredArg(args, value);
+        encodeDeferredArgs(args, others...);
+      }
+
+      QI_API void logDeferred(const LogSite& site,
+                              CategoryType category,
+                              const char* args,
+                              std::size_t size);
+
+      template <typename... Args>
+      void logDeferred(const LogSite& site, CategoryType category, const Args&... values)
+      {
+        DeferredArgs args;
+        encodeDeferredArgs(args, values...);
+        logDeferred(site, category, args.data(), args.size());
+      }
+    } // namespace detail
+  } // namespace log
+} // namespace qi
+
+#endif  // _QI_DETAIL_LOGDEFERRED_HXX_
@@ -0,0 +1,160 @@
+#pragma once
+
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#ifndef _QI_DETAIL_LOGLIMIT_HXX_
+#define _QI_DETAIL_LOGLIMIT_HXX_
+
+#include <atomic>
+#include <cstdint>
+
+#include <qi/clock.hpp>
+
+/* The limiter of a call site is a function-local static, so that the macros
+ * stay expressions usable with operator<<. It is constant-initialized: the
+ * check costs no guard, only a few relaxed atomic operations.
+ */
+#if defined(NO_QI_LOG_DETAILED_CONTEXT) || defined(NDEBUG)
+#  define _QI_LOG_LIMITER(Type, MaxPerSecond, Period)                                 \
+  ([]() -> ::qi::log::detail::LogLimiter& {                                           \
+    static ::qi::log::detail::LogLimiter _qi_log_limiter(::qi::Type, MaxPerSecond,    \
+                                                         Period, "", 0);              \
+    return _qi_log_limiter;                                                           \
+  }())
+#else
+#  define _QI_LOG_LIMITER(Type, MaxPerSecond, Period)                                 \
+  ([]() -> ::qi::log::detail::LogLimiter& {                                           \
+    static ::qi::log::detail::LogLimiter _qi_log_limiter(::qi::Type, MaxPerSecond,    \
+                                                         Period, __FILE__, __LINE__); \
+    return _qi_log_limiter;                                                           \
+  }())
+#endif
+
+// Same as _QI_LOG_MESSAGE_STREAM, once the limiter of the site let the message through.
+#  define _QI_LOG_MESSAGE_STREAM_LIMITED(Type, TypeCased, Limiter, ...)              \
+  QI_CAT(_QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_, _QI_LOG_ISEMPTY( __VA_ARGS__))(Type, TypeCased, Limiter, __VA_ARGS__)
+
+// no extra argument
+#define _QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_1(Type, TypeCased, Limiter, ...) \
+  ::qi::log::isVisible(_QI_LOG_CATEGORY_GET(), ::qi::Type)                     \
+  && Limiter.allow(_QI_LOG_CATEGORY_GET(), __FUNCTION__)                       \
+  && BOOST_PP_CAT(_qiLog, TypeCased)(_QI_LOG_CATEGORY_GET())
+
+// Visual bouncer for macro evalution order glitch.
+#ifdef _MSC_VER
+#define _QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_0(...) QI_DELAY(_QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_0) ## _BOUNCE(__VA_ARGS__)
+#else
+#define _QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_0(...) _QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_0_BOUNCE(__VA_ARGS__)
+#endif
+
+// At least one argument: category. Check for a format argument
+#define _QI_LOG_MESSAGE_STREAM_LIMITED_HASCAT_0_BOUNCE(Type, TypeCased, Limiter, cat, ...) \
+  ::qi::log::isVisible(cat, ::qi::Type)                                                  \
+  && Limiter.allow(cat, __FUNCTION__)                                                    \
+  && QI_CAT(_QI_LOG_MESSAGE_STREAM_HASCAT_HASFORMAT_, _QI_LOG_ISEMPTY( __VA_ARGS__))(Type, TypeCased, cat, __VA_ARGS__)
+
+namespace qi {
+  namespace log {
+    namespace detail {
+
+      /* State of a qiLog*Limited or qiLog*Sampled call site.
+       *
+       * Sampling keeps one message out of `period`, rate limiting keeps at
+       * most `maxPerSecond` messages per second. The number of messages left
+       * out is logged periodically, from the call site.
+       */
+      class QI_API LogLimiter
+      {
+      public:
+        LogLimiter(const LogLimiter&) = delete;
+        LogLimiter& operator=(const LogLimiter&) = delete;
+
+        constexpr LogLimiter(qi::LogLevel level,
+                             unsigned int maxPerSecond,
+                             unsigned int period,
+                             const char* file,
+                             int line)
+          : level(level)
+          , maxPerSecond(maxPerSecond)
+          , period(period)
+          , file(file)
+          , line(line)
+          , function(nullptr)
+          , category(nullptr)
+          , _window(0)
+          , _count(0)
+          , _sampled(0)
+          , _suppressed(0)
+          , _registered(false)
+        {
+        }
+
+        /// Return whether the message must be logged, count it otherwise.
+        bool allow(CategoryType cat, const char* fct)
+        {
+          if (pass())
+            return true;
+          suppress(cat, nullptr, fct);
+          return false;
+        }
+
+        bool allow(const char* cat, const char* fct)
+        {
+          if (pass())
+            return true;
+          suppress(nullptr, cat, fct);
+          return false;
+        }
+
+        /// Return the number of messages left out since the last call.
+        std::uint64_t takeSuppressed()
+        {
+          return _suppressed.exchange(0u, std::memory_order_relaxed);
+        }
+
+        const qi::LogLevel level;
+        const unsigned int maxPerSecond; // 0 for no limit
+        const unsigned int period;       // 0 or 1 for no sampling
+        const char* const  file;
+        const int          line;
+        // Set when the first message is left out.
+        const char*        function;
+        CategoryType       category;
+
+      private:
+        bool pass()
+        {
+          if (period > 1u && _sampled.fetch_add(1u, std::memory_order_relaxed) % period != 0u)
+            return false;
+          if (maxPerSecond == 0u)
+            return true;
+
+          const std::int64_t second = boost::chrono::duration_cast<qi::Seconds>(
+                                        qi::SteadyClock::now().time_since_epoch()).count();
+          std::int64_t window = _window.load(std::memory_order_relaxed);
+          if (window != second
+              && _window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+            _count.store(0u, std::memory_order_relaxed);
+          return _count.fetch_add(1u, std::memory_order_relaxed) < maxPerSecond;
+        }
+
+        // Count the message, and register the site for the summaries on
+        // the first call. One of `cat` and `catName` is null.
+        void suppress(CategoryType cat, const char* catName, const char* fct);
+
+        std::atomic<std::int64_t>  _window; // current second
+        std::atomic<unsigned int>  _count;  // messages in the current second
+        std::atomic<unsigned int>  _sampled;
+        std::atomic<std::uint64_t> _suppressed;
+        std::atomic<bool>          _registered;
+      };
+
+    }
+  }
+}
+
+#endif  // _QI_DETAIL_LOGLIMIT_HXX_
@@ -7,6 +7,8 @@
 #ifndef _QI_TYPE_JSONCODEC_HPP_
 #define _QI_TYPE_JSONCODEC_HPP_
 
+#include <iosfwd>
+#include <string>
 #include <qi/api.hpp>
 #include <qi/anyvalue.hpp>
 
@@ -24,6 +26,22 @@ namespace qi {
    */
   QI_API std::string encodeJSON(const qi::AutoAnyReference &val, JsonOption jsonPrintOption = JsonOption_None);
 
+  /** Append the value encoded in JSON to a string.
+   * Reusing the same string across calls saves the allocations of the output.
+   * @param val Value to encode
+   * @param out String to append to
+   * @param jsonPrintOption Option to change JSON output
+   */
+  QI_API void encodeJSON(const qi::AutoAnyReference &val, std::string &out, JsonOption jsonPrintOption = JsonOption_None);
+
+  /** Write the value encoded in JSON to a stream, by chunks, without holding
+   * the whole output in memory.
+   * @param val Value to encode
+   * @param out Stream to write to
+   * @param jsonPrintOption Option to change JSON output
+   */
+  QI_API void encodeJSON(const qi::AutoAnyReference &val, std::ostream &out, JsonOption jsonPrintOption = JsonOption_None);
+
   /**
     * creates a GV representing a JSON string or throw on parse error.
     * @param in JSON string to decode.
@@ -42,6 +60,56 @@ namespace qi {
                                          const std::string::const_iterator &end,
                                          AnyValue &target);
 
+  /**
+    * creates a GV representing the JSON value read from a stream or throw on parse error.
+    * The stream is read up to the end of the value, not further.
+    * @param in stream to read from.
+    * @return a GV representing the JSON value
+    */
+  QI_API qi::AnyValue decodeJSON(std::istream &in);
+
+  /**
+    * decode the JSON sequence between two pointers straight into a value of a
+    * known type, without building an intermediate GV, or throw on parse error
+    * or if the JSON value does not fit the type of the target.
+    *
+    * Objects fill maps, and structures by member name. Arrays fill lists, and
+    * structures by member position. Lists and maps of the target are
+    * appended to, members absent from the JSON are left untouched.
+    * @param begin pointer to the beginning of the sequence to decode.
+    * @param end pointer to the end of the sequence to decode.
+    * @param target reference to the value to set.
+    * @return a pointer to the last read char + 1
+    */
+  QI_API const char* decodeJSON(const char* begin, const char* end, AnyReference target);
+
+  /// Same as above, on a whole string.
+  QI_API void decodeJSON(const std::string &in, AnyReference target);
+
+  /// Same as above, reading a stream up to the end of the value.
+  QI_API void decodeJSON(std::istream &in, AnyReference target);
+
+  /**
+    * creates a GV of the given type from a JSON string or throw on parse error
+    * or if the JSON value does not fit the type.
+    * @param in JSON string to decode.
+    * @param targetType type of the value to create.
+    * @return a GV of type targetType
+    */
+  QI_API qi::AnyValue decodeJSON(const std::string &in, TypeInterface* targetType);
+
+  /**
+    * set a value of a registered type, such as a QI_TYPE_STRUCT, from a JSON
+    * string or throw on parse error or if the JSON value does not fit the type.
+    * Structure members are read straight from the JSON object, by name.
+    * @param in JSON string to decode.
+    * @param target value to set.
+    */
+  template <typename T>
+  void decodeJSON(const std::string &in, T &target)
+  {
+    decodeJSON(in, AnyReference::from(target));
+  }
 
 
 }
@@ -0,0 +1,100 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_LAZYANYVALUE_HPP_
+#define _QI_LAZYANYVALUE_HPP_
+
+#include <memory>
+#include <qi/api.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/buffer.hpp>
+#include <qi/signature.hpp>
+#include <qi/type/typeinterface.hpp>
+
+namespace qi
+{
+  /** Dynamic value kept in its binary encoding until it is read.
+   *
+   * Its signature is "m", as the one of AnyValue. The binary decoder keeps
+   * the encoding of a LazyAnyValue instead of building its value, and the
+   * binary encoder writes this encoding back: a value that is only forwarded
+   * is never decoded. The value is decoded by the first call to value(),
+   * once for all the copies.
+   *
+   * The values holding objects are decoded by the binary decoder, as their
+   * encoding is only meaningful on the connection they come from.
+   *
+   * A LazyAnyValue is immutable: the value it returns must not be modified.
+   */
+  class QI_API LazyAnyValue
+  {
+  public:
+    /// An empty value, without signature.
+    LazyAnyValue();
+    /// A value that is already decoded.
+    explicit LazyAnyValue(const AnyValue& value);
+    /// The value of signature `signature` whose binary encoding is `encoded`.
+    LazyAnyValue(const Signature& signature, Buffer encoded);
+
+    /// @return the signature of the value, invalid if it is empty.
+    const Signature& signature() const;
+    bool isValid() const;
+    /// @return whether the value was decoded.
+    bool isDecoded() const;
+    /// @return the binary encoding of the value, or null if it was built from
+    /// a value.
+    const Buffer* encoded() const;
+
+    /** @return the value, decoded by the first call.
+     * @throw std::runtime_error if the encoding is invalid.
+     */
+    const AnyValue& value() const;
+
+    /** @return the value converted to T.
+     *
+     * If the value was not decoded yet and T has its signature, the encoding
+     * is decoded directly into T: containers of LazyAnyValue only decode the
+     * elements that are read.
+     */
+    template <typename T>
+    T to() const
+    {
+      T result;
+      if (!decodeTo(AnyReference::fromPtr(&result)))
+        result = value().to<T>();
+      return result;
+    }
+
+  private:
+    bool decodeTo(AnyReference target) const;
+
+    struct State;
+    // Null for an empty value.
+    std::shared_ptr<State> _state;
+  };
+
+  template <>
+  class TypeImpl<LazyAnyValue> : public DynamicTypeInterface
+  {
+  public:
+    AnyReference get(void* storage) override
+    {
+      LazyAnyValue* ptr = (LazyAnyValue*)ptrFromStorage(&storage);
+      return ptr->value().asReference();
+    }
+
+    void set(void** storage, AnyReference src) override
+    {
+      LazyAnyValue* ptr = (LazyAnyValue*)ptrFromStorage(storage);
+      *ptr = LazyAnyValue(AnyValue(src, true, true));
+    }
+
+    using Methods = DefaultTypeImplMethods<LazyAnyValue, TypeByPointerPOD<LazyAnyValue>>;
+    _QI_BOUNCE_TYPE_METHODS(Methods);
+  };
+}
+
+#endif  // _QI_LAZYANYVALUE_HPP_
@@ -55,6 +55,38 @@
     ::qi::log::addCategory(Cat)
 
 
+/**
+ * \verbatim
+ * Define QI_LOG_MAX_LEVEL to the value of a qi::LogLevel to compile out the
+ * log sites of the more verbose levels, as NO_QI_DEBUG, NO_QI_VERBOSE and so
+ * on do. For instance, with 4 (qi::LogLevel_Info), qiLogVerbose and
+ * qiLogDebug sites do nothing and do not evaluate their arguments.
+ *
+ * libqi itself is built this way when its QI_LOG_MAX_LEVEL CMake setting is
+ * not empty.
+ * \endverbatim
+ */
+#if defined(QI_LOG_MAX_LEVEL)
+# if QI_LOG_MAX_LEVEL < 6 && !defined(NO_QI_DEBUG)
+#  define NO_QI_DEBUG
+# endif
+# if QI_LOG_MAX_LEVEL < 5 && !defined(NO_QI_VERBOSE)
+#  define NO_QI_VERBOSE
+# endif
+# if QI_LOG_MAX_LEVEL < 4 && !defined(NO_QI_INFO)
+#  define NO_QI_INFO
+# endif
+# if QI_LOG_MAX_LEVEL < 3 && !defined(NO_QI_WARNING)
+#  define NO_QI_WARNING
+# endif
+# if QI_LOG_MAX_LEVEL < 2 && !defined(NO_QI_ERROR)
+#  define NO_QI_ERROR
+# endif
+# if QI_LOG_MAX_LEVEL < 1 && !defined(NO_QI_FATAL)
+#  define NO_QI_FATAL
+# endif
+#endif
+
 /**
  * \verbatim
  * Log in debug mode. Not compiled on release and not shown by default.
@@ -72,9 +104,17 @@
 #if defined(NO_QI_DEBUG) || defined(NDEBUG)
 # define qiLogDebug(...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogDebugF(Msg, ...) do {} while(0)
+# define qiLogDebugDeferred(Msg, ...) do {} while(0)
+# define qiLogDebugLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogDebugSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogDebug(...)   _QI_LOG_MESSAGE_STREAM(LogLevel_Debug,   Debug ,  __VA_ARGS__)
 # define qiLogDebugF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Debug,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogDebugDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Debug, Msg, ##__VA_ARGS__)
+# define qiLogDebugLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Debug, Debug, _QI_LOG_LIMITER(LogLevel_Debug, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogDebugSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Debug, Debug, _QI_LOG_LIMITER(LogLevel_Debug, 0, Period), __VA_ARGS__)
 #endif
 
 /**
@@ -83,9 +123,17 @@
 #if defined(NO_QI_VERBOSE)
 # define qiLogVerbose(...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogVerboseF(Msg, ...) do {} while(0)
+# define qiLogVerboseDeferred(Msg, ...) do {} while(0)
+# define qiLogVerboseLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogVerboseSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogVerbose(...) _QI_LOG_MESSAGE_STREAM(LogLevel_Verbose, Verbose, __VA_ARGS__)
 # define qiLogVerboseF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Verbose,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogVerboseDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Verbose, Msg, ##__VA_ARGS__)
+# define qiLogVerboseLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Verbose, Verbose, _QI_LOG_LIMITER(LogLevel_Verbose, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogVerboseSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Verbose, Verbose, _QI_LOG_LIMITER(LogLevel_Verbose, 0, Period), __VA_ARGS__)
 #endif
 
 /**
@@ -94,9 +142,17 @@
 #if defined(NO_QI_INFO)
 # define qiLogInfo(...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogInfoF(Msg, ...) do {} while(0)
+# define qiLogInfoDeferred(Msg, ...) do {} while(0)
+# define qiLogInfoLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogInfoSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogInfo(...)    _QI_LOG_MESSAGE_STREAM(LogLevel_Info,    Info,    __VA_ARGS__)
 # define qiLogInfoF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Info,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogInfoDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Info, Msg, ##__VA_ARGS__)
+# define qiLogInfoLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Info, Info, _QI_LOG_LIMITER(LogLevel_Info, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogInfoSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Info, Info, _QI_LOG_LIMITER(LogLevel_Info, 0, Period), __VA_ARGS__)
 #endif
 
 /**
@@ -105,9 +161,17 @@
 #if defined(NO_QI_WARNING)
 # define qiLogWarning(...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogWarningF(Msg, ...) do {} while(0)
+# define qiLogWarningDeferred(Msg, ...) do {} while(0)
+# define qiLogWarningLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogWarningSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogWarning(...) _QI_LOG_MESSAGE_STREAM(LogLevel_Warning, Warning, __VA_ARGS__)
 # define qiLogWarningF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Warning,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogWarningDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Warning, Msg, ##__VA_ARGS__)
+# define qiLogWarningLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Warning, Warning, _QI_LOG_LIMITER(LogLevel_Warning, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogWarningSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Warning, Warning, _QI_LOG_LIMITER(LogLevel_Warning, 0, Period), __VA_ARGS__)
 #endif
 
 /**
@@ -116,9 +180,17 @@
 #if defined(NO_QI_ERROR)
 # define qiLogError(...)   ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogErrorF(Msg, ...) do {} while(0)
+# define qiLogErrorDeferred(Msg, ...) do {} while(0)
+# define qiLogErrorLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogErrorSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogError(...)   _QI_LOG_MESSAGE_STREAM(LogLevel_Error,   Error,   __VA_ARGS__)
 # define qiLogErrorF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Error,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogErrorDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Error, Msg, ##__VA_ARGS__)
+# define qiLogErrorLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Error, Error, _QI_LOG_LIMITER(LogLevel_Error, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogErrorSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Error, Error, _QI_LOG_LIMITER(LogLevel_Error, 0, Period), __VA_ARGS__)
 #endif
 
 /**
@@ -127,11 +199,57 @@
 #if defined(NO_QI_FATAL)
 # define qiLogFatal(...)  ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 # define qiLogFatalF(Msg, ...) do {} while(0)
+# define qiLogFatalDeferred(Msg, ...) do {} while(0)
+# define qiLogFatalLimited(MaxPerSecond, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
+# define qiLogFatalSampled(Period, ...) ::qi::log::detail::qiFalse() && false < qi::log::detail::NullStream().self()
 #else
 # define qiLogFatal(...)   _QI_LOG_MESSAGE_STREAM(LogLevel_Fatal,   Fatal,   __VA_ARGS__)
 # define qiLogFatalF(Msg, ...)   _QI_LOG_MESSAGE(LogLevel_Fatal,   _QI_LOG_FORMAT(Msg, __VA_ARGS__))
+# define qiLogFatalDeferred(Msg, ...) _QI_LOG_DEFERRED(LogLevel_Fatal, Msg, ##__VA_ARGS__)
+# define qiLogFatalLimited(MaxPerSecond, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Fatal, Fatal, _QI_LOG_LIMITER(LogLevel_Fatal, MaxPerSecond, 1), __VA_ARGS__)
+# define qiLogFatalSampled(Period, ...) \
+  _QI_LOG_MESSAGE_STREAM_LIMITED(LogLevel_Fatal, Fatal, _QI_LOG_LIMITER(LogLevel_Fatal, 0, Period), __VA_ARGS__)
 #endif
 
+/**
+ * \verbatim
+ * The qiLog*Deferred macros log like the qiLog*F ones, but the message is
+ * formatted later, out of the calling thread. The call site only records the
+ * raw values of the arguments, next to a static description of the call site
+ * (see qi::log::LogSite).
+ *
+ * .. code-block:: cpp
+ *
+ *     qiLogInfoDeferred("frame %d processed in %s ms", frameId, duration);
+ *
+ * The format must be a string literal. Arithmetic, string and pointer
+ * arguments are copied as is, other arguments are formatted on the spot with
+ * their operator<<.
+ *
+ * Messages are given as text to the handlers added without a
+ * qi::log::DeferredHandler, such as the console one.
+ * \endverbatim
+ */
+
+/**
+ * \verbatim
+ * The qiLog*Limited and qiLog*Sampled macros log like the stream ones, but
+ * leave messages out when the call site fires too often. qiLog*Limited
+ * logs at most *MaxPerSecond* messages per second, qiLog*Sampled logs one
+ * message out of *Period*. Use them where a remote peer can trigger the log.
+ *
+ * .. code-block:: cpp
+ *
+ *     qiLogWarningLimited(10) << "Invalid message from " << endpoint;
+ *     qiLogWarningSampled(100, "foo.bar") << "Late frame " << frameId;
+ *
+ * Each call site keeps its own count. About once per second, and on
+ * qi::log::flush(), the number of messages left out is logged from the call
+ * site, with its level and category: "N log message(s) suppressed".
+ * \endverbatim
+ */
+
 
 namespace qi {
   /**
@@ -156,6 +274,14 @@ namespace qi {
     LogColor_Always ///< Always show color
   };
 
+  /**
+   * \brief Behavior of asynchronous logs when the buffer of a thread is full.
+   */
+  enum LogOverflowPolicy {
+    LogOverflowPolicy_Drop, ///< Drop the message, the number of dropped messages is logged later
+    LogOverflowPolicy_Block ///< Wait for the log thread to make room
+  };
+
   /**
    * \brief Logs context attribute.
    */
@@ -242,6 +368,33 @@ namespace qi {
                              const char*,
                              int>;
 
+    /**
+     * \brief Static description of a call site of the qiLog*Deferred macros.
+     */
+    struct LogSite
+    {
+      qi::LogLevel level;
+      const char*  format;   ///< Format of the message, as for boost::format.
+      const char*  file;
+      const char*  function;
+      int          line;
+    };
+
+    /**
+     * \brief Boost delegate to log function receiving the messages of the
+     *        qiLog*Deferred macros before formatting (dates of log, category,
+     *        call site, encoded arguments and their size in bytes).
+     *
+     * The arguments can be formatted with qi::log::formatDeferred.
+     */
+    using DeferredHandler = boost::function6<void,
+                             const qi::Clock::time_point,
+                             const qi::SystemClock::time_point,
+                             const char*,
+                             const LogSite&,
+                             const char*,
+                             std::size_t>;
+
     /// Environment variables used by qi::log.
     /// Use qi::os::getenv() to get their value.
     namespace env {
@@ -448,6 +601,14 @@ namespace qi {
      */
     QI_API bool isVisible(const std::string& category, qi::LogLevel level);
 
+    /**
+     * \copydoc isVisible()
+     *
+     * Categories are cached by the address of their name, which makes this
+     * lock-free for names that are literals.
+     */
+    QI_API bool isVisible(const char* category, qi::LogLevel level);
+
     /**
      * \brief Parse and execute a set of verbosity rules.
      * \param rules Colon separated of rules.
@@ -536,6 +697,17 @@ namespace qi {
      */
     QI_API void setSynchronousLog(bool sync);
 
+    /**
+     * \brief Set what happens when a thread logs asynchronously faster than
+     *        the handlers can process.
+     * \param policy Overflow policy, LogOverflowPolicy_Drop by default.
+     *
+     * Each thread logs in its own buffer, whose size in bytes can be set with
+     * the QI_LOG_BUFFER_SIZE environment variable. Messages logged from a log
+     * handler are always dropped when the buffer is full.
+     */
+    QI_API void setAsynchronousLogOverflowPolicy(LogOverflowPolicy policy);
+
     /**
      * \brief Add a log handler for this process' logs.
      * \warning Handlers are usually called synchronously, they must not block.
@@ -547,6 +719,30 @@ namespace qi {
     QI_API SubscriberId addHandler(const std::string& name,
                                    qi::log::Handler fct,
                                    qi::LogLevel defaultLevel = LogLevel_Info);
+    /**
+     * \brief Add a log handler that also receives the messages of the
+     *        qiLog*Deferred macros before they are formatted.
+     * \param name Name of the handler, useful to remove handler (prefer lowercase).
+     * \param fct Boost delegate receiving the formatted messages.
+     * \param deferred Boost delegate receiving the messages of the
+     *        qiLog*Deferred macros.
+     * \param defaultLevel default log verbosity.
+     * \return New log subscriber id added.
+     */
+    QI_API SubscriberId addHandler(const std::string& name,
+                                   qi::log::Handler fct,
+                                   qi::log::DeferredHandler deferred,
+                                   qi::LogLevel defaultLevel = LogLevel_Info);
+
+    /**
+     * \brief Format the arguments of a message of the qiLog*Deferred macros.
+     * \param format Format of the message, as in qi::log::LogSite.
+     * \param args Encoded arguments, as given to a qi::log::DeferredHandler.
+     * \param size Size of the encoded arguments in bytes.
+     * \return The formatted message.
+     */
+    QI_API std::string formatDeferred(const char* format, const char* args, std::size_t size);
+
     /**
      * \brief Add a log handler.
      * \param name Name of the handler, useful to remove handler (prefer lowercase).
@@ -622,6 +818,8 @@ namespace qi {
 }
 
 # include <qi/detail/log.hxx>
+# include <qi/detail/logdeferred.hxx>
+# include <qi/detail/loglimit.hxx>
 
 namespace qi
 {
@@ -0,0 +1,128 @@
+#pragma once
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#ifndef _QI_LOG_BINARYFILELOGHANDLER_HPP_
+#define _QI_LOG_BINARYFILELOGHANDLER_HPP_
+
+#include <memory>
+#include <boost/noncopyable.hpp>
+#include <qi/log.hpp>
+
+namespace qi
+{
+namespace log
+{
+  /**
+   * \brief Layout of the files written by BinaryFileLogHandler.
+   *
+   * Numbers are written in the byte order of the machine, the header tells
+   * which one. Strings are written as an uint32 size followed by their bytes.
+   * Dates are int64 numbers of nanoseconds since the epoch of their clock.
+   *
+   * \verbatim
+   * Header:   "QILOGBIN", uint32 version, uint32 byte order mark (0x01020304)
+   * Category: uint8 1, uint32 id, string name
+   * Site:     uint8 2, uint32 id, uint8 level, int32 line,
+   *           string file, string function, string format
+   * Text:     uint8 3, int64 date, int64 system date, uint32 category id,
+   *           uint8 level, int32 line, string file, string function, string message
+   * Deferred: uint8 4, int64 date, int64 system date, uint32 category id,
+   *           uint32 site id, string arguments
+   * \endverbatim
+   *
+   * Categories and sites are written once, before the first record using
+   * them. The arguments of deferred records are formatted with
+   * qi::log::formatDeferred, see the qilog-decode tool.
+   */
+  namespace binarylog
+  {
+    static const char magic[] = "QILOGBIN";
+    static const std::size_t magicSize = sizeof(magic) - 1;
+    static const qi::uint32_t version = 1;
+    static const qi::uint32_t byteOrderMark = 0x01020304;
+
+    enum RecordType
+    {
+      RecordType_Category = 1,
+      RecordType_Site     = 2,
+      RecordType_Text     = 3,
+      RecordType_Deferred = 4
+    };
+  }
+
+  struct PrivateBinaryFileLogHandler;
+
+  /**
+   * \includename{qi/log/binaryfileloghandler.hpp}
+   *
+   * This class writes all logs to a file in a binary format. The messages of
+   * the qiLog*Deferred macros are written before formatting, which is left to
+   * the qilog-decode tool.
+   *
+   * \verbatim
+   * .. code-block:: cpp
+   *
+   *     qi::log::BinaryFileLogHandler handler("/tmp/app.qilog");
+   *     qi::log::addHandler("binaryfile",
+   *                         boost::bind(&BinaryFileLogHandler::log, &handler,
+   *                                     _1, _2, _3, _4, _5, _6, _7, _8),
+   *                         boost::bind(&BinaryFileLogHandler::logDeferred, &handler,
+   *                                     _1, _2, _3, _4, _5, _6));
+   * \endverbatim
+   */
+  class QI_API BinaryFileLogHandler : private boost::noncopyable
+  {
+  public:
+    /**
+     * \brief Initialize the file handler on the file. File is opened directly on construction.
+     * \param filePath the path to the file where log messages will be written.
+     *
+     * If the file could not be opened, it logs a warning and every log call
+     * will silently fail.
+     */
+    explicit BinaryFileLogHandler(const std::string& filePath);
+
+    /**
+     * \brief Closes the file.
+     */
+    ~BinaryFileLogHandler();
+
+    /**
+     * \brief Write a formatted log message to the file.
+     *
+     * Same parameters as qi::log::Handler.
+     */
+    void log(const qi::LogLevel verb,
+             const qi::Clock::time_point date,
+             const qi::SystemClock::time_point systemDate,
+             const char* category,
+             const char* msg,
+             const char* file,
+             const char* fct,
+             const int line);
+
+    /**
+     * \brief Write a log message of the qiLog*Deferred macros to the file,
+     *        without formatting it.
+     *
+     * Same parameters as qi::log::DeferredHandler.
+     */
+    void logDeferred(const qi::Clock::time_point date,
+                     const qi::SystemClock::time_point systemDate,
+                     const char* category,
+                     const LogSite& site,
+                     const char* args,
+                     std::size_t size);
+
+  private:
+    std::unique_ptr<PrivateBinaryFileLogHandler> _p;
+  };
+
+} // !log
+} // !qi
+
+#endif // _QI_LOG_BINARYFILELOGHANDLER_HPP_
@@ -0,0 +1,113 @@
+#pragma once
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#ifndef _QI_LOG_ROTATINGFILELOGHANDLER_HPP_
+#define _QI_LOG_ROTATINGFILELOGHANDLER_HPP_
+
+#include <memory>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <qi/clock.hpp>
+#include <qi/log.hpp>
+
+namespace qi
+{
+namespace log
+{
+  /**
+   * \brief Settings of a RotatingFileLogHandler.
+   * \includename{qi/log/rotatingfileloghandler.hpp}
+   */
+  struct RotatingFileLogOptions
+  {
+    /// Size of the buffer in which logs are kept before being written.
+    std::size_t bufferSize = 64 * 1024;
+    /// Buffered logs are written at least this often.
+    qi::Duration flushInterval = qi::Seconds(1);
+    /// Logs of this level or more severe are written right away.
+    qi::LogLevel flushLevel = qi::LogLevel_Error;
+    /// Rotate the file once it is this large, 0 to never rotate on size.
+    std::size_t maxFileSize = 10 * 1024 * 1024;
+    /// Rotate the file this often, 0 to never rotate on time.
+    qi::Duration rotationInterval = qi::Duration::zero();
+    /// Number of rotated files kept next to the current one.
+    unsigned int maxFiles = 5;
+    /// Compress the rotated files with gzip, in the background.
+    bool compress = false;
+  };
+
+  struct PrivateRotatingFileLogHandler;
+
+  /**
+   * \brief Write logs to a file through a buffer, and rotate it.
+   * \includename{qi/log/rotatingfileloghandler.hpp}
+   *
+   * \verbatim
+   * Logs are kept in memory until the buffer is full, until
+   * ``flushInterval`` has elapsed, or until a log of level ``flushLevel`` or
+   * more severe is received.
+   *
+   * When the file gets larger than ``maxFileSize``, or older than
+   * ``rotationInterval``, it is renamed to *filePath*.1, the previous
+   * *filePath*.1 to *filePath*.2 and so on, keeping ``maxFiles`` of them. With
+   * ``compress``, rotated files are compressed to *filePath*.1.gz and so on:
+   * they take their place once compressed in the background, and the oldest
+   * ones are dropped if the rotations outpace the compression.
+   *
+   * It can be enabled on the command line with ``--qi-log-file``.
+   * \endverbatim
+   */
+  class QI_API RotatingFileLogHandler : private boost::noncopyable
+  {
+  public:
+    /**
+     * \brief Open the file, truncating it.
+     * \param filePath path to the file.
+     * \param options buffering and rotation settings.
+     *
+     * \verbatim
+     * .. warning::
+     *
+     *      If the file could not be opened, it logs a warning and every log call
+     *      will silently fail.
+     * \endverbatim
+     */
+    explicit RotatingFileLogHandler(const std::string& filePath,
+                                    const RotatingFileLogOptions& options = RotatingFileLogOptions());
+
+    /**
+     * \brief Write the buffered logs and close the file.
+     */
+    ~RotatingFileLogHandler();
+
+    /**
+     * \brief Buffer the log message, and write the buffer if needed.
+     *
+     * Same parameters as qi::log::Handler.
+     */
+    void log(const qi::LogLevel verb,
+             const qi::Clock::time_point date,
+             const qi::SystemClock::time_point systemDate,
+             const char* category,
+             const char* msg,
+             const char* file,
+             const char* fct,
+             const int line);
+
+    /**
+     * \brief Write the buffered logs to the file.
+     */
+    void flush();
+
+  private:
+    std::unique_ptr<PrivateRotatingFileLogHandler> _p;
+  };
+
+} // !log
+} // !qi
+
+#endif // _QI_LOG_ROTATINGFILELOGHANDLER_HPP_
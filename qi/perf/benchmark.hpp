@@ -0,0 +1,139 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#pragma once
+#ifndef _QI_PERF_BENCHMARK_HPP_
+#define _QI_PERF_BENCHMARK_HPP_
+
+#include <string>
+#include <vector>
+
+#include <qi/api.hpp>
+#include <qi/clock.hpp>
+#include <qi/perf/measure.hpp>
+
+namespace qi
+{
+  /// Statistics over the iterations of a benchmark. Times are in microseconds.
+  struct QI_API BenchmarkResult
+  {
+    std::string name;
+    std::string variable;
+    /// Size of the message processed by an iteration, 0 if not relevant.
+    unsigned long msgSize = 0;
+    unsigned long iterations = 0;
+    double mean = 0.;
+    double min = 0.;
+    double p50 = 0.;
+    double p99 = 0.;
+    double p999 = 0.;
+    double max = 0.;
+    /// CPU time of all the threads of the process, per iteration.
+    double cpu = 0.;
+    /// Heap allocations per iteration, -1 if they are not counted.
+    double allocations = -1.;
+
+    double msgPerSecond() const;
+    /// @return -1 if msgSize is 0.
+    double megaBytePerSecond() const;
+  };
+
+  struct BenchmarkOptions
+  {
+    /// Iterations run before measuring.
+    unsigned int warmup = 10;
+    /// Measured iterations.
+    unsigned int iterations = 1000;
+    /// File where the results are written: CSV if it ends with ".csv", JSON
+    /// otherwise. Nothing is written if empty.
+    std::string output;
+    /// JSON results of a previous run, to compare with. Ignored if empty.
+    std::string baseline;
+    /// Slow down of the median compared to the baseline, in percent, above
+    /// which a benchmark is reported as a regression.
+    double tolerance = 10.;
+  };
+
+  class BenchmarkSuitePrivate;
+
+  /** Run benchmarks, print their statistics, and write them for
+   * regression tracking.
+   *
+   * Each iteration is timed separately, which gives percentiles. Code shorter
+   * than a microsecond should be run several times per iteration, see
+   * `batch`.
+   *
+   * Heap allocations are counted if the executable uses
+   * QI_PERF_COUNT_ALLOCATIONS (see qi/perf/measure.hpp).
+   */
+  class QI_API BenchmarkSuite
+  {
+  public:
+    BenchmarkSuite(const std::string& projectName,
+                   const std::string& executableName,
+                   const BenchmarkOptions& options = BenchmarkOptions());
+    ~BenchmarkSuite();
+
+    BenchmarkSuite(const BenchmarkSuite&) = delete;
+    BenchmarkSuite& operator=(const BenchmarkSuite&) = delete;
+
+    /** Call `iteration` `batch` times per iteration, for the warm-up and
+     * measured iterations of the options.
+     * @return the statistics of the measured iterations.
+     */
+    template <typename F>
+    const BenchmarkResult& run(const std::string& name,
+                               F&& iteration,
+                               unsigned long msgSize = 0,
+                               unsigned int batch = 1,
+                               const std::string& variable = std::string());
+
+    /** Call `iteration` for the warm-up of the options, then `iterations`
+     * times, for scenarios whose number of iterations must be bounded
+     * separately (large payloads for instance).
+     * @param calls calls made by one `iteration`, the statistics are per call.
+     * @return the statistics of the measured iterations.
+     */
+    template <typename F>
+    const BenchmarkResult& run(const std::string& name,
+                               const std::string& variable,
+                               unsigned long msgSize,
+                               unsigned int iterations,
+                               unsigned int calls,
+                               F&& iteration);
+
+    /** Compute the statistics of measured iterations and record them.
+     * @param samples duration of each iteration.
+     * @param cpu CPU time of the process over all the iterations.
+     * @param allocations heap allocations over all the iterations, -1 if not counted.
+     * @param batch calls per iteration, the statistics are per call.
+     */
+    const BenchmarkResult& add(const std::string& name,
+                               const std::string& variable,
+                               unsigned long msgSize,
+                               std::vector<qi::Duration> samples,
+                               qi::Duration cpu,
+                               qi::int64_t allocations,
+                               unsigned int batch = 1);
+
+    const BenchmarkOptions& options() const;
+    const std::vector<BenchmarkResult>& results() const;
+
+    /** Write the results to the output file, and compare them with the baseline.
+     * @return the number of regressions.
+     */
+    unsigned int close();
+
+  private:
+    BenchmarkSuitePrivate* _p;
+  };
+
+  /// Read results written by BenchmarkSuite in JSON, throw on error.
+  QI_API std::vector<BenchmarkResult> readBenchmarkResults(const std::string& filename);
+}
+
+#include <qi/perf/detail/benchmark.hxx>
+
+#endif  // _QI_PERF_BENCHMARK_HPP_
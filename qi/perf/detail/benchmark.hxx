@@ -0,0 +1,96 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_PERF_DETAIL_BENCHMARK_HXX_
+#define _QI_PERF_DETAIL_BENCHMARK_HXX_
+
+#include <algorithm>
+#include <utility>
+#include <boost/program_options.hpp>
+
+namespace qi {
+
+  template <typename F>
+  const BenchmarkResult& BenchmarkSuite::run(const std::string& name,
+                                             F&& iteration,
+                                             unsigned long msgSize,
+                                             unsigned int batch,
+                                             const std::string& variable)
+  {
+    return run(name, variable, msgSize, options().iterations, batch, [&] {
+      for (unsigned int j = 0; j < batch; ++j)
+        iteration();
+    });
+  }
+
+  template <typename F>
+  const BenchmarkResult& BenchmarkSuite::run(const std::string& name,
+                                             const std::string& variable,
+                                             unsigned long msgSize,
+                                             unsigned int iterations,
+                                             unsigned int calls,
+                                             F&& iteration)
+  {
+    const unsigned int warmup = std::min(options().warmup, iterations);
+    for (unsigned int i = 0; i < warmup; ++i)
+      iteration();
+
+    std::vector<qi::Duration> samples;
+    samples.reserve(iterations);
+    const qi::Duration cpuStart = measure::getProcessCpuTime();
+    const qi::int64_t allocationsStart = measure::getAllocationCount();
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+      const qi::SteadyClock::time_point start = qi::SteadyClock::now();
+      iteration();
+      samples.push_back(qi::SteadyClock::now() - start);
+    }
+    const qi::int64_t allocationsStop = measure::getAllocationCount();
+    const qi::Duration cpu = measure::getProcessCpuTime() - cpuStart;
+
+    return add(name, variable, msgSize, std::move(samples), cpu,
+               allocationsStart < 0 ? -1 : allocationsStop - allocationsStart, calls);
+  }
+
+  namespace detail {
+
+    inline boost::program_options::options_description getBenchmarkOptions()
+    {
+      namespace po = boost::program_options;
+      po::options_description desc(std::string("Options for benchmarks"));
+      const BenchmarkOptions defaults;
+
+      desc.add_options()
+        ("output,o", po::value<std::string>()->default_value(""),
+         "Output file, CSV if it ends with .csv, JSON otherwise.")
+        ("warmup", po::value<unsigned int>()->default_value(defaults.warmup),
+         "Iterations run before measuring.")
+        ("iterations", po::value<unsigned int>()->default_value(defaults.iterations),
+         "Measured iterations.")
+        ("baseline", po::value<std::string>()->default_value(""),
+         "JSON output of a previous run to compare with.")
+        ("tolerance", po::value<double>()->default_value(defaults.tolerance),
+         "Slow down of the median, in percent, reported as a regression.");
+
+      return desc;
+    }
+
+    inline BenchmarkOptions getBenchmarkOptions(const boost::program_options::variables_map& vm)
+    {
+      BenchmarkOptions options;
+      options.output = vm["output"].as<std::string>();
+      options.warmup = vm["warmup"].as<unsigned int>();
+      options.iterations = vm["iterations"].as<unsigned int>();
+      options.baseline = vm["baseline"].as<std::string>();
+      options.tolerance = vm["tolerance"].as<double>();
+      return options;
+    }
+
+  }
+
+}
+
+#endif /* _QI_PERF_DETAIL_BENCHMARK_HXX_ */
@@ -0,0 +1,205 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_PERF_DETAIL_INSTRUMENTEDMUTEX_HPP_
+#define _QI_PERF_DETAIL_INSTRUMENTEDMUTEX_HPP_
+
+#include <cstddef>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <qi/api.hpp>
+#include <qi/clock.hpp>
+#include <qi/config.hpp>
+
+namespace qi
+{
+  namespace instrumentation
+  {
+    /// Parts of the runtime whose heap allocations are counted.
+    enum AllocationSubsystem
+    {
+      /// Heap storage of buffers, counted at each growth.
+      AllocationSubsystem_Buffer = 0,
+      /// Shared state of each promise.
+      AllocationSubsystem_Future,
+      /// Task queued on a strand.
+      AllocationSubsystem_StrandCallback,
+      /// Message queued for sending on a socket.
+      AllocationSubsystem_Message,
+      AllocationSubsystem_Count
+    };
+  }
+
+  namespace detail
+  {
+    namespace instrumentation
+    {
+      class LockCounter;
+
+      QI_API bool enabled();
+      QI_API LockCounter& lockCounter(const char* name);
+      QI_API void recordLock(LockCounter& counter, qi::Duration wait);
+      QI_API void recordHold(LockCounter& counter, qi::Duration hold);
+      QI_API void recordAllocation(qi::instrumentation::AllocationSubsystem subsystem, std::size_t bytes);
+
+      /// Counter of the lock named by `Name::name()`, looked up once.
+      template <typename Name>
+      LockCounter& counter()
+      {
+        static LockCounter& result = lockCounter(Name::name());
+        return result;
+      }
+
+      /** Mutex recording, while instrumentation is enabled, the time waited
+       * to acquire it and the time it is held.
+       *
+       * The hold time is measured from the outermost lock to the matching
+       * unlock, so that recursive mutexes are measured once per ownership.
+       */
+      template <typename Mutex, typename Name>
+      class Lockable
+      {
+      public:
+        using scoped_lock = boost::unique_lock<Lockable>;
+
+        Lockable() = default;
+        Lockable(const Lockable&) = delete;
+        Lockable& operator=(const Lockable&) = delete;
+
+        void lock()
+        {
+          if (!enabled())
+          {
+            _mutex.lock();
+            return;
+          }
+          LockCounter& c = counter<Name>();
+          if (_mutex.try_lock())
+            recordLock(c, qi::Duration::zero());
+          else
+          {
+            const qi::SteadyClock::time_point start = qi::SteadyClock::now();
+            _mutex.lock();
+            recordLock(c, qi::SteadyClock::now() - start);
+          }
+          acquired();
+        }
+
+        bool try_lock()
+        {
+          if (!_mutex.try_lock())
+            return false;
+          if (enabled())
+          {
+            recordLock(counter<Name>(), qi::Duration::zero());
+            acquired();
+          }
+          return true;
+        }
+
+        void unlock()
+        {
+          // Only the owner reaches this point: _depth is protected by the mutex.
+          if (_depth != 0 && --_depth == 0)
+            recordHold(counter<Name>(), qi::SteadyClock::now() - _acquiredAt);
+          _mutex.unlock();
+        }
+
+      protected:
+        void acquired()
+        {
+          if (_depth++ == 0)
+            _acquiredAt = qi::SteadyClock::now();
+        }
+
+        Mutex _mutex;
+
+      private:
+        unsigned int _depth = 0;
+        qi::SteadyClock::time_point _acquiredAt;
+      };
+
+      /// Shared mutex recording the exclusive locks as Lockable does, and the
+      /// time waited for the shared locks.
+      template <typename Name>
+      class SharedLockable : public Lockable<boost::shared_mutex, Name>
+      {
+      public:
+        void lock_shared()
+        {
+          if (!enabled())
+          {
+            this->_mutex.lock_shared();
+            return;
+          }
+          LockCounter& c = counter<Name>();
+          if (this->_mutex.try_lock_shared())
+            recordLock(c, qi::Duration::zero());
+          else
+          {
+            const qi::SteadyClock::time_point start = qi::SteadyClock::now();
+            this->_mutex.lock_shared();
+            recordLock(c, qi::SteadyClock::now() - start);
+          }
+        }
+
+        bool try_lock_shared()
+        {
+          if (!this->_mutex.try_lock_shared())
+            return false;
+          if (enabled())
+            recordLock(counter<Name>(), qi::Duration::zero());
+          return true;
+        }
+
+        void unlock_shared()
+        {
+          this->_mutex.unlock_shared();
+        }
+      };
+    }
+
+    /* Mutex types of the runtime locks that can be instrumented. Without
+     * QI_WITH_INSTRUMENTATION they are the plain mutex types.
+     *
+     * `Name` is a type with a static `const char* name()`, see
+     * QI_INSTRUMENTATION_LOCK_NAME.
+     */
+#ifdef QI_WITH_INSTRUMENTATION
+    template <typename Mutex, typename Name>
+    using InstrumentedMutex = instrumentation::Lockable<Mutex, Name>;
+    template <typename Name>
+    using InstrumentedSharedMutex = instrumentation::SharedLockable<Name>;
+#else
+    template <typename Mutex, typename Name>
+    using InstrumentedMutex = Mutex;
+    template <typename Name>
+    using InstrumentedSharedMutex = boost::shared_mutex;
+#endif
+  }
+}
+
+/// Define the type `Type` naming a lock for InstrumentedMutex.
+#define QI_INSTRUMENTATION_LOCK_NAME(Type, lockName) \
+  struct Type                                        \
+  {                                                  \
+    static const char* name() { return lockName; }   \
+  }
+
+/// Count an allocation of `bytes` for `subsystem`, a qi::instrumentation::AllocationSubsystem.
+#ifdef QI_WITH_INSTRUMENTATION
+# define QI_INSTRUMENT_ALLOCATION(subsystem, bytes)                              \
+  do                                                                             \
+  {                                                                              \
+    if (::qi::detail::instrumentation::enabled())                                \
+      ::qi::detail::instrumentation::recordAllocation(                           \
+          ::qi::instrumentation::subsystem, bytes);                              \
+  } while (0)
+#else
+# define QI_INSTRUMENT_ALLOCATION(subsystem, bytes) ((void)0)
+#endif
+
+#endif  // _QI_PERF_DETAIL_INSTRUMENTEDMUTEX_HPP_
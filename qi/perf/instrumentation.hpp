@@ -0,0 +1,96 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_PERF_INSTRUMENTATION_HPP_
+#define _QI_PERF_INSTRUMENTATION_HPP_
+
+#include <string>
+#include <vector>
+#include <qi/api.hpp>
+#include <qi/types.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/perf/detail/instrumentedmutex.hpp>
+
+namespace qi
+{
+  class Session;
+
+  /** Contention of the runtime locks and heap allocations of its subsystems.
+   *
+   * Instrumentation is compiled in with the QI_WITH_INSTRUMENTATION CMake
+   * option, and enabled at runtime by setting the QI_INSTRUMENTATION
+   * environment variable to 1. Without the option the locks are the plain
+   * mutex types and the counting sites are empty.
+   *
+   * The instrumented locks are:
+   * - "qi.future": state of each future;
+   * - "qi.signal": subscribers of each signal;
+   * - "qi.strand": queue of each strand;
+   * - "qi.type.registry": the type registry, taken by getType;
+   * - "qi.servicedirectory.state" and "qi.servicedirectory.write": the service
+   *   directory.
+   */
+  namespace instrumentation
+  {
+    /// Buckets of LockStats::waitHistogram. Bucket 0 counts the waits shorter
+    /// than 1us, bucket i the waits in [2^(i-1), 2^i) us, and the last one all
+    /// the longer waits.
+    const unsigned int waitHistogramSize = 24;
+
+    /// Statistics of all the mutexes sharing a name. Times are in nanoseconds.
+    struct LockStats
+    {
+      std::string name;
+      qi::uint64_t acquisitions = 0;
+      /// Acquisitions that found the mutex locked.
+      qi::uint64_t contentions = 0;
+      qi::uint64_t waitTotal = 0;
+      qi::uint64_t waitMax = 0;
+      qi::uint64_t holdTotal = 0;
+      qi::uint64_t holdMax = 0;
+      std::vector<qi::uint64_t> waitHistogram;
+    };
+
+    struct AllocationStats
+    {
+      std::string subsystem;
+      qi::uint64_t count = 0;
+      qi::uint64_t bytes = 0;
+    };
+
+    struct Snapshot
+    {
+      bool enabled = false;
+      std::vector<LockStats> locks;
+      std::vector<AllocationStats> allocations;
+    };
+
+    /// @return whether libqi was built with QI_WITH_INSTRUMENTATION.
+    QI_API bool isCompiled();
+    /// @return whether the counters are updated.
+    QI_API bool isEnabled();
+    /// Start or stop updating the counters. Without QI_WITH_INSTRUMENTATION,
+    /// this has no effect.
+    QI_API void setEnabled(bool enabled);
+    /// @return the counters since the start of the process or the last reset.
+    QI_API Snapshot snapshot();
+    QI_API void reset();
+    QI_API const char* subsystemName(AllocationSubsystem subsystem);
+
+    /** Register the "qi.Introspection" service on `session`, with the
+     * methods snapshot, reset, isEnabled and setEnabled.
+     * @return the id of the service.
+     */
+    QI_API qi::Future<unsigned int> registerIntrospectionService(qi::Session& session);
+  }
+}
+
+QI_TYPE_STRUCT(qi::instrumentation::LockStats, name, acquisitions, contentions,
+               waitTotal, waitMax, holdTotal, holdMax, waitHistogram);
+QI_TYPE_STRUCT(qi::instrumentation::AllocationStats, subsystem, count, bytes);
+QI_TYPE_STRUCT(qi::instrumentation::Snapshot, enabled, locks, allocations);
+
+#endif  // _QI_PERF_INSTRUMENTATION_HPP_
@@ -9,7 +9,12 @@
 #ifndef _QI_PERF_UTILS_HPP_
 #define _QI_PERF_UTILS_HPP_
 
+#include <cstdlib>
+#include <new>
+
 #include <qi/api.hpp>
+#include <qi/clock.hpp>
+#include <qi/types.hpp>
 
 namespace qi
 {
@@ -17,7 +22,37 @@ namespace qi
   {
     // Get the number of fd currently open. Works only for linux.
     QI_API int getNumFD();
+
+    // Get the CPU time used by all the threads of the process, user and system.
+    QI_API qi::Duration getProcessCpuTime();
+
+    // Get the number of heap allocations of the process, or -1 if the
+    // executable does not count them with QI_PERF_COUNT_ALLOCATIONS.
+    QI_API qi::int64_t getAllocationCount();
+
+    namespace detail
+    {
+      QI_API void countAllocation();
+    }
   }
 }
 
+/* Replace the global operator new of the executable, to count the heap
+ * allocations of the process. Use it once, at global scope, in a benchmark
+ * executable only: every allocation then updates a shared counter.
+ */
+#define QI_PERF_COUNT_ALLOCATIONS()                                                   \
+  void* operator new(std::size_t size)                                                \
+  {                                                                                   \
+    ::qi::measure::detail::countAllocation();                                         \
+    if (void* ptr = std::malloc(size ? size : 1))                                     \
+      return ptr;                                                                     \
+    throw std::bad_alloc();                                                           \
+  }                                                                                   \
+  void* operator new[](std::size_t size) { return ::operator new(size); }             \
+  void operator delete(void* ptr) noexcept { std::free(ptr); }                        \
+  void operator delete[](void* ptr) noexcept { std::free(ptr); }                      \
+  void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }           \
+  void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
 #endif
@@ -88,6 +88,15 @@ namespace qi {
                                             const std::string& protocol,
                                             qi::MilliSeconds timeout);
 
+    /// Returns the asked services, the n-th future being the n-th service.
+    ///
+    /// The services are resolved together: their information is fetched from
+    /// the service directory in a single request, then the connections and
+    /// the metaobjects are fetched concurrently.
+    /// If the timeout triggers, the futures that are not set are canceled.
+    std::vector<qi::Future<qi::AnyObject>> resolveServices(const std::vector<std::string>& names,
+                                                           qi::MilliSeconds timeout = defaultServiceTimeout());
+
     //Server
     qi::FutureSync<void> listen(const qi::Url &address);
     std::vector<qi::Url> endpoints() const;
@@ -7,6 +7,9 @@
 #ifndef _QI_SIGNAL_HPP_
 #define _QI_SIGNAL_HPP_
 
+#include <memory>
+#include <typeinfo>
+#include <vector>
 #include <boost/function.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <qi/atomic.hpp>
@@ -35,6 +38,10 @@ namespace qi {
 
   using SignalLink = qi::uint64_t;
 
+  namespace detail
+  {
+    template<typename T> class BounceToSignalBase;
+  }
 
   /// SignalBase provides a signal subscription mechanism called "connection".
   /// Derived classes can customize the subscription step by setting
@@ -126,6 +133,9 @@ namespace qi {
     *        chose between synchronous and asynchronous call.
     *        The combination rule is to honor subscriber's override, then \p callType,
     *        then signal's callType and default to asynchronous
+    *
+    * The operator() of SignalF calls the subscribers without going through
+    * this function, unless a trigger override is set.
     */
     virtual void trigger(const GenericFunctionParameters& params, MetaCallType callType = MetaCallType_Auto);
     /// Set the MetaCallType used by operator()().
@@ -160,9 +170,25 @@ namespace qi {
     ExecutionContext* executionContext() const;
     void clearExecutionContext();
 
+    /** Subscribers to call for an emission, in the order of their connection.
+     * @param callType set to the call type of the emission.
+     * @return null if a trigger override is set: the emission must then go
+     * through trigger().
+     */
+    std::shared_ptr<const std::vector<SignalSubscriber>> emissionSubscribers(MetaCallType& callType);
+    /** Call one subscriber of an emission.
+     * @param paramsCopy copy of params shared by the asynchronous calls of the
+     * emission, made by the first of them.
+     */
+    void callSubscriber(const SignalSubscriber& subscriber,
+                        const GenericFunctionParameters& params,
+                        MetaCallType callType,
+                        std::shared_ptr<GenericFunctionParameters>& paramsCopy);
+
   protected:
     boost::shared_ptr<SignalBasePrivate> _p;
     friend class SignalBasePrivate;
+    template<typename T> friend class detail::BounceToSignalBase;
   };
 
   template <typename... P> class Signal;
@@ -270,6 +296,8 @@ QI_WARNING_POP()
     friend class ManageablePrivate;
     friend class SignalBase;
     friend class SignalBasePrivate;
+    template<typename T> friend class SignalF;
+    template<typename T> friend class detail::BounceToSignalBase;
 
     SignalSubscriber();
 
@@ -311,6 +339,17 @@ QI_WARNING_POP()
 
     void callImpl(const GenericFunctionParameters& args);
 
+    // Handler of function type T set by SignalF<T>::connect, or null.
+    template<typename T>
+    const boost::function<T>* typedHandler() const;
+
+    // Call `f` in place of the handler, with the rules of callImpl.
+    template<typename F>
+    void callTyped(F&& f);
+
+    void onPointerLockFailure();
+    static void onException(const char* what);
+
     boost::optional<ExecutionContext*> executionContextFor(MetaCallType callType) const;
 
     // Call the subscriber with the given arguments, which can be passed by
@@ -345,6 +384,11 @@ QI_WARNING_POP()
     //   Mode 1: Direct functor call
     AnyFunction handler;
     MetaCallType threadingModel = MetaCallType_Direct;
+    // Same function as handler if it was connected to a SignalF, as a
+    // boost::function<T> where T is given by typedHandlerType. It lets the
+    // signal call it without converting the arguments.
+    std::shared_ptr<void> typedHandler;
+    const std::type_info* typedHandlerType = nullptr;
 
     //   Mode 2: metaCall
     boost::scoped_ptr<AnyWeakObject> target;
@@ -140,6 +140,8 @@ namespace qi {
     const std::string& toString() const;
 
     /** Tell if arguments with this signature can be converted to \p b.
+     * The score of signatures constructed from strings is computed once per
+     * pair of strings.
      * @return 0 if conversion is impossible, or a score in ]0,1] indicating
      * the amount of type mismatch (the closer signatures are the bigger)
      */
@@ -150,6 +152,9 @@ namespace qi {
     // C4251
     boost::shared_ptr<SignaturePrivate> _p;
 
+  private:
+    float computeConvertibility(const Signature& b) const;
+
     friend QI_API bool operator==(const Signature &lhs, const Signature &rhs);
   };
 
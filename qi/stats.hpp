@@ -10,6 +10,10 @@
 
 # include <sstream>
 # include <algorithm>
+# include <cmath>
+# include <utility>
+# include <vector>
+# include <qi/types.hpp>
 
 namespace qi
 {
@@ -74,6 +78,140 @@ namespace qi
     float _cumulatedValue;
   };
 
+  /** Distribution of durations, counted in buckets of exponentially growing width.
+   *
+   * Bucket 0 counts the durations shorter than 1us. Each following power of
+   * two of microseconds, [2^k, 2^(k+1)), is split in `subBuckets` buckets of
+   * equal width, up to 2^`octaves` us (about 71 minutes), and the last bucket
+   * counts the longer durations. Percentiles are thus estimated within
+   * 1/(2 * `subBuckets`) of their value.
+   */
+  class DurationHistogram
+  {
+  public:
+    static const unsigned int subBuckets = 4;
+    static const unsigned int octaves = 32;
+    static const unsigned int bucketCount = octaves * subBuckets + 2;
+
+    DurationHistogram() {}
+    /// \param counts Number of durations of each bucket.
+    explicit DurationHistogram(const std::vector<qi::uint64_t>& counts)
+      : _counts(counts)
+    {
+      // The counts may come from another process: the extra buckets are
+      // counted in the last one, with the longest durations.
+      if (_counts.size() > bucketCount)
+      {
+        for (std::size_t i = bucketCount; i < _counts.size(); ++i)
+          _counts[bucketCount - 1] += _counts[i];
+        _counts.resize(bucketCount);
+      }
+    }
+
+    /// Number of durations of each bucket, empty if no duration was pushed.
+    const std::vector<qi::uint64_t>& counts() const { return _counts;}
+
+    /// Count a duration of \p seconds.
+    void push(float seconds)
+    {
+      if (_counts.empty())
+        _counts.resize(bucketCount);
+      const float us = seconds * 1e6f;
+      // NaN counts as 0, and the durations too long to convert, infinity
+      // included, in the last bucket.
+      const float longest = static_cast<float>(qi::uint64_t(1) << octaves);
+      ++_counts[bucket(us > 0 ? static_cast<qi::uint64_t>((std::min)(us, longest)) : 0)];
+    }
+
+    /// Add the durations counted by \p other.
+    void merge(const DurationHistogram& other)
+    {
+      if (_counts.size() < other._counts.size())
+        _counts.resize(other._counts.size());
+      for (std::size_t i = 0; i < other._counts.size(); ++i)
+        _counts[i] += other._counts[i];
+    }
+
+    /// Number of durations pushed.
+    qi::uint64_t count() const
+    {
+      qi::uint64_t total = 0;
+      for (qi::uint64_t c : _counts)
+        total += c;
+      return total;
+    }
+
+    /**
+     * \brief Estimate a percentile of the durations.
+     * \param fraction Fraction of the durations, in [0, 1]: 0.5 for the
+     *        median, 0.99 for the 99th percentile.
+     * \return The duration in seconds that \p fraction of the durations
+     *         do not exceed, taken in the middle of its bucket, or 0 if no
+     *         duration was pushed.
+     */
+    float percentile(float fraction) const
+    {
+      const qi::uint64_t total = count();
+      if (total == 0)
+        return 0;
+      const double clamped = (std::min)((std::max)(double(fraction), 0.), 1.);
+      const qi::uint64_t rank = (std::max)(static_cast<qi::uint64_t>(std::ceil(clamped * total)),
+                                           static_cast<qi::uint64_t>(1));
+      qi::uint64_t seen = 0;
+      std::size_t i = 0;
+      for (; i < _counts.size() - 1; ++i)
+      {
+        seen += _counts[i];
+        if (seen >= rank)
+          break;
+      }
+      // Durations are measured in microseconds: shorter ones are reported as 0.
+      if (i == 0)
+        return 0;
+      if (i == bucketCount - 1)
+        return lowerBound(i) / 1e6f;
+      return (lowerBound(i) + lowerBound(i + 1)) / 2e6f;
+    }
+
+    /// Forget all the durations.
+    void reset()
+    {
+      _counts.clear();
+    }
+
+    /// \return The bucket of a duration of \p us microseconds.
+    static unsigned int bucket(qi::uint64_t us)
+    {
+      if (us == 0)
+        return 0;
+      unsigned int octave = 0;
+      while (octave < octaves && (us >> (octave + 1)) != 0)
+        ++octave;
+      if (octave == octaves)
+        return bucketCount - 1;
+      // The bits following the highest one select the sub-bucket.
+      const unsigned int subBits = 2;
+      const qi::uint64_t sub = octave >= subBits
+        ? (us >> (octave - subBits)) & (subBuckets - 1)
+        : (us << (subBits - octave)) & (subBuckets - 1);
+      return 1 + octave * subBuckets + static_cast<unsigned int>(sub);
+    }
+
+    /// \return The shortest duration, in microseconds, counted by \p bucket.
+    static float lowerBound(std::size_t bucket)
+    {
+      if (bucket == 0)
+        return 0;
+      bucket = (std::min)(bucket, std::size_t(bucketCount - 1));
+      const std::size_t octave = (bucket - 1) / subBuckets;
+      const std::size_t sub = (bucket - 1) % subBuckets;
+      return static_cast<float>(qi::uint64_t(1) << octave) * (1.f + float(sub) / subBuckets);
+    }
+
+  private:
+    std::vector<qi::uint64_t> _counts;
+  };
+
   /// Store statistics about method calls.
   class MethodStatistics
   {
@@ -109,6 +247,24 @@ namespace qi
       _system.push(system, _count==0);
       ++_count;
     }
+    /**
+     * \brief Add the values pushed to \p other, as if they were pushed to this one.
+     * \param other Statistics to add.
+     */
+    void merge(const MethodStatistics& other)
+    {
+      if (other._count == 0)
+        return;
+      if (_count == 0)
+      {
+        *this = other;
+        return;
+      }
+      _wall = merged(_wall, other._wall);
+      _user = merged(_user, other._user);
+      _system = merged(_system, other._system);
+      _count += other._count;
+    }
     /**
      * \brief Get wall MinMaxSum value.
      * \return Return MinMaxSum value.
@@ -140,11 +296,86 @@ namespace qi
       _system.reset();
     }
   private:
+    static MinMaxSum merged(const MinMaxSum& a, const MinMaxSum& b)
+    {
+      return MinMaxSum((std::min)(a.minValue(), b.minValue()),
+                       (std::max)(a.maxValue(), b.maxValue()),
+                       a.cumulatedValue() + b.cumulatedValue());
+    }
+
     unsigned int _count;
     MinMaxSum _wall;
     MinMaxSum _user;
     MinMaxSum _system;
   };
+
+  /// Distributions of the durations of method calls, next to their MethodStatistics.
+  class MethodHistograms
+  {
+  public:
+    MethodHistograms() {}
+    /**
+     * \brief Constructor and Set.
+     * \param wall Distribution of the wall values.
+     * \param user Distribution of the user values.
+     * \param system Distribution of the system values.
+     */
+    MethodHistograms(DurationHistogram wall, DurationHistogram user, DurationHistogram system)
+      : _wall(std::move(wall)), _user(std::move(user)), _system(std::move(system))
+    {}
+
+    /**
+     * \brief Add value for all tree distributions.
+     * \param wall Wall value to add.
+     * \param user User value to add.
+     * \param system System value to add.
+     */
+    void push(float wall, float user, float system)
+    {
+      _wall.push(wall);
+      _user.push(user);
+      _system.push(system);
+    }
+    /**
+     * \brief Add the values pushed to \p other, as if they were pushed to this one.
+     * \param other Distributions to add.
+     */
+    void merge(const MethodHistograms& other)
+    {
+      _wall.merge(other._wall);
+      _user.merge(other._user);
+      _system.merge(other._system);
+    }
+    /**
+     * \brief Get the distribution of the wall values, for instance to read
+     *        their median with `wall().percentile(0.5f)`.
+     * \return Return DurationHistogram value.
+     */
+    const DurationHistogram& wall() const   { return _wall;}
+    /**
+     * \brief Get the distribution of the user values.
+     * \return Return DurationHistogram value.
+     */
+    const DurationHistogram& user() const   { return _user;}
+    /**
+     * \brief Get the distribution of the system values.
+     * \return Return DurationHistogram value.
+     */
+    const DurationHistogram& system() const { return _system;}
+    /**
+     * \brief Forget the values of all 3 distributions.
+     */
+    void reset()
+    {
+      _wall.reset();
+      _user.reset();
+      _system.reset();
+    }
+  private:
+    DurationHistogram _wall;
+    DurationHistogram _user;
+    DurationHistogram _system;
+  };
 }
 
 #endif // !_QI_STATS_HPP_
@@ -16,6 +16,7 @@
 #include <qi/config.hpp>
 #include <qi/detail/executioncontext.hpp>
 #include <qi/detail/futureunwrap.hpp>
+#include <qi/perf/detail/instrumentedmutex.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
@@ -38,6 +39,8 @@ namespace detail
 
   template <typename F>
   struct StrandedUnwrapped;
+
+  QI_INSTRUMENTATION_LOCK_NAME(StrandLockName, "qi.strand");
 }
 
 // we use ExecutionContext's helpers in schedulerFor, we don't need to implement all the methods
@@ -49,13 +52,14 @@ public:
   struct Callback;
 
   using Queue = std::deque<boost::shared_ptr<Callback>>;
+  using Mutex = detail::InstrumentedMutex<boost::recursive_mutex, detail::StrandLockName>;
 
   qi::ExecutionContext& _executor;
   std::atomic<unsigned int> _curId;
   std::atomic<unsigned int> _aliveCount;
   bool _processing; // protected by mutex, no need for atomic
   std::atomic<int> _processingThread;
-  boost::recursive_mutex _mutex;
+  Mutex _mutex;
   boost::condition_variable_any _processFinished;
   bool _dying;
   Queue _queue;
@@ -96,7 +100,7 @@ public:
 
   using ExecutionContext::async;
 private:
-  void stopProcess(boost::recursive_mutex::scoped_lock& lock,
+  void stopProcess(Mutex::scoped_lock& lock,
                    bool finished);
 
   bool joined = false;
@@ -7,6 +7,7 @@
 #ifndef _QITYPE_DETAIL_TYPELIST_HXX_
 #define _QITYPE_DETAIL_TYPELIST_HXX_
 
+#include <type_traits>
 #include <qi/atomic.hpp>
 
 #include <qi/type/detail/anyreference.hpp>
@@ -27,6 +28,8 @@ public:
   AnyIterator begin(void* storage) override;
   AnyIterator end(void* storage) override;
   void pushBack(void** storage, void* valueStorage) override;
+  void* emplaceBack(void** storage) override;
+  bool forEach(void* storage, ListTypeInterface::ElementCallback callback, void* context) override;
   _QI_BOUNCE_TYPE_METHODS(MethodsImpl);
   TypeInterface* _elementType;
 };
@@ -101,6 +104,29 @@ namespace detail
   {
     container.insert(*element);
   }
+
+  // Sets cannot be modified in place, and elements that are not default
+  // constructible cannot be emplaced.
+  template<typename T>
+  typename std::enable_if<std::is_default_constructible<typename T::value_type>::value,
+                          typename T::value_type*>::type
+  emplaceBack(T& container)
+  {
+    container.emplace_back();
+    return &container.back();
+  }
+  template<typename T>
+  typename std::enable_if<!std::is_default_constructible<typename T::value_type>::value,
+                          typename T::value_type*>::type
+  emplaceBack(T&)
+  {
+    return nullptr;
+  }
+  template<typename CE>
+  CE* emplaceBack(std::set<CE>&)
+  {
+    return nullptr;
+  }
 }
 template<typename T, typename H>
 void ListTypeInterfaceImpl<T, H>::pushBack(void **storage, void* valueStorage)
@@ -109,6 +135,16 @@ void ListTypeInterfaceImpl<T, H>::pushBack(void **storage, void* valueStorage)
   detail::pushBack(*ptr, (typename T::value_type*)_elementType->ptrFromStorage(&valueStorage));
 }
 
+template<typename T, typename H>
+void* ListTypeInterfaceImpl<T, H>::emplaceBack(void** storage)
+{
+  T* ptr = (T*) ptrFromStorage(storage);
+  typename T::value_type* element = detail::emplaceBack(*ptr);
+  if (!element)
+    return nullptr;
+  return _elementType->initializeStorage(element);
+}
+
 template<typename T, typename H>
 size_t ListTypeInterfaceImpl<T, H>::size(void* storage)
 {
@@ -116,6 +152,18 @@ size_t ListTypeInterfaceImpl<T, H>::size(void* storage)
   return ptr->size();
 }
 
+template<typename T, typename H>
+bool ListTypeInterfaceImpl<T, H>::forEach(void* storage, ListTypeInterface::ElementCallback callback, void* context)
+{
+  T* ptr = (T*) ptrFromStorage(&storage);
+  for (const auto& element : *ptr)
+  {
+    void* elementPtr = const_cast<void*>(static_cast<const void*>(&element));
+    callback(context, AnyReference(_elementType, _elementType->initializeStorage(elementPtr)));
+  }
+  return true;
+}
+
 // There is no way to register a template container type :(
 template<typename T> struct TypeImpl<std::vector<T> >: public ListTypeInterfaceImpl<std::vector<T> >
 {
@@ -157,6 +205,13 @@ public:
     void* vstor = adaptStorage(storage);
     BaseClass::pushBack(&vstor, valueStorage);
   }
+  void* emplaceBack(void** storage) override {
+    void* vstor = adaptStorage(storage);
+    return BaseClass::emplaceBack(&vstor);
+  }
+  bool forEach(void* storage, ListTypeInterface::ElementCallback callback, void* context) override {
+    return BaseClass::forEach(adaptStorage(&storage), callback, context);
+  }
 
   //ListTypeInterface* _list;
 };
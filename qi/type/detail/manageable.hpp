@@ -96,12 +96,20 @@ QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MinMaxSum,
   ("maxValue",       maxValue),
   ("cumulatedValue", cumulatedValue));
 
+QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::DurationHistogram,
+  ("counts", counts));
+
 QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MethodStatistics,
   ("count",  count),
   ("wall",   wall),
   ("user",   user),
   ("system", system));
 
+QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::MethodHistograms,
+  ("wall",   wall),
+  ("user",   user),
+  ("system", system));
+
 QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR(qi::EventTrace,
   ("id",            id),
   ("kind",          kind),
@@ -118,6 +126,7 @@ QI_TYPE_STRUCT(qi::os::timeval, tv_sec, tv_usec);
 namespace qi {
 
   using ObjectStatistics = std::map<unsigned int, MethodStatistics>;
+  using ObjectHistograms = std::map<unsigned int, MethodHistograms>;
 /** Per-instance context.
   */
   class QI_API Manageable
@@ -145,9 +154,29 @@ namespace qi {
     bool isStatsEnabled() const;
     /// Set statistics gathering status
     void enableStats(bool enable);
-    /// Push statistics information about \p slotId.
+    ///@return if the user and system times of the calls are measured
+    bool isStatsCpuTimeEnabled() const;
+    /** Set whether the statistics measure the user and system times of the
+     * calls, enabled by default. Measuring them costs two system calls per
+     * call: when disabled, only the wall time is measured and the user and
+     * system times are pushed as 0.
+     */
+    void enableStatsCpuTime(bool enable);
+    /** Push statistics information about \p slotId.
+     *
+     * The statistics are kept in shards, selected by the calling thread, so
+     * that threads pushing concurrently do not wait for each other.
+     */
     void pushStats(int slotId, float wallTime, float userTime, float systemTime);
+    /// @return the statistics of all the slots, merged from all the shards.
     ObjectStatistics stats() const;
+    /** @return the distributions of the durations of all the slots, merged
+     * from all the shards, for instance to read their 99th percentile with
+     * `statsHistograms()[slotId].wall().percentile(0.99f)`.
+     *
+     * They are served apart from stats(), whose format older peers expect.
+     */
+    ObjectHistograms statsHistograms() const;
     /// Reset all statistical data
     void clearStats();
 
@@ -23,6 +23,7 @@ public:
   AnyIterator end(void* storage) override;
   void insert(void** storage, void* keyStorage, void* valueStorage) override;
   AnyReference element(void** storage, void* keyStorage, bool autoInsert) override;
+  bool forEach(void* storage, ElementCallback callback, void* context) override;
   _QI_BOUNCE_TYPE_METHODS(MethodsImpl);
   TypeInterface* _keyType;
   TypeInterface* _elementType;
@@ -106,6 +107,21 @@ MapTypeInterfaceImpl<M>::element(void** storage, void* keyStorage, bool autoInse
 
 
 
+template<typename M> bool
+MapTypeInterfaceImpl<M>::forEach(void* storage, ElementCallback callback, void* context)
+{
+  M* ptr = (M*) ptrFromStorage(&storage);
+  for (const auto& entry : *ptr)
+  {
+    void* key = const_cast<void*>(static_cast<const void*>(&entry.first));
+    void* value = const_cast<void*>(static_cast<const void*>(&entry.second));
+    callback(context,
+             AnyReference(_keyType, _keyType->initializeStorage(key)),
+             AnyReference(_elementType, _elementType->initializeStorage(value)));
+  }
+  return true;
+}
+
 template<typename K, typename V, typename C, typename A>
 struct TypeImpl<std::map<K,V, C, A> >: public MapTypeInterfaceImpl<std::map<K, V,C,A> > {};
 
@@ -137,10 +137,22 @@ namespace detail {
     {
       return go()->enableStats(enable);
     }
+    inline bool isStatsCpuTimeEnabled() const
+    {
+      return go()->isStatsCpuTimeEnabled();
+    }
+    inline void enableStatsCpuTime(bool enable) const
+    {
+      return go()->enableStatsCpuTime(enable);
+    }
     inline ObjectStatistics stats() const
     {
       return go()->stats();
     }
+    inline ObjectHistograms statsHistograms() const
+    {
+      return go()->statsHistograms();
+    }
     inline void clearStats() const
     {
       return go()->clearStats();
@@ -7,6 +7,11 @@
 #ifndef _QITYPE_DETAIL_SIGNAL_HXX_
 #define _QITYPE_DETAIL_SIGNAL_HXX_
 
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <ka/functional.hpp>
 #include <qi/trackable.hpp>
 #include <qi/type/detail/manageable.hpp>
 #include <boost/bind.hpp>
@@ -14,6 +19,47 @@
 
 namespace qi
 {
+  namespace detail
+  {
+    template<typename F, typename... Args>
+    struct IsCallableWith
+    {
+      template<typename G>
+      static auto test(int) -> decltype(std::declval<G&>()(std::declval<Args>()...), std::true_type());
+      template<typename G>
+      static std::false_type test(...);
+      static const bool value = decltype(test<F>(0))::value;
+    };
+
+    // Function types of the typed handlers of SignalF<T>. Arguments that the
+    // signal takes by value are given by const reference to the callables
+    // accepting it, so that an emission copies them only for the subscribers
+    // taking them by value.
+    template<typename T> struct SignalHandlerType;
+    template<typename... P>
+    struct SignalHandlerType<void(P...)>
+    {
+      using ConstRef = void(const typename std::decay<P>::type&...);
+      template<typename F>
+      using For = typename std::conditional<
+        IsCallableWith<F, const typename std::decay<P>::type&...>::value, ConstRef, void(P...)>::type;
+    };
+
+    // Calls the typed handler of a subscriber from its AnyFunction, so that
+    // both emission paths share the same instance of the callable.
+    template<typename Handler>
+    struct ForwardToSignalHandler
+    {
+      std::shared_ptr<boost::function<Handler>> handler;
+
+      template<typename... A>
+      void operator()(A&&... args) const
+      {
+        (*handler)(std::forward<A>(args)...);
+      }
+    };
+  } // detail
+
   template <typename T>
   template <typename F, typename Arg0, typename... Args>
   SignalSubscriber SignalF<T>::connect(F&& func, Arg0&& arg0, Args&&... args)
@@ -96,10 +142,18 @@ namespace qi
   template<typename F>
   SignalSubscriber SignalF<T>::connect(F c)
   {
-    SignalSubscriber sub = connect(qi::AnyFunction::from(boost::function<T>(std::move(c))));
+    using Handler = typename detail::SignalHandlerType<T>::template For<F>;
+    auto handler = std::make_shared<boost::function<Handler>>(std::move(c));
+    boost::function<T> f(detail::ForwardToSignalHandler<Handler>{handler});
+    auto execContext = executionContext();
+    SignalSubscriber sub = execContext
+      ? SignalSubscriber(qi::AnyFunction::from(std::move(f)), execContext)
+      : SignalSubscriber(qi::AnyFunction::from(std::move(f)), MetaCallType_Auto);
+    sub._p->typedHandler = std::move(handler);
+    sub._p->typedHandlerType = &typeid(Handler);
     if (detail::IsAsyncBind<F>::value)
       sub.setCallType(MetaCallType_Direct);
-    return sub;
+    return SignalBase::connect(sub);
   }
   template<typename T>
   SignalSubscriber SignalF<T>::connect(const AnyObject& obj, const std::string& slot)
@@ -125,27 +179,118 @@ namespace qi
     {
     }
   };
-  #define pushArg(z, n, _) \
-    args.push_back(AutoAnyReference(p ##n));
-  #define makeBounce(n, argstypedecl, argstype, argsdecl, argsues, comma)     \
-  template<typename R comma argstypedecl> \
-  class BounceToSignalBase<R(argstype)>  {  \
-  public:                      \
-    BounceToSignalBase(SignalBase& signalBase) : signalBase(signalBase) {} \
-    R operator()(argsdecl) {   \
-      AnyReferenceVector args; \
-      BOOST_PP_REPEAT(n, pushArg, _);    \
-      signalBase.trigger(args);          \
-    }                                    \
-  private:                               \
-    SignalBase& signalBase;              \
+
+  /* Emits the signal for SignalF<void(P...)>::operator().
+   *
+   * The subscribers connected with a callable to a signal of the same type
+   * are called directly with the arguments. The others are called with the
+   * arguments converted to AnyReference, as trigger() would.
+   */
+  template<typename... P>
+  class BounceToSignalBase<void(P...)>
+  {
+  public:
+    BounceToSignalBase(SignalBase& signalBase) : signalBase(signalBase) {}
+
+    void operator()(P... p)
+    {
+      MetaCallType callType = MetaCallType_Auto;
+      const auto subscribers = signalBase.emissionSubscribers(callType);
+      if (!subscribers)
+      {
+        signalBase.trigger(AnyReferenceVector{AutoAnyReference(p)...});
+        return;
+      }
+
+      std::shared_ptr<Arguments> argsCopy;
+      GenericFunctionParameters params;
+      bool hasParams = false;
+      std::shared_ptr<GenericFunctionParameters> paramsCopy;
+      for (const SignalSubscriber& subscriber : *subscribers)
+      {
+        if (const auto* handler = subscriber.template typedHandler<typename HandlerType::ConstRef>())
+          callTypedSubscriber(subscriber, *handler, callType, argsCopy, p...);
+        else if (const auto* handler = subscriber.template typedHandler<void(P...)>())
+          callTypedSubscriber(subscriber, *handler, callType, argsCopy, p...);
+        else
+        {
+          if (!hasParams)
+          {
+            params = AnyReferenceVector{AutoAnyReference(p)...};
+            hasParams = true;
+          }
+          signalBase.callSubscriber(subscriber, params, callType, paramsCopy);
+        }
+      }
+    }
+
+  private:
+    using HandlerType = SignalHandlerType<void(P...)>;
+    using Arguments = std::tuple<typename std::decay<P>::type...>;
+
+    // Call the handler now, or post it with a copy of the arguments shared by
+    // the asynchronous subscribers of the emission.
+    template<typename F>
+    static void callTypedSubscriber(SignalSubscriber s, const boost::function<F>& handler,
+                                    MetaCallType callType, std::shared_ptr<Arguments>& argsCopy,
+                                    P&... p)
+    {
+      auto maybeExec = s.executionContextFor(callType);
+      if (!maybeExec)
+      {
+        s.callTyped([&] { handler(p...); });
+        return;
+      }
+      ExecutionContext* executionContext = maybeExec.value();
+      if (executionContext == nullptr)
+        throw std::runtime_error("Event loop was destroyed");
+      if (!argsCopy)
+        argsCopy = std::make_shared<Arguments>(p...);
+      // The handler is owned by the subscriber, kept alive by the task.
+      const boost::function<F>* h = &handler;
+      executionContext->post([s, h, argsCopy]() mutable {
+        s.callTyped([&] { ka::apply(*h, *argsCopy); });
+      });
+    }
+
+    SignalBase& signalBase;
   };
-  QI_GEN(makeBounce)
-  #undef makeBounce
-  #undef pushArg
 
   } // detail
 
+  template<typename T>
+  const boost::function<T>* SignalSubscriber::typedHandler() const
+  {
+    if (!_p->typedHandlerType || *_p->typedHandlerType != typeid(T))
+      return nullptr;
+    return static_cast<const boost::function<T>*>(_p->typedHandler.get());
+  }
+
+  template<typename F>
+  void SignalSubscriber::callTyped(F&& f)
+  {
+    if (!_p->enabled)
+      return;
+
+    // do not throw
+    try
+    {
+      f();
+    }
+    catch (const qi::PointerLockException&)
+    {
+      onPointerLockFailure();
+    }
+    catch (const std::exception& e)
+    {
+      onException(e.what());
+    }
+    catch (...)
+    {
+      onException(nullptr);
+    }
+  }
+
   template<typename T>
   SignalF<T>::SignalF(OnSubscribers onSubscribers)
     : SignalF(nullptr, std::move(onSubscribers))
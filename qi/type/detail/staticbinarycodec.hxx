@@ -0,0 +1,209 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _QI_TYPE_DETAIL_STATICBINARYCODEC_HXX_
+#define _QI_TYPE_DETAIL_STATICBINARYCODEC_HXX_
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <qi/numeric.hpp>
+#include <qi/types.hpp>
+#include <qi/type/detail/anyreference.hpp>
+
+namespace qi
+{
+  namespace detail
+  {
+    /// Output of StructTypeInterface::encodeBinary.
+    class BinaryFieldWriter
+    {
+    public:
+      virtual ~BinaryFieldWriter() = default;
+      /// Write the `size` bytes at `data`.
+      virtual void write(const void* data, std::size_t size) = 0;
+      /// Write `value` with the generic binary encoder.
+      virtual void write(AnyReference value) = 0;
+    };
+
+    /// Input of StructTypeInterface::decodeBinary.
+    class BinaryFieldReader
+    {
+    public:
+      virtual ~BinaryFieldReader() = default;
+      /** @return the next `size` bytes, valid until the end of the decoding.
+       * @throw std::runtime_error if there are fewer bytes left.
+       */
+      virtual const void* read(std::size_t size) = 0;
+      /// Read `value` in place with the generic binary decoder.
+      virtual void read(AnyReference value) = 0;
+    };
+
+    /** Binary encoding of a struct field of type T, chosen at compile time.
+     *
+     * The numbers, strings and vectors of them are written directly, in the
+     * format of the generic encoder. The other types go through the generic
+     * encoder.
+     */
+    template <typename T, typename Enable = void>
+    struct StaticBinaryCodec
+    {
+      static void encode(BinaryFieldWriter& out, const T& value)
+      {
+        out.write(AnyReference::from(value));
+      }
+
+      static void decode(BinaryFieldReader& in, T& value)
+      {
+        // The generic decoder appends to the containers: it reads a new value
+        // to replace the field, as the generic decoding of the struct does.
+        T result;
+        in.read(AnyReference::fromPtr(&result));
+        value = std::move(result);
+      }
+    };
+
+    /// Numbers whose binary format is their memory representation, see
+    /// the integral and floating point types of src/registration.cpp.
+    template <typename T> struct IsRawBinaryField : std::false_type {};
+    template <> struct IsRawBinaryField<char> : std::true_type {};
+    template <> struct IsRawBinaryField<signed char> : std::true_type {};
+    template <> struct IsRawBinaryField<unsigned char> : std::true_type {};
+    template <> struct IsRawBinaryField<short> : std::true_type {};
+    template <> struct IsRawBinaryField<unsigned short> : std::true_type {};
+    template <> struct IsRawBinaryField<int> : std::true_type {};
+    template <> struct IsRawBinaryField<unsigned int> : std::true_type {};
+    template <> struct IsRawBinaryField<long> : std::true_type {};
+    template <> struct IsRawBinaryField<unsigned long> : std::true_type {};
+    template <> struct IsRawBinaryField<long long> : std::true_type {};
+    template <> struct IsRawBinaryField<unsigned long long> : std::true_type {};
+    template <> struct IsRawBinaryField<float> : std::true_type {};
+    template <> struct IsRawBinaryField<double> : std::true_type {};
+
+    template <typename T>
+    struct StaticBinaryCodec<T, typename std::enable_if<IsRawBinaryField<T>::value>::type>
+    {
+      static void encode(BinaryFieldWriter& out, const T& value)
+      {
+        out.write(&value, sizeof(T));
+      }
+
+      static void decode(BinaryFieldReader& in, T& value)
+      {
+        std::memcpy(&value, in.read(sizeof(T)), sizeof(T));
+      }
+    };
+
+    template <>
+    struct StaticBinaryCodec<bool>
+    {
+      static void encode(BinaryFieldWriter& out, const bool& value)
+      {
+        const unsigned char byte = value ? 1 : 0;
+        out.write(&byte, 1);
+      }
+
+      static void decode(BinaryFieldReader& in, bool& value)
+      {
+        value = *static_cast<const unsigned char*>(in.read(1)) != 0;
+      }
+    };
+
+    // Strings are written as their size, on 32 bits, followed by their bytes.
+    template <>
+    struct StaticBinaryCodec<std::string>
+    {
+      static void encode(BinaryFieldWriter& out, const std::string& value)
+      {
+        StaticBinaryCodec<qi::uint32_t>::encode(out, qi::numericConvert<qi::uint32_t>(value.size()));
+        if (!value.empty())
+          out.write(value.data(), value.size());
+      }
+
+      static void decode(BinaryFieldReader& in, std::string& value)
+      {
+        qi::uint32_t size = 0;
+        StaticBinaryCodec<qi::uint32_t>::decode(in, size);
+        if (size == 0)
+          value.clear();
+        else
+          value.assign(static_cast<const char*>(in.read(size)), size);
+      }
+    };
+
+    // Lists are written as their size, on 32 bits, followed by their elements.
+    template <typename T>
+    struct StaticBinaryCodec<std::vector<T>>
+    {
+      static void encode(BinaryFieldWriter& out, const std::vector<T>& value)
+      {
+        StaticBinaryCodec<qi::uint32_t>::encode(out, qi::numericConvert<qi::uint32_t>(value.size()));
+        for (const T& element : value)
+          StaticBinaryCodec<T>::encode(out, element);
+      }
+
+      static void decode(BinaryFieldReader& in, std::vector<T>& value)
+      {
+        qi::uint32_t size = 0;
+        StaticBinaryCodec<qi::uint32_t>::decode(in, size);
+        // The size is not trusted to reserve the storage: each element must
+        // be read first.
+        value.clear();
+        for (qi::uint32_t i = 0; i < size; ++i)
+        {
+          T element;
+          StaticBinaryCodec<T>::decode(in, element);
+          value.push_back(std::move(element));
+        }
+      }
+    };
+
+    /** Whether StaticBinaryCodec<T> can decode a field of type T.
+     *
+     * The generic decoding of a field replaces it with a new value: T must be
+     * default constructible and move assignable. The structs with other
+     * fields are decoded by the generic decoder.
+     */
+    template <typename T>
+    struct IsBinaryFieldDecodable
+      : std::integral_constant<bool, std::is_default_constructible<T>::value &&
+                                     std::is_move_assignable<T>::value>
+    {};
+    template <typename T>
+    struct IsBinaryFieldDecodable<std::vector<T>> : IsBinaryFieldDecodable<T> {};
+
+    template <typename T>
+    void encodeBinaryField(BinaryFieldWriter& out, const T& value)
+    {
+      StaticBinaryCodec<T>::encode(out, value);
+    }
+
+    template <typename T>
+    bool isBinaryFieldDecodable(const T&)
+    {
+      return IsBinaryFieldDecodable<T>::value;
+    }
+
+    template <typename T>
+    typename std::enable_if<IsBinaryFieldDecodable<T>::value>::type
+    decodeBinaryField(BinaryFieldReader& in, T& value)
+    {
+      StaticBinaryCodec<T>::decode(in, value);
+    }
+    template <typename T>
+    typename std::enable_if<!IsBinaryFieldDecodable<T>::value>::type
+    decodeBinaryField(BinaryFieldReader&, T&)
+    {
+      throw std::logic_error("struct field cannot be decoded in place");
+    }
+  }
+}
+
+#endif  // _QI_TYPE_DETAIL_STATICBINARYCODEC_HXX_
@@ -13,6 +13,7 @@
 #include <qi/api.hpp>
 #include <qi/type/fwd.hpp>
 #include <qi/type/detail/accessor.hxx>
+#include <qi/type/detail/staticbinarycodec.hxx>
 #include <qi/type/typeinterface.hpp>
 #include <qi/preproc.hpp>
 
@@ -201,6 +202,13 @@ namespace qi
         (void*)&detail::Accessor<A>::access(inst, accessor));
     }
 
+    template<typename C, typename A>
+    void encodeBinaryField(BinaryFieldWriter& out, C* instance, A accessor)
+    {
+      using T = typename detail::Accessor<A>::value_type;
+      StaticBinaryCodec<T>::encode(out, detail::Accessor<A>::access(instance, accessor));
+    }
+
     template<typename C, typename A>
     typename detail::Accessor<A>::value_type&
     fieldValue(C* instance, A accessor, void** data)
@@ -231,6 +239,8 @@ namespace qi
       virtual bool convertTo(std::map<std::string, ::qi::AnyValue>& fields,                           \
                              const std::vector<std::tuple<std::string, TypeInterface*>>& missing,     \
                              const std::map<std::string, ::qi::AnyReference>& dropfields) override;   \
+      void encodeBinary(void* storage, ::qi::detail::BinaryFieldWriter& out) override;                \
+      bool decodeBinary(void** storage, ::qi::detail::BinaryFieldReader& in) override;                \
       extra using Impl = ::qi::DefaultTypeImplMethods<name, ::qi::TypeByPointerPOD<name>>;            \
       _QI_BOUNCE_TYPE_METHODS(Impl);                                                                  \
     };                                                                                                \
@@ -240,6 +250,9 @@ namespace qi
 #define __QI_TUPLE_GET(_, what, field) if (i == index) return ::qi::typeOf(ptr->field)->initializeStorage(&ptr->field); i++;
 #define __QI_TUPLE_SET(_, what, field) if (i == index) ::qi::detail::setFromStorage(ptr->field, valueStorage); i++;
 #define __QI_TUPLE_FIELD_NAME(_, what, field) res.push_back(BOOST_PP_STRINGIZE(QI_DELAY(field)));
+#define __QI_TUPLE_ENCODE(_, what, field) ::qi::detail::encodeBinaryField(out, ptr->field);
+#define __QI_TUPLE_DECODE(_, what, field) ::qi::detail::decodeBinaryField(in, ptr->field);
+#define __QI_TUPLE_DECODABLE(_, what, field) decodable = decodable && ::qi::detail::isBinaryFieldDecodable(ptr->field);
 #define __QI_TYPE_STRUCT_IMPLEMENT(name, inl, onSet, ...)                                                     \
   namespace qi                                                                                                \
   {                                                                                                           \
@@ -268,6 +281,22 @@ namespace qi
       QI_VAARGS_APPLY(__QI_TUPLE_SET, _, __VA_ARGS__);                                                        \
       onSet                                                                                                   \
     }                                                                                                         \
+    inl void TypeImpl<name>::encodeBinary(void* storage, ::qi::detail::BinaryFieldWriter& out)                \
+    {                                                                                                         \
+      name* ptr = (name*)ptrFromStorage(&storage);                                                            \
+      QI_VAARGS_APPLY(__QI_TUPLE_ENCODE, _, __VA_ARGS__);                                                     \
+    }                                                                                                         \
+    inl bool TypeImpl<name>::decodeBinary(void** storage, ::qi::detail::BinaryFieldReader& in)                \
+    {                                                                                                         \
+      name* ptr = (name*)ptrFromStorage(storage);                                                             \
+      bool decodable = true;                                                                                  \
+      QI_VAARGS_APPLY(__QI_TUPLE_DECODABLE, _, __VA_ARGS__);                                                  \
+      if (!decodable)                                                                                         \
+        return false;                                                                                         \
+      QI_VAARGS_APPLY(__QI_TUPLE_DECODE, _, __VA_ARGS__);                                                     \
+      onSet                                                                                                   \
+      return true;                                                                                            \
+    }                                                                                                         \
     inl std::vector<std::string> TypeImpl<name>::elementsName()                                               \
     {                                                                                                         \
       std::vector<std::string> res;                                                                           \
@@ -321,6 +350,7 @@ namespace qi
 #define __QI_ATUPLE_TYPE(_, what, field) res.push_back(::qi::detail::fieldType(__QI_STRUCT_ACCESS(field)));
 #define __QI_ATUPLE_GET(_, what, field) if (i == index) return ::qi::detail::fieldStorage(ptr, __QI_STRUCT_ACCESS(field)); i++;
 #define __QI_ATUPLE_FIELD_NAME(_, what, field) res.push_back(QI_PAIR_FIRST(field));
+#define __QI_ATUPLE_ENCODE(_, what, field) ::qi::detail::encodeBinaryField(out, ptr, __QI_STRUCT_ACCESS(field));
 #define __QI_ATUPLE_FROMDATA(idx, what, field) ::qi::detail::fieldValue(ptr, __QI_STRUCT_ACCESS(field), const_cast<void**>(&data[idx]))
 #define __QI_TYPE_STRUCT_AGREGATE_CONSTRUCTOR_IMPLEMENT(name, inl, onSet, ...)                                \
   namespace qi                                                                                                \
@@ -355,6 +385,17 @@ namespace qi
       *ptr = name(QI_VAARGS_MAP(__QI_ATUPLE_FROMDATA, name, __VA_ARGS__));                                    \
     }                                                                                                         \
                                                                                                               \
+    inl void TypeImpl<name>::encodeBinary(void* storage, ::qi::detail::BinaryFieldWriter& out)                \
+    {                                                                                                         \
+      name* ptr = (name*)ptrFromStorage(&storage);                                                            \
+      QI_VAARGS_APPLY(__QI_ATUPLE_ENCODE, name, __VA_ARGS__);                                                 \
+    }                                                                                                         \
+                                                                                                              \
+    inl bool TypeImpl<name>::decodeBinary(void** storage, ::qi::detail::BinaryFieldReader& in)                \
+    {                                                                                                         \
+      return false;                                                                                           \
+    }                                                                                                         \
+                                                                                                              \
     inl std::vector<std::string> TypeImpl<name>::elementsName()                                               \
     {                                                                                                         \
       std::vector<std::string> res;                                                                           \
@@ -392,13 +433,17 @@ friend class qi::TypeImpl<name>;
  * or in a header included by all source files using the structure.
  * See QI_TYPE_STRUCT_REGISTER for a similar macro that can be called from a
  * single source file.
+ * The binary codec of the struct is generated from the fields: the numbers,
+ * strings and vectors of them are encoded without going through the type
+ * system, see qi::detail::StaticBinaryCodec.
  */
 #define QI_TYPE_STRUCT(name, ...) \
   QI_TYPE_STRUCT_DECLARE(name) \
   __QI_TYPE_STRUCT_IMPLEMENT(name, inline, /**/, __VA_ARGS__)
 
 /** Similar to QI_TYPE_STRUCT, but evaluates 'onSet' after writting to an instance.
- * The instance is accessible through the variable 'ptr'.
+ * The instance is accessible through the variable 'ptr'. The binary decoder
+ * evaluates it once, after reading all the fields.
  */
 #define QI_TYPE_STRUCT_EX(name, onSet, ...) \
   QI_TYPE_STRUCT_DECLARE(name) \
@@ -546,6 +591,20 @@ namespace qi {
       return bounceType()->elementsName();
     }
 
+    void encodeBinary(void* storage, detail::BinaryFieldWriter& out) override
+    {
+      void* astorage;
+      adaptStorage(&storage, &astorage);
+      bounceType()->encodeBinary(astorage, out);
+    }
+
+    bool decodeBinary(void** storage, detail::BinaryFieldReader& in) override
+    {
+      void* astorage;
+      adaptStorage(storage, &astorage);
+      return bounceType()->decodeBinary(&astorage, in);
+    }
+
     virtual bool convertFrom(std::map<std::string, qi::AnyValue>& fields,
                              const std::vector<std::tuple<std::string, TypeInterface*>>& missing,
                              const std::map<std::string, qi::AnyReference>& dropfields) override
@@ -50,6 +50,12 @@ namespace qi
 
   class Signature;
 
+  namespace detail
+  {
+    class BinaryFieldWriter;
+    class BinaryFieldReader;
+  }
+
   //warning update the C enum when updating this one.
   enum TypeKind
   {
@@ -199,8 +199,27 @@ namespace qi{
     virtual AnyIterator end(void* storage) = 0;
     /// Append an element to the end of the list
     virtual void pushBack(void** storage, void* valueStorage) = 0;
+    /**
+     * Append a default constructed element to the end of the list, to be set
+     * in place.
+     *
+     * @return the storage of the new element, or null if the list does not
+     * support it, in which case nothing is appended: use pushBack() instead.
+     */
+    virtual void* emplaceBack(void** storage);
     /// Get the element at index
     virtual void* element(void* storage, int index);
+
+    /// Callback of forEach, called with the context given to forEach.
+    using ElementCallback = void (*)(void* context, AnyReference element);
+    /**
+     * Call `callback` on each element of the list, in order, without going
+     * through iterators.
+     *
+     * @return false if the list does not support it, in which case
+     * `callback` is not called: iterate from begin() to end() instead.
+     */
+    virtual bool forEach(void* storage, ElementCallback callback, void* context);
     TypeKind kind() override { return TypeKind_List;}
   };
 
@@ -233,6 +252,17 @@ namespace qi{
      * otherwise an invalid reference is returned.
      */
     virtual AnyReference element(void** storage, void* keyStorage, bool autoInsert) = 0;
+
+    /// Callback of forEach, called with the context given to forEach.
+    using ElementCallback = void (*)(void* context, AnyReference key, AnyReference value);
+    /**
+     * Call `callback` on each key-value pair of the map, in order, without
+     * going through iterators.
+     *
+     * @return false if the map does not support it, in which case `callback`
+     * is not called: iterate from begin() to end() instead.
+     */
+    virtual bool forEach(void* storage, ElementCallback callback, void* context);
     TypeKind kind() override { return TypeKind_Map; }
     // Since our typesystem has no erased operator < or operator ==,
     // MapTypeInterface does not provide a find()
@@ -265,6 +295,20 @@ namespace qi{
     /// Get the type name of the struct
     virtual std::string className() { return std::string(); }
 
+    /**
+     * Write the fields of the struct, in the binary format of a tuple. The
+     * default implementation writes each field with the generic encoder. The
+     * structs registered with QI_TYPE_STRUCT write them directly.
+     */
+    virtual void encodeBinary(void* storage, detail::BinaryFieldWriter& out);
+    /**
+     * Read the fields of the struct, in the binary format of a tuple.
+     *
+     * @return false if the struct does not support it, in which case nothing
+     * is read: decode each field and call set() instead.
+     */
+    virtual bool decodeBinary(void** storage, detail::BinaryFieldReader& in);
+
     /** @{
     *
     * Versioning support.
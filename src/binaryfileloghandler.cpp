@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#include <qi/log/binaryfileloghandler.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+
+qiLogCategory("qi.log.binaryfileloghandler");
+
+namespace qi
+{
+namespace log
+{
+  struct PrivateBinaryFileLogHandler
+  {
+    FILE* _file;
+    // Ids of the categories and sites already written to the file.
+    boost::unordered_map<std::string, qi::uint32_t> _categories;
+    boost::unordered_map<const LogSite*, qi::uint32_t> _sites;
+
+    template <typename T>
+    void write(T value)
+    {
+      fwrite(&value, sizeof(value), 1, _file);
+    }
+
+    void writeString(const char* str, std::size_t size)
+    {
+      write(static_cast<qi::uint32_t>(size));
+      fwrite(str, 1, size, _file);
+    }
+
+    void writeString(const char* str)
+    {
+      if (!str)
+        str = "";
+      writeString(str, std::strlen(str));
+    }
+
+    template <typename Date>
+    void writeDate(Date date)
+    {
+      write(static_cast<qi::int64_t>(
+          boost::chrono::duration_cast<qi::NanoSeconds>(date.time_since_epoch()).count()));
+    }
+
+    qi::uint32_t categoryId(const char* category)
+    {
+      auto it = _categories.find(category);
+      if (it != _categories.end())
+        return it->second;
+      const auto id = static_cast<qi::uint32_t>(_categories.size());
+      _categories.emplace(category, id);
+      write(static_cast<qi::uint8_t>(binarylog::RecordType_Category));
+      write(id);
+      writeString(category);
+      return id;
+    }
+
+    qi::uint32_t siteId(const LogSite& site)
+    {
+      auto it = _sites.find(&site);
+      if (it != _sites.end())
+        return it->second;
+      const auto id = static_cast<qi::uint32_t>(_sites.size());
+      _sites.emplace(&site, id);
+      write(static_cast<qi::uint8_t>(binarylog::RecordType_Site));
+      write(id);
+      write(static_cast<qi::uint8_t>(site.level));
+      write(static_cast<qi::int32_t>(site.line));
+      writeString(site.file);
+      writeString(site.function);
+      writeString(site.format);
+      return id;
+    }
+  };
+
+  BinaryFileLogHandler::BinaryFileLogHandler(const std::string& filePath)
+    : _p(new PrivateBinaryFileLogHandler)
+  {
+    _p->_file = NULL;
+    boost::filesystem::path fPath(filePath);
+    // Create the directory!
+    try
+    {
+      if (!boost::filesystem::exists(fPath.make_preferred().parent_path()))
+        boost::filesystem::create_directories(fPath.make_preferred().parent_path());
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+      qiLogWarning() << e.what();
+    }
+
+    // Open the file.
+    FILE* file = qi::os::fopen(fPath.make_preferred().string().c_str(), "wb");
+
+    if (file)
+    {
+      _p->_file = file;
+      fwrite(binarylog::magic, 1, binarylog::magicSize, file);
+      _p->write(binarylog::version);
+      _p->write(binarylog::byteOrderMark);
+      fflush(file);
+    }
+    else
+      qiLogWarning() << "Cannot open " << filePath;
+  }
+
+  BinaryFileLogHandler::~BinaryFileLogHandler()
+  {
+    if (_p->_file != NULL)
+      fclose(_p->_file);
+  }
+
+  void BinaryFileLogHandler::log(const qi::LogLevel verb,
+                                 const qi::Clock::time_point date,
+                                 const qi::SystemClock::time_point systemDate,
+                                 const char* category,
+                                 const char* msg,
+                                 const char* file,
+                                 const char* fct,
+                                 const int line)
+  {
+    if (_p->_file == NULL)
+      return;
+    const qi::uint32_t catId = _p->categoryId(category);
+    _p->write(static_cast<qi::uint8_t>(binarylog::RecordType_Text));
+    _p->writeDate(date);
+    _p->writeDate(systemDate);
+    _p->write(catId);
+    _p->write(static_cast<qi::uint8_t>(verb));
+    _p->write(static_cast<qi::int32_t>(line));
+    _p->writeString(file);
+    _p->writeString(fct);
+    _p->writeString(msg);
+    fflush(_p->_file);
+  }
+
+  void BinaryFileLogHandler::logDeferred(const qi::Clock::time_point date,
+                                         const qi::SystemClock::time_point systemDate,
+                                         const char* category,
+                                         const LogSite& site,
+                                         const char* args,
+                                         std::size_t size)
+  {
+    if (_p->_file == NULL)
+      return;
+    const qi::uint32_t catId = _p->categoryId(category);
+    const qi::uint32_t siteId = _p->siteId(site);
+    _p->write(static_cast<qi::uint8_t>(binarylog::RecordType_Deferred));
+    _p->writeDate(date);
+    _p->writeDate(systemDate);
+    _p->write(catId);
+    _p->write(siteId);
+    _p->writeString(args, size);
+    fflush(_p->_file);
+  }
+}
+}
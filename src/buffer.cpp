@@ -6,6 +6,7 @@
 #include <qi/assert.hpp>
 #include <qi/buffer.hpp>
 #include <qi/log.hpp>
+#include <qi/perf/detail/instrumentedmutex.hpp>
 
 #include <cstdio>
 #include <cstring>
@@ -26,7 +27,7 @@ namespace qi
 
   BufferPrivate::~BufferPrivate()
   {
-    if (_bigdata)
+    if (_bigdata && !_external)
     {
       free(_bigdata);
       _bigdata = NULL;
@@ -43,6 +44,7 @@ namespace qi
     if (b._bigdata)
     {
       _bigdata = static_cast<unsigned char*>(malloc(b.used));
+      QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Buffer, b.used);
       ::memcpy(_bigdata, b._bigdata, b.used);
     }
     else
@@ -60,12 +62,15 @@ namespace qi
     _subBuffers = b._subBuffers;
     if (_bigdata)
     {
-      free(_bigdata);
+      if (!_external)
+        free(_bigdata);
       _bigdata = NULL;
+      _external.reset();
     }
     if (b._bigdata)
     {
       _bigdata = static_cast<unsigned char*>(malloc(b.used));
+      QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Buffer, b.used);
       ::memcpy(_bigdata, b._bigdata, b.used);
     }
     else
@@ -118,9 +123,24 @@ namespace qi
     qiLogDebug() << "Resizing buffer from " << available << " to " << neededSize;
     unsigned char *newBigdata;
 
+    if (_external)
+    {
+      // The storage is not ours: move to the heap before growing.
+      newBigdata = static_cast<unsigned char *>(malloc(neededSize));
+      if (newBigdata == NULL)
+        return false;
+      QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Buffer, neededSize);
+      ::memcpy(newBigdata, _bigdata, used);
+      _external.reset();
+      available = neededSize;
+      _bigdata = newBigdata;
+      return true;
+    }
+
     newBigdata = static_cast<unsigned char *>(realloc(_bigdata, neededSize));
     if (newBigdata == NULL)
       return false;
+    QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Buffer, neededSize);
     if (!_bigdata && used > 0)
       ::memcpy(newBigdata, _data, used);
     available = neededSize;
@@ -128,6 +148,17 @@ namespace qi
     return true;
   }
 
+  Buffer BufferPrivate::fromExternal(void* data, size_t size, boost::shared_ptr<void> keeper)
+  {
+    Buffer buffer;
+    BufferPrivate& p = *buffer._p;
+    p._bigdata = static_cast<unsigned char*>(data);
+    p._external = std::move(keeper);
+    p.used = size;
+    p.available = size;
+    return buffer;
+  }
+
   Buffer::Buffer()
     : _p(boost::make_shared<BufferPrivate>())
   {
@@ -12,7 +12,9 @@
 
 #include <vector>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <qi/atomic.hpp>
+#include <qi/buffer.hpp>
 #include <qi/types.hpp>
 
 namespace qi
@@ -30,6 +32,18 @@ namespace qi
     boost::optional<size_t> indexOfSubBuffer(size_t offset) const;
     friend bool operator==(const BufferPrivate& a, const BufferPrivate& b);
 
+    /// Return a buffer whose content is the \p size bytes at \p data, without
+    /// copying them. The storage is kept alive by \p keeper and is never freed
+    /// by the buffer. It must stay writable (for instance a private mapping)
+    /// and is copied to the heap as soon as the buffer needs to grow.
+    static Buffer fromExternal(void* data, size_t size, boost::shared_ptr<void> keeper);
+
+    /// Call \p proc(const char* data, size_t size) on each contiguous chunk of
+    /// \p buffer, in the order in which they are sent on the wire: each
+    /// sub-buffer follows its size in the main buffer. See sock::makeBuffers.
+    template <typename Proc>
+    static void forEachWireChunk(const Buffer& buffer, Proc&& proc);
+
   public:
     unsigned char*  _bigdata = nullptr;
     unsigned char   _data[STATIC_BLOCK] = {};
@@ -38,7 +52,28 @@ namespace qi
     size_t          available = std::extent<decltype(_data)>::value; // total size of buffer
 
     std::vector<std::pair<size_t, Buffer> > _subBuffers;
+
+    // Owner of the storage pointed to by _bigdata, if it is not ours.
+    boost::shared_ptr<void> _external;
   };
+
+  template <typename Proc>
+  void BufferPrivate::forEachWireChunk(const Buffer& buffer, Proc&& proc)
+  {
+    const char* data = static_cast<const char*>(buffer.data());
+    size_t begin = 0;
+    for (const auto& sub : buffer.subBuffers())
+    {
+      const size_t end = sub.first + sizeof(Buffer::size_type);
+      if (end != begin)
+        proc(data + begin, end - begin);
+      begin = end;
+      const Buffer& subBuffer = sub.second;
+      proc(static_cast<const char*>(subBuffer.data()), subBuffer.size());
+    }
+    if (buffer.size() != begin)
+      proc(data + begin, buffer.size() - begin);
+  }
 }
 
 #endif  // _SRC_BUFFER_P_HPP_
@@ -22,7 +22,7 @@ namespace qi {
       FutureBasePrivate& operator=(const FutureBasePrivate&) = delete;
 
       boost::condition_variable_any _cond;
-      boost::recursive_mutex _mutex;
+      FutureMutex _mutex;
       std::string  _error;
       std::atomic<FutureState> _state;
       std::atomic<bool> _cancelRequested;
@@ -42,6 +42,7 @@ namespace qi {
     FutureBase::FutureBase()
       : _p(new FutureBasePrivate())
     {
+      QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Future, sizeof(FutureBasePrivate));
     }
 
     FutureBase::~FutureBase()
@@ -60,7 +61,7 @@ namespace qi {
     }
 
     FutureState FutureBase::wait(int msecs) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
+      FutureMutex::scoped_lock lock(_p->_mutex);
       if (_p->_state.load() != FutureState_Running)
         return FutureState(_p->_state.load());
       if (msecs == FutureTimeout_Infinite)
@@ -73,7 +74,7 @@ namespace qi {
     }
 
     FutureState FutureBase::wait(qi::Duration duration) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
+      FutureMutex::scoped_lock lock(_p->_mutex);
       if (_p->_state.load() != FutureState_Running)
         return FutureState(_p->_state.load());
       _p->_cond.wait_for(lock, duration, boost::bind(&waitFinished, _p));
@@ -81,7 +82,7 @@ namespace qi {
     }
 
     FutureState FutureBase::wait(qi::SteadyClock::time_point timepoint) const {
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
+      FutureMutex::scoped_lock lock(_p->_mutex);
       if (_p->_state.load() != FutureState_Running)
         return FutureState(_p->_state.load());
       _p->_cond.wait_until(lock, timepoint, boost::bind(&waitFinished, _p));
@@ -117,7 +118,7 @@ namespace qi {
     }
 
     void FutureBase::notifyFinish() {
-      boost::unique_lock<boost::recursive_mutex> l{_p->_mutex};
+      FutureMutex::scoped_lock l{_p->_mutex};
       _p->_cond.notify_all();
     }
 
@@ -155,11 +156,11 @@ namespace qi {
         throw FutureException(FutureException::ExceptionState_FutureTimeout);
       if (_p->_state.load() != FutureState_FinishedWithError)
         throw FutureException(FutureException::ExceptionState_FutureHasNoError);
-      boost::recursive_mutex::scoped_lock lock(_p->_mutex);
+      FutureMutex::scoped_lock lock(_p->_mutex);
       return _p->_error;
     }
 
-    boost::recursive_mutex& FutureBase::mutex()
+    FutureMutex& FutureBase::mutex()
     {
       return _p->_mutex;
     }
@@ -15,26 +15,34 @@
 #include <qi/assert.hpp>
 #include <qi/log.hpp>
 #include "log_p.hpp"
+#include "logring_p.hpp"
 #include <qi/os.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 #include <qi/application.hpp>
 #include <qi/atomic.hpp>
 #include <qi/log/consoleloghandler.hpp>
+#include <qi/log/rotatingfileloghandler.hpp>
 
 #include <boost/thread/thread.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/program_options.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp>
 
-#include <boost/lockfree/queue.hpp>
 #include <boost/function.hpp>
 #include <boost/predef.h>
 
@@ -56,13 +64,6 @@
 #endif
 
 
-#define RTLOG_BUFFERS (128)
-
-#define CAT_SIZE 64
-#define FILE_SIZE 128
-#define FUNC_SIZE 64
-#define LOG_SIZE 2048
-
 qiLogCategory("qi.log");
 
 namespace qi {
@@ -231,18 +232,6 @@ namespace qi {
 
   namespace log {
 
-    using privateLog = struct sPrivateLog
-    {
-      qi::LogLevel               _logLevel;
-      char                       _category[CAT_SIZE];
-      char                       _file[FILE_SIZE];
-      char                       _function[FUNC_SIZE];
-      int                        _line;
-      char                       _log[LOG_SIZE];
-      qi::Clock::time_point       _date;
-      qi::SystemClock::time_point _systemDate;
-    };
-
     class Log
     {
     public:
@@ -252,11 +241,29 @@ namespace qi {
       struct Handler
       {
         qi::log::Handler func;
+        qi::log::DeferredHandler deferredFunc; // optional
         unsigned int index; // index of this handler in category levels
       };
 
       void run();
-      void printLog();
+      // Dispatch the records of all the rings, return how many there were.
+      std::size_t printLog();
+      std::size_t printLog_unsynchronized();
+      // Push a record in the ring of the calling thread.
+      void push(const qi::LogLevel level,
+                const qi::Clock::time_point date,
+                const qi::SystemClock::time_point systemDate,
+                detail::Category& category,
+                const char* log,
+                const char* file,
+                const char* function,
+                int line);
+      void push(const qi::Clock::time_point date,
+                const qi::SystemClock::time_point systemDate,
+                detail::Category& category,
+                const LogSite& site,
+                const char* args,
+                std::size_t size);
       // Invoke handlers who enabled given level/category
       void dispatch_unsynchronized(const qi::LogLevel,
                                    const qi::Clock::time_point date,
@@ -274,9 +281,26 @@ namespace qi {
                                    const char* file,
                                    const char* function,
                                    int line);
+      // Invoke handlers who enabled the level/category of a site, formatting
+      // the message for those that do not handle deferred logs.
+      void dispatch_unsynchronized(const qi::Clock::time_point date,
+                                   const qi::SystemClock::time_point systemDate,
+                                   detail::Category& category,
+                                   const LogSite& site,
+                                   const char* args,
+                                   std::size_t size);
       Handler* logHandler(SubscriberId id);
 
       void setSynchronousLog(bool sync);
+
+    private:
+      detail::LogRing& threadRing();
+      template <typename TryPush, typename Dispatch>
+      void push(TryPush tryPush, Dispatch dispatch);
+      bool hasPendingLogs();
+      void wakeConsumer();
+      void reportDroppedLogs();
+
     public:
       bool                       LogInit;
       boost::thread              LogThread;
@@ -286,7 +310,15 @@ namespace qi {
       bool                       SyncLog;
       bool                       AsyncLogInit;
 
-      boost::lockfree::queue<privateLog*>     logs;
+      // Rings of the threads logging asynchronously, drained by LogThread.
+      boost::mutex                                    RingsLock;
+      std::vector<boost::shared_ptr<detail::LogRing>> Rings;
+      const std::size_t                               RingCapacity;
+      const unsigned int                              Generation;
+      std::atomic<LogOverflowPolicy>                  OverflowPolicy;
+      std::atomic<bool>                               ConsumerSleeping;
+      std::atomic<qi::uint64_t>                       DroppedLogs;
+      qi::uint64_t                                    ReportedDroppedLogs; // under LogHandlerLock
 
       using LogHandlerMap = std::map<std::string, Handler>;
       LogHandlerMap logHandlers;
@@ -333,13 +365,140 @@ namespace qi {
       return *_glMutex;
     }
 
+    // Categories by the address of their name, as given by the log sites.
+    // These names are mostly literals: finding them takes neither _mutex()
+    // nor a map lookup. Entries are written once under _mutex(), and are
+    // checked against the name since addresses of other strings can be
+    // reused.
+    struct InternedCategory
+    {
+      std::atomic<const char*>       name;
+      std::atomic<detail::Category*> category;
+    };
+    static const std::size_t internedCategoriesSize = 1024; // power of 2
+    static const std::size_t internedCategoriesProbes = 8;
+    static InternedCategory _glInternedCategories[internedCategoriesSize];
+
+    static detail::Category* internedCategory(const char* name)
+    {
+      const std::size_t first = reinterpret_cast<std::uintptr_t>(name) >> 3;
+      for (std::size_t i = 0; i < internedCategoriesProbes; ++i)
+      {
+        InternedCategory& entry = _glInternedCategories[(first + i) & (internedCategoriesSize - 1)];
+        const char* entryName = entry.name.load(std::memory_order_acquire);
+        if (!entryName)
+          break;
+        if (entryName == name)
+        {
+          detail::Category* category = entry.category.load(std::memory_order_relaxed);
+          if (category->name == name)
+            return category;
+          return addCategory(name);
+        }
+      }
+
+      detail::Category* category = addCategory(name);
+      boost::recursive_mutex::scoped_lock lock(_mutex());
+      for (std::size_t i = 0; i < internedCategoriesProbes; ++i)
+      {
+        InternedCategory& entry = _glInternedCategories[(first + i) & (internedCategoriesSize - 1)];
+        const char* entryName = entry.name.load(std::memory_order_relaxed);
+        if (entryName == name)
+          break;
+        if (!entryName)
+        {
+          entry.category.store(category, std::memory_order_relaxed);
+          entry.name.store(name, std::memory_order_release);
+          break;
+        }
+      }
+      return category;
+    }
+
     static int                    _glContext = 0;
     static bool                   _glInit    = false;
     static LogColor               _glColorWhen = LogColor_Auto;
 
     static Log                   *LogInstance = nullptr;
-    static privateLog             LogBuffer[RTLOG_BUFFERS];
-    static volatile unsigned long LogPush = 0;
+    static std::atomic<unsigned int> _glLogGeneration{0};
+
+    // Sites of the qiLog*Limited and qiLog*Sampled macros that left messages
+    // out. Their limiters are statics: they are never unregistered.
+    inline std::vector<detail::LogLimiter*>& _limiters()
+    {
+      static std::vector<detail::LogLimiter*>* _glLimiters;
+      QI_ONCE(_glLimiters = new std::vector<detail::LogLimiter*>);
+      return *_glLimiters;
+    }
+
+    inline boost::mutex& _limitersMutex()
+    {
+      static boost::mutex* _glLimitersMutex;
+      QI_ONCE(_glLimitersMutex = new boost::mutex);
+      return *_glLimitersMutex;
+    }
+
+    // Date of the next summary of the suppressed messages, max until a site
+    // leaves a message out.
+    static std::atomic<qi::int64_t> _glNextSuppressedReport{
+      std::numeric_limits<qi::int64_t>::max()};
+    static const qi::Duration suppressedReportPeriod = qi::Seconds(1);
+
+    // Log how many messages each site left out since the last summary.
+    static void reportSuppressedLogs()
+    {
+      std::vector<std::pair<detail::LogLimiter*, qi::uint64_t>> suppressed;
+      {
+        boost::mutex::scoped_lock lock(_limitersMutex());
+        for (detail::LogLimiter* limiter : _limiters())
+        {
+          const qi::uint64_t count = limiter->takeSuppressed();
+          if (count != 0u)
+            suppressed.emplace_back(limiter, count);
+        }
+      }
+      for (const auto& site : suppressed)
+      {
+        std::ostringstream ss;
+        ss << site.second << " log message(s) suppressed";
+        qi::log::log(site.first->level, site.first->category, ss.str(), site.first->file,
+                     site.first->function, site.first->line);
+      }
+    }
+
+    // Cheap enough to be called on every log: one relaxed load while no
+    // summary is due.
+    static void reportSuppressedLogsIfDue(const qi::Clock::time_point now)
+    {
+      qi::int64_t next = _glNextSuppressedReport.load(std::memory_order_relaxed);
+      if (now.time_since_epoch().count() < next)
+        return;
+      // Only one thread reports, and the summaries it logs do not recurse.
+      if (!_glNextSuppressedReport.compare_exchange_strong(
+            next, (now + suppressedReportPeriod).time_since_epoch().count()))
+        return;
+      reportSuppressedLogs();
+    }
+
+    // Ring of the current thread, for a given instance of Log.
+    struct ThreadRing
+    {
+      boost::shared_ptr<detail::LogRing> ring;
+      unsigned int generation;
+
+      ~ThreadRing()
+      {
+        if (ring)
+          ring->orphaned = true;
+      }
+    };
+
+    inline boost::thread_specific_ptr<ThreadRing>& _threadRing()
+    {
+      static boost::thread_specific_ptr<ThreadRing>* _glThreadRing;
+      QI_ONCE(_glThreadRing = new boost::thread_specific_ptr<ThreadRing>());
+      return *_glThreadRing;
+    }
 
     namespace detail {
 
@@ -411,6 +570,7 @@ namespace qi {
 
 
     static ConsoleLogHandler *_glConsoleLogHandler = nullptr;
+    static RotatingFileLogHandler *_glRotatingFileLogHandler = nullptr;
 
     namespace env {
       namespace QI_DEFAULT_LOGHANDLER {
@@ -498,6 +658,11 @@ namespace qi {
 
       void destroyDefaultHandler()
       {
+        if (_glRotatingFileLogHandler)
+        {
+          delete _glRotatingFileLogHandler;
+          _glRotatingFileLogHandler = nullptr;
+        }
 #ifndef ANDROID
         if(_glConsoleLogHandler)
         {
@@ -651,17 +816,179 @@ namespace qi {
       }
     } synchLog;
 
-    void Log::printLog()
+    std::size_t Log::printLog()
     {
-      privateLog* pl = nullptr;
-
       boost::recursive_mutex::scoped_lock lock(_mutex(), boost::defer_lock);
       boost::mutex::scoped_lock lockHandlers(LogInstance->LogHandlerLock, boost::defer_lock);
       boost::lock(lock, lockHandlers);
-      while (logs.pop(pl))
+      return printLog_unsynchronized();
+    }
+
+    std::size_t Log::printLog_unsynchronized()
+    {
+      std::vector<boost::shared_ptr<detail::LogRing>> rings;
+      {
+        boost::mutex::scoped_lock lockRings(RingsLock);
+        // Rings of the threads that exited are dropped once drained.
+        Rings.erase(std::remove_if(Rings.begin(), Rings.end(),
+                                   [](const boost::shared_ptr<detail::LogRing>& ring) {
+                                     return ring->orphaned && ring->empty();
+                                   }),
+                    Rings.end());
+        rings = Rings;
+      }
+
+      // Merge the rings by date, so that records of different threads are
+      // dispatched in order.
+      std::vector<detail::LogRing::Record> fronts(rings.size());
+      std::vector<char> hasFront(rings.size());
+      for (std::size_t i = 0; i < rings.size(); ++i)
+        hasFront[i] = rings[i]->front(fronts[i]);
+      std::size_t count = 0;
+      while (true)
+      {
+        std::size_t next = rings.size();
+        for (std::size_t i = 0; i < rings.size(); ++i)
+        {
+          if (hasFront[i] && (next == rings.size() || fronts[i].date < fronts[next].date))
+            next = i;
+        }
+        if (next == rings.size())
+          break;
+        const detail::LogRing::Record& r = fronts[next];
+        if (r.site)
+          dispatch_unsynchronized(r.date, r.systemDate, *r.category, *r.site, r.message,
+                                  r.messageSize);
+        else
+          dispatch_unsynchronized(r.level, r.date, r.systemDate, *r.category, r.message, r.file,
+                                  r.function, r.line);
+        rings[next]->pop();
+        hasFront[next] = rings[next]->front(fronts[next]);
+        ++count;
+      }
+      reportDroppedLogs();
+      return count;
+    }
+
+    void Log::reportDroppedLogs()
+    {
+      const qi::uint64_t dropped = DroppedLogs.load();
+      if (dropped == ReportedDroppedLogs)
+        return;
+      std::ostringstream ss;
+      ss << (dropped - ReportedDroppedLogs) << " log message(s) dropped: asynchronous log buffer full";
+      ReportedDroppedLogs = dropped;
+      dispatch_unsynchronized(qi::LogLevel_Warning, qi::Clock::now(), qi::SystemClock::now(),
+                              *addCategory("qi.log"), ss.str().c_str(), __FILE__, __FUNCTION__,
+                              __LINE__);
+    }
+
+    detail::LogRing& Log::threadRing()
+    {
+      ThreadRing* threadRing = _threadRing().get();
+      if (!threadRing)
+      {
+        threadRing = new ThreadRing;
+        _threadRing().reset(threadRing);
+      }
+      if (!threadRing->ring || threadRing->generation != Generation)
+      {
+        threadRing->ring = boost::make_shared<detail::LogRing>(RingCapacity);
+        threadRing->generation = Generation;
+        boost::mutex::scoped_lock lock(RingsLock);
+        Rings.push_back(threadRing->ring);
+      }
+      return *threadRing->ring;
+    }
+
+    void Log::push(const qi::LogLevel level,
+                   const qi::Clock::time_point date,
+                   const qi::SystemClock::time_point systemDate,
+                   detail::Category& category,
+                   const char* log,
+                   const char* file,
+                   const char* function,
+                   int line)
+    {
+      push([&](detail::LogRing& ring) {
+             return ring.tryPush(level, date, systemDate, &category, file, function, line, log);
+           },
+           [&] {
+             dispatch_unsynchronized(level, date, systemDate, category, log, file, function,
+                                     line);
+           });
+    }
+
+    void Log::push(const qi::Clock::time_point date,
+                   const qi::SystemClock::time_point systemDate,
+                   detail::Category& category,
+                   const LogSite& site,
+                   const char* args,
+                   std::size_t size)
+    {
+      push([&](detail::LogRing& ring) {
+             return ring.tryPush(date, systemDate, &category, site, args, size);
+           },
+           [&] { dispatch_unsynchronized(date, systemDate, category, site, args, size); });
+    }
+
+    template <typename TryPush, typename Dispatch>
+    void Log::push(TryPush tryPush, Dispatch dispatch)
+    {
+      detail::LogRing& ring = threadRing();
+      // The log thread cannot wait for itself, nor take the handler lock it
+      // already holds.
+      const bool logThread = boost::this_thread::get_id() == LogThread.get_id();
+      detail::LogRing::PushResult result;
+      while ((result = tryPush(ring)) == detail::LogRing::PushResult_Full)
+      {
+        if (OverflowPolicy.load(std::memory_order_relaxed) == LogOverflowPolicy_Drop
+            || !LogInit || logThread)
+        {
+          ++DroppedLogs;
+          break;
+        }
+        wakeConsumer();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+
+      if (result == detail::LogRing::PushResult_TooBig)
+      {
+        // Waiting for the log thread would not make room for it: dispatch
+        // the record now, after those already queued so that the records of
+        // this thread stay in order.
+        if (logThread)
+          ++DroppedLogs;
+        else
+        {
+          boost::recursive_mutex::scoped_lock lock(_mutex(), boost::defer_lock);
+          boost::mutex::scoped_lock lockHandlers(LogHandlerLock, boost::defer_lock);
+          boost::lock(lock, lockHandlers);
+          printLog_unsynchronized();
+          dispatch();
+        }
+        return;
+      }
+      wakeConsumer();
+    }
+
+    bool Log::hasPendingLogs()
+    {
+      boost::mutex::scoped_lock lock(RingsLock);
+      return std::any_of(Rings.begin(), Rings.end(),
+                         [](const boost::shared_ptr<detail::LogRing>& ring) {
+                           return !ring->empty();
+                         });
+    }
+
+    void Log::wakeConsumer()
+    {
+      // Only pay for the notification if the log thread is waiting, and
+      // only once per wait.
+      if (ConsumerSleeping.load(std::memory_order_relaxed) && ConsumerSleeping.exchange(false))
       {
-        dispatch_unsynchronized(pl->_logLevel, pl->_date, pl->_systemDate, pl->_category, pl->_log,
-                                pl->_file, pl->_function, pl->_line);
+        boost::mutex::scoped_lock lock(LogWriteLock);
+        LogReadyCond.notify_one();
       }
     }
 
@@ -674,8 +1001,8 @@ namespace qi {
                                       const char* function,
                                       int line)
     {
-      dispatch_unsynchronized(level, date, systemDate, *addCategory(category), log, file, function,
-                              line);
+      dispatch_unsynchronized(level, date, systemDate, *internedCategory(category), log, file,
+                              function, line);
     }
 
     void Log::dispatch_unsynchronized(const qi::LogLevel level,
@@ -700,16 +1027,62 @@ namespace qi {
       }
     }
 
-    void Log::run()
+    void Log::dispatch_unsynchronized(const qi::Clock::time_point date,
+                                      const qi::SystemClock::time_point systemDate,
+                                      detail::Category& category,
+                                      const LogSite& site,
+                                      const char* args,
+                                      std::size_t size)
     {
-      while (LogInit)
+      // Formatted once, for the first handler that needs it.
+      std::string message;
+      bool formatted = false;
+      for (LogHandlerMap::iterator it = logHandlers.begin(); it != logHandlers.end(); ++it)
       {
+        Handler& h = it->second;
+        unsigned int index = h.index;
+        if (category.levels.size() > index && category.levels[index] < site.level)
+          continue;
+        if (h.deferredFunc)
+        {
+          h.deferredFunc(date, systemDate, category.name.c_str(), site, args, size);
+          continue;
+        }
+        if (!formatted)
         {
-          boost::mutex::scoped_lock lock(LogWriteLock);
-          LogReadyCond.wait(lock, []{ return !LogInstance->logs.empty(); });
+          message = formatDeferred(site.format, args, size);
+          formatted = true;
         }
+        h.func(site.level, date, systemDate, category.name.c_str(), message.c_str(), site.file,
+               site.function, site.line);
+      }
+    }
 
-        printLog();
+    void Log::run()
+    {
+      while (LogInit)
+      {
+        reportSuppressedLogsIfDue(qi::Clock::now());
+        if (printLog() != 0u)
+          continue;
+
+        // Stay awake for a moment, so that producers logging continuously
+        // seldom have to wake us up.
+        const qi::SteadyClock::time_point spinEnd = qi::SteadyClock::now() + qi::MicroSeconds(50);
+        bool pending = false;
+        while (!(pending = hasPendingLogs()) && qi::SteadyClock::now() < spinEnd)
+          boost::this_thread::yield();
+        if (pending)
+          continue;
+
+        boost::mutex::scoped_lock lock(LogWriteLock);
+        ConsumerSleeping = true;
+        // Producers check ConsumerSleeping after pushing: if they pushed
+        // before it was set, their record is seen here. The timeout bounds
+        // the delay of a notification missed in between.
+        if (!hasPendingLogs())
+          LogReadyCond.wait_for(lock, boost::chrono::milliseconds(100));
+        ConsumerSleeping = false;
       }
     }
 
@@ -726,7 +1099,12 @@ namespace qi {
     inline Log::Log() :
       SyncLog(true),
       AsyncLogInit(false)
-      , logs(50)
+      , RingCapacity(qi::os::getEnvParam<std::size_t>("QI_LOG_BUFFER_SIZE", 256 * 1024))
+      , Generation(++_glLogGeneration)
+      , OverflowPolicy(LogOverflowPolicy_Drop)
+      , ConsumerSleeping(false)
+      , DroppedLogs(0u)
+      , ReportedDroppedLogs(0u)
     {
       LogInit = true;
     }
@@ -746,17 +1124,6 @@ namespace qi {
       }
     }
 
-    static void my_strcpy(char *dst, const char *src, int len) {
-      if (!src)
-        src = "(null)";
-#ifdef _MSV_VER
-      strncpy_s(dst, len, src, _TRUNCATE);
-#else
-      strncpy(dst, src, len);
-      dst[len - 1] = 0;
-#endif
-    }
-
     static void doInit(qi::LogLevel verb) {
       //if init has already been called, we are set here. (reallocating all globals
       // will lead to racecond)
@@ -790,8 +1157,15 @@ namespace qi {
       LogInstance = nullptr;
     }
 
+    void setAsynchronousLogOverflowPolicy(LogOverflowPolicy policy)
+    {
+      if (LogInstance)
+        LogInstance->OverflowPolicy = policy;
+    }
+
     void flush()
     {
+      reportSuppressedLogs();
       if (_glInit)
         LogInstance->printLog();
     }
@@ -816,10 +1190,11 @@ namespace qi {
              const char           *fct,
              const int             line)
     {
-      if (!isVisible(categoryStr, verb))
+      CategoryType category = internedCategory(categoryStr);
+      if (!isVisible(category, verb))
         return;
 
-      ::qi::log::detail::log(verb, NULL, categoryStr, msg, file, fct, line);
+      ::qi::log::detail::log(verb, category, categoryStr, msg, file, fct, line);
     }
 
     void detail::log(const qi::LogLevel    verb,
@@ -851,21 +1226,135 @@ namespace qi {
       }
       else
       {
-        int tmpRtLogPush = ++LogPush % RTLOG_BUFFERS;
-        privateLog* pl = &(LogBuffer[tmpRtLogPush]);
-
-        pl->_logLevel = verb;
-        pl->_line = line;
-        pl->_date = date;
-        pl->_systemDate = systemDate;
-
-        my_strcpy(pl->_category, categoryStr, CAT_SIZE);
-        my_strcpy(pl->_file, file, FILE_SIZE);
-        my_strcpy(pl->_function, fct, FUNC_SIZE);
-        my_strcpy(pl->_log, msg, LOG_SIZE);
-        LogInstance->logs.push(pl);
-        LogInstance->LogReadyCond.notify_one();
+        if (!category)
+          category = internedCategory(categoryStr);
+        LogInstance->push(verb, date, systemDate, *category, msg, file, fct, line);
       }
+      reportSuppressedLogsIfDue(date);
+    }
+
+    void detail::logDeferred(const LogSite& site,
+                             CategoryType category,
+                             const char* args,
+                             std::size_t size)
+    {
+      if (!LogInstance)
+        return;
+      if (!LogInstance->LogInit)
+        return;
+
+      qi::Clock::time_point date = qi::Clock::now();
+      qi::SystemClock::time_point systemDate = qi::SystemClock::now();
+      if (LogInstance->SyncLog)
+      {
+        boost::recursive_mutex::scoped_lock lock(_mutex(), boost::defer_lock);
+        boost::mutex::scoped_lock lockHandlers(LogInstance->LogHandlerLock, boost::defer_lock);
+        boost::lock(lock, lockHandlers);
+        LogInstance->dispatch_unsynchronized(date, systemDate, *category, site, args, size);
+      }
+      else
+        LogInstance->push(date, systemDate, *category, site, args, size);
+      reportSuppressedLogsIfDue(date);
+    }
+
+    void detail::LogLimiter::suppress(CategoryType cat, const char* catName, const char* fct)
+    {
+      _suppressed.fetch_add(1u, std::memory_order_relaxed);
+      if (_registered.load(std::memory_order_relaxed) || _registered.exchange(true))
+        return;
+
+      if (!cat)
+        cat = internedCategory(catName);
+      boost::mutex::scoped_lock lock(_limitersMutex());
+      category = cat;
+      function = fct;
+      _limiters().push_back(this);
+      qi::int64_t never = std::numeric_limits<qi::int64_t>::max();
+      _glNextSuppressedReport.compare_exchange_strong(
+          never, (qi::Clock::now() + suppressedReportPeriod).time_since_epoch().count());
+    }
+
+    namespace
+    {
+      template <typename T>
+      bool readDeferredArg(const char*& args, const char* end, T& value)
+      {
+        if (static_cast<std::size_t>(end - args) < sizeof(value))
+          return false;
+        std::memcpy(&value, args, sizeof(value));
+        args += sizeof(value);
+        return true;
+      }
+    }
+
+    std::string formatDeferred(const char* format, const char* args, std::size_t size)
+    {
+      boost::format fmt = detail::getFormat(format);
+      const char* end = args + size;
+      while (args != end)
+      {
+        const char tag = *args++;
+        bool ok = false;
+        switch (tag)
+        {
+        case detail::DeferredArgTag_Bool:
+        {
+          char value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % (value != 0);
+          break;
+        }
+        case detail::DeferredArgTag_Char:
+        {
+          char value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % value;
+          break;
+        }
+        case detail::DeferredArgTag_Int:
+        {
+          std::int64_t value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % value;
+          break;
+        }
+        case detail::DeferredArgTag_UInt:
+        {
+          std::uint64_t value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % value;
+          break;
+        }
+        case detail::DeferredArgTag_Double:
+        {
+          double value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % value;
+          break;
+        }
+        case detail::DeferredArgTag_Pointer:
+        {
+          std::uint64_t value;
+          if ((ok = readDeferredArg(args, end, value)))
+            fmt % reinterpret_cast<const void*>(static_cast<std::uintptr_t>(value));
+          break;
+        }
+        case detail::DeferredArgTag_String:
+        {
+          std::uint32_t strSize;
+          if ((ok = readDeferredArg(args, end, strSize)
+                    && static_cast<std::size_t>(end - args) >= strSize))
+          {
+            fmt % std::string(args, strSize);
+            args += strSize;
+          }
+          break;
+        }
+        }
+        if (!ok)
+          return fmt.str() + " (invalid log arguments)";
+      }
+      return fmt.str();
     }
 
     Log::Handler* Log::logHandler(SubscriberId id)
@@ -897,6 +1386,12 @@ namespace qi {
 
     SubscriberId addHandler(const std::string& name, Handler fct,
                             qi::LogLevel defaultLevel)
+    {
+      return addHandler(name, std::move(fct), DeferredHandler(), defaultLevel);
+    }
+
+    SubscriberId addHandler(const std::string& name, Handler fct, DeferredHandler deferred,
+                            qi::LogLevel defaultLevel)
     {
       if (!LogInstance)
         return -1;
@@ -906,6 +1401,7 @@ namespace qi {
       Log::Handler h;
       h.index = id;
       h.func = fct;
+      h.deferredFunc = deferred;
       LogInstance->logHandlers[name] = h;
       setLogLevel(defaultLevel, id);
       return id;
@@ -1041,6 +1537,11 @@ namespace qi {
       return log::isVisible(addCategory(category), level);
     }
 
+    bool isVisible(const char* category, qi::LogLevel level)
+    {
+      return log::isVisible(internedCategory(category), level);
+    }
+
     void enableCategory(const std::string& cat, SubscriberId sub)
     {
       addFilter(cat, logLevel(sub), sub);
@@ -1188,6 +1689,27 @@ namespace qi {
       addFilters(filters);
     }
 
+    static void _setLogFile(const std::string &path)
+    {
+      static const char* const name = "rotatingfileloghandler";
+      if (_glRotatingFileLogHandler)
+      {
+        removeHandler(name);
+        delete _glRotatingFileLogHandler;
+      }
+      RotatingFileLogOptions options;
+      options.maxFileSize = qi::os::getEnvParam<std::size_t>("QI_LOG_FILE_MAX_SIZE",
+                                                             options.maxFileSize);
+      options.maxFiles = qi::os::getEnvParam<unsigned int>("QI_LOG_FILE_MAX_FILES",
+                                                           options.maxFiles);
+      options.compress = qi::os::getEnvParam<bool>("QI_LOG_FILE_COMPRESS", options.compress);
+      _glRotatingFileLogHandler = new RotatingFileLogHandler(path, options);
+      addHandler(name,
+                 boost::bind(&RotatingFileLogHandler::log, _glRotatingFileLogHandler,
+                             _1, _2, _3, _4, _5, _6, _7, _8),
+                 logLevel());
+    }
+
     static const std::string contextLogOption = ""
         "Show context logs, it's a bit field (add the values below):\n"
         " 1  : Verbosity\n"
@@ -1229,6 +1751,13 @@ namespace qi {
         "Can be set with env var QI_LOG_FILTERS\n"
         "Example: 'qi.*=debug:-qi.foo:+qi.foo.bar' (all qi.* logs in info, remove all qi.foo logs except qi.foo.bar)";
 
+    static const std::string fileLogOption = ""
+        "Also write logs to this file, through a buffer.\n"
+        " Errors are written right away, other logs at least every second.\n"
+        " The file is rotated when it reaches QI_LOG_FILE_MAX_SIZE bytes (default: 10 MiB),\n"
+        " keeping QI_LOG_FILE_MAX_FILES old files (default: 5),\n"
+        " compressed if QI_LOG_FILE_COMPRESS is set to 1.";
+
     _QI_COMMAND_LINE_OPTIONS(
       "Logging options",
       ("qi-log-context",     value<int>()->notifier(&setContext), contextLogOption.c_str())
@@ -1236,6 +1765,7 @@ namespace qi {
       ("qi-log-level",       value<std::string>()->notifier(&_setLogLevel), levelLogOption.c_str())
       ("qi-log-color",       value<std::string>()->notifier(&_setColor), "Tell if we should put color or not in log (auto, always, never).")
       ("qi-log-filters",     value<std::string>()->notifier(&_setFilters), filterLogOption.c_str())
+      ("qi-log-file",        value<std::string>()->notifier(&_setLogFile), fileLogOption.c_str())
     )
 
     // deprecated
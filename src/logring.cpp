@@ -0,0 +1,232 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "logring_p.hpp"
+
+namespace qi
+{
+  namespace log
+  {
+    namespace detail
+    {
+      namespace
+      {
+        const std::size_t alignment = sizeof(std::uint64_t);
+
+        std::size_t alignUp(std::size_t size)
+        {
+          return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        // A size of 0 marks the padding before the end of the buffer.
+        const std::uint32_t paddingMark = 0u;
+      }
+
+      struct LogRing::Header
+      {
+        std::uint32_t               size; // aligned size of the whole record
+        std::uint32_t               fileSize;
+        std::uint32_t               functionSize;
+        std::uint32_t               messageSize;
+        qi::LogLevel                level;
+        int                         line;
+        qi::Clock::time_point       date;
+        qi::SystemClock::time_point systemDate;
+        Category*                   category;
+        const LogSite*              site;
+      };
+
+      LogRing::LogRing(std::size_t capacity)
+        : orphaned(false)
+        , _capacity(std::max(alignUp(capacity), 4 * alignUp(sizeof(Header) + 3)))
+        , _storage(new std::uint64_t[_capacity / alignment])
+        , _data(reinterpret_cast<char*>(_storage.get()))
+        , _head(0u)
+        , _tail(0u)
+      {
+      }
+
+      LogRing::PushResult LogRing::tryPush(qi::LogLevel level,
+                                           qi::Clock::time_point date,
+                                           qi::SystemClock::time_point systemDate,
+                                           Category* category,
+                                           const char* file,
+                                           const char* function,
+                                           int line,
+                                           const char* message)
+      {
+        if (!file)
+          file = "";
+        if (!function)
+          function = "";
+        if (!message)
+          message = "";
+        const std::size_t fileSize = std::strlen(file) + 1;
+        const std::size_t functionSize = std::strlen(function) + 1;
+        std::size_t messageSize = std::strlen(message) + 1;
+
+        // Truncate the message so that the record fits in a quarter of the
+        // ring: a few large records must not starve the others.
+        const std::size_t maxSize = _capacity / 4;
+        std::size_t size = alignUp(sizeof(Header) + fileSize + functionSize + messageSize);
+        if (size > maxSize)
+        {
+          const std::size_t excess = size - maxSize;
+          if (excess >= messageSize)
+            return PushResult_TooBig; // file and function names alone do not fit
+          messageSize -= excess;
+          size = alignUp(sizeof(Header) + fileSize + functionSize + messageSize);
+        }
+
+        std::size_t head;
+        char* dst = reserve(size, head);
+        if (!dst)
+          return PushResult_Full;
+
+        Header header;
+        header.size = static_cast<std::uint32_t>(size);
+        header.fileSize = static_cast<std::uint32_t>(fileSize);
+        header.functionSize = static_cast<std::uint32_t>(functionSize);
+        header.messageSize = static_cast<std::uint32_t>(messageSize);
+        header.level = level;
+        header.line = line;
+        header.date = date;
+        header.systemDate = systemDate;
+        header.category = category;
+        header.site = nullptr;
+        std::memcpy(dst, &header, sizeof(header));
+        char* strings = dst + sizeof(header);
+        std::memcpy(strings, file, fileSize);
+        strings += fileSize;
+        std::memcpy(strings, function, functionSize);
+        strings += functionSize;
+        std::memcpy(strings, message, messageSize - 1);
+        strings[messageSize - 1] = '\0';
+
+        _head.store(head + size, std::memory_order_release);
+        return PushResult_Pushed;
+      }
+
+      LogRing::PushResult LogRing::tryPush(qi::Clock::time_point date,
+                                           qi::SystemClock::time_point systemDate,
+                                           Category* category,
+                                           const LogSite& site,
+                                           const char* args,
+                                           std::size_t argsSize)
+      {
+        const std::size_t size = alignUp(sizeof(Header) + argsSize);
+        if (size > _capacity / 4)
+          return PushResult_TooBig;
+        std::size_t head;
+        char* dst = reserve(size, head);
+        if (!dst)
+          return PushResult_Full;
+
+        Header header;
+        header.size = static_cast<std::uint32_t>(size);
+        header.fileSize = 0u;
+        header.functionSize = 0u;
+        header.messageSize = static_cast<std::uint32_t>(argsSize);
+        header.level = site.level;
+        header.line = site.line;
+        header.date = date;
+        header.systemDate = systemDate;
+        header.category = category;
+        header.site = &site;
+        std::memcpy(dst, &header, sizeof(header));
+        std::memcpy(dst + sizeof(header), args, argsSize);
+
+        _head.store(head + size, std::memory_order_release);
+        return PushResult_Pushed;
+      }
+
+      char* LogRing::reserve(std::size_t size, std::size_t& head)
+      {
+        head = _head.load(std::memory_order_relaxed);
+        const std::size_t tail = _tail.load(std::memory_order_acquire);
+        const std::size_t offset = head % _capacity;
+        const std::size_t contiguous = _capacity - offset;
+        const std::size_t needed = size <= contiguous ? size : contiguous + size;
+        if (_capacity - (head - tail) < needed)
+          return nullptr;
+
+        if (size > contiguous)
+        {
+          std::memcpy(_data + offset, &paddingMark, sizeof(paddingMark));
+          head += contiguous;
+          return _data;
+        }
+        return _data + offset;
+      }
+
+      bool LogRing::firstRecord(std::size_t& tail, std::size_t& offset)
+      {
+        tail = _tail.load(std::memory_order_relaxed);
+        const std::size_t head = _head.load(std::memory_order_acquire);
+        if (tail == head)
+          return false;
+        offset = tail % _capacity;
+        std::uint32_t size;
+        std::memcpy(&size, _data + offset, sizeof(size));
+        if (size == paddingMark)
+        {
+          tail += _capacity - offset;
+          _tail.store(tail, std::memory_order_release);
+          if (tail == head)
+            return false;
+          offset = 0u;
+        }
+        return true;
+      }
+
+      bool LogRing::front(Record& record)
+      {
+        std::size_t tail, offset;
+        if (!firstRecord(tail, offset))
+          return false;
+        const char* src = _data + offset;
+        Header header;
+        std::memcpy(&header, src, sizeof(header));
+        record.level = header.level;
+        record.line = header.line;
+        record.date = header.date;
+        record.systemDate = header.systemDate;
+        record.category = header.category;
+        record.site = header.site;
+        if (header.site)
+        {
+          record.file = header.site->file;
+          record.function = header.site->function;
+          record.message = src + sizeof(header);
+        }
+        else
+        {
+          record.file = src + sizeof(header);
+          record.function = record.file + header.fileSize;
+          record.message = record.function + header.functionSize;
+        }
+        record.messageSize = header.messageSize;
+        return true;
+      }
+
+      void LogRing::pop()
+      {
+        std::size_t tail, offset;
+        if (!firstRecord(tail, offset))
+          return;
+        std::uint32_t size;
+        std::memcpy(&size, _data + offset, sizeof(size));
+        _tail.store(tail + size, std::memory_order_release);
+      }
+
+      bool LogRing::empty() const
+      {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+      }
+    }
+  }
+}
@@ -0,0 +1,122 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_LOGRING_P_HPP_
+#define _SRC_LOGRING_P_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <boost/noncopyable.hpp>
+#include <qi/api.hpp>
+#include <qi/clock.hpp>
+#include <qi/log.hpp>
+
+namespace qi
+{
+  namespace log
+  {
+    namespace detail
+    {
+      /// Single producer, single consumer ring of log records.
+      ///
+      /// Each thread logging asynchronously owns one ring, and the log thread
+      /// drains them all. Records have a variable length: the strings are
+      /// copied right after a fixed size header, without truncation as long
+      /// as the record fits in a quarter of the ring.
+      class QI_API LogRing : private boost::noncopyable
+      {
+      public:
+        /// A record, as seen by the consumer. The pointers are valid until
+        /// the record is popped.
+        struct Record
+        {
+          qi::LogLevel                level;
+          int                         line;
+          qi::Clock::time_point       date;
+          qi::SystemClock::time_point systemDate;
+          Category*                   category;
+          const char*                 file;
+          const char*                 function;
+          const char*                 message;
+          /// Set for the records of the qiLog*Deferred macros: the message
+          /// holds the encoded arguments, of messageSize bytes.
+          const LogSite*              site;
+          std::size_t                 messageSize;
+        };
+
+        /// Outcome of a push.
+        enum PushResult
+        {
+          PushResult_Pushed,
+          /// The ring is full: the push may succeed once the ring is drained.
+          PushResult_Full,
+          /// The record can never fit in the ring, even when empty.
+          PushResult_TooBig,
+        };
+
+        /// The capacity is rounded up to a multiple of 8 bytes.
+        explicit LogRing(std::size_t capacity);
+
+        std::size_t capacity() const { return _capacity; }
+
+        /// Producer side. The message is truncated to fit in a quarter of the
+        /// ring; the record is too big only if the file and function names
+        /// alone do not fit.
+        PushResult tryPush(qi::LogLevel level,
+                     qi::Clock::time_point date,
+                     qi::SystemClock::time_point systemDate,
+                     Category* category,
+                     const char* file,
+                     const char* function,
+                     int line,
+                     const char* message);
+
+        /// Producer side, for the qiLog*Deferred macros. The file and function
+        /// names are taken from the site, and the arguments are never
+        /// truncated: the record is too big if they do not fit in a quarter
+        /// of the ring.
+        PushResult tryPush(qi::Clock::time_point date,
+                     qi::SystemClock::time_point systemDate,
+                     Category* category,
+                     const LogSite& site,
+                     const char* args,
+                     std::size_t size);
+
+        /// Consumer side. Return false if the ring is empty.
+        bool front(Record& record);
+        /// Consumer side. Remove the record returned by the last `front`.
+        void pop();
+
+        bool empty() const;
+
+        /// Set when the producer thread has exited: the ring can be dropped
+        /// once drained.
+        std::atomic<bool> orphaned;
+
+      private:
+        struct Header;
+
+        // Reserve size bytes, return where to write the record or nullptr
+        // if the ring is full. `head` receives the position to commit.
+        char* reserve(std::size_t size, std::size_t& head);
+
+        // Skip the padding record at the end of the buffer, if any.
+        // Return the offset of the first record, or false if the ring is empty.
+        bool firstRecord(std::size_t& tail, std::size_t& offset);
+
+        const std::size_t _capacity;
+        std::unique_ptr<std::uint64_t[]> _storage;
+        char* const _data;
+        // Monotonic positions, in bytes.
+        std::atomic<std::size_t> _head; // written by the producer
+        std::atomic<std::size_t> _tail; // written by the consumer
+      };
+    }
+  }
+}
+
+#endif  // _SRC_LOGRING_P_HPP_
@@ -270,7 +270,7 @@ namespace qi {
         if (!mm) {
           std::stringstream ss;
           ss << "No such method " << msg.address();
-          qiLogError() << ss.str();
+          qiLogErrorLimited(10) << ss.str();
           throw std::runtime_error(ss.str());
         }
         sigparam = mm->parametersSignature();
@@ -285,7 +285,7 @@ namespace qi {
           if (mm)
             sigparam = mm->parametersSignature();
           else {
-            qiLogError() << "No such signal/method on event message " << msg.address();
+            qiLogErrorLimited(10) << "No such signal/method on event message " << msg.address();
             return;
           }
         }
@@ -298,7 +298,7 @@ namespace qi {
       }
       else
       {
-        qiLogError() << "Unexpected message type " << msg.type() << " on " << msg.address();
+        qiLogErrorLimited(10) << "Unexpected message type " << msg.type() << " on " << msg.address();
         return;
       }
 
@@ -347,6 +347,10 @@ namespace qi {
         mustDestroyRef = true; // Reactivate destroy on scope exit.
       }
       mfp = ref.asTupleValuePtr();
+      // Hand the arguments over to the call: a queued call keeps them instead
+      // of copying them.
+      mfp.setStorage(std::make_shared<AnyValue>(ref, false, true));
+      mustDestroyRef = false;
       /* Because of 'global' _currentSocket, we cannot support parallel
       * executions at this point.
       * Both on self, and on obj which can use currentSocket() too.
@@ -399,7 +403,7 @@ namespace qi {
       }
         break;
       default:
-        qiLogError() << "unknown request of type " << (int)msg.type() << " on service: " << msg.address();
+        qiLogErrorLimited(10) << "unknown request of type " << (int)msg.type() << " on service: " << msg.address();
       }
       //########################
     } catch (const std::runtime_error &e) {
@@ -131,6 +131,9 @@ namespace qi {
       ServiceDirectoryAction_ServiceAdded        = 106,
       ServiceDirectoryAction_ServiceRemoved      = 107,
       ServiceDirectoryAction_MachineId           = 108,
+      // 109 is _socketOfService, used locally only.
+      ServiceDirectoryAction_ChangesSince        = 110,
+      ServiceDirectoryAction_ServiceChanged      = 111,
     };
 
     enum Type
@@ -162,6 +165,15 @@ namespace qi {
      * NOT IMPLEMENTED
      */
     static const unsigned int TypeFlag_ReturnType = 2;
+    /* If flag is set, the payload is only a descriptor of a shared memory
+     * segment holding the actual payload.
+     * Only set when the SharedMemoryPayload capability is shared.
+     */
+    static const unsigned int TypeFlag_SharedMemoryPayload = 4;
+    /* If flag is set, message payload is compressed.
+     * Only set when the PayloadCompression capability is shared.
+     */
+    static const unsigned int TypeFlag_CompressedPayload = 8;
 
     QI_API static const char* typeToString(Type t);
     QI_API static const char* actionToString(unsigned int action, unsigned int service);
@@ -0,0 +1,158 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <iterator>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <ka/sha1.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include <qi/path.hpp>
+#include "metaobjectcache.hpp"
+#include "../buffer_p.hpp"
+
+qiLogCategory("qimessaging.metaobjectcache");
+
+namespace qi
+{
+  namespace
+  {
+    std::string encode(const MetaObject& metaObject)
+    {
+      Buffer buffer;
+      encodeBinary(&buffer, AutoAnyReference(metaObject));
+      std::string res;
+      res.reserve(buffer.totalSize());
+      BufferPrivate::forEachWireChunk(buffer, [&](const char* data, std::size_t size) {
+        res.append(data, size);
+      });
+      return res;
+    }
+
+    std::string hexDigest(const std::string& data)
+    {
+      static const char hexDigits[] = "0123456789abcdef";
+      const ka::sha1_digest_t digest = ka::sha1(data.begin(), data.end());
+      std::string res;
+      res.reserve(2 * digest.size());
+      for (const auto byte : digest)
+      {
+        res.push_back(hexDigits[byte >> 4]);
+        res.push_back(hexDigits[byte & 0xf]);
+      }
+      return res;
+    }
+
+    // Hashes come from the network and are used as file names: only accept
+    // the hexadecimal representation of a SHA-1 digest.
+    bool isValidHash(const std::string& hash)
+    {
+      return hash.size() == 2 * std::tuple_size<ka::sha1_digest_t>::value
+          && std::all_of(hash.begin(), hash.end(), [](char c) {
+               return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+             });
+    }
+
+    std::string defaultDirectory()
+    {
+      const std::string env = os::getenv("QI_METAOBJECT_CACHE_DIR");
+      if (!env.empty())
+        return env;
+      return path::userWritableDataPath("qimessaging", "metaobjects");
+    }
+  }
+
+  MetaObjectCache::MetaObjectCache(const std::string& directory)
+    : _directory(directory)
+  {
+  }
+
+  MetaObjectCache& MetaObjectCache::instance()
+  {
+    static MetaObjectCache cache(defaultDirectory());
+    return cache;
+  }
+
+  std::string MetaObjectCache::hash(const MetaObject& metaObject)
+  {
+    return hexDigest(encode(metaObject));
+  }
+
+  boost::optional<MetaObject> MetaObjectCache::find(const std::string& hash)
+  {
+    if (!isValidHash(hash))
+      return {};
+    boost::mutex::scoped_lock lock(_mutex);
+    const auto it = _entries.find(hash);
+    if (it != _entries.end())
+      return it->second;
+    if (_directory.empty())
+      return {};
+
+    const boost::filesystem::path file = qi::Path(_directory).bfsPath() / hash;
+    try
+    {
+      boost::filesystem::ifstream input(file, std::ios::binary);
+      if (!input)
+        return {};
+      const std::string content{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+      // A truncated, corrupted or foreign file must not be taken for the
+      // metaobject of this hash.
+      if (hexDigest(content) != hash)
+        throw std::runtime_error("content does not match its hash");
+      Buffer buffer;
+      buffer.write(content.data(), content.size());
+      BufferReader reader(buffer);
+      MetaObject metaObject;
+      decodeBinary(&reader, &metaObject);
+      qiLogDebug() << "Loaded metaobject " << hash << " from " << file.string();
+      _entries[hash] = metaObject;
+      return metaObject;
+    }
+    catch (const std::exception& e)
+    {
+      qiLogVerbose() << "Discarding invalid cached metaobject " << file.string() << ": " << e.what();
+      boost::system::error_code ec;
+      boost::filesystem::remove(file, ec);
+      return {};
+    }
+  }
+
+  void MetaObjectCache::insert(const std::string& hash, const MetaObject& metaObject)
+  {
+    if (!isValidHash(hash))
+      return;
+    boost::mutex::scoped_lock lock(_mutex);
+    if (!_entries.insert(std::make_pair(hash, metaObject)).second || _directory.empty())
+      return;
+
+    // Write in a temporary file first: other processes may read the cache.
+    const boost::filesystem::path dir = qi::Path(_directory).bfsPath();
+    const boost::filesystem::path file = dir / hash;
+    const boost::filesystem::path tmp =
+        dir / (hash + ".tmp" + boost::lexical_cast<std::string>(os::getpid()));
+    try
+    {
+      boost::filesystem::create_directories(dir);
+      const std::string encoded = encode(metaObject);
+      {
+        boost::filesystem::ofstream output(tmp, std::ios::binary | std::ios::trunc);
+        output.write(encoded.data(), encoded.size());
+        if (!output)
+          throw std::runtime_error("cannot write " + tmp.string());
+      }
+      boost::filesystem::rename(tmp, file);
+    }
+    catch (const std::exception& e)
+    {
+      qiLogVerbose() << "Cannot store metaobject " << hash << " on disk: " << e.what();
+      boost::system::error_code ec;
+      boost::filesystem::remove(tmp, ec);
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_METAOBJECTCACHE_HPP_
+#define _SRC_METAOBJECTCACHE_HPP_
+
+#include <map>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/api.hpp>
+#include <qi/type/metaobject.hpp>
+
+namespace qi
+{
+  /// Cache of the metaobjects of remote services, indexed by their hash.
+  ///
+  /// Servers advertise the hash of the metaobject of each of their services
+  /// when a client connects (see capabilityname::metaObjectHashes). If the
+  /// hash is known, the client does not need to fetch the metaobject.
+  ///
+  /// Entries are kept in memory and, if a directory is given, on disk so that
+  /// they survive the process.
+  class QI_API MetaObjectCache : private boost::noncopyable
+  {
+  public:
+    /// If `directory` is empty, the cache is only kept in memory.
+    explicit MetaObjectCache(const std::string& directory = std::string());
+
+    /// The cache of the process. Its directory is given by the
+    /// `QI_METAOBJECT_CACHE_DIR` environment variable, and defaults to the
+    /// `metaobjects` directory of the writable data path of qimessaging.
+    static MetaObjectCache& instance();
+
+    /// Return the hash of a metaobject, as advertised by servers.
+    static std::string hash(const MetaObject& metaObject);
+
+    /// Look for the metaobject of the given hash in memory, then on disk.
+    boost::optional<MetaObject> find(const std::string& hash);
+
+    /// Store a metaobject. Errors while writing on disk are only logged.
+    void insert(const std::string& hash, const MetaObject& metaObject);
+
+    const std::string& directory() const { return _directory; }
+
+  private:
+    boost::mutex _mutex;
+    const std::string _directory;
+    std::map<std::string, MetaObject> _entries;
+  };
+}
+
+#endif  // _SRC_METAOBJECTCACHE_HPP_
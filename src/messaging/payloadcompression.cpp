@@ -0,0 +1,367 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <zlib.h>
+#include <qi/clock.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "payloadcompression.hpp"
+#include "../buffer_p.hpp"
+
+qiLogCategory("qimessaging.payloadcompression");
+
+namespace qi
+{
+  namespace
+  {
+    // algorithm (uint8) + original size (uint64)
+    const std::size_t headerSize = sizeof(qi::uint8_t) + sizeof(qi::uint64_t);
+
+    const std::size_t defaultThreshold = 16 * 1024;
+
+    struct Counters
+    {
+      std::atomic<qi::uint64_t> compressedMessages;
+      std::atomic<qi::uint64_t> decompressedMessages;
+      std::atomic<qi::uint64_t> bytesBeforeCompression;
+      std::atomic<qi::uint64_t> bytesAfterCompression;
+      std::atomic<qi::uint64_t> compressionTimeNs;
+      std::atomic<qi::uint64_t> decompressionTimeNs;
+    };
+
+    Counters& counters()
+    {
+      static Counters c;
+      return c;
+    }
+
+    qi::uint64_t nanosecondsSince(SteadyClock::time_point start)
+    {
+      return static_cast<qi::uint64_t>(
+            boost::chrono::duration_cast<qi::NanoSeconds>(SteadyClock::now() - start).count());
+    }
+
+    const char* algorithmName(PayloadCompressor::Algorithm algo)
+    {
+      switch (algo)
+      {
+      case PayloadCompressor::Algorithm::Zlib:
+        return "zlib";
+      case PayloadCompressor::Algorithm::None:
+        break;
+      }
+      return "none";
+    }
+
+    PayloadCompressor::Algorithm algorithmFromName(const std::string& name)
+    {
+      if (name == "zlib")
+        return PayloadCompressor::Algorithm::Zlib;
+      return PayloadCompressor::Algorithm::None;
+    }
+
+    std::vector<std::string> algorithmList(const boost::optional<AnyValue>& capability)
+    {
+      std::vector<std::string> res;
+      if (!capability)
+        return res;
+      try
+      {
+        const std::string value = capability->to<std::string>();
+        boost::algorithm::split(res, value, boost::algorithm::is_any_of(","));
+        for (auto& name : res)
+          boost::algorithm::trim(name);
+      }
+      catch (const std::exception& e)
+      {
+        qiLogDebug() << "Invalid capability value: " << e.what();
+      }
+      return res;
+    }
+  }
+
+  PayloadCompressionStats payloadCompressionStats()
+  {
+    Counters& c = counters();
+    PayloadCompressionStats stats;
+    stats.compressedMessages = c.compressedMessages.load();
+    stats.decompressedMessages = c.decompressedMessages.load();
+    stats.bytesBeforeCompression = c.bytesBeforeCompression.load();
+    stats.bytesAfterCompression = c.bytesAfterCompression.load();
+    stats.compressionTimeNs = c.compressionTimeNs.load();
+    stats.decompressionTimeNs = c.decompressionTimeNs.load();
+    return stats;
+  }
+
+  void resetPayloadCompressionStats()
+  {
+    Counters& c = counters();
+    c.compressedMessages = 0;
+    c.decompressedMessages = 0;
+    c.bytesBeforeCompression = 0;
+    c.bytesAfterCompression = 0;
+    c.compressionTimeNs = 0;
+    c.decompressionTimeNs = 0;
+  }
+
+  // zlib streams, initialized on first use.
+  struct PayloadCompressor::Streams
+  {
+    z_stream deflater;
+    z_stream inflater;
+    bool deflaterReady = false;
+    bool inflaterReady = false;
+    // Set if compression failed midway: the receiver can no longer follow the
+    // stream, so messages are sent inline until the next connection.
+    bool deflaterBroken = false;
+
+    Streams()
+    {
+      std::memset(&deflater, 0, sizeof(deflater));
+      std::memset(&inflater, 0, sizeof(inflater));
+    }
+
+    ~Streams()
+    {
+      if (deflaterReady)
+        deflateEnd(&deflater);
+      if (inflaterReady)
+        inflateEnd(&inflater);
+    }
+
+    z_stream& deflateStream()
+    {
+      if (!deflaterReady)
+      {
+        // Favor speed: compression is done on the send path.
+        if (deflateInit(&deflater, Z_BEST_SPEED) != Z_OK)
+          throw std::runtime_error("cannot initialize zlib compression stream");
+        deflaterReady = true;
+      }
+      return deflater;
+    }
+
+    z_stream& inflateStream()
+    {
+      if (!inflaterReady)
+      {
+        if (inflateInit(&inflater) != Z_OK)
+          throw std::runtime_error("cannot initialize zlib decompression stream");
+        inflaterReady = true;
+      }
+      return inflater;
+    }
+  };
+
+  PayloadCompressor::PayloadCompressor()
+    : _streams(new Streams)
+  {
+  }
+
+  PayloadCompressor::~PayloadCompressor() = default;
+
+  size_t PayloadCompressor::threshold()
+  {
+    static const size_t value = []{
+      const std::string env = os::getenv("QI_COMPRESSION_THRESHOLD");
+      if (env.empty())
+        return defaultThreshold;
+      try
+      {
+        return boost::lexical_cast<size_t>(env);
+      }
+      catch (const boost::bad_lexical_cast&)
+      {
+        qiLogWarning() << "Invalid value for QI_COMPRESSION_THRESHOLD: '" << env << "'";
+        return defaultThreshold;
+      }
+    }();
+    return value;
+  }
+
+  PayloadCompressor::Algorithm PayloadCompressor::negotiate(const StreamContext& context)
+  {
+    const auto local = algorithmList(context.localCapability(capabilityname::payloadCompression));
+    if (local.empty())
+      return Algorithm::None;
+    const auto remote = algorithmList(context.remoteCapability(capabilityname::payloadCompression));
+    for (const auto& name : local)
+    {
+      const Algorithm algo = algorithmFromName(name);
+      if (algo != Algorithm::None && std::find(remote.begin(), remote.end(), name) != remote.end())
+        return algo;
+    }
+    return Algorithm::None;
+  }
+
+  bool PayloadCompressor::compress(Message& msg, const StreamContext& context)
+  {
+    const Buffer& payload = msg.buffer();
+    const std::size_t size = payload.totalSize();
+    if (size < threshold()
+        || (msg.flags() & (Message::TypeFlag_CompressedPayload | Message::TypeFlag_SharedMemoryPayload)))
+      return false;
+    const Algorithm algo = negotiate(context);
+    if (algo == Algorithm::None)
+      return false;
+
+    const auto start = SteadyClock::now();
+    boost::mutex::scoped_lock lock(_mutex);
+    if (_streams->deflaterBroken)
+      return false;
+    std::size_t produced = headerSize;
+    Buffer compressed;
+    try
+    {
+      z_stream& z = _streams->deflateStream();
+      _scratch.resize(headerSize + deflateBound(&z, static_cast<uLong>(size)));
+      _scratch[0] = static_cast<unsigned char>(algo);
+      const qi::uint64_t originalSize = size;
+      std::memcpy(&_scratch[1], &originalSize, sizeof(originalSize));
+
+      const auto run = [&](int flush) {
+        do
+        {
+          if (produced == _scratch.size())
+            _scratch.resize(_scratch.size() * 2);
+          z.next_out = &_scratch[produced];
+          z.avail_out = static_cast<uInt>(_scratch.size() - produced);
+          const int res = deflate(&z, flush);
+          produced = _scratch.size() - z.avail_out;
+          if (res == Z_STREAM_ERROR)
+            throw std::runtime_error("zlib compression stream is corrupted");
+        } while (z.avail_in != 0 || (flush == Z_SYNC_FLUSH && z.avail_out == 0));
+      };
+      BufferPrivate::forEachWireChunk(payload, [&](const char* data, std::size_t chunkSize) {
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        z.avail_in = static_cast<uInt>(chunkSize);
+        run(Z_NO_FLUSH);
+      });
+      // Flush to a byte boundary, keeping the history for the next message.
+      z.next_in = nullptr;
+      z.avail_in = 0;
+      run(Z_SYNC_FLUSH);
+      compressed.write(_scratch.data(), produced);
+    }
+    catch (const std::exception& e)
+    {
+      // Data may have been given to the stream: it cannot be used anymore.
+      _streams->deflaterBroken = true;
+      qiLogError() << "Cannot compress payload of message " << msg.id()
+                   << ", compression disabled until reconnection: " << e.what();
+      return false;
+    }
+    lock.unlock();
+
+    msg.setBuffer(std::move(compressed));
+    msg.addFlags(Message::TypeFlag_CompressedPayload);
+
+    Counters& c = counters();
+    ++c.compressedMessages;
+    c.bytesBeforeCompression += size;
+    c.bytesAfterCompression += produced;
+    c.compressionTimeNs += nanosecondsSince(start);
+    qiLogDebug() << "Message " << msg.id() << ": " << size << " bytes compressed to "
+                 << produced << " with " << algorithmName(algo);
+    return true;
+  }
+
+  bool PayloadCompressor::decompress(Message& msg, const StreamContext& context, std::size_t maxSize)
+  {
+    const auto start = SteadyClock::now();
+    if (negotiate(context) == Algorithm::None)
+    {
+      qiLogError() << "Message " << msg.id()
+                   << " has a compressed payload, but no compression was negotiated";
+      return false;
+    }
+    const Buffer& payload = msg.buffer();
+    const unsigned char* data = static_cast<const unsigned char*>(payload.data());
+    const std::size_t size = payload.size();
+    if (size < headerSize || !payload.subBuffers().empty())
+    {
+      qiLogError() << "Invalid compressed payload of message " << msg.id();
+      return false;
+    }
+    const Algorithm algo = static_cast<Algorithm>(data[0]);
+    if (algo != Algorithm::Zlib)
+    {
+      qiLogError() << "Unsupported compression algorithm " << static_cast<int>(data[0])
+                   << " for message " << msg.id();
+      return false;
+    }
+    qi::uint64_t originalSize = 0;
+    std::memcpy(&originalSize, data + 1, sizeof(originalSize));
+    if (originalSize > std::numeric_limits<qi::uint32_t>::max() || originalSize > maxSize)
+    {
+      qiLogError() << "Invalid compressed payload size " << originalSize << " of message "
+                   << msg.id() << ", maximum is " << maxSize;
+      return false;
+    }
+
+    // The declared size is not trusted to allocate the payload: the output
+    // grows as data is actually decompressed, and one more byte than declared
+    // is asked to detect longer payloads.
+    Buffer decompressed;
+    try
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      z_stream& z = _streams->inflateStream();
+      z.next_in = const_cast<Bytef*>(data + headerSize);
+      z.avail_in = static_cast<uInt>(size - headerSize);
+      const std::size_t limit = static_cast<std::size_t>(originalSize) + 1;
+      std::size_t produced = 0;
+      _scratch.resize((std::min)(limit, std::size_t(64 * 1024)));
+      while (true)
+      {
+        z.next_out = &_scratch[produced];
+        z.avail_out = static_cast<uInt>(_scratch.size() - produced);
+        const int res = inflate(&z, Z_SYNC_FLUSH);
+        produced = _scratch.size() - z.avail_out;
+        if ((res != Z_OK && res != Z_BUF_ERROR) || produced > originalSize)
+        {
+          qiLogError() << "Cannot decompress payload of message " << msg.id() << ": "
+                       << (z.msg ? z.msg : "size mismatch");
+          return false;
+        }
+        if (z.avail_out != 0)
+          break;
+        _scratch.resize((std::min)(limit, _scratch.size() * 2));
+      }
+      if (z.avail_in != 0 || produced != originalSize)
+      {
+        qiLogError() << "Cannot decompress payload of message " << msg.id() << ": size mismatch";
+        return false;
+      }
+      decompressed.write(_scratch.data(), produced);
+    }
+    catch (const std::exception& e)
+    {
+      qiLogError() << "Cannot decompress payload of message " << msg.id() << ": " << e.what();
+      return false;
+    }
+
+    msg.setBuffer(std::move(decompressed));
+    msg.setFlags(msg.flags() & ~Message::TypeFlag_CompressedPayload);
+
+    Counters& c = counters();
+    ++c.decompressedMessages;
+    c.decompressionTimeNs += nanosecondsSince(start);
+    return true;
+  }
+
+  void PayloadCompressor::reset()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _streams.reset(new Streams);
+    std::vector<unsigned char>().swap(_scratch);
+  }
+}
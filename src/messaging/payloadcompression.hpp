@@ -0,0 +1,106 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_PAYLOADCOMPRESSION_HPP_
+#define _SRC_PAYLOADCOMPRESSION_HPP_
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/api.hpp>
+#include <qi/types.hpp>
+#include "message.hpp"
+#include "streamcontext.hpp"
+
+namespace qi
+{
+  /// Process-wide counters of the payload compression.
+  struct PayloadCompressionStats
+  {
+    qi::uint64_t compressedMessages = 0;
+    qi::uint64_t decompressedMessages = 0;
+    /// Payload bytes given to the compressor and bytes actually sent.
+    qi::uint64_t bytesBeforeCompression = 0;
+    qi::uint64_t bytesAfterCompression = 0;
+    qi::uint64_t compressionTimeNs = 0;
+    qi::uint64_t decompressionTimeNs = 0;
+
+    /// Compressed size over original size, 1 if nothing was compressed.
+    double ratio() const
+    {
+      return bytesBeforeCompression
+          ? double(bytesAfterCompression) / double(bytesBeforeCompression)
+          : 1.0;
+    }
+  };
+
+  QI_API PayloadCompressionStats payloadCompressionStats();
+  QI_API void resetPayloadCompressionStats();
+
+  /// Compresses the payload of large messages sent on a socket, and
+  /// decompresses the ones received on it.
+  ///
+  /// Compression is used when both ends advertise a common algorithm in the
+  /// `PayloadCompression` capability, which is a comma-separated list of
+  /// algorithm names by order of preference. Only payloads of at least
+  /// threshold() bytes are compressed. Compressed messages are flagged with
+  /// Message::TypeFlag_CompressedPayload, and their payload is:
+  ///   - the algorithm (uint8),
+  ///   - the original payload size (uint64),
+  ///   - the compressed data.
+  ///
+  /// Each direction of the socket is one compression stream, so that
+  /// redundancy between messages is exploited: compress() must be called in
+  /// the order the messages are sent, decompress() in the order they are
+  /// received, and reset() when the connection is lost.
+  class QI_API PayloadCompressor : private boost::noncopyable
+  {
+  public:
+    enum class Algorithm : qi::uint8_t
+    {
+      None = 0,
+      Zlib = 1,
+    };
+
+    PayloadCompressor();
+    ~PayloadCompressor();
+
+    /// Minimum payload size for which compression is used.
+    /// Can be set with the `QI_COMPRESSION_THRESHOLD` environment variable.
+    static size_t threshold();
+
+    /// Return the preferred local algorithm that the remote end also supports.
+    static Algorithm negotiate(const StreamContext& context);
+
+    /// Compress the payload of `msg` if it is big enough and an algorithm is
+    /// shared on `context`.
+    /// Return true if the message was modified.
+    bool compress(Message& msg, const StreamContext& context);
+
+    /// Replace the payload of a message flagged with
+    /// Message::TypeFlag_CompressedPayload by its decompressed content.
+    /// Return false if no algorithm is shared on `context`, if the declared
+    /// original size is above `maxSize` or if the payload is invalid, in which
+    /// case the stream is unusable.
+    bool decompress(Message& msg, const StreamContext& context,
+                    std::size_t maxSize = std::numeric_limits<qi::uint32_t>::max());
+
+    /// Restart both streams, for a new connection.
+    void reset();
+
+  private:
+    struct Streams;
+
+    boost::mutex _mutex;
+    std::unique_ptr<Streams> _streams;
+    std::vector<unsigned char> _scratch;
+  };
+}
+
+#endif  // _SRC_PAYLOADCOMPRESSION_HPP_
@@ -173,15 +173,17 @@ namespace qi {
           // Remove top-level tuple
           //sig = sig.substr(1, sig.length()-2);
           //TODO: Optimise
-          AnyValue value(msg.value((msg.flags() & Message::TypeFlag_DynamicPayload) ? "m" : sig,
-                                   sock));
+          auto value = std::make_shared<AnyValue>(
+              msg.value((msg.flags() & Message::TypeFlag_DynamicPayload) ? "m" : sig, sock));
 
           {
             GenericFunctionParameters args;
             if (sig == "m")
-              args = value.content().asTupleValuePtr();
+              args = value->content().asTupleValuePtr();
             else
-              args = value.asTupleValuePtr();
+              args = value->asTupleValuePtr();
+            // Asynchronous subscribers share the values instead of copying them.
+            args.setStorage(value);
             qiLogDebug() << "Triggering local event listeners with args : " << args.size();
             sb->trigger(args);
           }
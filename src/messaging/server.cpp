@@ -12,6 +12,7 @@
 #include <exception>
 #include "servicedirectoryclient.hpp"
 #include "authprovider_p.hpp"
+#include "metaobjectcache.hpp"
 
 qiLogCategory("qimessaging.server");
 
@@ -46,6 +47,11 @@ namespace qi {
   {
     if (!obj)
       return false;
+    // The metaobject of a service does not change once it is registered:
+    // clients never fetch it again.
+    boost::optional<std::string> metaObjectHash;
+    if (auto serviceObject = boost::dynamic_pointer_cast<ServiceBoundObject>(obj))
+      metaObjectHash = MetaObjectCache::hash(serviceObject->metaObject(0));
     //register into _boundObjects
     {
       boost::mutex::scoped_lock sl(_boundObjectsMutex);
@@ -55,6 +61,8 @@ namespace qi {
         return false;
       }
       _boundObjects[id] = obj;
+      if (metaObjectHash)
+        _metaObjectHashes[id] = *metaObjectHash;
       return true;
     }
   }
@@ -72,6 +80,7 @@ namespace qi {
       }
       removedObject = it->second;
       _boundObjects.erase(idx);
+      _metaObjectHashes.erase(idx);
     }
     removedObject.reset();
     return true;
@@ -133,6 +142,11 @@ namespace qi {
     // If true, it's an actual connection to this server.
     if (startReading)
     {
+      {
+        boost::mutex::scoped_lock lock(_boundObjectsMutex);
+        if (!_metaObjectHashes.empty())
+          socket->advertiseCapability(capabilityname::metaObjectHashes, AnyValue::from(_metaObjectHashes));
+      }
       auto signalLink = boost::make_shared<qi::SignalLink>();
       auto first = boost::make_shared<bool>(true);
       // We are reading on the socket for the first time : the first message has to be the capabilities
@@ -73,6 +73,8 @@ namespace qi {
 
     //ObjectList
     BoundAnyObjectMap                   _boundObjects;
+    // Hashes of the metaobjects of the bound services, see MetaObjectCache.
+    std::map<unsigned int, std::string> _metaObjectHashes;
     boost::mutex                        _boundObjectsMutex;
 
     boost::mutex                        _stateMutex;
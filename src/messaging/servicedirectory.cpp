@@ -9,6 +9,8 @@
 # pragma warning(disable: 4355)
 #endif
 
+#include <algorithm>
+#include <random>
 #include <vector>
 #include <map>
 
@@ -66,14 +68,33 @@ namespace qi
       QI_ASSERT(id == qi::Message::ServiceDirectoryAction_MachineId);
       ob->advertiseMethod("_socketOfService", &ServiceDirectory::_socketOfService);
       // used locally only, we do not export its id
+      id = ob->advertiseMethod("changesSince", &ServiceDirectory::changesSince);
+      QI_ASSERT(id == qi::Message::ServiceDirectoryAction_ChangesSince);
+      id = ob->advertiseSignal("serviceChanged", &ServiceDirectory::serviceChanged);
+      QI_ASSERT(id == qi::Message::ServiceDirectoryAction_ServiceChanged);
       // Silence compile warning unused id
       (void)id;
     }
     return ob->object(self);
   }
 
+  namespace
+  {
+    qi::uint64_t newEpoch()
+    {
+      std::random_device device;
+      qi::uint64_t epoch = 0;
+      while (epoch == 0)
+        epoch = (static_cast<qi::uint64_t>(device()) << 32) ^ device();
+      return epoch;
+    }
+  }
+
   ServiceDirectory::ServiceDirectory()
     : servicesCount(0)
+    , servicesSnapshot(boost::make_shared<const std::vector<ServiceInfo>>())
+    , epoch(newEpoch())
+    , version(0)
   {
   }
 
@@ -83,61 +104,95 @@ namespace qi
       qiLogWarning() << "Destroying while connected services remain";
   }
 
-  void ServiceDirectory::onSocketDisconnected(MessageSocketPtr socket, std::string error)
+  void ServiceDirectory::recordChange(ServiceDirectoryChange::Kind kind, const ServiceInfo& info,
+                                      std::vector<ServiceDirectoryChange>& changes)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    // clean from idxToSocket
-    for (std::map<unsigned int, MessageSocketPtr>::iterator it = idxToSocket.begin(), iend = idxToSocket.end(); it != iend;)
+    ServiceDirectoryChange change;
+    change.version = ++version;
+    change.kind = kind;
+    change.serviceInfo = info;
+    journal.push_back(change);
+    if (journal.size() > journalCapacity)
+      journal.pop_front();
+    changes.push_back(std::move(change));
+  }
+
+  void ServiceDirectory::updateSnapshot()
+  {
+    auto snapshot = boost::make_shared<std::vector<ServiceInfo>>();
+    snapshot->reserve(connectedServices.size());
+    for (const auto& service : connectedServices)
+      snapshot->push_back(service.second);
+    std::sort(snapshot->begin(), snapshot->end(), [](const ServiceInfo& a, const ServiceInfo& b) {
+      return a.serviceId() < b.serviceId();
+    });
+    servicesSnapshot = snapshot;
+  }
+
+  void ServiceDirectory::emitChanges(const std::vector<ServiceDirectoryChange>& changes)
+  {
+    for (const auto& change : changes)
     {
-      std::map<unsigned int, MessageSocketPtr>::iterator next = it;
-      ++next;
-      if (it->second == socket)
-        idxToSocket.erase(it);
-      it = next;
+      const ServiceInfo& info = change.serviceInfo;
+      if (change.kind == ServiceDirectoryChange::Kind_Added)
+        serviceAdded(info.serviceId(), info.name());
+      else if (change.kind == ServiceDirectoryChange::Kind_Removed)
+        serviceRemoved(info.serviceId(), info.name());
+      serviceChanged(change);
     }
-    // if services were connected behind the socket
-    std::map<MessageSocketPtr, std::vector<unsigned int> >::iterator it;
-    it = socketToIdx.find(socket);
-    if (it == socketToIdx.end()) {
-      return;
-    }
-    // Copy the vector, iterators will be invalidated.
-    std::vector<unsigned int> ids = it->second;
-    // Always start at the beginning since we erase elements on unregisterService
-    // and mess up the iterator
-    for (std::vector<unsigned int>::iterator it2 = ids.begin();
-         it2 != ids.end();
-         ++it2)
+  }
+
+  void ServiceDirectory::onSocketDisconnected(MessageSocketPtr socket, std::string error)
+  {
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    std::vector<ServiceDirectoryChange> changes;
     {
-      qiLogInfo() << "Service #" << *it2 << " disconnected";
-      try {
-        unregisterService(*it2);
-      } catch (std::runtime_error &) {
-        qiLogWarning() << "Cannot unregister service #" << *it2;
+      boost::unique_lock<StateMutex> lock(stateMutex);
+      // clean from idxToSocket
+      for (auto it = idxToSocket.begin(); it != idxToSocket.end();)
+      {
+        if (it->second == socket)
+          it = idxToSocket.erase(it);
+        else
+          ++it;
       }
+      // if services were connected behind the socket
+      auto it = socketToIdx.find(socket);
+      if (it == socketToIdx.end()) {
+        return;
+      }
+      // Copy the vector, iterators will be invalidated.
+      std::vector<unsigned int> ids = it->second;
+      for (const unsigned int id : ids)
+      {
+        qiLogInfo() << "Service #" << id << " disconnected";
+        try {
+          unregisterServiceUnsync(id, changes);
+        } catch (std::runtime_error &) {
+          qiLogWarning() << "Cannot unregister service #" << id;
+        }
+      }
+      socketToIdx.erase(socket);
     }
-    socketToIdx.erase(it);
+    emitChanges(changes);
   }
 
   std::vector<ServiceInfo> ServiceDirectory::services()
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    std::vector<ServiceInfo> result;
-    std::map<unsigned int, ServiceInfo>::const_iterator it;
-
-    for (it = connectedServices.begin(); it != connectedServices.end(); ++it)
-      result.push_back(it->second);
-
-    return result;
+    boost::shared_ptr<const std::vector<ServiceInfo>> snapshot;
+    {
+      boost::shared_lock<StateMutex> lock(stateMutex);
+      snapshot = servicesSnapshot;
+    }
+    // Copy outside of the lock.
+    return *snapshot;
   }
 
   ServiceInfo ServiceDirectory::service(const std::string &name)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    std::map<unsigned int, ServiceInfo>::const_iterator servicesIt;
-    std::map<std::string, unsigned int>::const_iterator it;
+    boost::shared_lock<StateMutex> lock(stateMutex);
 
-    it = nameToIdx.find(name);
+    const auto it = nameToIdx.find(name);
     if (it == nameToIdx.end()) {
       std::stringstream ss;
       ss << "Cannot find service '" << name << "' in index";
@@ -146,7 +201,7 @@ namespace qi
 
     unsigned int idx = it->second;
 
-    servicesIt = connectedServices.find(idx);
+    const auto servicesIt = connectedServices.find(idx);
     if (servicesIt == connectedServices.end()) {
       std::stringstream ss;
       ss << "Cannot find ServiceInfo for service '" << name << "'";
@@ -162,9 +217,9 @@ namespace qi
       throw std::runtime_error("ServiceBoundObject has expired.");
 
     MessageSocketPtr socket = sbo->currentSocket();
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    std::map<std::string, unsigned int>::iterator it;
-    it = nameToIdx.find(svcinfo.name());
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    boost::unique_lock<StateMutex> lock(stateMutex);
+    const auto it = nameToIdx.find(svcinfo.name());
     if (it != nameToIdx.end())
     {
       std::stringstream ss;
@@ -207,12 +262,20 @@ namespace qi
 
   void ServiceDirectory::unregisterService(const unsigned int &idx)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    std::vector<ServiceDirectoryChange> changes;
+    {
+      boost::unique_lock<StateMutex> lock(stateMutex);
+      unregisterServiceUnsync(idx, changes);
+    }
+    emitChanges(changes);
+  }
+
+  std::string ServiceDirectory::unregisterServiceUnsync(unsigned int idx,
+                                                        std::vector<ServiceDirectoryChange>& changes)
+  {
     bool pending = false;
-    // search the id before accessing it
-    // otherwise operator[] create a empty entry
-    std::map<unsigned int, ServiceInfo>::iterator it2;
-    it2 = connectedServices.find(idx);
+    auto it2 = connectedServices.find(idx);
     if (it2 == connectedServices.end()) {
       qiLogVerbose() << "Unregister Service: service #" << idx << " not found in the"
                      << " connected list. Looking in the pending list.";
@@ -229,8 +292,7 @@ namespace qi
 
     std::string serviceName = it2->second.name();
 
-    std::map<std::string, unsigned int>::iterator it;
-    it = nameToIdx.find(serviceName);
+    const auto it = nameToIdx.find(serviceName);
     if (it == nameToIdx.end())
     {
       std::stringstream ss;
@@ -254,86 +316,158 @@ namespace qi
       qiLogInfo() << ss.str();
     }
 
+    ServiceInfo removed;
+    removed.setServiceId(idx);
+    removed.setName(serviceName);
+
     nameToIdx.erase(it);
     if (pending)
       pendingServices.erase(it2);
     else
+    {
       connectedServices.erase(it2);
+      updateSnapshot();
+    }
 
     // Find and remove serviceId into socketToIdx map
-    {
-      std::map<MessageSocketPtr , std::vector<unsigned int> >::iterator it;
-      for (it = socketToIdx.begin(); it != socketToIdx.end(); ++it) {
-        std::vector<unsigned int>::iterator jt;
-        for (jt = it->second.begin(); jt != it->second.end(); ++jt) {
-          if (*jt == idx) {
-            it->second.erase(jt);
-            //socketToIdx is erased by onSocketDisconnected
-            break;
-          }
-        }
+    for (auto& socketIds : socketToIdx) {
+      auto& ids = socketIds.second;
+      const auto jt = std::find(ids.begin(), ids.end(), idx);
+      if (jt != ids.end()) {
+        ids.erase(jt);
+        //socketToIdx is erased by onSocketDisconnected
+        break;
       }
     }
 
-    serviceRemoved(idx, serviceName);
+    // Clients are notified of removal even for pending services, as they
+    // were before.
+    recordChange(ServiceDirectoryChange::Kind_Removed, removed, changes);
+    return serviceName;
   }
 
   void ServiceDirectory::updateServiceInfo(const ServiceInfo &svcinfo)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    std::map<unsigned int, ServiceInfo>::iterator itService;
-
-    for (itService = connectedServices.begin();
-         itService != connectedServices.end();
-         ++itService)
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    std::vector<ServiceDirectoryChange> changes;
     {
-      if (svcinfo.sessionId() == itService->second.sessionId())
+      boost::unique_lock<StateMutex> lock(stateMutex);
+      bool updated = false;
+      for (auto& service : connectedServices)
       {
-        itService->second.setEndpoints(svcinfo.endpoints());
+        if (svcinfo.sessionId() == service.second.sessionId()
+            && service.first != svcinfo.serviceId())
+        {
+          service.second.setEndpoints(svcinfo.endpoints());
+          recordChange(ServiceDirectoryChange::Kind_Updated, service.second, changes);
+          updated = true;
+        }
       }
-    }
 
-    itService = connectedServices.find(svcinfo.serviceId());
-    if (itService != connectedServices.end())
-    {
-      connectedServices[svcinfo.serviceId()] = svcinfo;
-      return;
+      auto itService = connectedServices.find(svcinfo.serviceId());
+      if (itService != connectedServices.end())
+      {
+        itService->second = svcinfo;
+        recordChange(ServiceDirectoryChange::Kind_Updated, svcinfo, changes);
+        updated = true;
+      }
+      else
+      {
+        // maybe the service registration was pending...
+        itService = pendingServices.find(svcinfo.serviceId());
+        if (itService != pendingServices.end())
+        {
+          itService->second = svcinfo;
+        }
+        else
+        {
+          if (updated)
+            updateSnapshot();
+          std::stringstream ss;
+          ss << "updateServiceInfo: Can't find service #" << svcinfo.serviceId();
+          qiLogVerbose() << ss.str();
+          lock.unlock();
+          emitChanges(changes);
+          throw std::runtime_error(ss.str());
+        }
+      }
+      if (updated)
+        updateSnapshot();
     }
+    emitChanges(changes);
+  }
 
-    // maybe the service registration was pending...
-    itService = pendingServices.find(svcinfo.serviceId());
-    if (itService != pendingServices.end())
+  bool ServiceDirectory::updateServiceEndpoints(unsigned int idx, const qi::UrlVector& endpoints)
+  {
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    std::vector<ServiceDirectoryChange> changes;
     {
-      pendingServices[svcinfo.serviceId()] = svcinfo;
-      return;
+      boost::unique_lock<StateMutex> lock(stateMutex);
+      const auto it = connectedServices.find(idx);
+      if (it == connectedServices.end())
+        return false;
+      it->second.setEndpoints(endpoints);
+      recordChange(ServiceDirectoryChange::Kind_Updated, it->second, changes);
+      updateSnapshot();
     }
-
-    std::stringstream ss;
-    ss << "updateServiceInfo: Can't find service #" << svcinfo.serviceId();
-    qiLogVerbose() << ss.str();
-    throw std::runtime_error(ss.str());
+    emitChanges(changes);
+    return true;
   }
 
   void ServiceDirectory::serviceReady(const unsigned int &idx)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    // search the id before accessing it
-    // otherwise operator[] create a empty entry
-    std::map<unsigned int, ServiceInfo>::iterator itService;
-    itService = pendingServices.find(idx);
-    if (itService == pendingServices.end())
+    WriteMutex::scoped_lock writeLock(writeMutex);
+    std::vector<ServiceDirectoryChange> changes;
     {
-      std::stringstream ss;
-      ss << "Can't find pending service #" << idx;
-      qiLogError() << ss.str();
-      throw std::runtime_error(ss.str());
-    }
+      boost::unique_lock<StateMutex> lock(stateMutex);
+      const auto itService = pendingServices.find(idx);
+      if (itService == pendingServices.end())
+      {
+        std::stringstream ss;
+        ss << "Can't find pending service #" << idx;
+        qiLogError() << ss.str();
+        throw std::runtime_error(ss.str());
+      }
 
-    std::string serviceName = itService->second.name();
-    connectedServices[idx] = itService->second;
-    pendingServices.erase(itService);
+      const ServiceInfo& info = itService->second;
+      connectedServices[idx] = info;
+      recordChange(ServiceDirectoryChange::Kind_Added, info, changes);
+      pendingServices.erase(itService);
+      updateSnapshot();
+    }
+    emitChanges(changes);
+  }
 
-    serviceAdded(idx, serviceName);
+  ServiceDirectoryChanges ServiceDirectory::changesSince(qi::uint64_t fromEpoch,
+                                                        qi::uint64_t fromVersion)
+  {
+    boost::shared_lock<StateMutex> lock(stateMutex);
+    ServiceDirectoryChanges result;
+    result.epoch = epoch;
+    result.version = version;
+    if (fromEpoch == epoch && fromVersion == version)
+      return result;
+
+    // The journal holds the changes leading to versions
+    // ]version - journal.size(), version].
+    const qi::uint64_t oldestKnown = version - journal.size();
+    if (fromEpoch != epoch || fromVersion < oldestKnown || fromVersion > version)
+    {
+      result.reset = true;
+      result.changes.reserve(servicesSnapshot->size());
+      for (const auto& info : *servicesSnapshot)
+      {
+        ServiceDirectoryChange change;
+        change.version = version;
+        change.kind = ServiceDirectoryChange::Kind_Added;
+        change.serviceInfo = info;
+        result.changes.push_back(std::move(change));
+      }
+      return result;
+    }
+    result.changes.assign(journal.begin() + static_cast<std::ptrdiff_t>(fromVersion - oldestKnown),
+                          journal.end());
+    return result;
   }
 
 
@@ -404,12 +538,8 @@ namespace qi
       if (!error.empty())
         throw std::runtime_error(error);
 
-      auto it = _sdObject->connectedServices.find(qi::Message::Service_ServiceDirectory);
-      if (it != _sdObject->connectedServices.end())
-      {
-        it->second.setEndpoints(_server->endpoints());
+      if (_sdObject->updateServiceEndpoints(qi::Message::Service_ServiceDirectory, _server->endpoints()))
         return;
-      }
 
       ServiceInfo si;
       si.setName(Session::serviceDirectoryServiceName());
@@ -437,8 +567,8 @@ namespace qi
 
   qi::MessageSocketPtr ServiceDirectory::_socketOfService(unsigned int id)
   {
-    boost::recursive_mutex::scoped_lock lock(mutex);
-    std::map<unsigned int, MessageSocketPtr>::iterator it = idxToSocket.find(id);
+    boost::shared_lock<StateMutex> lock(stateMutex);
+    const auto it = idxToSocket.find(id);
     if (it == idxToSocket.end())
       return MessageSocketPtr();
     else
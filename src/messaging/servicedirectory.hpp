@@ -10,15 +10,30 @@
 # include <qi/url.hpp>
 # include <qi/future.hpp>
 # include "messagesocket.hpp"
+# include <deque>
+# include <unordered_map>
+# include <boost/functional/hash.hpp>
 # include <boost/thread/recursive_mutex.hpp>
+# include <boost/thread/shared_mutex.hpp>
+# include <qi/perf/detail/instrumentedmutex.hpp>
 # include "boundobject.hpp"
 # include "server.hpp"
 # include "objectregistrar.hpp"
+# include "servicedirectorychange.hpp"
 
 namespace qi
 {
+  namespace detail
+  {
+    QI_INSTRUMENTATION_LOCK_NAME(ServiceDirectoryStateLockName, "qi.servicedirectory.state");
+    QI_INSTRUMENTATION_LOCK_NAME(ServiceDirectoryWriteLockName, "qi.servicedirectory.write");
+  }
+
   class ServiceDirectory {
   public:
+    using StateMutex = detail::InstrumentedSharedMutex<detail::ServiceDirectoryStateLockName>;
+    using WriteMutex = detail::InstrumentedMutex<boost::recursive_mutex, detail::ServiceDirectoryWriteLockName>;
+
     ServiceDirectory();
     virtual ~ServiceDirectory();
 
@@ -38,21 +53,60 @@ namespace qi
     qi::MessageSocketPtr   _socketOfService(unsigned int id);
     void                     _setServiceBoundObject(boost::shared_ptr<ServiceBoundObject> sbo);
 
+    /// Return the changes that happened after `version` of `epoch`. A client
+    /// keeping a copy of the services can stay up to date with
+    /// serviceChanged, and catch up with this function after a
+    /// disconnection. If `epoch` is not the one of this service directory,
+    /// for instance 0 for a client that never synchronized or the epoch of a
+    /// service directory that restarted since, all the services are returned.
+    ServiceDirectoryChanges  changesSince(qi::uint64_t epoch, qi::uint64_t version);
+
+    /// Set the endpoints of a ready service. Return false if there is no
+    /// such service.
+    bool                     updateServiceEndpoints(unsigned int idx, const qi::UrlVector& endpoints);
+
     qi::Signal<unsigned int, std::string>  serviceAdded;
     qi::Signal<unsigned int, std::string>  serviceRemoved;
+    qi::Signal<ServiceDirectoryChange>     serviceChanged;
+
+    /// Number of changes kept to answer changesSince.
+    static const std::size_t journalCapacity = 1024;
+
+  private:
+    using SocketHash = boost::hash<MessageSocketPtr>;
+
+    // The following must be called with the state locked for writing.
+    void recordChange(ServiceDirectoryChange::Kind kind, const ServiceInfo& info,
+                      std::vector<ServiceDirectoryChange>& changes);
+    std::string unregisterServiceUnsync(unsigned int idx,
+                                        std::vector<ServiceDirectoryChange>& changes);
+    void updateSnapshot();
+
+    void emitChanges(const std::vector<ServiceDirectoryChange>& changes);
+
+    std::unordered_map<unsigned int, ServiceInfo>                       pendingServices;
+    std::unordered_map<unsigned int, ServiceInfo>                       connectedServices;
+    std::unordered_map<std::string, unsigned int>                       nameToIdx;
+    std::unordered_map<MessageSocketPtr, std::vector<unsigned int>, SocketHash> socketToIdx;
+    std::unordered_map<unsigned int, MessageSocketPtr>                  idxToSocket;
+    unsigned int                                                        servicesCount;
+    boost::weak_ptr<ServiceBoundObject>                                 serviceBoundObject;
+
+    // Ready services sorted by id, rebuilt after each change.
+    boost::shared_ptr<const std::vector<ServiceInfo>>                   servicesSnapshot;
+    const qi::uint64_t                                                  epoch;
+    qi::uint64_t                                                        version;
+    std::deque<ServiceDirectoryChange>                                  journal;
 
-  public:
-    std::map<unsigned int, ServiceInfo>                       pendingServices;
-    std::map<unsigned int, ServiceInfo>                       connectedServices;
-    std::map<std::string, unsigned int>                       nameToIdx;
-    std::map<MessageSocketPtr, std::vector<unsigned int> >  socketToIdx;
-    std::map<unsigned int, MessageSocketPtr>                idxToSocket;
-    unsigned int                                              servicesCount;
-    boost::weak_ptr<ServiceBoundObject>                       serviceBoundObject;
     /* Our methods can be invoked from remote, and from socket callbacks,
     * so thread-safety is required.
+    * Readers only lock `stateMutex` for reading. Writers are serialized by
+    * `writeMutex`, which is held while signals are emitted so that they are
+    * emitted in the order of the changes. It is recursive because signal
+    * handlers may modify the directory.
     */
-    boost::recursive_mutex                                    mutex;
+    mutable StateMutex                                                  stateMutex;
+    WriteMutex                                                          writeMutex;
   }; // !ServiceDirectoryPrivate
 
 
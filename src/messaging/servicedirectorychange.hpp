@@ -0,0 +1,57 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_SERVICEDIRECTORYCHANGE_HPP_
+#define _SRC_SERVICEDIRECTORYCHANGE_HPP_
+
+#include <vector>
+#include <qi/types.hpp>
+#include <qi/messaging/serviceinfo.hpp>
+#include <qi/type/typeinterface.hpp>
+
+namespace qi
+{
+  /// A change of the services listed by the service directory.
+  struct ServiceDirectoryChange
+  {
+    enum Kind
+    {
+      Kind_Added   = 0,
+      Kind_Updated = 1,
+      Kind_Removed = 2,
+    };
+
+    /// Version of the service directory once the change is applied.
+    /// Versions of successive changes are consecutive.
+    qi::uint64_t version = 0;
+    Kind         kind = Kind_Added;
+    /// For removed services, only the id and the name are meaningful.
+    ServiceInfo  serviceInfo;
+  };
+
+  /// Changes to apply to go from a version of the service directory to
+  /// another.
+  struct ServiceDirectoryChanges
+  {
+    /// Identifies the instance of the service directory that numbered the
+    /// versions. It is drawn at random when the service directory starts, and
+    /// is never 0: versions from another instance are meaningless.
+    qi::uint64_t epoch = 0;
+    /// Version of the service directory once all the changes are applied.
+    qi::uint64_t version = 0;
+    /// If true, the requested version cannot be resynchronized, because it
+    /// comes from another epoch or is too old: `changes` lists all the
+    /// services as added, and the previous state must be dropped.
+    bool reset = false;
+    std::vector<ServiceDirectoryChange> changes;
+  };
+}
+
+QI_TYPE_ENUM(qi::ServiceDirectoryChange::Kind);
+QI_TYPE_STRUCT(qi::ServiceDirectoryChange, version, kind, serviceInfo);
+QI_TYPE_STRUCT(qi::ServiceDirectoryChanges, epoch, version, reset, changes);
+
+#endif  // _SRC_SERVICEDIRECTORYCHANGE_HPP_
@@ -480,6 +480,11 @@ namespace qi {
     return _object.async<std::string>("machineId");
   }
 
+  qi::Future<ServiceDirectoryChanges>  ServiceDirectoryClient::changesSince(qi::uint64_t epoch,
+                                                                           qi::uint64_t version) {
+    return _object.async<ServiceDirectoryChanges>("changesSince", epoch, version);
+  }
+
   qi::Future<qi::MessageSocketPtr>   ServiceDirectoryClient::_socketOfService(unsigned int id) {
     return _object.async<MessageSocketPtr>("_socketOfService", id);
   }
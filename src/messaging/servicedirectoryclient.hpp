@@ -16,6 +16,7 @@
 #include "remoteobject_p.hpp"
 #include "clientauthenticator_p.hpp"
 #include "messagesocket.hpp"
+#include "servicedirectorychange.hpp"
 
 namespace qi {
 
@@ -45,6 +46,10 @@ namespace qi {
     qi::Future< void >                     serviceReady(const unsigned int &idx);
     qi::Future< void >                     updateServiceInfo(const ServiceInfo &svcinfo);
     qi::Future< std::string >              machineId();
+    /// Changes of the service list since the given version (see ServiceDirectory::changesSince).
+    /// Nothing in the client follows them yet: the session still lists the
+    /// services with services().
+    qi::Future< ServiceDirectoryChanges >  changesSince(qi::uint64_t epoch, qi::uint64_t version);
     /// if isLocal() only, return socket holding given service id
     qi::Future<qi::MessageSocketPtr>     _socketOfService(unsigned int serviceId);
 
@@ -249,6 +249,19 @@ namespace qi {
     return cancelOnTimeout(_p->_serviceHandler.service(service, protocol), timeout);
   }
 
+  std::vector<qi::Future<qi::AnyObject>> Session::resolveServices(
+    const std::vector<std::string>& names, qi::MilliSeconds timeout)
+  {
+    if (!isConnected()) {
+      return std::vector<qi::Future<qi::AnyObject>>(
+        names.size(), qi::makeFutureError<qi::AnyObject>("Session not connected."));
+    }
+    auto futures = _p->_serviceHandler.services(names, "");
+    for (auto& fut : futures)
+      fut = cancelOnTimeout(fut, timeout);
+    return futures;
+  }
+
   qi::FutureSync<void> Session::listen(const qi::Url &address)
   {
     qiLogInfo() << "Session listener created on " << address.str();
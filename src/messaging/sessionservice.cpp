@@ -14,6 +14,7 @@
 #include "servicedirectoryclient.hpp"
 #include "objectregistrar.hpp"
 #include "remoteobject_p.hpp"
+#include "metaobjectcache.hpp"
 
 qiLogCategory("qimessaging.sessionservice");
 
@@ -150,6 +151,62 @@ namespace qi {
       qiLogWarning() << caller << ": Unknown service request. "
         "requestId = " << requestId;
     }
+
+    // Hash of the metaobject of the service, as advertised by the server on
+    // connection.
+    boost::optional<std::string> advertisedMetaObjectHash(const MessageSocket& socket,
+                                                          unsigned int serviceId)
+    {
+      const auto hashes = socket.remoteCapability(capabilityname::metaObjectHashes);
+      if (!hashes)
+        return {};
+      try
+      {
+        const auto hashMap = hashes->to<std::map<unsigned int, std::string>>();
+        const auto it = hashMap.find(serviceId);
+        if (it != hashMap.end())
+          return it->second;
+      }
+      catch (const std::exception& e)
+      {
+        qiLogVerbose() << "Invalid metaobject hashes capability: " << e.what();
+      }
+      return {};
+    }
+
+    // Set the metaobject of the remote object from the cache if the server
+    // advertised a known hash, fetch it otherwise.
+    Future<void> fetchMetaObject(const RemoteObjectPtr& remoteObject,
+                                 const MessageSocket& socket,
+                                 unsigned int serviceId)
+    {
+      const auto hash = advertisedMetaObjectHash(socket, serviceId);
+      if (!hash)
+        return remoteObject->fetchMetaObject();
+
+      if (const auto metaObject = MetaObjectCache::instance().find(*hash))
+      {
+        qiLogVerbose() << "Using cached metaobject " << *hash << " for service #" << serviceId;
+        remoteObject->setMetaObject(*metaObject);
+        return Future<void>{nullptr};
+      }
+      const std::string knownHash = *hash;
+      return remoteObject->fetchMetaObject().then(FutureCallbackType_Sync,
+                                                  [=](Future<void> fut) {
+        fut.value(); // Propagates the error.
+        // The server may advertise the hash of another metaobject: caching it
+        // would give a wrong metaobject to all the services with that hash.
+        const MetaObject metaObject = remoteObject->metaObject();
+        if (MetaObjectCache::hash(metaObject) != knownHash)
+        {
+          qiLogVerbose() << "Metaobject of service #" << serviceId
+                         << " does not match its advertised hash " << knownHash
+                         << ", not caching it";
+          return;
+        }
+        MetaObjectCache::instance().insert(knownHash, metaObject);
+      });
+    }
   } // namespace
 
   void Session_Service::SetPromiseInError::operator()()
@@ -216,7 +273,7 @@ namespace qi {
         sr->remoteObject.reset(new qi::RemoteObject(sr->serviceInfo.serviceId(), socket, sr->serviceInfo.objectUid()));
 
         // TODO 40203: check if it's possible that the following future is never set.
-        metaObjFut = sr->remoteObject->fetchMetaObject();
+        metaObjFut = fetchMetaObject(sr->remoteObject, *socket, sr->serviceInfo.serviceId());
 
         qiLogVerbose() << "Fetching metaobject (1) for requestId = " << requestId;
         metaObjFut.connect(track(
@@ -252,7 +309,7 @@ namespace qi {
       sr->remoteObject = boost::make_shared<RemoteObject>(sr->serviceInfo.serviceId(), socket, sr->serviceInfo.objectUid());
 
       //ask the remoteObject to fetch the metaObject
-      metaObjFut = sr->remoteObject->fetchMetaObject();
+      metaObjFut = fetchMetaObject(sr->remoteObject, *socket, sr->serviceInfo.serviceId());
       qiLogVerbose() << "Fetching metaobject (2) for requestId = " << requestId;
       metaObjFut.connect(track(
         boost::bind(
@@ -408,8 +465,8 @@ namespace qi {
       throw std::runtime_error("Service already in cache: " + name);
   }
 
-  qi::Future<qi::AnyObject> Session_Service::service(const std::string &service,
-                                                     const std::string &protocol)
+  boost::optional<qi::Future<qi::AnyObject>> Session_Service::availableService(
+      const std::string& service, const std::string& protocol)
   {
     if (protocol == "" || protocol == "local") {
       //qiLogError() << "service is not implemented for local service, it always return a remote service";
@@ -434,6 +491,37 @@ namespace qi {
         return qi::Future<qi::AnyObject>(it->second);
       }
     }
+    return {};
+  }
+
+  boost::optional<qi::Future<qi::AnyObject>> Session_Service::pendingService(const std::string& service)
+  {
+    boost::recursive_mutex::scoped_lock l(_requestsMutex);
+    for (auto it = _requests.begin(); it != _requests.end(); ++it)
+    {
+      if (it->second->serviceInfo.name() == service)
+      {
+        qiLogVerbose() << "Found service '" << service << "' in the pending service requests.";
+        return it->second->promise.future();
+      }
+    }
+    return {};
+  }
+
+  long Session_Service::addRequest(const std::string& service)
+  {
+    boost::recursive_mutex::scoped_lock l(_requestsMutex);
+    const long requestId = ++_requestsIndex;
+    QI_ASSERT_NULL(_requests[requestId]);
+    _requests[requestId].reset(new ServiceRequest(service));
+    return requestId;
+  }
+
+  qi::Future<qi::AnyObject> Session_Service::service(const std::string &service,
+                                                     const std::string &protocol)
+  {
+    if (auto available = availableService(service, protocol))
+      return *available;
 
     qi::Future<qi::ServiceInfo> fut;
     ServiceRequest* rq = nullptr;
@@ -445,24 +533,15 @@ namespace qi {
     // for the same service and then concurrent authentication requests, remote objects, etc.
     {
       boost::recursive_mutex::scoped_lock l(_requestsMutex);
-      for (auto it = _requests.begin(); it != _requests.end(); ++it)
-      {
-        if (it->second->serviceInfo.name() == service)
-        {
-          qiLogVerbose() << "Found service '" << service << "' in the pending service requests.";
-          return it->second->promise.future();
-        }
-      }
+      if (auto pending = pendingService(service))
+        return *pending;
 
       // TODO 40203: check if it's possible that the following future is never set.
       fut = _sdClient->service(service);
-      rq = new ServiceRequest(service);
-      requestId = ++_requestsIndex;
+      requestId = addRequest(service);
+      rq = serviceRequest(*requestId);
       qiLogVerbose() << "Asynchronously asking service '" << service << "' to SD client. "
         "requestId = " << os::to_string(*requestId);
-
-      QI_ASSERT_NULL(_requests[*requestId]);
-      _requests[*requestId].reset(rq);
     }
     rq->promise.setOnCancel(track([=](Promise<AnyObject>& p) mutable {
       removeRequest(*requestId);
@@ -472,92 +551,172 @@ namespace qi {
     //rq is not valid anymore after addCallbacks, because it could have been handled and cleaned
     fut.connect(track([=](Future<ServiceInfo> fut) -> void
     {
-      qiLogDebug() << "Got serviceinfo message";
+      onServiceInfoResult(fut, *requestId, protocol);
+    }, this));
+    return result;
+  }
 
-      // Ensure that the promise is always set, even in case of exception.
-      bool mustSetPromise = true;
-      boost::optional<Promise<AnyObject>> promise;
-      auto _ = ka::scoped(SetPromiseInError{*this, promise, mustSetPromise, *requestId});
+  std::vector<qi::Future<qi::AnyObject>> Session_Service::services(
+      const std::vector<std::string>& services, const std::string& protocol)
+  {
+    std::vector<qi::Future<qi::AnyObject>> results(services.size());
+    std::vector<std::size_t> unavailable;
+    for (std::size_t i = 0; i < services.size(); ++i)
+    {
+      if (auto available = availableService(services[i], protocol))
+        results[i] = *available;
+      else
+        unavailable.push_back(i);
+    }
+    if (unavailable.empty())
+      return results;
 
+    // (service name, request id) of the requests created here.
+    std::vector<std::pair<std::string, long>> requests;
+    {
+      boost::recursive_mutex::scoped_lock l(_requestsMutex);
+      for (const auto i : unavailable)
       {
-        boost::recursive_mutex::scoped_lock sl(_requestsMutex);
-        ServiceRequest *sr = serviceRequest(*requestId);
-        if (!sr)
+        const std::string& service = services[i];
+        if (auto pending = pendingService(service))
         {
-          logWarningUnknownServiceRequest("service() ServiceInfo continuation", *requestId);
-          return;
+          results[i] = *pending;
+          continue;
         }
-
-        qiLogVerbose() << "Received answer from SD client for service '" << sr->serviceInfo.name() << "'. "
-          "requestId = " << *requestId;
-        promise = sr->promise;
-
+        const long requestId = addRequest(service);
+        ServiceRequest* rq = serviceRequest(requestId);
+        rq->promise.setOnCancel(track([=](Promise<AnyObject>& p) mutable {
+          removeRequest(requestId);
+          p.setCanceled();
+        }, this));
+        results[i] = rq->promise.future();
+        requests.emplace_back(service, requestId);
+      }
+    }
+    if (requests.empty())
+      return results;
+
+    // A single request to the service directory for all the services. Each
+    // one then goes on independently: connections to the endpoints and
+    // metaobject fetches run concurrently.
+    qiLogVerbose() << "Asynchronously asking " << requests.size() << " services to SD client.";
+    _sdClient->services().connect(track([=](Future<std::vector<ServiceInfo>> fut) -> void
+    {
+      std::map<std::string, const ServiceInfo*> infos;
+      if (!fut.hasError())
+      {
+        for (const auto& info : fut.value())
+          infos[info.name()] = &info;
+      }
+      for (const auto& request : requests)
+      {
+        const std::string& service = request.first;
+        Future<ServiceInfo> infoFuture;
         if (fut.hasError())
+          infoFuture = makeFutureError<ServiceInfo>(fut.error());
+        else
         {
-          setErrorAndRemoveRequest(*promise, fut.error(), *requestId);
-          return;
-        }
-        const qi::ServiceInfo& si = fut.value();
-        sr->serviceInfo = si;
-        if (_sdClient->isLocal())
-        { // Wait! If sd is local, we necessarily have an open socket
-          // on which service was registered, whose lifetime is bound
-          // to the service
-          // TODO 40203: Could this block forever?
-          MessageSocketPtr s = _sdClient->_socketOfService(sr->serviceInfo.serviceId()).value();
-
-          if (!s) // weird
-            qiLogVerbose() << "_socketOfService returned 0";
+          const auto it = infos.find(service);
+          if (it == infos.end())
+            infoFuture = makeFutureError<ServiceInfo>("Cannot find service '" + service + "' in index");
           else
-          {
-            // check if the socket support that capability
-            if (s->remoteCapability(capabilityname::clientServerSocket, false))
-            {
-              qiLogVerbose() << "sd is local and service is capable, going through socketOfService";
-              onTransportSocketResult(qi::Future<MessageSocketPtr>(s), *requestId);
-              mustSetPromise = false;
-              return;
-            }
-          }
-        }
-        //empty serviceInfo
-        if (!si.endpoints().size()) {
-          std::stringstream ss;
-          ss << "No endpoints returned for service:" << sr->serviceInfo.name()
-             << " (id:" << sr->serviceInfo.serviceId() << ")";
-          qiLogVerbose() << ss.str();
-          setErrorAndRemoveRequest(*promise, ss.str(), *requestId);
-          return;
+            infoFuture = Future<ServiceInfo>(*it->second);
         }
+        onServiceInfoResult(infoFuture, request.second, protocol);
+      }
+    }, this));
+    return results;
+  }
 
-        if (protocol != "")
-        {
-          std::vector<qi::Url>::const_iterator it = si.endpoints().begin();
+  void Session_Service::onServiceInfoResult(qi::Future<qi::ServiceInfo> fut, long requestId,
+                                            const std::string& protocol)
+  {
+    qiLogDebug() << "Got serviceinfo message";
 
-          for (;
-               it != si.endpoints().end() && it->protocol() != protocol;
-               it++)
-          {
-            continue;
-          }
+    // Ensure that the promise is always set, even in case of exception.
+    bool mustSetPromise = true;
+    boost::optional<Promise<AnyObject>> promise;
+    auto _ = ka::scoped(SetPromiseInError{*this, promise, mustSetPromise, requestId});
 
-          if (it == si.endpoints().end())
+    std::string service;
+    {
+      boost::recursive_mutex::scoped_lock sl(_requestsMutex);
+      ServiceRequest *sr = serviceRequest(requestId);
+      if (!sr)
+      {
+        logWarningUnknownServiceRequest("service() ServiceInfo continuation", requestId);
+        return;
+      }
+      service = sr->serviceInfo.name();
+
+      qiLogVerbose() << "Received answer from SD client for service '" << service << "'. "
+        "requestId = " << requestId;
+      promise = sr->promise;
+
+      if (fut.hasError())
+      {
+        setErrorAndRemoveRequest(*promise, fut.error(), requestId);
+        return;
+      }
+      const qi::ServiceInfo& si = fut.value();
+      sr->serviceInfo = si;
+      if (_sdClient->isLocal())
+      { // Wait! If sd is local, we necessarily have an open socket
+        // on which service was registered, whose lifetime is bound
+        // to the service
+        // TODO 40203: Could this block forever?
+        MessageSocketPtr s = _sdClient->_socketOfService(sr->serviceInfo.serviceId()).value();
+
+        if (!s) // weird
+          qiLogVerbose() << "_socketOfService returned 0";
+        else
+        {
+          // check if the socket support that capability
+          if (s->remoteCapability(capabilityname::clientServerSocket, false))
           {
-            std::stringstream ss;
-            ss << "No " << protocol << " endpoint available for service:" << sr->serviceInfo.name()
-               << " (id:" << sr->serviceInfo.serviceId() << ")";
-            qiLogVerbose() << ss.str();
-            setErrorAndRemoveRequest(*promise, ss.str(), *requestId);
+            qiLogVerbose() << "sd is local and service is capable, going through socketOfService";
+            onTransportSocketResult(qi::Future<MessageSocketPtr>(s), requestId);
+            mustSetPromise = false;
+            return;
           }
         }
       }
-      qiLogVerbose() << "Requesting socket from cache. service = '" << service << "', "
-        "requestId = " << *requestId;
-      Future<qi::MessageSocketPtr> f = _socketCache->socket(fut.value(), protocol);
-      f.connect(track(boost::bind(&Session_Service::onTransportSocketResult, this, _1, *requestId), this));
-      mustSetPromise = false;
-    }, this));
-    return result;
+      //empty serviceInfo
+      if (!si.endpoints().size()) {
+        std::stringstream ss;
+        ss << "No endpoints returned for service:" << sr->serviceInfo.name()
+           << " (id:" << sr->serviceInfo.serviceId() << ")";
+        qiLogVerbose() << ss.str();
+        setErrorAndRemoveRequest(*promise, ss.str(), requestId);
+        return;
+      }
+
+      if (protocol != "")
+      {
+        std::vector<qi::Url>::const_iterator it = si.endpoints().begin();
+
+        for (;
+             it != si.endpoints().end() && it->protocol() != protocol;
+             it++)
+        {
+          continue;
+        }
+
+        if (it == si.endpoints().end())
+        {
+          std::stringstream ss;
+          ss << "No " << protocol << " endpoint available for service:" << sr->serviceInfo.name()
+             << " (id:" << sr->serviceInfo.serviceId() << ")";
+          qiLogVerbose() << ss.str();
+          setErrorAndRemoveRequest(*promise, ss.str(), requestId);
+        }
+      }
+    }
+    qiLogVerbose() << "Requesting socket from cache. service = '" << service << "', "
+      "requestId = " << requestId;
+    Future<qi::MessageSocketPtr> f = _socketCache->socket(fut.value(), protocol);
+    f.connect(track(boost::bind(&Session_Service::onTransportSocketResult, this, _1, requestId), this));
+    mustSetPromise = false;
   }
 }
 
@@ -55,13 +55,26 @@ namespace qi {
     qi::Future<qi::AnyObject> service(const std::string &service,
                                       const std::string &protocol);
 
+    /// Resolve several services with a single request to the service
+    /// directory. The n-th future is the one of the n-th service.
+    std::vector<qi::Future<qi::AnyObject>> services(const std::vector<std::string>& services,
+                                                    const std::string& protocol);
+
     void addService(const std::string& name, const qi::AnyObject &obj);
     void removeService(const std::string &service);
 
     void setClientAuthenticatorFactory(ClientAuthenticatorFactoryPtr factory);
 
   private:
+    // Return the service if it is local or already resolved.
+    boost::optional<qi::Future<qi::AnyObject>> availableService(const std::string& service,
+                                                                const std::string& protocol);
+    // Return the service if a request for it is pending.
+    boost::optional<qi::Future<qi::AnyObject>> pendingService(const std::string& service);
+    long addRequest(const std::string& service);
+
     //FutureInterface
+    void onServiceInfoResult(qi::Future<qi::ServiceInfo> value, long requestId, const std::string& protocol);
     void onRemoteObjectComplete(qi::Future<void> value, long requestId);
     void onTransportSocketResult(qi::Future<MessageSocketPtr> value, long requestId);
 
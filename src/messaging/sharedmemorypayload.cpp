@@ -0,0 +1,235 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <cstring>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+#include <qi/atomic.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "sharedmemorypayload.hpp"
+#include "../buffer_p.hpp"
+
+qiLogCategory("qimessaging.sharedmemorypayload");
+
+namespace bip = boost::interprocess;
+
+namespace qi
+{
+  namespace
+  {
+    // Number of pending segments above which we look for consumed ones.
+    const std::size_t pruneThreshold = 32;
+
+    const std::size_t defaultThreshold = 1024 * 1024;
+
+    // Prefix of the segments created by this module: the receiver only maps
+    // and unlinks segments named with it.
+    const std::string segmentPrefix = "qi-shm-";
+
+    std::string newSegmentName()
+    {
+      static qi::Atomic<unsigned int> counter;
+      return segmentPrefix + boost::lexical_cast<std::string>(qi::os::getpid())
+          + "-" + boost::lexical_cast<std::string>(++counter);
+    }
+
+    // The name comes from the peer: it must not designate a segment that was
+    // not created by a SharedMemoryPayloadChannel.
+    bool isValidSegmentName(const std::string& name)
+    {
+      return name.size() > segmentPrefix.size()
+          && name.compare(0, segmentPrefix.size(), segmentPrefix) == 0
+          && name.find('/') == std::string::npos;
+    }
+
+    // Copy the buffer as it is laid out on the wire.
+    void copyWireLayout(const Buffer& buffer, char* dest)
+    {
+      BufferPrivate::forEachWireChunk(buffer, [&](const char* data, std::size_t size) {
+        std::memcpy(dest, data, size);
+        dest += size;
+      });
+    }
+
+    bool segmentExists(const std::string& name)
+    {
+      try
+      {
+        bip::shared_memory_object shm(bip::open_only, name.c_str(), bip::read_only);
+        return true;
+      }
+      catch (const bip::interprocess_exception&)
+      {
+        return false;
+      }
+    }
+  }
+
+  SharedMemoryPayloadChannel::~SharedMemoryPayloadChannel()
+  {
+    release();
+  }
+
+  size_t SharedMemoryPayloadChannel::threshold()
+  {
+    static const size_t value = []{
+      const std::string env = os::getenv("QI_SHM_PAYLOAD_THRESHOLD");
+      if (env.empty())
+        return defaultThreshold;
+      try
+      {
+        return boost::lexical_cast<size_t>(env);
+      }
+      catch (const boost::bad_lexical_cast&)
+      {
+        qiLogWarning() << "Invalid value for QI_SHM_PAYLOAD_THRESHOLD: '" << env << "'";
+        return defaultThreshold;
+      }
+    }();
+    return value;
+  }
+
+  bool SharedMemoryPayloadChannel::isUsable(const StreamContext& context)
+  {
+    const auto local = context.localCapability(capabilityname::sharedMemoryPayload);
+    if (!local)
+      return false;
+    const auto remote = context.remoteCapability(capabilityname::sharedMemoryPayload);
+    if (!remote)
+      return false;
+    try
+    {
+      return local->to<std::string>() == remote->to<std::string>();
+    }
+    catch (const std::exception& e)
+    {
+      qiLogDebug() << "Invalid capability value: " << e.what();
+      return false;
+    }
+  }
+
+  bool SharedMemoryPayloadChannel::exportPayload(Message& msg, const StreamContext& context)
+  {
+    const Buffer& payload = msg.buffer();
+    const std::size_t size = payload.totalSize();
+    if (size < threshold() || (msg.flags() & Message::TypeFlag_SharedMemoryPayload))
+      return false;
+    if (!isUsable(context))
+      return false;
+
+    const std::string name = newSegmentName();
+    try
+    {
+      bip::shared_memory_object shm(bip::create_only, name.c_str(), bip::read_write);
+      try
+      {
+        shm.truncate(static_cast<bip::offset_t>(size));
+        bip::mapped_region region(shm, bip::read_write, 0, size);
+        copyWireLayout(payload, static_cast<char*>(region.get_address()));
+      }
+      catch (...)
+      {
+        bip::shared_memory_object::remove(name.c_str());
+        throw;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      qiLogVerbose() << "Cannot use shared memory for message " << msg.id()
+                     << ", sending it inline: " << e.what();
+      return false;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (_pendingSegments.size() >= pruneThreshold)
+        pruneConsumed();
+      _pendingSegments.push_back(name);
+    }
+
+    Buffer descriptor;
+    encodeBinary(&descriptor, AutoAnyReference(name));
+    encodeBinary(&descriptor, AutoAnyReference(static_cast<qi::uint64_t>(size)));
+    msg.setBuffer(std::move(descriptor));
+    msg.addFlags(Message::TypeFlag_SharedMemoryPayload);
+    qiLogDebug() << "Message " << msg.id() << ": " << size << " bytes passed through " << name;
+    return true;
+  }
+
+  bool SharedMemoryPayloadChannel::importPayload(Message& msg, const StreamContext& context)
+  {
+    if (!isUsable(context))
+    {
+      qiLogError() << "Message " << msg.id()
+                   << " has a shared memory payload, but the capability was not negotiated";
+      return false;
+    }
+
+    std::string name;
+    qi::uint64_t size = 0;
+    try
+    {
+      BufferReader reader(msg.buffer());
+      decodeBinary(&reader, &name);
+      decodeBinary(&reader, &size);
+      if (!isValidSegmentName(name))
+      {
+        qiLogError() << "Message " << msg.id() << " has an invalid shared memory segment name '"
+                     << name << "'";
+        return false;
+      }
+
+      bip::shared_memory_object shm(bip::open_only, name.c_str(), bip::read_only);
+      // Mapping past the end of the segment would fault when reading it.
+      bip::offset_t segmentSize = 0;
+      if (!shm.get_size(segmentSize) || segmentSize < 0
+          || static_cast<qi::uint64_t>(segmentSize) < size)
+      {
+        qiLogError() << "Shared memory segment '" << name << "' of message " << msg.id()
+                     << " is smaller than its declared size " << size;
+        return false;
+      }
+      // A private mapping: the buffer can be written to without affecting the
+      // segment, and it stays valid once the segment is unlinked.
+      auto region = boost::make_shared<bip::mapped_region>(
+            shm, bip::copy_on_write, 0, static_cast<std::size_t>(size));
+      bip::shared_memory_object::remove(name.c_str());
+
+      void* data = region->get_address();
+      msg.setBuffer(BufferPrivate::fromExternal(data, static_cast<std::size_t>(size), region));
+      msg.setFlags(msg.flags() & ~Message::TypeFlag_SharedMemoryPayload);
+    }
+    catch (const std::exception& e)
+    {
+      qiLogError() << "Cannot map shared memory payload '" << name << "' of message "
+                   << msg.id() << ": " << e.what();
+      return false;
+    }
+    return true;
+  }
+
+  void SharedMemoryPayloadChannel::release()
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    for (const auto& name : _pendingSegments)
+      bip::shared_memory_object::remove(name.c_str());
+    _pendingSegments.clear();
+  }
+
+  void SharedMemoryPayloadChannel::pruneConsumed()
+  {
+    auto it = _pendingSegments.begin();
+    while (it != _pendingSegments.end())
+    {
+      if (segmentExists(*it))
+        ++it;
+      else
+        it = _pendingSegments.erase(it);
+    }
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_SHAREDMEMORYPAYLOAD_HPP_
+#define _SRC_SHAREDMEMORYPAYLOAD_HPP_
+
+#include <deque>
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include "message.hpp"
+#include "streamcontext.hpp"
+
+namespace qi
+{
+  /// Passes large message payloads between two endpoints of the same machine
+  /// through shared memory segments instead of the socket.
+  ///
+  /// The payload is written in a segment by the sender, and only a descriptor
+  /// (segment name and size) is sent in the message, flagged with
+  /// Message::TypeFlag_SharedMemoryPayload. The receiver maps the segment and
+  /// wraps the mapping in a qi::Buffer without copying it.
+  ///
+  /// Reclamation: the receiver unlinks a segment as soon as it has mapped it,
+  /// the mapping staying valid until the last copy of the buffer is destroyed.
+  /// The sender keeps track of the segments it created and unlinks those that
+  /// were never received when the socket is released.
+  ///
+  /// The channel is only used if the `SharedMemoryPayload` capability is
+  /// shared by both ends, otherwise messages are sent inline.
+  class SharedMemoryPayloadChannel : private boost::noncopyable
+  {
+  public:
+    SharedMemoryPayloadChannel() = default;
+    ~SharedMemoryPayloadChannel();
+
+    /// Minimum payload size for which shared memory is used.
+    /// Can be set with the `QI_SHM_PAYLOAD_THRESHOLD` environment variable.
+    static size_t threshold();
+
+    /// Return true if the two ends of the stream share the capability, that is
+    /// if they run on the same machine.
+    static bool isUsable(const StreamContext& context);
+
+    /// If the payload of `msg` is bigger than the threshold and the channel is
+    /// usable on `context`, move the payload to a shared memory segment and
+    /// replace it by its descriptor.
+    /// Return true if the message was modified.
+    /// On any error, the message is left untouched so that it is sent inline.
+    bool exportPayload(Message& msg, const StreamContext& context);
+
+    /// Replace the descriptor payload of a message flagged with
+    /// Message::TypeFlag_SharedMemoryPayload by the shared memory content.
+    /// Return false if the channel is not usable on `context`, if the segment
+    /// was not created by a SharedMemoryPayloadChannel, if it is smaller than
+    /// the declared size or if it could not be mapped.
+    static bool importPayload(Message& msg, const StreamContext& context);
+
+    /// Unlink all the segments created by this channel that are still present.
+    void release();
+
+  private:
+    // Unlink the segments that were already consumed by the receiver from our
+    // bookkeeping. Must be called with _mutex locked.
+    void pruneConsumed();
+
+    boost::mutex _mutex;
+    std::deque<std::string> _pendingSegments;
+  };
+}
+
+#endif  // _SRC_SHAREDMEMORYPAYLOAD_HPP_
@@ -261,7 +261,7 @@ namespace qi { namespace sock {
       auto header = msg.header();
       if (header.magic != Message::Header::magicCookie)
       {
-        qiLogWarning(logCategory()) << &(*socket) << ": Incorrect magic from "
+        qiLogWarningLimited(10, logCategory()) << &(*socket) << ": Incorrect magic from "
           << (*socket).lowest_layer().remote_endpoint().address().to_string()
           << " (expected " << Message::Header::magicCookie
           << ", got " << header.magic << ").";
@@ -277,7 +277,7 @@ namespace qi { namespace sock {
       }
       if (payload > maxPayload)
       {
-        qiLogWarning(logCategory()) << "Receiving message of size " << payload
+        qiLogWarningLimited(10, logCategory()) << "Receiving message of size " << payload
           << " above maximum configured payload size " << maxPayload <<
              " (configure with environment variable QI_MAX_MESSAGE_PAYLOAD).";
         receiveErrorAndMaybeReceiveNext(messageSize<ErrorCode<N>>());
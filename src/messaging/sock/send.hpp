@@ -295,6 +295,7 @@ namespace qi { namespace sock {
     {
       std::lock_guard<std::mutex> lock{_sendMutex};
       _sendQueue.emplace_back(std::forward<Msg>(msg));
+      QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_Message, sizeof(Message));
       itMsg = _sendQueue.begin();
       // We've just added a message to the queue, so if we are not currently sending,
       // we must (re)start the send loop.
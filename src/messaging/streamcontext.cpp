@@ -4,6 +4,7 @@
 */
 
 #include <boost/algorithm/string.hpp>
+#include <boost/predef/os.h>
 
 #include "streamcontext.hpp"
 
@@ -16,6 +17,9 @@ namespace qi
     char const * const messageFlags          = "MessageFlags";
     char const * const remoteCancelableCalls = "RemoteCancelableCalls";
     char const * const objectPtrUid          = "ObjectPtrUID";
+    char const * const sharedMemoryPayload   = "SharedMemoryPayload";
+    char const * const payloadCompression    = "PayloadCompression";
+    char const * const metaObjectHashes      = "MetaObjectHashes";
   }
 
 
@@ -114,6 +118,9 @@ static void initCapabilities()
   , { capabilityname::metaObjectCache      , AnyValue::from(false) }
   , { capabilityname::remoteCancelableCalls, AnyValue::from(true)  }
   , { capabilityname::objectPtrUid         , AnyValue::from(true)  }
+#if BOOST_OS_LINUX && !BOOST_OS_ANDROID
+  , { capabilityname::sharedMemoryPayload  , AnyValue::from(qi::os::getMachineId()) }
+#endif
   };
 
   _defaultCapabilities = new CapabilityMap(defaultCaps);
@@ -37,6 +37,23 @@ using CapabilityMap = std::map<std::string, AnyValue>;
 
     // Capability: Objects allow unique identification using Ptruid/ObjectUid.
     QI_API extern char const * const objectPtrUid;
+
+    // Capability: large message payloads can be passed through shared memory.
+    // The value is the machine id of the advertiser: the capability is only
+    // shared if both ends advertise the same machine id.
+    QI_API extern char const * const sharedMemoryPayload;
+
+    // Capability: large message payloads can be compressed. The value is the
+    // comma-separated list of supported algorithms, by order of preference.
+    // Not advertised by default, set it with QI_TRANSPORT_CAPABILITIES, for
+    // instance `PayloadCompression=zlib`.
+    QI_API extern char const * const payloadCompression;
+
+    // Capability: hashes of the metaobjects of the services of a server, as a
+    // map of service id to MetaObjectCache::hash(). Advertised by servers
+    // on each incoming connection, so that clients may skip fetching the
+    // metaobjects they already know.
+    QI_API extern char const * const metaObjectHashes;
   }
 
 /** Store contextual data associated to one point-to-point point transport.
@@ -18,6 +18,8 @@
 #include "message.hpp"
 #include "messagedispatcher.hpp"
 #include "messagesocket.hpp"
+#include "payloadcompression.hpp"
+#include "sharedmemorypayload.hpp"
 #include "sock/disconnectedstate.hpp"
 #include "sock/disconnectingstate.hpp"
 #include "sock/connectingstate.hpp"
@@ -280,6 +282,8 @@ namespace qi {
     using State = boost::variant<DisconnectedState, ConnectingState, ConnectedState, DisconnectingState>;
     State _state;
     boost::synchronized_value<Url> _url;
+    SharedMemoryPayloadChannel _sharedMemoryChannel;
+    PayloadCompressor _compressor;
 
     bool mustTreatAsServerAuthentication(const Message& msg) const;
     bool handleCapabilityMessage(const Message& msg);
@@ -508,8 +512,12 @@ namespace qi {
         {
           boost::recursive_mutex::scoped_lock lock(self->_stateMutex);
           self->_state = DisconnectedState{};
+          // The compression streams restart with the next connection.
+          self->_compressor.reset();
           QI_LOG_DEBUG_SOCKET(socket.get()) << "Socket disconnected.";
         }
+        // Segments that were not received will never be.
+        self->_sharedMemoryChannel.release();
         static const std::string data{"disconnected"};
         if (wasConnected)
         {
@@ -547,7 +555,7 @@ namespace qi {
     }
     catch (const std::runtime_error& e)
     {
-      QI_LOG_ERROR_SOCKET(this) << "Ill-formed capabilities message: " << e.what();
+      qiLogErrorLimited(10, sock::logCategory()) << this << ": Ill-formed capabilities message: " << e.what();
       return false;
     }
     return true;
@@ -556,6 +564,17 @@ namespace qi {
   template<typename N, typename S>
   bool TcpMessageSocket<N, S>::handleNormalMessage(Message& msg)
   {
+    if ((msg.flags() & Message::TypeFlag_SharedMemoryPayload)
+        && !SharedMemoryPayloadChannel::importPayload(msg, *this))
+    {
+      return false;
+    }
+    static const auto maxPayload = getMaxPayloadFromEnv();
+    if ((msg.flags() & Message::TypeFlag_CompressedPayload)
+        && !_compressor.decompress(msg, *this, maxPayload))
+    {
+      return false;
+    }
     messageReady(msg);
     socketEvent(SocketEventData(msg));
     _dispatcher.dispatch(msg);
@@ -587,12 +606,17 @@ namespace qi {
   template<typename N, typename S>
   bool TcpMessageSocket<N, S>::send(Message msg)
   {
+    // Done before locking: the payload may be copied to shared memory.
+    _sharedMemoryChannel.exportPayload(msg, *this);
     boost::recursive_mutex::scoped_lock lock(_stateMutex);
     if (getStatus() != Status::Connected)
     {
       QI_LOG_DEBUG_SOCKET(this) << "Socket must be connected to send().";
       return false;
     }
+    // Done under the lock: compressed messages must be sent in the order they
+    // were given to the compression stream.
+    _compressor.compress(msg, *this);
     // NOTE: Should we specify an `onSent` callback and stop sending if an error
     // occurred?
     asConnected(_state).send(std::move(msg), _ssl);
@@ -6,10 +6,12 @@
 #include <sstream>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 
 #include <qi/log.hpp>
 #include <qi/numeric.hpp>
+#include <qi/os.hpp>
 
 #include "messagesocket.hpp"
 #include "transportsocketcache.hpp"
@@ -18,11 +20,61 @@ qiLogCategory("qimessaging.transportsocketcache");
 
 namespace qi
 {
-TransportSocketCache::TransportSocketCache()
-  : _dying(false)
+TransportSocketCache::TransportSocketCache(unsigned int socketsPerEndpoint,
+                                           std::set<std::string> bulkServices)
+  : _socketsPerEndpoint(std::max(socketsPerEndpoint, 1u))
+  , _connections(_socketsPerEndpoint)
+  , _bulkServices(std::move(bulkServices))
+  , _dying(false)
 {
 }
 
+unsigned int TransportSocketCache::defaultSocketsPerEndpoint()
+{
+  const std::string env = os::getenv("QI_SOCKETS_PER_ENDPOINT");
+  if (env.empty())
+    return 1u;
+  try
+  {
+    return std::max(boost::lexical_cast<unsigned int>(env), 1u);
+  }
+  catch (const boost::bad_lexical_cast&)
+  {
+    qiLogWarning() << "Invalid value for QI_SOCKETS_PER_ENDPOINT: '" << env << "'";
+    return 1u;
+  }
+}
+
+std::set<std::string> TransportSocketCache::defaultBulkServices()
+{
+  std::set<std::string> names;
+  const std::string env = os::getenv("QI_BULK_SERVICES");
+  if (env.empty())
+    return names;
+  std::vector<std::string> split;
+  boost::algorithm::split(split, env, boost::algorithm::is_any_of(","));
+  for (auto& name : split)
+  {
+    boost::algorithm::trim(name);
+    if (!name.empty())
+      names.insert(name);
+  }
+  return names;
+}
+
+unsigned int TransportSocketCache::lane(const ServiceInfo& servInfo) const
+{
+  const unsigned int lanes = socketsPerEndpoint();
+  if (lanes == 1u)
+    return 0u;
+  if (_bulkServices.empty())
+    return servInfo.serviceId() % lanes;
+  // The last lane is reserved to the bulk services.
+  if (_bulkServices.count(servInfo.name()))
+    return lanes - 1u;
+  return servInfo.serviceId() % (lanes - 1u);
+}
+
 TransportSocketCache::~TransportSocketCache()
 {
   _dying = true;
@@ -60,32 +112,35 @@ void TransportSocketCache::close()
 {
   qiLogDebug() << "TransportSocketCache is closing";
   {
-    ConnectionMap map;
+    std::vector<ConnectionMap> maps(_socketsPerEndpoint);
     std::list<MessageSocketPtr> pending;
     {
       boost::mutex::scoped_lock lock(_socketMutex);
       _dying = true;
-      std::swap(map, _connections);
+      std::swap(maps, _connections);
       std::swap(pending, _allPendingConnections);
     }
-    for (auto& pairMachineIdConnection: map)
+    for (auto& map: maps)
     {
-      auto& mapUrlConnection = pairMachineIdConnection.second;
-      for (auto& pairUrlConnection: mapUrlConnection)
+      for (auto& pairMachineIdConnection: map)
       {
-        auto& connectionAttempt = *pairUrlConnection.second;
-        auto endpoint = connectionAttempt.endpoint;
-
-        // Disconnect any valid socket we were holding.
-        if (endpoint)
-        {
-          endpoint->disconnect();
-          endpoint->disconnected.disconnect(connectionAttempt.disconnectionTracking);
-        }
-        else
+        auto& mapUrlConnection = pairMachineIdConnection.second;
+        for (auto& pairUrlConnection: mapUrlConnection)
         {
-          connectionAttempt.state = State_Error;
-          connectionAttempt.promise.setError("TransportSocketCache is closing.");
+          auto& connectionAttempt = *pairUrlConnection.second;
+          auto endpoint = connectionAttempt.endpoint;
+
+          // Disconnect any valid socket we were holding.
+          if (endpoint)
+          {
+            endpoint->disconnect();
+            endpoint->disconnected.disconnect(connectionAttempt.disconnectionTracking);
+          }
+          else
+          {
+            connectionAttempt.state = State_Error;
+            connectionAttempt.promise.setError("TransportSocketCache is closing.");
+          }
         }
       }
     }
@@ -138,6 +193,7 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
 
   couple->endpoint = MessageSocketPtr();
   couple->state = State_Pending;
+  const unsigned int socketLane = lane(servInfo);
   {
     // If we already have a pending connection to one of the urls, we return the future in question
     boost::mutex::scoped_lock lock(_socketMutex);
@@ -145,8 +201,9 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
     if (_dying)
       return makeFutureError<MessageSocketPtr>("TransportSocketCache is closed.");
 
-    ConnectionMap::iterator machineIt = _connections.find(machineId);
-    if (machineIt != _connections.end())
+    ConnectionMap& connections = _connections[socketLane];
+    ConnectionMap::iterator machineIt = connections.find(machineId);
+    if (machineIt != connections.end())
     {
       // Check if any connection to the machine matches one of our urls
       UrlVector& vurls = couple->relatedUrls;
@@ -166,7 +223,7 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
     // Otherwise, we keep track of all those URLs and assign them the same promise in our map.
     // They will all track the same connection.
     couple->attemptCount = qi::numericConvert<int>(connectionCandidates.size());
-    std::map<Url, ConnectionAttemptPtr>& urlMap = _connections[machineId];
+    std::map<Url, ConnectionAttemptPtr>& urlMap = connections[machineId];
     for (const auto& url: connectionCandidates)
     {
       if (!url.isValid())
@@ -179,9 +236,9 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
       MessageSocketPtr socket = makeMessageSocket(url.protocol());
       _allPendingConnections.push_back(socket);
       Future<void> sockFuture = socket->connect(url);
-      qiLogDebug() << "Inserted [" << machineId << "][" << url.str() << "]";
+      qiLogDebug() << "Inserted [" << machineId << "][" << url.str() << "] on lane " << socketLane;
       sockFuture.then(std::bind(&TransportSocketCache::onSocketParallelConnectionAttempt, this,
-                                std::placeholders::_1, socket, url, servInfo));
+                                std::placeholders::_1, socket, url, servInfo, socketLane));
     }
   }
   return couple->promise.future();
@@ -228,10 +285,11 @@ void TransportSocketCache::insert(const std::string& machineId, const Url& url,
 
   info.setMachineId(machineId);
   qi::SignalLink disconnectionTracking = socket->disconnected.connect(
-      track([=](const std::string&) { onSocketDisconnected(url, info); }, this));
+      track([=](const std::string&) { onSocketDisconnected(url, info, 0u); }, this));
 
-  ConnectionMap::iterator mIt = _connections.find(machineId);
-  if (mIt != _connections.end())
+  ConnectionMap& connections = _connections[0];
+  ConnectionMap::iterator mIt = connections.find(machineId);
+  if (mIt != connections.end())
   {
     std::map<Url, ConnectionAttemptPtr>::iterator uIt = mIt->second.find(url);
     if (uIt != mIt->second.end())
@@ -257,7 +315,7 @@ void TransportSocketCache::insert(const std::string& machineId, const Url& url,
   couple->endpoint = socket;
   couple->state = State_Connected;
   couple->relatedUrls.push_back(url);
-  _connections[machineId][url] = couple;
+  connections[machineId][url] = couple;
   couple->promise.setValue(socket);
 }
 
@@ -276,7 +334,8 @@ void TransportSocketCache::insert(const std::string& machineId, const Url& url,
 void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
                                                              MessageSocketPtr socket,
                                                              Url url,
-                                                             const ServiceInfo& info)
+                                                             const ServiceInfo& info,
+                                                             unsigned int lane)
 {
   boost::mutex::scoped_lock lock(_socketMutex);
 
@@ -291,12 +350,13 @@ void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
     return;
   }
 
-  ConnectionMap::iterator machineIt = _connections.find(info.machineId());
+  ConnectionMap& connections = _connections[lane];
+  ConnectionMap::iterator machineIt = connections.find(info.machineId());
   std::map<Url, ConnectionAttemptPtr>::iterator urlIt;
-  if (machineIt != _connections.end())
+  if (machineIt != connections.end())
     urlIt = machineIt->second.find(url);
 
-  if (machineIt == _connections.end() || urlIt == machineIt->second.end())
+  if (machineIt == connections.end() || urlIt == machineIt->second.end())
   {
     // The socket was disconnected at some point, and we removed it from our map:
     // return early.
@@ -312,7 +372,7 @@ void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
     qiLogDebug() << "Already connected: reject socket " << socket.get() << " endpoint " << url.str();
     _allPendingConnections.remove(socket);
     socket->disconnect();
-    checkClear(attempt, info.machineId());
+    checkClear(attempt, info.machineId(), lane);
     return;
   }
   if (fut.hasError())
@@ -328,12 +388,12 @@ void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
       qiLogError() << err.str();
       attempt->promise.setError(err.str());
       attempt->state = State_Error;
-      checkClear(attempt, info.machineId());
+      checkClear(attempt, info.machineId(), lane);
     }
     return;
   }
   qi::SignalLink disconnectionTracking = socket->disconnected.connect(
-      track([=](const std::string&) { onSocketDisconnected(url, info); }, this));
+      track([=](const std::string&) { onSocketDisconnected(url, info, lane); }, this));
   attempt->state = State_Connected;
   attempt->endpoint = socket;
   attempt->promise.setValue(socket);
@@ -342,18 +402,19 @@ void TransportSocketCache::onSocketParallelConnectionAttempt(Future<void> fut,
                << socket.get();
 }
 
-void TransportSocketCache::checkClear(ConnectionAttemptPtr attempt, const std::string& machineId)
+void TransportSocketCache::checkClear(ConnectionAttemptPtr attempt, const std::string& machineId, unsigned int lane)
 {
   if ((attempt->attemptCount <= 0 && attempt->state != State_Connected) || attempt->state == State_Error)
   {
-    ConnectionMap::iterator machineIt = _connections.find(machineId);
-    if (machineIt == _connections.end())
+    ConnectionMap& connections = _connections[lane];
+    ConnectionMap::iterator machineIt = connections.find(machineId);
+    if (machineIt == connections.end())
       return;
     for (UrlVector::const_iterator uit = attempt->relatedUrls.begin(), end = attempt->relatedUrls.end(); uit != end;
          ++uit)
       machineIt->second.erase(*uit);
     if (machineIt->second.size() == 0)
-      _connections.erase(machineIt);
+      connections.erase(machineIt);
   }
 }
 
@@ -383,18 +444,19 @@ static void updateDisconnectInfos(C& disconnectInfos, const MessageSocketPtr& so
   promise.setValue(0);
 }
 
-void TransportSocketCache::onSocketDisconnected(Url url, const ServiceInfo& info)
+void TransportSocketCache::onSocketDisconnected(Url url, const ServiceInfo& info, unsigned int lane)
 {
   // remove from the available connections
   boost::mutex::scoped_lock lock(_socketMutex);
 
-  ConnectionMap::iterator machineIt = _connections.find(info.machineId());
-  if (machineIt == _connections.end())
+  ConnectionMap& connections = _connections[lane];
+  ConnectionMap::iterator machineIt = connections.find(info.machineId());
+  if (machineIt == connections.end())
     return;
   qiLogDebug() << "onSocketDisconnected: about to erase socket";
   auto attempt = machineIt->second[url];
   attempt->state = State_Error;
-  checkClear(attempt, info.machineId());
+  checkClear(attempt, info.machineId(), lane);
   auto syncDisconnectInfos = _disconnectInfos.synchronize();
   updateDisconnectInfos(*syncDisconnectInfos, attempt->endpoint);
 }
@@ -9,6 +9,8 @@
 
 #include <string>
 #include <queue>
+#include <set>
+#include <vector>
 
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/synchronized_value.hpp>
@@ -33,14 +35,37 @@ namespace qi
   * -> if the connection is pending wait for the result
   * -> if the socket do not exist, create it, and try to connect it
   * -> if the socket is disconnected try to reconnect it
+  *
+  * Several sockets can be kept for the same endpoint, so that the traffic
+  * of unrelated services does not share a single TCP stream. Each service
+  * is assigned to one of these sockets (its lane) by hashing its id, so
+  * that all the messages of an object, and thus of each of its signals,
+  * keep going through the same socket and stay ordered. Services known to
+  * exchange large payloads can be given a lane of their own, so that they
+  * do not delay the small messages of other services.
   */
 
   class TransportSocketCache : public Trackable<TransportSocketCache>
   {
   public:
-    TransportSocketCache();
+    /// @param socketsPerEndpoint Maximum number of sockets kept for each endpoint.
+    /// @param bulkServices Names of the services that get a dedicated socket
+    /// when `socketsPerEndpoint` is greater than 1.
+    explicit TransportSocketCache(unsigned int socketsPerEndpoint = defaultSocketsPerEndpoint(),
+                                  std::set<std::string> bulkServices = defaultBulkServices());
     ~TransportSocketCache();
 
+    /// Value of the `QI_SOCKETS_PER_ENDPOINT` environment variable, 1 by default.
+    static unsigned int defaultSocketsPerEndpoint();
+    /// Comma separated list of the `QI_BULK_SERVICES` environment variable.
+    static std::set<std::string> defaultBulkServices();
+
+    unsigned int socketsPerEndpoint() const { return _socketsPerEndpoint; }
+
+    /// Index of the socket used for the given service, among the sockets of
+    /// its endpoint.
+    unsigned int lane(const ServiceInfo& servInfo) const;
+
     void init();
     void close();
 
@@ -51,6 +76,7 @@ namespace qi
     /// @param servInfo A service info retrieved from a service directory.
     /// @param sdUrl The endpoint of the service directory on which the service info came from.
     Future<MessageSocketPtr> socket(const ServiceInfo& servInfo, const std::string& sdUrl);
+    /// Insert an already connected socket, as the first socket of the endpoint.
     void insert(const std::string& machineId, const Url& url, MessageSocketPtr socket);
 
     /// The returned future is set when the socket has been disconnected and
@@ -66,8 +92,8 @@ namespace qi
 
     using UrlVectorPtr = boost::shared_ptr<UrlVector>;
     void onSocketConnectionAttempt(Future<void> fut, Promise<MessageSocketPtr> prom, MessageSocketPtr socket, const ServiceInfo& info, uint32_t currentUrlIdx, UrlVectorPtr urls);
-    void onSocketParallelConnectionAttempt(Future<void> fut, MessageSocketPtr socket, Url url, const ServiceInfo& info);
-    void onSocketDisconnected(Url url, const ServiceInfo& info);
+    void onSocketParallelConnectionAttempt(Future<void> fut, MessageSocketPtr socket, Url url, const ServiceInfo& info, unsigned int lane);
+    void onSocketDisconnected(Url url, const ServiceInfo& info, unsigned int lane);
 
 
     boost::mutex _socketMutex;
@@ -81,7 +107,7 @@ namespace qi
     };
     using ConnectionAttemptPtr = boost::shared_ptr<ConnectionAttempt>;
 
-    void checkClear(ConnectionAttemptPtr, const std::string& machineId);
+    void checkClear(ConnectionAttemptPtr, const std::string& machineId, unsigned int lane);
 
     /// The promise is set when the `disconnected` signal of `socket` has been received.
     struct DisconnectInfo
@@ -92,7 +118,12 @@ namespace qi
 
     using MachineId = std::string;
     using ConnectionMap = std::map<MachineId, std::map<Url, ConnectionAttemptPtr>>;
-    ConnectionMap _connections;
+    /// Number of lanes. It never changes, so it can be read without locking,
+    /// whereas `_connections` is swapped by close().
+    const unsigned int _socketsPerEndpoint;
+    /// One map per lane, guarded by `_socketMutex`.
+    std::vector<ConnectionMap> _connections;
+    const std::set<std::string> _bulkServices;
     std::list<MessageSocketPtr> _allPendingConnections;
     boost::synchronized_value<std::vector<DisconnectInfo>> _disconnectInfos;
     bool _dying;
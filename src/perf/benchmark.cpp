@@ -0,0 +1,220 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include "benchmark_p.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/jsoncodec.hpp>
+
+QI_TYPE_STRUCT(qi::BenchmarkResult, name, variable, msgSize, iterations,
+               mean, min, p50, p99, p999, max, cpu, allocations);
+QI_TYPE_STRUCT(qi::BenchmarkFile, project, executable, results);
+
+namespace qi
+{
+  namespace
+  {
+    double toMicroseconds(qi::Duration d, unsigned int batch)
+    {
+      return boost::chrono::duration<double, boost::micro>(d).count() / batch;
+    }
+
+    // Nearest-rank percentile of sorted samples.
+    qi::Duration percentile(const std::vector<qi::Duration>& sorted, double p)
+    {
+      const std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+      return sorted[rank == 0 ? 0 : rank - 1];
+    }
+  }
+
+  double BenchmarkResult::msgPerSecond() const
+  {
+    return 1000.0 * 1000.0 / mean;
+  }
+
+  double BenchmarkResult::megaBytePerSecond() const
+  {
+    if (msgSize > 0)
+      return (msgPerSecond() * msgSize) / (1024.0 * 1024.0);
+
+    return -1;
+  }
+
+  BenchmarkSuite::BenchmarkSuite(const std::string& projectName,
+                                 const std::string& executableName,
+                                 const BenchmarkOptions& options)
+    : _p(new BenchmarkSuitePrivate)
+  {
+    _p->options = options;
+    _p->file.project = projectName;
+    _p->file.executable = executableName;
+
+    std::cout << projectName << ": " << executableName << std::endl
+              << "Name: bytes, msg/s, MB/s, mean/p50/p99/p999/max (us), cpu (us), allocations"
+              << std::endl;
+  }
+
+  BenchmarkSuite::~BenchmarkSuite()
+  {
+    try
+    {
+      close();
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << e.what() << std::endl;
+    }
+    delete _p;
+  }
+
+  const BenchmarkResult& BenchmarkSuite::add(const std::string& name,
+                                             const std::string& variable,
+                                             unsigned long msgSize,
+                                             std::vector<qi::Duration> samples,
+                                             qi::Duration cpu,
+                                             qi::int64_t allocations,
+                                             unsigned int batch)
+  {
+    if (samples.empty())
+      throw std::invalid_argument("BenchmarkSuite: no sample for " + name);
+    if (batch == 0)
+      batch = 1;
+
+    std::sort(samples.begin(), samples.end());
+    qi::Duration total(0);
+    for (const qi::Duration& sample : samples)
+      total += sample;
+
+    const unsigned long calls = static_cast<unsigned long>(samples.size()) * batch;
+    BenchmarkResult result;
+    result.name = name;
+    result.variable = variable;
+    result.msgSize = msgSize;
+    result.iterations = calls;
+    result.mean = toMicroseconds(total, batch) / samples.size();
+    result.min = toMicroseconds(samples.front(), batch);
+    result.p50 = toMicroseconds(percentile(samples, 0.5), batch);
+    result.p99 = toMicroseconds(percentile(samples, 0.99), batch);
+    result.p999 = toMicroseconds(percentile(samples, 0.999), batch);
+    result.max = toMicroseconds(samples.back(), batch);
+    result.cpu = toMicroseconds(cpu, 1) / calls;
+    result.allocations = allocations < 0 ? -1. : static_cast<double>(allocations) / calls;
+
+    std::cout << name << "-" << variable << ": ";
+    if (msgSize > 0)
+      std::cout << msgSize << " b, ";
+    std::cout << std::fixed << std::setprecision(2) << result.msgPerSecond() << " msg/s, ";
+    if (msgSize > 0)
+      std::cout << result.megaBytePerSecond() << " MB/s, ";
+    std::cout << std::setprecision(3)
+              << result.mean << "/" << result.p50 << "/" << result.p99 << "/"
+              << result.p999 << "/" << result.max << " us, "
+              << result.cpu << " us";
+    if (result.allocations >= 0)
+      std::cout << ", " << std::setprecision(1) << result.allocations << " alloc";
+    std::cout << std::endl;
+
+    _p->file.results.push_back(std::move(result));
+    return _p->file.results.back();
+  }
+
+  const BenchmarkOptions& BenchmarkSuite::options() const
+  {
+    return _p->options;
+  }
+
+  const std::vector<BenchmarkResult>& BenchmarkSuite::results() const
+  {
+    return _p->file.results;
+  }
+
+  unsigned int BenchmarkSuite::close()
+  {
+    if (_p->closed)
+      return 0;
+    _p->closed = true;
+
+    const std::string& output = _p->options.output;
+    if (!output.empty())
+    {
+      boost::filesystem::ofstream out(output, std::ios_base::out | std::ios_base::trunc);
+      if (!out.is_open())
+        std::cerr << "Can't open file " << output << "." << std::endl;
+      else if (boost::algorithm::iends_with(output, ".csv"))
+        _p->writeCSV(out);
+      else
+        _p->writeJSON(out);
+    }
+
+    if (_p->options.baseline.empty())
+      return 0;
+    return _p->compare(readBenchmarkResults(_p->options.baseline));
+  }
+
+  void BenchmarkSuitePrivate::writeJSON(std::ostream& out) const
+  {
+    encodeJSON(file, out, JsonOption_PrettyPrint);
+    out << std::endl;
+  }
+
+  void BenchmarkSuitePrivate::writeCSV(std::ostream& out) const
+  {
+    out << "project,executable,name,variable,msg_size,iterations,"
+           "mean_us,min_us,p50_us,p99_us,p999_us,max_us,cpu_us,allocations"
+        << std::endl;
+    out << std::setprecision(6);
+    for (const BenchmarkResult& r : file.results)
+    {
+      // Names are identifiers chosen by the benchmarks, they are not quoted.
+      out << file.project << ',' << file.executable << ','
+          << r.name << ',' << r.variable << ','
+          << r.msgSize << ',' << r.iterations << ','
+          << r.mean << ',' << r.min << ',' << r.p50 << ','
+          << r.p99 << ',' << r.p999 << ',' << r.max << ','
+          << r.cpu << ',' << r.allocations << std::endl;
+    }
+  }
+
+  unsigned int BenchmarkSuitePrivate::compare(const std::vector<BenchmarkResult>& baseline) const
+  {
+    unsigned int regressions = 0;
+    std::cout << "Comparison of the median with " << options.baseline << ":" << std::endl;
+    for (const BenchmarkResult& r : file.results)
+    {
+      const auto reference = std::find_if(baseline.begin(), baseline.end(),
+          [&](const BenchmarkResult& b) { return b.name == r.name && b.variable == r.variable; });
+      if (reference == baseline.end() || reference->p50 <= 0)
+        continue;
+
+      const double change = (r.p50 / reference->p50 - 1.) * 100.;
+      const bool regression = change > options.tolerance;
+      if (regression)
+        ++regressions;
+      std::cout << r.name << "-" << r.variable << ": "
+                << std::fixed << std::setprecision(3)
+                << reference->p50 << " -> " << r.p50 << " us ("
+                << std::showpos << std::setprecision(1) << change << std::noshowpos << " %)"
+                << (regression ? " REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+  }
+
+  std::vector<BenchmarkResult> readBenchmarkResults(const std::string& filename)
+  {
+    boost::filesystem::ifstream in(filename);
+    if (!in.is_open())
+      throw std::runtime_error("Can't open benchmark results " + filename);
+    BenchmarkFile file;
+    decodeJSON(in, AnyReference::from(file));
+    return std::move(file.results);
+  }
+}
@@ -0,0 +1,35 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#pragma once
+#ifndef _QI_PERF_BENCHMARK_P_HPP_
+#define _QI_PERF_BENCHMARK_P_HPP_
+
+#include <qi/perf/benchmark.hpp>
+
+namespace qi
+{
+  /// Layout of the JSON output.
+  struct BenchmarkFile
+  {
+    std::string project;
+    std::string executable;
+    std::vector<BenchmarkResult> results;
+  };
+
+  class BenchmarkSuitePrivate
+  {
+  public:
+    BenchmarkOptions options;
+    BenchmarkFile file;
+    bool closed = false;
+
+    void writeJSON(std::ostream& out) const;
+    void writeCSV(std::ostream& out) const;
+    unsigned int compare(const std::vector<BenchmarkResult>& baseline) const;
+  };
+}
+
+#endif  // _QI_PERF_BENCHMARK_P_HPP_
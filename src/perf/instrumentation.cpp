@@ -0,0 +1,263 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <qi/perf/instrumentation.hpp>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <boost/thread/mutex.hpp>
+#include <qi/atomic.hpp>
+#include <qi/os.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+
+namespace qi
+{
+  namespace detail
+  {
+    namespace instrumentation
+    {
+      using Counters = std::array<std::atomic<qi::uint64_t>, qi::instrumentation::waitHistogramSize>;
+
+      class LockCounter
+      {
+      public:
+        explicit LockCounter(const std::string& name)
+          : name(name)
+          , waitHistogram()
+        {}
+
+        const std::string name;
+        std::atomic<qi::uint64_t> acquisitions{0};
+        std::atomic<qi::uint64_t> contentions{0};
+        std::atomic<qi::uint64_t> waitTotal{0};
+        std::atomic<qi::uint64_t> waitMax{0};
+        std::atomic<qi::uint64_t> holdTotal{0};
+        std::atomic<qi::uint64_t> holdMax{0};
+        Counters waitHistogram;
+      };
+
+      namespace
+      {
+        std::atomic<bool>& enabledFlag()
+        {
+#ifdef QI_WITH_INSTRUMENTATION
+          static std::atomic<bool> flag(qi::os::getenv("QI_INSTRUMENTATION") == "1");
+#else
+          static std::atomic<bool> flag(false);
+#endif
+          return flag;
+        }
+
+        struct Registry
+        {
+          boost::mutex mutex;
+          std::map<std::string, LockCounter*> locks;
+        };
+
+        // Counters are never destroyed: locks may be taken until the very end
+        // of the process.
+        Registry& registry()
+        {
+          static Registry* result = nullptr;
+          QI_THREADSAFE_NEW(result);
+          return *result;
+        }
+
+        // Constant-initialized, as allocations may happen during the static
+        // initialization.
+        std::atomic<qi::uint64_t> allocationCounts[qi::instrumentation::AllocationSubsystem_Count];
+        std::atomic<qi::uint64_t> allocationBytes[qi::instrumentation::AllocationSubsystem_Count];
+
+        qi::uint64_t nanoseconds(qi::Duration d)
+        {
+          return d.count() < 0 ? 0 : static_cast<qi::uint64_t>(d.count());
+        }
+
+        void updateMax(std::atomic<qi::uint64_t>& max, qi::uint64_t value)
+        {
+          qi::uint64_t current = max.load(std::memory_order_relaxed);
+          while (value > current &&
+                 !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+          {}
+        }
+
+        unsigned int histogramBucket(qi::uint64_t ns)
+        {
+          qi::uint64_t us = ns / 1000;
+          unsigned int bucket = 0;
+          while (us != 0 && bucket < qi::instrumentation::waitHistogramSize - 1)
+          {
+            us >>= 1;
+            ++bucket;
+          }
+          return bucket;
+        }
+
+        void store(std::atomic<qi::uint64_t>& counter)
+        {
+          counter.store(0, std::memory_order_relaxed);
+        }
+
+        qi::uint64_t load(const std::atomic<qi::uint64_t>& counter)
+        {
+          return counter.load(std::memory_order_relaxed);
+        }
+      }
+
+      bool enabled()
+      {
+        return enabledFlag().load(std::memory_order_relaxed);
+      }
+
+      LockCounter& lockCounter(const char* name)
+      {
+        Registry& r = registry();
+        boost::mutex::scoped_lock lock(r.mutex);
+        LockCounter*& counter = r.locks[name];
+        if (!counter)
+          counter = new LockCounter(name);
+        return *counter;
+      }
+
+      void recordLock(LockCounter& counter, qi::Duration wait)
+      {
+        const qi::uint64_t ns = nanoseconds(wait);
+        counter.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        counter.waitHistogram[histogramBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        if (ns == 0)
+          return;
+        counter.contentions.fetch_add(1, std::memory_order_relaxed);
+        counter.waitTotal.fetch_add(ns, std::memory_order_relaxed);
+        updateMax(counter.waitMax, ns);
+      }
+
+      void recordHold(LockCounter& counter, qi::Duration hold)
+      {
+        const qi::uint64_t ns = nanoseconds(hold);
+        counter.holdTotal.fetch_add(ns, std::memory_order_relaxed);
+        updateMax(counter.holdMax, ns);
+      }
+
+      void recordAllocation(qi::instrumentation::AllocationSubsystem subsystem, std::size_t bytes)
+      {
+        allocationCounts[subsystem].fetch_add(1, std::memory_order_relaxed);
+        allocationBytes[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  namespace instrumentation
+  {
+    namespace impl = qi::detail::instrumentation;
+
+    bool isCompiled()
+    {
+#ifdef QI_WITH_INSTRUMENTATION
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    bool isEnabled()
+    {
+      return impl::enabled();
+    }
+
+    void setEnabled(bool enabled)
+    {
+      if (isCompiled())
+        impl::enabledFlag().store(enabled, std::memory_order_relaxed);
+    }
+
+    const char* subsystemName(AllocationSubsystem subsystem)
+    {
+      switch (subsystem)
+      {
+      case AllocationSubsystem_Buffer:
+        return "Buffer";
+      case AllocationSubsystem_Future:
+        return "Future";
+      case AllocationSubsystem_StrandCallback:
+        return "StrandCallback";
+      case AllocationSubsystem_Message:
+        return "Message";
+      default:
+        return "Unknown";
+      }
+    }
+
+    Snapshot snapshot()
+    {
+      Snapshot result;
+      result.enabled = isEnabled();
+      {
+        impl::Registry& registry = impl::registry();
+        boost::mutex::scoped_lock lock(registry.mutex);
+        for (const auto& entry : registry.locks)
+        {
+          const impl::LockCounter& counter = *entry.second;
+          LockStats stats;
+          stats.name = counter.name;
+          stats.acquisitions = impl::load(counter.acquisitions);
+          stats.contentions = impl::load(counter.contentions);
+          stats.waitTotal = impl::load(counter.waitTotal);
+          stats.waitMax = impl::load(counter.waitMax);
+          stats.holdTotal = impl::load(counter.holdTotal);
+          stats.holdMax = impl::load(counter.holdMax);
+          for (const auto& bucket : counter.waitHistogram)
+            stats.waitHistogram.push_back(impl::load(bucket));
+          result.locks.push_back(std::move(stats));
+        }
+      }
+      for (int i = 0; i < AllocationSubsystem_Count; ++i)
+      {
+        AllocationStats stats;
+        stats.subsystem = subsystemName(static_cast<AllocationSubsystem>(i));
+        stats.count = impl::load(impl::allocationCounts[i]);
+        stats.bytes = impl::load(impl::allocationBytes[i]);
+        result.allocations.push_back(std::move(stats));
+      }
+      return result;
+    }
+
+    void reset()
+    {
+      {
+        impl::Registry& registry = impl::registry();
+        boost::mutex::scoped_lock lock(registry.mutex);
+        for (const auto& entry : registry.locks)
+        {
+          impl::LockCounter& counter = *entry.second;
+          impl::store(counter.acquisitions);
+          impl::store(counter.contentions);
+          impl::store(counter.waitTotal);
+          impl::store(counter.waitMax);
+          impl::store(counter.holdTotal);
+          impl::store(counter.holdMax);
+          for (auto& bucket : counter.waitHistogram)
+            impl::store(bucket);
+        }
+      }
+      for (int i = 0; i < AllocationSubsystem_Count; ++i)
+      {
+        impl::store(impl::allocationCounts[i]);
+        impl::store(impl::allocationBytes[i]);
+      }
+    }
+
+    qi::Future<unsigned int> registerIntrospectionService(qi::Session& session)
+    {
+      qi::DynamicObjectBuilder builder;
+      builder.advertiseMethod("snapshot", &snapshot);
+      builder.advertiseMethod("reset", &reset);
+      builder.advertiseMethod("isEnabled", &isEnabled);
+      builder.advertiseMethod("setEnabled", &setEnabled);
+      return session.registerService("qi.Introspection", builder.object());
+    }
+  }
+}
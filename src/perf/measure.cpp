@@ -7,6 +7,9 @@
 
 #include <qi/perf/measure.hpp>
 
+#include <atomic>
+#include <boost/chrono/process_cpu_clocks.hpp>
+
 #ifdef __linux__
 #include <dirent.h>
 #include <unistd.h>
@@ -32,5 +35,38 @@ namespace qi
 
       return fdCount;
     }
+
+    Duration getProcessCpuTime()
+    {
+      const auto times = boost::chrono::process_cpu_clock::now().time_since_epoch().count();
+      using CpuDuration = boost::chrono::process_cpu_clock::duration;
+      return boost::chrono::duration_cast<Duration>(
+            boost::chrono::duration<CpuDuration::rep::rep, CpuDuration::period>(times.user + times.system));
+    }
+
+    namespace
+    {
+      std::atomic<qi::int64_t> allocationCount(0);
+      std::atomic<bool> allocationCounted(false);
+    }
+
+    qi::int64_t getAllocationCount()
+    {
+      if (!allocationCounted.load(std::memory_order_relaxed))
+        return -1;
+      return allocationCount.load(std::memory_order_relaxed);
+    }
+
+    namespace detail
+    {
+      void countAllocation()
+      {
+        // Allocations may happen before the initialization of the
+        // counters, which are constant-initialized.
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        if (!allocationCounted.load(std::memory_order_relaxed))
+          allocationCounted.store(true, std::memory_order_relaxed);
+      }
+    }
   }
 }
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#include <qi/log/rotatingfileloghandler.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <zlib.h>
+#include "log_p.hpp"
+#include <qi/os.hpp>
+
+qiLogCategory("qi.log.rotatingfileloghandler");
+
+namespace qi
+{
+namespace log
+{
+  namespace
+  {
+    // Compress `source` into `source`.gz, then remove `source`.
+    bool gzipFile(const std::string& source)
+    {
+      FILE* in = qi::os::fopen(source.c_str(), "rb");
+      if (!in)
+        return false;
+      const std::string target = source + ".gz";
+      gzFile out = gzopen(target.c_str(), "wb");
+      if (!out)
+      {
+        fclose(in);
+        return false;
+      }
+      char chunk[64 * 1024];
+      bool ok = true;
+      std::size_t read;
+      while (ok && (read = fread(chunk, 1, sizeof(chunk), in)) > 0)
+        ok = gzwrite(out, chunk, static_cast<unsigned int>(read)) == static_cast<int>(read);
+      ok = !ferror(in) && ok;
+      fclose(in);
+      ok = gzclose(out) == Z_OK && ok;
+
+      boost::system::error_code ec;
+      boost::filesystem::remove(ok ? source : target, ec);
+      return ok;
+    }
+  }
+
+  struct PrivateRotatingFileLogHandler
+  {
+    RotatingFileLogOptions _options;
+    std::string _fileName;
+    FILE* _file;
+    std::string _buffer;
+    std::size_t _fileSize;
+    qi::SteadyClock::time_point _fileOpened;
+    qi::SteadyClock::time_point _lastFlush;
+
+    // The background thread writes the buffer periodically, and compresses
+    // the rotated files.
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    std::deque<std::string> _toCompress;
+    unsigned int _rotations;
+    bool _stop;
+    boost::thread _thread;
+
+    std::string rotatedName(unsigned int index, bool compressed) const
+    {
+      std::string name = _fileName + "." + std::to_string(index);
+      if (compressed)
+        name += ".gz";
+      return name;
+    }
+
+    // Called with _mutex locked.
+    bool open()
+    {
+      _file = qi::os::fopen(_fileName.c_str(), "w+");
+      _fileSize = 0;
+      _fileOpened = qi::SteadyClock::now();
+      return _file != NULL;
+    }
+
+    // Called with _mutex locked.
+    void flush()
+    {
+      _lastFlush = qi::SteadyClock::now();
+      if (_buffer.empty() || !_file)
+        return;
+      fwrite(_buffer.data(), 1, _buffer.size(), _file);
+      fflush(_file);
+      _fileSize += _buffer.size();
+      _buffer.clear();
+    }
+
+    bool rotationNeeded() const
+    {
+      if (_options.maxFileSize != 0 && _fileSize + _buffer.size() >= _options.maxFileSize)
+        return true;
+      return _options.rotationInterval != qi::Duration::zero()
+          && qi::SteadyClock::now() - _fileOpened >= _options.rotationInterval;
+    }
+
+    // Called with _mutex locked. Shift the rotated files, and rename `path`
+    // to the first one.
+    void insertRotated(const std::string& path, bool gzipped)
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove(rotatedName(_options.maxFiles, false), ec);
+      boost::filesystem::remove(rotatedName(_options.maxFiles, true), ec);
+      for (unsigned int i = _options.maxFiles - 1; i > 0; --i)
+      {
+        for (bool compressed : {false, true})
+        {
+          if (boost::filesystem::exists(rotatedName(i, compressed), ec))
+            boost::filesystem::rename(rotatedName(i, compressed),
+                                      rotatedName(i + 1, compressed), ec);
+        }
+      }
+      boost::filesystem::rename(path, rotatedName(1, gzipped), ec);
+      if (ec)
+        std::cerr << "qi.log.rotatingfileloghandler: cannot rotate " << path << ": "
+                  << ec.message() << std::endl;
+    }
+
+    // Called with _mutex locked.
+    void rotate()
+    {
+      flush();
+      fclose(_file);
+      _file = NULL;
+
+      boost::system::error_code ec;
+      if (_options.maxFiles == 0)
+        boost::filesystem::remove(_fileName, ec);
+      else if (!_options.compress)
+        insertRotated(_fileName, false);
+      else
+      {
+        // The background thread shifts the rotated files once it has
+        // compressed this one: renaming them now would lose the file being
+        // compressed, and waiting for it would block the logging thread.
+        const std::string path = _fileName + ".rotated" + std::to_string(++_rotations);
+        boost::filesystem::rename(_fileName, path, ec);
+        if (ec)
+          std::cerr << "qi.log.rotatingfileloghandler: cannot rotate " << _fileName << ": "
+                    << ec.message() << std::endl;
+        else
+        {
+          _toCompress.push_back(path);
+          // The oldest files would be removed by the rotation of the newer
+          // ones anyway: drop them rather than letting the backlog grow.
+          while (_toCompress.size() > _options.maxFiles)
+          {
+            boost::filesystem::remove(_toCompress.front(), ec);
+            _toCompress.pop_front();
+          }
+          _cond.notify_all();
+        }
+      }
+
+      if (!open())
+        std::cerr << "qi.log.rotatingfileloghandler: cannot reopen " << _fileName << std::endl;
+    }
+
+    // Called with _mutex locked, by the background thread or once it is
+    // stopped.
+    void compressNext(boost::mutex::scoped_lock& lock)
+    {
+      const std::string path = _toCompress.front();
+      _toCompress.pop_front();
+      lock.unlock();
+      const bool ok = gzipFile(path);
+      lock.lock();
+      if (!ok)
+        std::cerr << "qi.log.rotatingfileloghandler: cannot compress " << path << std::endl;
+      insertRotated(ok ? path + ".gz" : path, ok);
+    }
+
+    void run()
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      while (!_stop)
+      {
+        if (!_toCompress.empty())
+        {
+          compressNext(lock);
+          continue;
+        }
+
+        if (_options.flushInterval <= qi::Duration::zero())
+        {
+          _cond.wait(lock);
+          continue;
+        }
+        const qi::SteadyClock::time_point nextFlush = _lastFlush + _options.flushInterval;
+        if (qi::SteadyClock::now() >= nextFlush)
+        {
+          flush();
+          continue;
+        }
+        _cond.wait_until(lock, nextFlush);
+      }
+    }
+  };
+
+  RotatingFileLogHandler::RotatingFileLogHandler(const std::string& filePath,
+                                                 const RotatingFileLogOptions& options)
+    : _p(new PrivateRotatingFileLogHandler)
+  {
+    _p->_options = options;
+    _p->_file = NULL;
+    _p->_rotations = 0;
+    _p->_stop = false;
+    _p->_lastFlush = qi::SteadyClock::now();
+    _p->_buffer.reserve(options.bufferSize);
+
+    boost::filesystem::path fPath(filePath);
+    _p->_fileName = fPath.make_preferred().string();
+    // Create the directory!
+    try
+    {
+      if (!boost::filesystem::exists(fPath.make_preferred().parent_path()))
+        boost::filesystem::create_directories(fPath.make_preferred().parent_path());
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+      qiLogWarning() << e.what();
+    }
+
+    if (!_p->open())
+    {
+      qiLogWarning() << "Cannot open " << filePath;
+      return;
+    }
+    _p->_thread = boost::thread(&PrivateRotatingFileLogHandler::run, _p.get());
+  }
+
+  RotatingFileLogHandler::~RotatingFileLogHandler()
+  {
+    {
+      boost::mutex::scoped_lock lock(_p->_mutex);
+      _p->flush();
+      _p->_stop = true;
+      _p->_cond.notify_all();
+    }
+    if (_p->_thread.joinable())
+      _p->_thread.join();
+    // Compress what the thread did not have time to.
+    {
+      boost::mutex::scoped_lock lock(_p->_mutex);
+      while (!_p->_toCompress.empty())
+        _p->compressNext(lock);
+    }
+    if (_p->_file != NULL)
+      fclose(_p->_file);
+  }
+
+  void RotatingFileLogHandler::log(const qi::LogLevel verb,
+                                   const qi::Clock::time_point date,
+                                   const qi::SystemClock::time_point systemDate,
+                                   const char* category,
+                                   const char* msg,
+                                   const char* file,
+                                   const char* fct,
+                                   const int line)
+  {
+    if (verb > qi::log::logLevel())
+      return;
+
+    boost::mutex::scoped_lock lock(_p->_mutex);
+    if (_p->_file == NULL)
+      return;
+
+    const std::string logline =
+        qi::detail::logline(qi::log::context(), date, systemDate, category, msg, file, fct, line, verb);
+    if (_p->_buffer.size() + logline.size() > _p->_options.bufferSize)
+      _p->flush();
+    _p->_buffer += logline;
+
+    if (_p->rotationNeeded())
+      _p->rotate();
+    else if (verb <= _p->_options.flushLevel || _p->_buffer.size() >= _p->_options.bufferSize)
+      _p->flush();
+  }
+
+  void RotatingFileLogHandler::flush()
+  {
+    boost::mutex::scoped_lock lock(_p->_mutex);
+    _p->flush();
+  }
+}
+}
@@ -160,7 +160,7 @@ void StrandPrivate::join() QI_NOEXCEPT(true)
     return;
   }
 
-  boost::unique_lock<boost::recursive_mutex> lock(_mutex);
+  Mutex::scoped_lock lock(_mutex);
   qiLogDebug() << "Strand joining (" << this << ")...";
 
   _dying = true; // Starting from this point, either this thread or the processing thread will complete the joining.
@@ -208,6 +208,7 @@ boost::shared_ptr<StrandPrivate::Callback> StrandPrivate::createCallback(boost::
 {
   ++_aliveCount;
   boost::shared_ptr<Callback> cbStruct = boost::make_shared<Callback>();
+  QI_INSTRUMENT_ALLOCATION(AllocationSubsystem_StrandCallback, sizeof(Callback));
   cbStruct->id = ++_curId;
   cbStruct->state = State::None;
   cbStruct->callback = std::move(cb);
@@ -252,7 +253,7 @@ void StrandPrivate::enqueue(boost::shared_ptr<Callback> cbStruct, ExecutionOptio
 {
   const bool shouldschedule = [&]()
   {
-    boost::recursive_mutex::scoped_lock lock(_mutex);
+    Mutex::scoped_lock lock(_mutex);
     qiLogDebug() << "Enqueueing job id " << cbStruct->id;
 
     auto scheduleCallback = [&] {
@@ -309,7 +310,7 @@ void StrandPrivate::enqueue(boost::shared_ptr<Callback> cbStruct, ExecutionOptio
   }
 }
 
-void StrandPrivate::stopProcess(boost::recursive_mutex::scoped_lock& lock,
+void StrandPrivate::stopProcess(Mutex::scoped_lock& lock,
                                 bool finished)
 {
   // if we still have work
@@ -341,7 +342,7 @@ void StrandPrivate::process()
   {
     boost::shared_ptr<Callback> cbStruct;
     {
-      boost::recursive_mutex::scoped_lock lock(_mutex);
+      Mutex::scoped_lock lock(_mutex);
       if (_dying)
       {
         qiLogDebug() << this << " strand is dying, stopping process";
@@ -389,14 +390,14 @@ void StrandPrivate::process()
   _processingThread = 0;
 
   {
-    boost::recursive_mutex::scoped_lock lock(_mutex);
+    Mutex::scoped_lock lock(_mutex);
     stopProcess(lock, false);
   }
 }
 
 void StrandPrivate::cancel(boost::shared_ptr<Callback> cbStruct)
 {
-  boost::recursive_mutex::scoped_lock lock(_mutex);
+  Mutex::scoped_lock lock(_mutex);
 
   switch (cbStruct->state)
   {
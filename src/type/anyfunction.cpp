@@ -2,6 +2,10 @@
 **  Copyright (C) 2012 Aldebaran Robotics
 **  See COPYING for the license
 */
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <utility>
 #include <boost/noncopyable.hpp>
 #include <boost/container/small_vector.hpp>
 #include <qi/future.hpp>
@@ -14,6 +18,188 @@ qiLogCategory("qitype.functiontype");
 
 namespace qi
 {
+  namespace detail
+  {
+    /// Conversion of an argument to the type expected by a function.
+    using ArgumentConverter = UniqueAnyReference (*)(const AnyReference& arg, TypeInterface* targetType);
+
+    /// Conversions of the arguments of the calls with the given argument types.
+    struct ArgumentConversionPlan
+    {
+      std::vector<TypeInterface*> sourceTypes;
+      /// Index in the function arguments of the first converted argument.
+      std::size_t offset;
+      /// Null for the arguments passed as they are.
+      std::vector<ArgumentConverter> converters;
+    };
+
+    /** Conversion plans of a function type.
+     *
+     * The first plans are kept for the lifetime of the type, and looked up
+     * without locking. Once they are all taken, the conversions of the other
+     * calls are decided at each call.
+     */
+    class ArgumentConversionPlans : private boost::noncopyable
+    {
+    public:
+      static const std::size_t capacity = 8;
+
+      ArgumentConversionPlans()
+      {
+        for (auto& plan : _plans)
+          plan.store(nullptr, std::memory_order_relaxed);
+      }
+
+      ~ArgumentConversionPlans()
+      {
+        for (auto& plan : _plans)
+          delete plan.load(std::memory_order_relaxed);
+      }
+
+      /// @return the plan for these arguments, or null if the arguments have
+      /// no type or there is no room left for a new plan.
+      const ArgumentConversionPlan* plan(const AnyReference* args, std::size_t count, std::size_t offset,
+                                         const std::vector<TypeInterface*>& targetTypes);
+
+    private:
+      std::atomic<const ArgumentConversionPlan*> _plans[capacity];
+    };
+
+    namespace
+    {
+      template<typename Interface>
+      UniqueAnyReference convertTo(const AnyReference& arg, TypeInterface* targetType)
+      {
+        return arg.convert(static_cast<Interface*>(targetType));
+      }
+
+      UniqueAnyReference convertToAny(const AnyReference& arg, TypeInterface* targetType)
+      {
+        return arg.convert(targetType);
+      }
+
+      // Pairs of kinds that AnyReferenceBase::convert(TypeInterface*) converts
+      // with the overload for the target kind.
+      bool convertsToTargetKind(TypeKind source, TypeKind target)
+      {
+        static const std::pair<TypeKind, TypeKind> compatible[] = {
+          { TypeKind_List, TypeKind_Tuple },    { TypeKind_Tuple, TypeKind_List },
+          { TypeKind_Tuple, TypeKind_Map },     { TypeKind_VarArgs, TypeKind_List },
+          { TypeKind_List, TypeKind_VarArgs },  { TypeKind_VarArgs, TypeKind_Tuple },
+          { TypeKind_Tuple, TypeKind_VarArgs }, { TypeKind_List, TypeKind_Map },
+          { TypeKind_Map, TypeKind_List },      { TypeKind_Map, TypeKind_Tuple },
+          { TypeKind_Float, TypeKind_Int },     { TypeKind_Int, TypeKind_Float },
+          { TypeKind_String, TypeKind_Raw },    { TypeKind_Raw, TypeKind_String },
+        };
+        return source == target ||
+               std::find(std::begin(compatible), std::end(compatible),
+                         std::make_pair(source, target)) != std::end(compatible);
+      }
+
+      // Same decision as AnyFunction::call and AnyReferenceBase::convert, made
+      // once for a pair of types.
+      ArgumentConverter argumentConverter(TypeInterface* sourceType, TypeInterface* targetType)
+      {
+        if (sourceType == targetType || sourceType->info() == targetType->info())
+          return nullptr;
+        const TypeKind targetKind = targetType->kind();
+        if (!convertsToTargetKind(sourceType->kind(), targetKind))
+          return &convertToAny;
+        switch (targetKind)
+        {
+        case TypeKind_Float:
+          return &convertTo<FloatTypeInterface>;
+        case TypeKind_Int:
+          return &convertTo<IntTypeInterface>;
+        case TypeKind_String:
+          return &convertTo<StringTypeInterface>;
+        case TypeKind_VarArgs:
+        case TypeKind_List:
+          return &convertTo<ListTypeInterface>;
+        case TypeKind_Map:
+          return &convertTo<MapTypeInterface>;
+        case TypeKind_Pointer:
+          return &convertTo<PointerTypeInterface>;
+        case TypeKind_Tuple:
+          return &convertTo<StructTypeInterface>;
+        case TypeKind_Dynamic:
+          return &convertTo<DynamicTypeInterface>;
+        case TypeKind_Raw:
+          return &convertTo<RawTypeInterface>;
+        case TypeKind_Optional:
+          return &convertTo<OptionalTypeInterface>;
+        default:
+          return &convertToAny;
+        }
+      }
+
+      bool matches(const ArgumentConversionPlan& plan, const AnyReference* args, std::size_t count,
+                   std::size_t offset)
+      {
+        if (plan.offset != offset || plan.sourceTypes.size() != count)
+          return false;
+        for (std::size_t i = 0; i < count; ++i)
+          if (plan.sourceTypes[i] != args[i].type())
+            return false;
+        return true;
+      }
+    }
+
+    const ArgumentConversionPlan* ArgumentConversionPlans::plan(const AnyReference* args,
+                                                                std::size_t count,
+                                                                std::size_t offset,
+                                                                const std::vector<TypeInterface*>& targetTypes)
+    {
+      std::size_t free = 0;
+      for (; free < capacity; ++free)
+      {
+        const ArgumentConversionPlan* plan = _plans[free].load(std::memory_order_acquire);
+        if (!plan)
+          break;
+        if (matches(*plan, args, count, offset))
+          return plan;
+      }
+      if (free == capacity)
+        return nullptr;
+
+      std::unique_ptr<ArgumentConversionPlan> newPlan(new ArgumentConversionPlan);
+      newPlan->offset = offset;
+      newPlan->sourceTypes.reserve(count);
+      newPlan->converters.reserve(count);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        TypeInterface* sourceType = args[i].type();
+        if (!sourceType)
+          return nullptr;
+        newPlan->sourceTypes.push_back(sourceType);
+        newPlan->converters.push_back(argumentConverter(sourceType, targetTypes[i + offset]));
+      }
+
+      // Publish the plan in the first free slot. Another thread may publish
+      // the same plan concurrently: the duplicate is harmless.
+      for (; free < capacity; ++free)
+      {
+        const ArgumentConversionPlan* expected = nullptr;
+        if (_plans[free].compare_exchange_strong(expected, newPlan.get(), std::memory_order_acq_rel))
+          return newPlan.release();
+        if (matches(*expected, args, count, offset))
+          return expected;
+      }
+      return nullptr;
+    }
+  }
+
+  FunctionTypeInterface::FunctionTypeInterface()
+    : _conversionPlans(new detail::ArgumentConversionPlans)
+  {
+  }
+
+  FunctionTypeInterface::~FunctionTypeInterface() = default;
+
+  detail::ArgumentConversionPlans& FunctionTypeInterface::conversionPlans()
+  {
+    return *_conversionPlans;
+  }
 
   AnyReference AnyFunction::call(AnyReference arg1, const AnyReferenceVector& remaining)
   {
@@ -96,6 +282,11 @@ namespace qi
     if (transform.prependValue)
       callArgs.push_back(transform.boundValue);
 
+    // The conversions only depend on the types of the arguments: decide them
+    // once for the types of this call.
+    const detail::ArgumentConversionPlan* plan = type->conversionPlans().plan(
+        args, qi::numericConvert<std::size_t>(sz), qi::numericConvert<std::size_t>(offset), target);
+
     for (auto i = 0; i < sz; ++i)
     {
       const auto ti = qi::numericConvert<std::size_t>(i + offset);
@@ -107,12 +298,15 @@ namespace qi
                                   target[ti]->signature(),
                                   this->parametersSignature(this->transform.dropFirst));
 
+      const detail::ArgumentConverter converter = plan
+        ? plan->converters[qi::numericConvert<std::size_t>(i)]
+        : detail::argumentConverter(argType, target[ti]);
       void* callArg = nullptr;
-      if (argType == target[ti] || argType->info() == target[ti]->info())
+      if (!converter)
         callArg = arg.rawValue();
       else
       {
-        auto v = arg.convert(target[ti]);
+        auto v = converter(arg, target[ti]);
         if (!v->type())
         {
           if (arg.isValid())
@@ -250,6 +444,7 @@ namespace qi
   GenericFunctionParameters GenericFunctionParameters::copy(bool notFirst) const
   {
     GenericFunctionParameters result(*this);
+    result._storage.reset();
     for (unsigned i=notFirst?1:0; i<size(); ++i)
       result[i] = result[i].clone();
     return result;
@@ -261,6 +456,16 @@ namespace qi
       (*this)[i].destroy();
   }
 
+  void GenericFunctionParameters::setStorage(std::shared_ptr<void> storage)
+  {
+    _storage = std::move(storage);
+  }
+
+  const std::shared_ptr<void>& GenericFunctionParameters::storage() const
+  {
+    return _storage;
+  }
+
   GenericFunctionParameters
   GenericFunctionParameters::convert(const Signature& sig) const
   {
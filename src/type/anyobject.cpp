@@ -134,47 +134,57 @@ inline void call(qi::Promise<AnyReference>& out,
       0,0, callerContext, qi::os::gettid(), postTimestamp));
   }
 
-  qi::int64_t time = stats?qi::os::ustime():0;
+  // The user and system times cost two system calls: they are only measured
+  // when the trace or the statistics report them.
+  const bool cpuTime = trace || (stats && context.isStatsCpuTimeEnabled());
+  qi::SteadyClockTimePoint start;
+  if (stats)
+    start = qi::SteadyClock::now();
   std::pair<int64_t, int64_t> cputime, cpuendtime;
-  if (stats||trace)
+  if (cpuTime)
      cputime = qi::os::cputime();
 
   bool success = false;
+  qi::AnyReference ret;
+  std::string error;
   try
   {
-    qi::AnyReference ret;
     //the return value is destroyed by ServerResult in the future callback.
     ret = func.call(params);
     //copy the value for tracing later. (we want the tracing to happend after setValue
     if (trace)
       retref = ret.clone();
-    //the reference, is dropped here... not cool man!
-    out.setValue(ret);
     success = true;
   }
   catch(const std::exception& e)
   {
-    success = false;
-    out.setError(e.what());
+    error = e.what();
   }
   catch(...)
   {
-    success = false;
-    out.setError("Unknown exception caught.");
+    error = "Unknown exception caught.";
   }
 
-  if (stats||trace)
+  if (cpuTime)
   {
     cpuendtime = qi::os::cputime();
     cpuendtime.first -= cputime.first;
     cpuendtime.second -= cputime.second;
   }
 
+  // The statistics are pushed before the result is set, so that they count
+  // the call once its caller gets the result.
   if (stats)
-    context.asGenericObject()->pushStats(methodId, (float)(qi::os::ustime() - time)/1e6f,
+    context.asGenericObject()->pushStats(methodId,
+                       (float)qi::durationSince<qi::MicroSeconds>(start).count() / 1e6f,
                        (float)cpuendtime.first / 1e6f,
                        (float)cpuendtime.second / 1e6f);
 
+  //the reference, is dropped here... not cool man!
+  if (success)
+    out.setValue(ret);
+  else
+    out.setError(error);
 
   if (trace)
   {
@@ -204,8 +214,7 @@ public:
     , postTimestamp(postTimestamp_)
   {
     std::swap(this->func, func_);
-    std::swap((AnyReferenceVector&) params_,
-      (AnyReferenceVector&) this->params);
+    std::swap(params_, this->params);
   }
 
   MFunctorCall(const MFunctorCall& b)
@@ -215,8 +224,7 @@ public:
   void operator = (const MFunctorCall& b)
   {
     // Implement move semantic on =
-    std::swap( (AnyReferenceVector&) params,
-      (AnyReferenceVector&) b.params);
+    std::swap(params, const_cast<MFunctorCall&>(b).params);
     std::swap(func, const_cast<MFunctorCall&>(b).func);
     context = b.context;
     methodId = b.methodId;
@@ -228,7 +236,9 @@ public:
   void operator()()
   {
     call(out, context, params, methodId, func, callerId, postTimestamp);
-    params.destroy(noCloneFirst);
+    // Owned parameters are destroyed with their storage.
+    if (!params.storage())
+      params.destroy(noCloneFirst);
   }
   qi::Promise<AnyReference> out;
   GenericFunctionParameters params;
@@ -267,11 +277,16 @@ qi::Future<AnyReference> metaCall(ExecutionContext* el,
   qiLogDebug() << "metacall sync=" << sync << " el=" << el
                << " ct=" << callType;
 
+  // The caller thread and the time of the call are only reported with the
+  // stats or the trace of the object.
+  const bool observed = context && (context.isStatsEnabled() || context.isTraceEnabled());
+  if (observed && !callerId)
+    callerId = qi::os::gettid();
+
   if (sync)
   {
     qi::Promise<AnyReference> out(FutureCallbackType_Sync);
-    call(out, context, params, methodId, func,
-         callerId ? callerId : qi::os::gettid(), postTimestamp);
+    call(out, context, params, methodId, func, callerId, postTimestamp);
     return out.future();
   }
   else
@@ -279,11 +294,15 @@ qi::Future<AnyReference> metaCall(ExecutionContext* el,
     // If call is handled by our thread pool, we can safely switch the promise
     // to synchronous mode.
     qi::Promise<AnyReference> out;
-    GenericFunctionParameters pCopy = params.copy(noCloneFirst);
+    // Parameters owning their values are handed over to the call instead of
+    // being cloned.
+    GenericFunctionParameters pCopy = params.storage() ? params : params.copy(noCloneFirst);
     qi::Future<AnyReference> result = out.future();
-    qi::os::timeval t(qi::SystemClock::now().time_since_epoch());
+    qi::os::timeval t;
+    if (observed)
+      t = qi::os::timeval(qi::SystemClock::now().time_since_epoch());
     el->post(MFunctorCall(func, pCopy, out, noCloneFirst, context,
-                           methodId, callerId ? callerId : qi::os::gettid(), t));
+                           methodId, callerId, t));
     return result;
   }
 }
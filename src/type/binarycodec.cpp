@@ -7,6 +7,7 @@
 
 #include <qi/binarycodec.hpp>
 #include <qi/anyvalue.hpp>
+#include <qi/lazyanyvalue.hpp>
 
 #include "binarycodec_p.hpp"
 #include "src/messaging/streamcontext.hpp"
@@ -28,6 +29,7 @@ namespace qi {
   namespace detail
   {
     void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, StreamContext* ctx);
+    void serializeValue(AnyReference val, BinaryEncoder& out, const SerializeObjectCallback& context, StreamContext* ctx);
     AnyReference deserialize(AnyReference what, BinaryDecoder& in, DeserializeObjectCallback context, StreamContext* ctx);
     AnyReference deserialize(qi::TypeInterface *type, BinaryDecoder& in, DeserializeObjectCallback context, StreamContext* ctx);
   }
@@ -363,6 +365,13 @@ namespace qi {
     ++_p->_innerSerialization;
   }
 
+  void BinaryEncoder::beginTuple(StructTypeInterface* type)
+  {
+    if (!_p->_innerSerialization)
+      _p->_signature += qi::makeTupleSignature(type->memberTypes()).toString();
+    ++_p->_innerSerialization;
+  }
+
   void BinaryEncoder::endTuple()
   {
     --_p->_innerSerialization;
@@ -473,10 +482,13 @@ namespace qi {
 
       void visitList(AnyIterator it, AnyIterator end)
       {
-        out.beginList(numericConvert<std::uint32_t>(value.size()),
-                      static_cast<ListTypeInterface*>(value.type())->elementType()->signature());
-        for (; it != end; ++it)
-          serialize(*it, out, serializeObjectCb, streamContext);
+        ListTypeInterface* type = static_cast<ListTypeInterface*>(value.type());
+        out.beginList(numericConvert<std::uint32_t>(value.size()), type->elementType()->signature());
+        if (!type->forEach(value.rawValue(), &serializeElement, this))
+        {
+          for (; it != end; ++it)
+            serialize(*it, out, serializeObjectCb, streamContext);
+        }
         out.endList();
       }
 
@@ -490,15 +502,31 @@ namespace qi {
         MapTypeInterface* type = static_cast<MapTypeInterface*>(value.type());
         out.beginMap(numericConvert<std::uint32_t>(value.size()), type->keyType()->signature(),
                      type->elementType()->signature());
-        for (; it != end; ++it)
+        if (!type->forEach(value.rawValue(), &serializeKeyValue, this))
         {
-          AnyReference v = *it;
-          serialize(v[0], out, serializeObjectCb, streamContext);
-          serialize(v[1], out, serializeObjectCb, streamContext);
+          for (; it != end; ++it)
+          {
+            AnyReference v = *it;
+            serialize(v[0], out, serializeObjectCb, streamContext);
+            serialize(v[1], out, serializeObjectCb, streamContext);
+          }
         }
         out.endMap();
       }
 
+      static void serializeElement(void* context, AnyReference element)
+      {
+        SerializeTypeVisitor& self = *static_cast<SerializeTypeVisitor*>(context);
+        serialize(element, self.out, self.serializeObjectCb, self.streamContext);
+      }
+
+      static void serializeKeyValue(void* context, AnyReference key, AnyReference value)
+      {
+        SerializeTypeVisitor& self = *static_cast<SerializeTypeVisitor*>(context);
+        serialize(key, self.out, self.serializeObjectCb, self.streamContext);
+        serialize(value, self.out, self.serializeObjectCb, self.streamContext);
+      }
+
       void visitObject(GenericObject value)
       {
         // No refcount, user called us with some kind of Object, not AnyObject
@@ -556,8 +584,7 @@ namespace qi {
       void visitDynamic(AnyReference pointee)
       {
         //Remaining types
-        out.writeValue(pointee, boost::bind(&typeDispatch<SerializeTypeVisitor>,
-                                            SerializeTypeVisitor(out, serializeObjectCb, pointee, streamContext), pointee));
+        out.writeValue(pointee, [&] { serializeValue(pointee, out, serializeObjectCb, streamContext); });
       }
 
       void visitRaw(AnyReference raw)
@@ -589,6 +616,14 @@ namespace qi {
       StreamContext* streamContext;
     };
 
+    // The types storing their values in the storage itself, such as the
+    // pointers, decode into a copy: their values cannot be decoded in place.
+    bool isStoredByPointer(TypeInterface* type)
+    {
+      void* storage = nullptr;
+      return type->ptrFromStorage(&storage) != &storage;
+    }
+
     class DeserializeTypeVisitor
     {
       /*
@@ -687,13 +722,24 @@ namespace qi {
 
       void visitList(AnyIterator, AnyIterator)
       {
-        TypeInterface* elementType = static_cast<ListTypeInterface*>(result.type())->elementType();
+        ListTypeInterface* listType = static_cast<ListTypeInterface*>(result.type());
+        TypeInterface* elementType = listType->elementType();
         std::uint32_t sz = 0;
         in.read(sz);
         if (in.status() != BinaryDecoder::Status::Ok)
           return;
+        // Decode the elements directly in the list when it supports it, rather
+        // than in a temporary value that is copied into the list.
+        const bool inPlace = isStoredByPointer(elementType);
         for (unsigned i = 0; i < sz; ++i)
         {
+          void* storage = result.rawValue();
+          void* element = inPlace ? listType->emplaceBack(&storage) : nullptr;
+          if (element)
+          {
+            deserialize(AnyReference(elementType, element), in, context, streamContext);
+            continue;
+          }
           AnyReference v = deserialize(elementType, in, context, streamContext);
           result.append(v);
           v.destroy();
@@ -713,12 +759,27 @@ namespace qi {
         in.read(sz);
         if (in.status() != BinaryDecoder::Status::Ok)
           return;
+        // The values of new keys are decoded directly in the map. A value
+        // replacing the one of a duplicate key is decoded apart, as it must
+        // not be merged with the previous one.
+        MapTypeInterface* mapType = static_cast<MapTypeInterface*>(result.type());
+        const bool inPlace = isStoredByPointer(elementType);
         for (unsigned i = 0; i < sz; ++i)
         {
-          AnyReference k = deserialize(keyType, in, context, streamContext);
+          detail::UniqueAnyReference k{ deserialize(keyType, in, context, streamContext) };
+          if (inPlace)
+          {
+            void* storage = result.rawValue();
+            const std::size_t previousSize = mapType->size(storage);
+            AnyReference element = mapType->element(&storage, k->rawValue(), true);
+            if (element.isValid() && mapType->size(storage) != previousSize)
+            {
+              deserialize(element, in, context, streamContext);
+              continue;
+            }
+          }
           AnyReference v = deserialize(elementType, in, context, streamContext);
-          result.insert(k, v);
-          k.destroy();
+          result.insert(*k, v);
           v.destroy();
         }
       }
@@ -810,6 +871,15 @@ namespace qi {
         DeserializeTypeVisitor dtv(*this);
         dtv.result = AnyReference(type);
         typeDispatch<DeserializeTypeVisitor>(dtv, dtv.result);
+
+        // An AnyValue takes the decoded value over instead of copying it.
+        static TypeInterface* tvalue = nullptr;
+        QI_ONCE(tvalue = qi::typeOf<AnyValue>());
+        if (result.type() == tvalue || result.type()->info() == tvalue->info())
+        {
+          result.as<AnyValue>().reset(dtv.result, false, true);
+          return;
+        }
         result.setDynamic(dtv.result);
         dtv.result.destroy();
       }
@@ -850,10 +920,257 @@ namespace qi {
       StreamContext* streamContext;
     }; //class
 
-    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, StreamContext* sctx)
+    /// Writes the fields of the structs with StructTypeInterface::encodeBinary.
+    class StructFieldWriter : public BinaryFieldWriter
     {
+    public:
+      StructFieldWriter(BinaryEncoder& out, const SerializeObjectCallback& context, StreamContext* sctx)
+        : _out(out)
+        , _context(context)
+        , _streamContext(sctx)
+      {}
+
+      void write(const void* data, std::size_t size) override
+      {
+        _out.write(static_cast<const char*>(data), size);
+      }
+
+      void write(AnyReference value) override
+      {
+        serialize(value, _out, _context, _streamContext);
+      }
+
+    private:
+      BinaryEncoder& _out;
+      const SerializeObjectCallback& _context;
+      StreamContext* _streamContext;
+    };
+
+    /// Reads the fields of the structs with StructTypeInterface::decodeBinary.
+    class StructFieldReader : public BinaryFieldReader
+    {
+    public:
+      StructFieldReader(BinaryDecoder& in, const DeserializeObjectCallback& context, StreamContext* sctx)
+        : _in(in)
+        , _context(context)
+        , _streamContext(sctx)
+      {}
+
+      const void* read(std::size_t size) override
+      {
+        const void* data = _in.readRaw(size);
+        if (!data)
+        {
+          _in.setStatus(BinaryDecoder::Status::ReadPastEnd);
+          std::stringstream ss;
+          ss << "ISerialization error " << BinaryDecoder::statusToStr(_in.status());
+          throw std::runtime_error(ss.str());
+        }
+        return data;
+      }
+
+      void read(AnyReference value) override
+      {
+        deserialize(value, _in, _context, _streamContext);
+      }
+
+    private:
+      BinaryDecoder& _in;
+      const DeserializeObjectCallback& _context;
+      StreamContext* _streamContext;
+    };
+
+    bool isLazyAnyValue(TypeInterface* type)
+    {
+      static TypeInterface* tlazy = nullptr;
+      QI_ONCE(tlazy = qi::typeOf<LazyAnyValue>());
+      return type == tlazy || type->info() == tlazy->info();
+    }
+
+    bool skipSize(BufferReader& in, std::uint32_t& size)
+    {
+      const void* data = in.read(sizeof(size));
+      if (!data)
+        return false;
+      std::memcpy(&size, data, sizeof(size));
+      return true;
+    }
+
+    /* Move `in` past a value of signature `sig` without decoding it.
+     *
+     * Return false if the value cannot be skipped: if it is truncated, or if
+     * its encoding is not the bytes read, as the objects and the buffers
+     * stored in sub-buffers.
+     */
+    bool skipEncoded(BufferReader& in, const Signature& sig)
+    {
+      std::uint32_t size = 0;
+      switch (sig.type())
+      {
+      case Signature::Type_None:
+      case Signature::Type_Void:
+        return true;
+      case Signature::Type_Bool:
+      case Signature::Type_Int8:
+      case Signature::Type_UInt8:
+        return in.read(1) != nullptr;
+      case Signature::Type_Int16:
+      case Signature::Type_UInt16:
+        return in.read(2) != nullptr;
+      case Signature::Type_Int32:
+      case Signature::Type_UInt32:
+      case Signature::Type_Float:
+        return in.read(4) != nullptr;
+      case Signature::Type_Int64:
+      case Signature::Type_UInt64:
+      case Signature::Type_Double:
+        return in.read(8) != nullptr;
+      case Signature::Type_Raw:
+        if (in.hasSubBuffer())
+          return false;
+        // The buffers that are not sub-buffers are written as strings.
+        QI_FALLTHROUGH;
+      case Signature::Type_String:
+        return skipSize(in, size) && (size == 0 || in.read(size) != nullptr);
+      case Signature::Type_List:
+      case Signature::Type_VarArgs:
+      case Signature::Type_Map:
+      {
+        if (!skipSize(in, size))
+          return false;
+        const SignatureVector& children = sig.children();
+        for (std::uint32_t i = 0; i < size; ++i)
+        {
+          const std::size_t position = in.position();
+          for (const Signature& child : children)
+          {
+            if (!skipEncoded(in, child))
+              return false;
+          }
+          // The elements of an empty encoding are all empty.
+          if (in.position() == position)
+            return true;
+        }
+        return true;
+      }
+      case Signature::Type_Tuple:
+        for (const Signature& child : sig.children())
+        {
+          if (!skipEncoded(in, child))
+            return false;
+        }
+        return true;
+      case Signature::Type_Dynamic:
+      {
+        if (!skipSize(in, size))
+          return false;
+        if (size == 0)
+          return true;
+        const char* data = static_cast<const char*>(in.read(size));
+        if (!data)
+          return false;
+        const Signature content(std::string(data, size));
+        return content.isValid() && skipEncoded(in, content);
+      }
+      case Signature::Type_Optional:
+      {
+        const unsigned char* hasValue = static_cast<const unsigned char*>(in.read(1));
+        return hasValue && (!*hasValue || skipEncoded(in, sig.children()[0]));
+      }
+      default:
+        return false;
+      }
+    }
+
+    // Keep the encoding of the dynamic value, when it can be skipped, instead
+    // of decoding it.
+    void deserializeLazyValue(LazyAnyValue& result, BinaryDecoder& in, const DeserializeObjectCallback& context, StreamContext* sctx)
+    {
+      std::string sig;
+      in.read(sig);
+      if (in.status() != BinaryDecoder::Status::Ok)
+        return;
+      if (sig.empty())
+      {
+        result = LazyAnyValue();
+        return;
+      }
+      const Signature signature(sig);
+      BufferReader probe(in.bufferReader());
+      if (signature.isValid() && skipEncoded(probe, signature))
+      {
+        const std::size_t size = probe.position() - in.bufferReader().position();
+        Buffer encoded;
+        if (size != 0)
+          encoded.write(in.readRaw(size), size);
+        result = LazyAnyValue(signature, std::move(encoded));
+        return;
+      }
+
+      TypeInterface* type = TypeInterface::fromSignature(signature);
+      if (!type)
+      {
+        std::stringstream ss;
+        ss << "Cannot find a type to deserialize signature " << sig << " within a dynamic value.";
+        throw std::runtime_error(ss.str());
+      }
+      AnyValue value(deserialize(type, in, context, sctx), false, true);
+      result = LazyAnyValue(value);
+    }
+
+    // Structs are written by their type, to avoid building the references to
+    // their fields and dispatching each of them. The lazy values that were
+    // not decoded are written as they were read.
+    void serializeValue(AnyReference val, BinaryEncoder& out, const SerializeObjectCallback& context, StreamContext* sctx)
+    {
+      if (val.type() && val.kind() == TypeKind_Tuple)
+      {
+        StructTypeInterface* type = static_cast<StructTypeInterface*>(val.type());
+        StructFieldWriter writer(out, context, sctx);
+        out.beginTuple(type);
+        type->encodeBinary(val.rawValue(), writer);
+        out.endTuple();
+        return;
+      }
+      if (val.type() && val.kind() == TypeKind_Dynamic && isLazyAnyValue(val.type()))
+      {
+        const LazyAnyValue& lazy = val.as<LazyAnyValue>();
+        if (const Buffer* encoded = lazy.encoded())
+        {
+          out.beginDynamic(lazy.signature());
+          out.write(static_cast<const char*>(encoded->data()), encoded->size());
+          out.endDynamic();
+          return;
+        }
+      }
       detail::SerializeTypeVisitor stv(out, context, val, sctx);
       qi::typeDispatch(stv, val);
+    }
+
+    // Structs whose type supports it are read by their type, in place.
+    AnyReference deserializeValue(AnyReference what, BinaryDecoder& in, const DeserializeObjectCallback& context, StreamContext* sctx)
+    {
+      if (what.type() && what.kind() == TypeKind_Tuple)
+      {
+        void* storage = what.rawValue();
+        StructFieldReader reader(in, context, sctx);
+        if (static_cast<StructTypeInterface*>(what.type())->decodeBinary(&storage, reader))
+          return AnyReference(what.type(), storage);
+      }
+      if (what.type() && what.kind() == TypeKind_Dynamic && isLazyAnyValue(what.type()))
+      {
+        deserializeLazyValue(what.as<LazyAnyValue>(), in, context, sctx);
+        return what;
+      }
+      detail::DeserializeTypeVisitor dtv(in, context, sctx);
+      dtv.result = what;
+      qi::typeDispatch(dtv, dtv.result);
+      return dtv.result;
+    }
+
+    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, StreamContext* sctx)
+    {
+      serializeValue(val, out, context, sctx);
       if (out.status() != BinaryEncoder::Status::Ok) {
         std::stringstream ss;
         ss << "OSerialization error " << BinaryEncoder::statusToStr(out.status());
@@ -863,15 +1180,13 @@ namespace qi {
 
     AnyReference deserialize(AnyReference what, BinaryDecoder& in, DeserializeObjectCallback context, StreamContext* sctx)
     {
-      detail::DeserializeTypeVisitor dtv(in, context, sctx);
-      dtv.result = what;
-      qi::typeDispatch(dtv, dtv.result);
+      AnyReference result = deserializeValue(what, in, context, sctx);
       if (in.status() != BinaryDecoder::Status::Ok) {
         std::stringstream ss;
         ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
         throw std::runtime_error(ss.str());
       }
-      return dtv.result;
+      return result;
     }
 
     AnyReference deserialize(qi::TypeInterface *type, BinaryDecoder& in, DeserializeObjectCallback context, StreamContext* sctx)
@@ -889,8 +1204,7 @@ namespace qi {
 
   void encodeBinary(qi::Buffer *buf, const qi::AutoAnyReference &gvp, SerializeObjectCallback onObject, StreamContext* sctx) {
     BinaryEncoder be(*buf);
-    detail::SerializeTypeVisitor stv(be, onObject, gvp, sctx);
-    qi::typeDispatch(stv, gvp);
+    detail::serializeValue(gvp, be, onObject, sctx);
     if (be.status() != BinaryEncoder::Status::Ok) {
       std::stringstream ss;
       ss << "OSerialization error " << BinaryEncoder::statusToStr(be.status());
@@ -902,16 +1216,14 @@ namespace qi {
   AnyReference decodeBinary(qi::BufferReader *buf, qi::AnyReference gvp,
     DeserializeObjectCallback onObject, StreamContext* sctx) {
     BinaryDecoder in(buf);
-    detail::DeserializeTypeVisitor dtv(in, onObject, sctx);
-    dtv.result = gvp;
-    qi::typeDispatch(dtv, dtv.result);
+    AnyReference result = detail::deserializeValue(gvp, in, onObject, sctx);
     if (in.status() != BinaryDecoder::Status::Ok) {
       std::stringstream ss;
       ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
       qiLogError() << ss.str();
       throw std::runtime_error(ss.str());
     }
-    return dtv.result;
+    return result;
   }
 
 }
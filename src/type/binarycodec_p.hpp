@@ -147,6 +147,8 @@ namespace qi {
                   const qi::Signature& valueSignature);
     void endMap();
     void beginTuple(const qi::Signature &signature);
+    /// Begin a struct of `type`, computing its signature only if it is recorded.
+    void beginTuple(StructTypeInterface* type);
     void endTuple();
     void beginDynamic(const qi::Signature &elementSignature);
     void endDynamic();
@@ -275,6 +275,7 @@ namespace qi
     else
       p.push_back(AnyReference::from(this));
     p.insert(p.end(), params.begin(), params.end());
+    p.setStorage(params.storage());
     return ::qi::metaCall(ec, _p->threadingModel,
       i->second.second, callType, context, method, i->second.first, p);
   }
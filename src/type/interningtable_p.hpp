@@ -0,0 +1,130 @@
+#pragma once
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_INTERNINGTABLE_P_HPP_
+#define _SRC_INTERNINGTABLE_P_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace qi
+{
+  namespace detail
+  {
+    /** Insert-only hash table of the values created once per key, such as
+     * the types built by makeListType or makeTupleType.
+     *
+     * Looking up an existing entry does not lock: the buckets are lists of
+     * immutable nodes, whose heads are published atomically. Insertions are
+     * serialized by a mutex. Entries are never removed, and the number of
+     * buckets is fixed at construction. Tables of keys coming from outside
+     * the process are bounded with `maxSize`.
+     *
+     * Lookups may use another type than Key, as long as Hash and Equal accept
+     * it and Key can be constructed from it, to avoid building a Key for
+     * each lookup.
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>,
+              typename Equal = std::equal_to<Key>>
+    class InterningTable : private boost::noncopyable
+    {
+    public:
+      explicit InterningTable(std::size_t bucketCount = 1024,
+                              std::size_t maxSize = std::numeric_limits<std::size_t>::max())
+        : _bucketCount(bucketCount)
+        , _maxSize(maxSize)
+        , _buckets(new std::atomic<const Node*>[bucketCount])
+      {
+        for (std::size_t i = 0; i < _bucketCount; ++i)
+          _buckets[i].store(nullptr, std::memory_order_relaxed);
+      }
+
+      ~InterningTable()
+      {
+        for (std::size_t i = 0; i < _bucketCount; ++i)
+        {
+          const Node* node = _buckets[i].load(std::memory_order_relaxed);
+          while (node)
+          {
+            const Node* next = node->next;
+            delete node;
+            node = next;
+          }
+        }
+      }
+
+      /// @return the value of `key`, valid as long as the table, or null if there is none.
+      template <typename LookupKey>
+      const Value* find(const LookupKey& key) const
+      {
+        const Node* node = findNode(key, _hash(key));
+        return node ? &node->value : nullptr;
+      }
+
+      /** @return the value of `key`, created by calling `make()` if there is
+       * none. `make` is called at most once per key, with the insertion
+       * lock held. Once the table holds `maxSize` entries, `make` is not
+       * called for new keys and a default constructed Value is returned.
+       */
+      template <typename LookupKey, typename Make>
+      Value findOrInsert(const LookupKey& key, Make&& make)
+      {
+        const std::size_t hash = _hash(key);
+        if (const Node* node = findNode(key, hash))
+          return node->value;
+
+        boost::mutex::scoped_lock lock(_mutex);
+        if (const Node* node = findNode(key, hash))
+          return node->value;
+        if (_size == _maxSize)
+          return Value();
+        ++_size;
+        std::atomic<const Node*>& bucket = _buckets[hash % _bucketCount];
+        const Node* node = new Node{ Key(key), hash, std::forward<Make>(make)(),
+                                     bucket.load(std::memory_order_relaxed) };
+        bucket.store(node, std::memory_order_release);
+        return node->value;
+      }
+
+    private:
+      struct Node
+      {
+        const Key key;
+        const std::size_t hash;
+        const Value value;
+        const Node* const next;
+      };
+
+      template <typename LookupKey>
+      const Node* findNode(const LookupKey& key, std::size_t hash) const
+      {
+        for (const Node* node = _buckets[hash % _bucketCount].load(std::memory_order_acquire);
+             node; node = node->next)
+        {
+          if (node->hash == hash && _equal(node->key, key))
+            return node;
+        }
+        return nullptr;
+      }
+
+      const std::size_t _bucketCount;
+      const std::size_t _maxSize;
+      std::size_t _size = 0;
+      std::unique_ptr<std::atomic<const Node*>[]> _buckets;
+      boost::mutex _mutex;
+      Hash _hash;
+      Equal _equal;
+    };
+  }
+}
+
+#endif  // _SRC_INTERNINGTABLE_P_HPP_
@@ -7,40 +7,131 @@
 #ifndef _JSONPARSER_P_HPP_
 # define _JSONPARSER_P_HPP_
 
+# include <cstdio>
+# include <streambuf>
 # include <string>
+# include <unordered_map>
+# include <vector>
 # include <qi/anyvalue.hpp>
 
 namespace qi {
 
+  /// Members of a structure type, computed once per type.
+  struct JsonStructInfo
+  {
+    std::vector<TypeInterface*> types;
+    std::vector<std::string> names;
+    /// Index of each member by name.
+    std::unordered_map<std::string, unsigned int> indexes;
+  };
+
+  /// @return the members of `type`, for the lifetime of the process.
+  const JsonStructInfo& jsonStructInfo(StructTypeInterface* type);
+
+  /// Per-encoding or per-decoding cache of jsonStructInfo, taken without lock.
+  class JsonStructInfoCache
+  {
+  public:
+    const JsonStructInfo& get(StructTypeInterface* type)
+    {
+      auto it = _infos.find(type);
+      if (it == _infos.end())
+        it = _infos.emplace(type, &jsonStructInfo(type)).first;
+      return *it->second;
+    }
+
+  private:
+    std::unordered_map<StructTypeInterface*, const JsonStructInfo*> _infos;
+  };
+
+  /// Input of the decoder: a range of memory.
+  class JsonMemorySource
+  {
+  public:
+    JsonMemorySource(const char* begin, const char* end)
+      : _it(begin)
+      , _end(end)
+    {}
+
+    /// @return the current char, or EOF at the end of the input.
+    int peek() const { return _it == _end ? EOF : static_cast<unsigned char>(*_it); }
+    void next() { ++_it; }
+    const char* position() const { return _it; }
+
+  private:
+    const char*       _it;
+    const char* const _end;
+  };
+
+  /// Input of the decoder: a stream buffer, not read past the decoded value.
+  class JsonStreamSource
+  {
+  public:
+    explicit JsonStreamSource(std::streambuf* buffer)
+      : _buffer(buffer)
+    {}
+
+    int peek() const { return _buffer->sgetc(); }
+    void next() { _buffer->sbumpc(); }
+
+  private:
+    std::streambuf* _buffer;
+  };
+
+  /** Incremental JSON parser. It reads its source char by char, without
+   * backtracking, and decodes either into a GV or straight into a value of a
+   * known type.
+   */
+  template <typename Source>
   class JsonDecoderPrivate
   {
   public:
-    JsonDecoderPrivate(const std::string &in);
-    JsonDecoderPrivate(const std::string::const_iterator &begin,
-                      const std::string::const_iterator &end);
-    std::string::const_iterator decode(AnyValue &out);
+    explicit JsonDecoderPrivate(Source source);
+
+    void decode(AnyValue &out);
+    void decode(AnyReference target);
+    const Source& source() const { return _source; }
 
   private:
+    enum Number
+    {
+      Number_Int,
+      Number_UInt,
+      Number_Float
+    };
+
+    int peek() const { return _source.peek(); }
+    void next() { _source.next(); }
+    // Append the current char to the current number token.
+    void take();
     void skipWhiteSpaces();
-    bool getDigits(std::string &result);
-    bool getInteger(std::string &result);
-    bool getInteger(qi::int64_t &result);
-    bool getExponent(std::string &result);
-    bool getFloat(double &result);
-    bool decodeArray(AnyValue &value);
-    bool decodeFloat(AnyValue &value);
-    bool decodeInteger(AnyValue &value);
-    bool getCleanString(std::string &result);
-    bool decodeString(AnyValue &value);
-    bool decodeObject(AnyValue &value);
-    bool match(std::string const& expected);
-    bool decodeSpecial(AnyValue &value);
-    bool decodeValue(AnyValue &value);
+    void expect(char c);
+    void expectLiteral(const char* literal);
+    Number getNumber();
+    void getCleanString(std::string &result);
+    void getEscapedChar(std::string &result);
+    unsigned int getHexQuad();
+    void decodeArray(AnyValue &value);
+    void decodeObject(AnyValue &value);
+    void decodeValue(AnyValue &value);
+    void decodeInto(AnyReference target);
+    void decodeNumberInto(AnyReference target);
+    void decodeListInto(AnyReference target);
+    void decodeMapInto(AnyReference target);
+    void decodeTupleInto(AnyReference target);
+    void decodeOptionalInto(AnyReference target);
+    void skipValue();
+    void throwMismatch(TypeInterface* type);
 
   private:
-    std::string::const_iterator const _begin;
-    std::string::const_iterator const _end;
-    std::string::const_iterator       _it;
+    Source        _source;
+    // Reused across values, to save allocations.
+    std::string   _token;
+    std::string   _string;
+    qi::int64_t   _int;
+    qi::uint64_t  _uint;
+    double        _float;
+    JsonStructInfoCache _structs;
   };
 
 }
@@ -5,396 +5,774 @@
 
 #include <qi/jsoncodec.hpp>
 #include <qi/anyvalue.hpp>
-#include <iterator>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <boost/lexical_cast.hpp>
-#ifdef WITH_BOOST_LOCALE
-#  include <boost/locale.hpp>
-#endif
+#include <boost/thread/mutex.hpp>
+#include <qi/atomic.hpp>
 #include "jsoncodec_p.hpp"
 
 namespace qi {
 
-  JsonDecoderPrivate::JsonDecoderPrivate(const std::string &in)
-    :_begin(in.begin()),
-      _end(in.end()),
-      _it(_begin)
-  {}
+  namespace
+  {
+    // Powers of ten exactly representable as a double.
+    const double exactPowersOfTen[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxExactPowerOfTen = 22;
+    const qi::uint64_t maxExactMantissa = qi::uint64_t(1) << 53;
+
+    bool isDigit(int c)
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    void throwParseError()
+    {
+      throw std::runtime_error("parse error");
+    }
+
+    void appendUtf8(std::string &result, unsigned int codePoint)
+    {
+      if (codePoint < 0x80)
+        result += static_cast<char>(codePoint);
+      else if (codePoint < 0x800)
+      {
+        result += static_cast<char>(0xC0 | (codePoint >> 6));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+      }
+      else if (codePoint < 0x10000)
+      {
+        result += static_cast<char>(0xE0 | (codePoint >> 12));
+        result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+      }
+      else
+      {
+        result += static_cast<char>(0xF0 | (codePoint >> 18));
+        result += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+      }
+    }
+
+    // mantissa = mantissa * 10 + digit, unless it overflows.
+    bool appendDigit(qi::uint64_t &mantissa, int digit)
+    {
+      const qi::uint64_t max = std::numeric_limits<qi::uint64_t>::max();
+      if (mantissa > max / 10 || (mantissa == max / 10 && static_cast<qi::uint64_t>(digit) > max % 10))
+        return false;
+      mantissa = mantissa * 10 + digit;
+      return true;
+    }
+
+    bool isHighSurrogate(unsigned int c) { return c >= 0xD800 && c <= 0xDBFF; }
+    bool isLowSurrogate(unsigned int c) { return c >= 0xDC00 && c <= 0xDFFF; }
+  }
 
-  JsonDecoderPrivate::JsonDecoderPrivate(const std::string::const_iterator &begin,
-                    const std::string::const_iterator &end)
-    :_begin(begin),
-      _end(end),
-      _it(_begin)
+  template <typename Source>
+  JsonDecoderPrivate<Source>::JsonDecoderPrivate(Source source)
+    : _source(source)
+    , _int(0)
+    , _uint(0)
+    , _float(0.)
   {}
 
-  std::string::const_iterator JsonDecoderPrivate::decode(AnyValue &out)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decode(AnyValue &out)
   {
-    _it = _begin;
-    if (!decodeValue(out))
-      throw std::runtime_error("parse error");
-    return _it;
+    decodeValue(out);
+    skipWhiteSpaces();
   }
 
-  void JsonDecoderPrivate::skipWhiteSpaces()
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decode(AnyReference target)
   {
-    while (_it != _end && (*_it == ' ' || *_it == '\n'))
-      ++_it;
+    decodeInto(target);
+    skipWhiteSpaces();
   }
 
-  bool JsonDecoderPrivate::getDigits(std::string &result)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::take()
   {
-    std::string::const_iterator begin = _it;
-
-    while (_it != _end && *_it >= '0' && *_it <= '9')
-      ++_it;
-    if (_it == begin)
-        return false;
-    result = std::string(begin, _it);
-    return true;
+    _token += static_cast<char>(peek());
+    next();
   }
 
-  bool JsonDecoderPrivate::getInteger(std::string &result)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::skipWhiteSpaces()
   {
-    std::string::const_iterator save = _it;
-    std::string integerStr;
-
-    if (_it == _end)
-      return false;
-    if (*_it == '-')
-    {
-      ++_it;
-      integerStr = "-";
-    }
-    std::string digitsStr;
-
-    if (!getDigits(digitsStr))
-    {
-      _it = save;
-      return false;
-    }
-    integerStr += digitsStr;
-
-    result = integerStr;
-    return true;
+    for (int c = peek(); c == ' ' || c == '\n' || c == '\t' || c == '\r'; c = peek())
+      next();
   }
 
-  bool JsonDecoderPrivate::getInteger(qi::int64_t &result)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::expect(char c)
   {
-    std::string integerStr;
-
-    if (!getInteger(integerStr))
-      return false;
-    result = ::atol(integerStr.c_str());
-    return true;
+    if (peek() != c)
+      throwParseError();
+    next();
   }
 
-  bool JsonDecoderPrivate::getExponent(std::string &result)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::expectLiteral(const char* literal)
   {
-    std::string::const_iterator save = _it;
+    for (; *literal; ++literal)
+      expect(*literal);
+  }
 
-    if (_it == _end || (*_it != 'e' && *_it != 'E'))
-      return false;
-    ++_it;
-    std::string exponentStr;
+  /* The mantissa is accumulated while the token is read. When it fits in a
+   * double and the power of ten is exact too, the result of a single
+   * multiplication or division is correctly rounded. Otherwise, the token is
+   * converted by boost::lexical_cast.
+   */
+  template <typename Source>
+  typename JsonDecoderPrivate<Source>::Number JsonDecoderPrivate<Source>::getNumber()
+  {
+    _token.clear();
+    const bool negative = peek() == '-';
+    if (negative)
+      take();
+    if (!isDigit(peek()))
+      throwParseError();
+
+    qi::uint64_t mantissa = 0;
+    bool overflow = false;
+    int exponent = 0;
+    for (int c = peek(); isDigit(c); c = peek())
+    {
+      if (!appendDigit(mantissa, c - '0'))
+        overflow = true;
+      take();
+    }
 
-    exponentStr += 'e';
-    if (*_it == '+' || *_it == '-')
+    bool isFloat = false;
+    if (peek() == '.')
     {
-      exponentStr += *_it;
-      ++_it;
+      isFloat = true;
+      take();
+      if (!isDigit(peek()))
+        throwParseError();
+      for (int c = peek(); isDigit(c); c = peek())
+      {
+        if (appendDigit(mantissa, c - '0'))
+          --exponent;
+        else
+          overflow = true;
+        take();
+      }
     }
-    else
-      exponentStr += '+';
-    std::string integerStr;
-    if (!getDigits(integerStr))
+    if (peek() == 'e' || peek() == 'E')
     {
-      _it = save;
-      return false;
+      isFloat = true;
+      take();
+      bool negativeExponent = false;
+      if (peek() == '+' || peek() == '-')
+      {
+        negativeExponent = peek() == '-';
+        take();
+      }
+      if (!isDigit(peek()))
+        throwParseError();
+      int explicitExponent = 0;
+      for (int c = peek(); isDigit(c); c = peek())
+      {
+        if (explicitExponent < 100000)
+          explicitExponent = explicitExponent * 10 + (c - '0');
+        take();
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
     }
 
-    result = exponentStr + integerStr;
-    return true;
-  }
-
-  bool JsonDecoderPrivate::getFloat(double &result)
-  {
-    std::string floatStr;
-    std::string beforePoint;
-    std::string afterPoint;
-    std::string exponent;
-    std::string::const_iterator save = _it;
-
-    if (!getInteger(beforePoint))
-      return false;
-    if (!getExponent(exponent))
+    if (!isFloat && !overflow)
     {
-      if (_it == _end || *_it != '.')
+      if (negative && mantissa <= qi::uint64_t(1) << 63)
       {
-        _it = save;
-        return false;
+        _int = static_cast<qi::int64_t>(0 - mantissa);
+        return Number_Int;
       }
-      ++_it;
-      if (!getDigits(afterPoint))
+      if (!negative && mantissa <= static_cast<qi::uint64_t>(std::numeric_limits<qi::int64_t>::max()))
       {
-        _it = save;
-        return false;
+        _int = static_cast<qi::int64_t>(mantissa);
+        return Number_Int;
+      }
+      if (!negative)
+      {
+        _uint = mantissa;
+        return Number_UInt;
       }
-      getExponent(exponent);
-      floatStr = beforePoint + "." + afterPoint + exponent;
     }
-    else
-      floatStr = beforePoint + exponent;
 
-    result = boost::lexical_cast<double>(floatStr.c_str());
-    return true;
+    if (!overflow && mantissa <= maxExactMantissa
+        && exponent >= -maxExactPowerOfTen && exponent <= maxExactPowerOfTen)
+    {
+      _float = static_cast<double>(mantissa);
+      if (exponent < 0)
+        _float /= exactPowersOfTen[-exponent];
+      else
+        _float *= exactPowersOfTen[exponent];
+      if (negative)
+        _float = -_float;
+    }
+    else
+      _float = boost::lexical_cast<double>(_token.data(), _token.size());
+    return Number_Float;
   }
 
-  bool JsonDecoderPrivate::decodeArray(AnyValue &value)
+  template <typename Source>
+  unsigned int JsonDecoderPrivate<Source>::getHexQuad()
   {
-    std::string::const_iterator save = _it;
-
-    if (_it == _end || *_it != '[')
-      return false;
-    ++_it;
-    AnyValueVector   tmpArray;
-
-    while (true)
+    unsigned int result = 0;
+    for (int i = 0; i < 4; ++i)
     {
-      AnyValue subElement;
+      const int c = peek();
+      result <<= 4;
+      if (c >= '0' && c <= '9')
+        result |= c - '0';
+      else if (c >= 'a' && c <= 'f')
+        result |= c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F')
+        result |= c - 'A' + 10;
+      else
+        throwParseError();
+      next();
+    }
+    return result;
+  }
 
-      if (!decodeValue(subElement))
-        break;
-      tmpArray.push_back(subElement);
-      if (*_it != ',')
-        break;
-      ++_it;
+  // After the backslash.
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::getEscapedChar(std::string &result)
+  {
+    const int c = peek();
+    if (c == EOF)
+      throwParseError();
+    next();
+    switch (c)
+    {
+    case '"' : result += '"' ; break;
+    case '\\': result += '\\'; break;
+    case '/' : result += '/' ; break;
+    case 'b' : result += '\b'; break;
+    case 'f' : result += '\f'; break;
+    case 'n' : result += '\n'; break;
+    case 'r' : result += '\r'; break;
+    case 't' : result += '\t'; break;
+    case 'u' :
+    {
+      const unsigned int codePoint = getHexQuad();
+      if (isHighSurrogate(codePoint) && peek() == '\\')
+      {
+        next();
+        if (peek() != 'u')
+        {
+          // Lone surrogates are dropped.
+          getEscapedChar(result);
+          break;
+        }
+        next();
+        const unsigned int low = getHexQuad();
+        if (isLowSurrogate(low))
+          appendUtf8(result, 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00));
+        else if (!isHighSurrogate(low))
+          appendUtf8(result, low);
+      }
+      else if (!isHighSurrogate(codePoint) && !isLowSurrogate(codePoint))
+        appendUtf8(result, codePoint);
+      break;
+    }
+    default:
+      throwParseError();
     }
-    if (*_it != ']')
+  }
+
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::getCleanString(std::string &result)
+  {
+    expect('"');
+    result.clear();
+    for (int c = peek(); c != '"'; c = peek())
     {
-      _it = save;
-      return false;
+      if (c == EOF)
+        throwParseError();
+      next();
+      if (c == '\\')
+        getEscapedChar(result);
+      else
+        result += static_cast<char>(c);
     }
-    ++_it;
-    value = AnyValue(tmpArray);
-    return true;
+    next();
   }
 
-  bool JsonDecoderPrivate::decodeFloat(AnyValue &value)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeArray(AnyValue &value)
   {
-    double tmpFloat;
+    expect('[');
+    value.reset(qi::typeOf<AnyValueVector>());
+    AnyValueVector& array = *value.ptr<AnyValueVector>(false);
 
-    if (!getFloat(tmpFloat))
-      return false;
-    value = AnyValue(tmpFloat);
-    return true;
+    skipWhiteSpaces();
+    while (peek() != ']')
+    {
+      array.emplace_back();
+      decodeValue(array.back());
+      skipWhiteSpaces();
+      if (peek() != ',')
+        break;
+      next();
+      skipWhiteSpaces();
+    }
+    expect(']');
   }
 
-  bool JsonDecoderPrivate::decodeInteger(AnyValue &value)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeObject(AnyValue &value)
   {
-    qi::int64_t tmpInteger;
+    using Object = std::map<std::string, AnyValue>;
+    expect('{');
+    value.reset(qi::typeOf<Object>());
+    Object& object = *value.ptr<Object>(false);
 
-    if (!getInteger(tmpInteger))
-      return false;
-    value = AnyValue(tmpInteger);
-    return true;
+    skipWhiteSpaces();
+    while (peek() != '}')
+    {
+      getCleanString(_string);
+      AnyValue& member = object[_string];
+      skipWhiteSpaces();
+      expect(':');
+      decodeValue(member);
+      skipWhiteSpaces();
+      if (peek() != ',')
+        break;
+      next();
+      skipWhiteSpaces();
+    }
+    expect('}');
   }
 
-  bool JsonDecoderPrivate::getCleanString(std::string &result)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeValue(AnyValue &value)
   {
-    std::string::const_iterator save = _it;
-
-    if (_it == _end || *_it != '"')
-      return false;
-    std::string tmpString;
+    skipWhiteSpaces();
+    switch (peek())
+    {
+    case '"':
+      getCleanString(_string);
+      value.reset(AnyReference::from(_string), true, true);
+      break;
+    case '[':
+      decodeArray(value);
+      break;
+    case '{':
+      decodeObject(value);
+      break;
+    case 't':
+      expectLiteral("true");
+      value = AnyValue(true);
+      break;
+    case 'f':
+      expectLiteral("false");
+      value = AnyValue::from(false);
+      break;
+    case 'n':
+      expectLiteral("null");
+      value = AnyValue(qi::typeOf<void>());
+      break;
+    default:
+      switch (getNumber())
+      {
+      case Number_Int:
+        value.reset(AnyReference::from(_int), true, true);
+        break;
+      case Number_UInt:
+        value.reset(AnyReference::from(_uint), true, true);
+        break;
+      case Number_Float:
+        value.reset(AnyReference::from(_float), true, true);
+        break;
+      }
+    }
+  }
 
-    ++_it;
-    for (;_it != _end && *_it != '"';)
+  // Same syntax as decodeValue, nothing is stored.
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::skipValue()
+  {
+    skipWhiteSpaces();
+    switch (peek())
     {
-      if (*_it == '\\')
+    case '"':
+      getCleanString(_string);
+      break;
+    case '[':
+      next();
+      skipWhiteSpaces();
+      while (peek() != ']')
       {
-        if (_it + 1 == _end)
-        {
-          _it = save;
-          return false;
-        }
-        switch (*(_it + 1))
-        {
-        case '"' : tmpString += '"' ; _it += 2; break;
-        case '\\': tmpString += '\\'; _it += 2; break;
-        case '/' : tmpString += '/' ; _it += 2; break;
-        case 'b' : tmpString += '\b'; _it += 2; break;
-        case 'f' : tmpString += '\f'; _it += 2; break;
-        case 'n' : tmpString += '\n'; _it += 2; break;
-        case 'r' : tmpString += '\r'; _it += 2; break;
-        case 't' : tmpString += '\t'; _it += 2; break;
-#ifdef WITH_BOOST_LOCALE
-        case 'u' :
-        {
-          if (std::distance(_it, _end) <= 6)
-          {
-            _it = save;
-            return false;
-          }
-          std::istringstream ss(std::string(_it+2, _it+6));
-          int val;
-          ss >> std::hex >> val;
-          if (!ss.eof())
-          {
-            _it = save;
-            return false;
-          }
-          tmpString += boost::locale::conv::utf_to_utf<char>(&val, &val + 1);
-          _it += 6;
+        skipValue();
+        skipWhiteSpaces();
+        if (peek() != ',')
           break;
-        }
-#endif
-        default:
-          _it = save;
-          return false;
-        }
+        next();
+        skipWhiteSpaces();
       }
-      else
+      expect(']');
+      break;
+    case '{':
+      next();
+      skipWhiteSpaces();
+      while (peek() != '}')
       {
-        tmpString += *_it;
-        ++_it;
+        getCleanString(_string);
+        skipWhiteSpaces();
+        expect(':');
+        skipValue();
+        skipWhiteSpaces();
+        if (peek() != ',')
+          break;
+        next();
+        skipWhiteSpaces();
       }
+      expect('}');
+      break;
+    case 't':
+      expectLiteral("true");
+      break;
+    case 'f':
+      expectLiteral("false");
+      break;
+    case 'n':
+      expectLiteral("null");
+      break;
+    default:
+      getNumber();
     }
-    if (_it == _end)
+  }
+
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::throwMismatch(TypeInterface* type)
+  {
+    std::string found;
+    switch (peek())
     {
-      _it = save;
-      return false;
+    case '"': found = "a string"; break;
+    case '[': found = "an array"; break;
+    case '{': found = "an object"; break;
+    case 't': found = "true"; break;
+    case 'f': found = "false"; break;
+    case 'n': found = "null"; break;
+    case EOF: throwParseError();
+    default:  found = "a number"; break;
     }
-    ++_it;
-    result = tmpString;
-    return true;
+    throw std::runtime_error("JSON: cannot decode " + found + " into " + type->infoString());
   }
 
-  bool JsonDecoderPrivate::decodeString(AnyValue &value)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeInto(AnyReference target)
   {
-    std::string tmpString;
-
-    if (!getCleanString(tmpString))
-      return false;
-    value = AnyValue(tmpString);
-    return true;
+    skipWhiteSpaces();
+    switch (target.kind())
+    {
+    case TypeKind_Int:
+    case TypeKind_Float:
+      decodeNumberInto(target);
+      break;
+    case TypeKind_String:
+      if (peek() != '"')
+        throwMismatch(target.type());
+      getCleanString(_string);
+      target.setString(_string);
+      break;
+    case TypeKind_List:
+    case TypeKind_VarArgs:
+      decodeListInto(target);
+      break;
+    case TypeKind_Map:
+      decodeMapInto(target);
+      break;
+    case TypeKind_Tuple:
+      decodeTupleInto(target);
+      break;
+    case TypeKind_Optional:
+      decodeOptionalInto(target);
+      break;
+    case TypeKind_Dynamic:
+      if (target.type()->info() == qi::typeOf<AnyValue>()->info())
+        decodeValue(*target.ptr<AnyValue>(false));
+      else
+      {
+        AnyValue value;
+        decodeValue(value);
+        target.setDynamic(value.asReference());
+      }
+      break;
+    case TypeKind_Void:
+      if (peek() != 'n')
+        throwMismatch(target.type());
+      expectLiteral("null");
+      break;
+    default:
+      throw std::runtime_error(std::string("JSON: cannot decode into ") + target.type()->infoString());
+    }
   }
 
-  bool JsonDecoderPrivate::decodeObject(AnyValue &value)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeNumberInto(AnyReference target)
   {
-    std::string::const_iterator save = _it;
+    switch (peek())
+    {
+    case 't':
+      expectLiteral("true");
+      target.setInt(1);
+      return;
+    case 'f':
+      expectLiteral("false");
+      target.setInt(0);
+      return;
+    case '-':
+      break;
+    default:
+      if (!isDigit(peek()))
+        throwMismatch(target.type());
+    }
+    switch (getNumber())
+    {
+    case Number_Int:
+      target.setInt(_int);
+      break;
+    case Number_UInt:
+      target.setUInt(_uint);
+      break;
+    case Number_Float:
+      target.setDouble(_float);
+      break;
+    }
+  }
 
-    if (_it == _end || *_it != '{')
-      return false;
-    ++_it;
+  /* Elements are decoded into a value of the element type, then appended:
+   * lists only support appending by copy.
+   */
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeListInto(AnyReference target)
+  {
+    if (peek() != '[')
+      throwMismatch(target.type());
+    next();
+    ListTypeInterface* type = static_cast<ListTypeInterface*>(target.type());
+    TypeInterface* elementType = type->elementType();
+    void* storage = target.rawValue();
 
-    std::map<std::string, AnyValue> tmpMap;
-    while (true)
+    skipWhiteSpaces();
+    while (peek() != ']')
     {
+      AnyValue element(elementType);
+      decodeInto(element.asReference());
+      type->pushBack(&storage, element.rawValue());
       skipWhiteSpaces();
-      std::string key;
-
-      if (!getCleanString(key))
+      if (peek() != ',')
         break;
+      next();
       skipWhiteSpaces();
-      if (_it == _end || *_it != ':')
+    }
+    expect(']');
+  }
+
+  /* Values are decoded in place, keys of other kinds than string are read
+   * from the JSON key.
+   */
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeMapInto(AnyReference target)
+  {
+    if (peek() != '{')
+      throwMismatch(target.type());
+    next();
+    MapTypeInterface* type = static_cast<MapTypeInterface*>(target.type());
+    TypeInterface* keyType = type->keyType();
+    void* storage = target.rawValue();
+    AnyValue key(keyType);
+
+    skipWhiteSpaces();
+    while (peek() != '}')
+    {
+      if (peek() != '"')
+        decodeInto(key.asReference());
+      else if (keyType->kind() == TypeKind_String)
       {
-        _it = save;
-        return false;
+        getCleanString(_string);
+        key.setString(_string);
       }
-      ++_it;
-      AnyValue tmpValue;
-      if (!decodeValue(tmpValue))
+      else
       {
-        _it = save;
-        return false;
+        getCleanString(_string);
+        JsonDecoderPrivate<JsonMemorySource> keyDecoder(
+              JsonMemorySource(_string.data(), _string.data() + _string.size()));
+        keyDecoder.decode(key.asReference());
+        if (keyDecoder.source().peek() != EOF)
+          throwParseError();
       }
-      if (_it == _end)
-        break;
-      tmpMap[key] = tmpValue;
-      if (*_it != ',')
+      skipWhiteSpaces();
+      expect(':');
+      decodeInto(type->element(&storage, key.rawValue(), true));
+      skipWhiteSpaces();
+      if (peek() != ',')
         break;
-      ++_it;
-    }
-    if (_it == _end || *_it != '}')
-    {
-      _it = save;
-      return false;
+      next();
+      skipWhiteSpaces();
     }
-    ++_it;
-    value = AnyValue(tmpMap);
-    return true;
+    expect('}');
   }
 
-  bool JsonDecoderPrivate::match(std::string const& expected)
+  /* Members are decoded in place: by name from an object, if the structure
+   * has member names, or by position from an array.
+   */
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeTupleInto(AnyReference target)
   {
-    std::string::const_iterator save = _it;
-    std::string::const_iterator begin = expected.begin();
+    StructTypeInterface* type = static_cast<StructTypeInterface*>(target.type());
+    const JsonStructInfo& info = _structs.get(type);
+    const std::vector<TypeInterface*>& memberTypes = info.types;
+    void* storage = target.rawValue();
 
-    while (_it != _end && begin != expected.end())
+    if (peek() == '[')
     {
-      if (*_it != *begin)
+      next();
+      skipWhiteSpaces();
+      unsigned int index = 0;
+      while (peek() != ']')
       {
-        _it = save;
-        return false;
+        if (index >= memberTypes.size())
+          throw std::runtime_error(std::string("JSON: too many elements for ") + type->infoString());
+        decodeInto(AnyReference(memberTypes[index], type->get(storage, index)));
+        ++index;
+        skipWhiteSpaces();
+        if (peek() != ',')
+          break;
+        next();
+        skipWhiteSpaces();
       }
-      ++_it;
-      ++begin;
+      expect(']');
+      return;
     }
-    if (begin != expected.end())
+
+    if (peek() != '{' || info.indexes.empty())
+      throwMismatch(type);
+    next();
+    skipWhiteSpaces();
+    while (peek() != '}')
     {
-      _it = save;
-      return false;
+      getCleanString(_string);
+      const auto member = info.indexes.find(_string);
+      skipWhiteSpaces();
+      expect(':');
+      if (member != info.indexes.end())
+        decodeInto(AnyReference(memberTypes[member->second], type->get(storage, member->second)));
+      else
+        skipValue();
+      skipWhiteSpaces();
+      if (peek() != ',')
+        break;
+      next();
+      skipWhiteSpaces();
     }
-    return true;
+    expect('}');
   }
 
-  bool JsonDecoderPrivate::decodeSpecial(AnyValue &value)
+  template <typename Source>
+  void JsonDecoderPrivate<Source>::decodeOptionalInto(AnyReference target)
   {
-    if (_it == _end)
-      return false;
-    if (match("true"))
-      value = AnyValue(true);
-    else if (match("false"))
-      value = AnyValue::from(false);
-    else if (match("null"))
-      value = AnyValue(qi::typeOf<void>());
-    else
-      return false;
-    return true;
+    if (peek() == 'n')
+    {
+      expectLiteral("null");
+      target.resetOptional();
+      return;
+    }
+    OptionalTypeInterface* type = static_cast<OptionalTypeInterface*>(target.type());
+    AnyValue value(type->valueType());
+    decodeInto(value.asReference());
+    void* storage = target.rawValue();
+    type->set(&storage, value.rawValue());
   }
 
-  bool JsonDecoderPrivate::decodeValue(AnyValue &value)
+  const JsonStructInfo& jsonStructInfo(StructTypeInterface* type)
   {
-    skipWhiteSpaces();
-    if (decodeSpecial(value)
-        || decodeString(value)
-        || decodeFloat(value)
-        || decodeInteger(value)
-        || decodeArray(value)
-        || decodeObject(value)
-        )
+    static boost::mutex* mutex = nullptr;
+    QI_THREADSAFE_NEW(mutex);
+    boost::mutex::scoped_lock lock(*mutex);
+    static std::unordered_map<StructTypeInterface*, std::unique_ptr<JsonStructInfo>>* infos = nullptr;
+    if (!infos)
+      infos = new std::unordered_map<StructTypeInterface*, std::unique_ptr<JsonStructInfo>>();
+
+    std::unique_ptr<JsonStructInfo>& info = (*infos)[type];
+    if (!info)
     {
-      skipWhiteSpaces();
-      return true;
+      info.reset(new JsonStructInfo{type->memberTypes(), type->elementsName(), {}});
+      for (unsigned int i = 0; i < info->names.size(); ++i)
+        info->indexes.emplace(info->names[i], i);
     }
-    return false;
+    return *info;
   }
 
   std::string::const_iterator decodeJSON(const std::string::const_iterator &begin,
                                          const std::string::const_iterator &end,
                                          AnyValue &target)
   {
-    JsonDecoderPrivate parser(begin, end);
-    return parser.decode(target);
+    const char* const first = begin == end ? nullptr : &*begin;
+    JsonDecoderPrivate<JsonMemorySource> parser(JsonMemorySource(first, first + (end - begin)));
+    AnyValue value;
+
+    parser.decode(value);
+    target = std::move(value);
+    return begin + (parser.source().position() - first);
   }
 
   AnyValue decodeJSON(const std::string &in)
   {
     AnyValue value;
-    JsonDecoderPrivate parser(in);
+    JsonDecoderPrivate<JsonMemorySource> parser(JsonMemorySource(in.data(), in.data() + in.size()));
+
+    parser.decode(value);
+    return value;
+  }
+
+  AnyValue decodeJSON(std::istream &in)
+  {
+    AnyValue value;
+    JsonDecoderPrivate<JsonStreamSource> parser{JsonStreamSource(in.rdbuf())};
 
     parser.decode(value);
     return value;
   }
 
+  const char* decodeJSON(const char* begin, const char* end, AnyReference target)
+  {
+    JsonDecoderPrivate<JsonMemorySource> parser(JsonMemorySource(begin, end));
+
+    parser.decode(target);
+    return parser.source().position();
+  }
+
+  void decodeJSON(const std::string &in, AnyReference target)
+  {
+    decodeJSON(in.data(), in.data() + in.size(), target);
+  }
+
+  AnyValue decodeJSON(const std::string &in, TypeInterface* targetType)
+  {
+    AnyValue value(targetType);
+    decodeJSON(in, value.asReference());
+    return value;
+  }
+
+  void decodeJSON(std::istream &in, AnyReference target)
+  {
+    JsonDecoderPrivate<JsonStreamSource> parser{JsonStreamSource(in.rdbuf())};
+
+    parser.decode(target);
+  }
+
 }
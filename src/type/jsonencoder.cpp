@@ -3,9 +3,10 @@
 **  See COPYING for the license
 */
 
-#include <sstream>
+#include <cstdio>
+#include <limits>
+#include <ostream>
 #include <string>
-#include <iomanip>
 #ifdef WITH_BOOST_LOCALE
 #  include <boost/locale.hpp>
 #endif
@@ -13,13 +14,12 @@
 #include <qi/anyobject.hpp>
 #include <qi/type/typedispatcher.hpp>
 #include <qi/numeric.hpp>
+#include "jsoncodec_p.hpp"
 
 qiLogCategory("qitype.jsonencoder");
 
 namespace qi {
 
-  static void serialize(AnyReference val, std::stringstream& out, JsonOption jsonPrintOption, unsigned int indent);
-
   //Taken from boost::json
   inline char to_hex_char(unsigned int c)
   {
@@ -95,53 +95,108 @@ namespace qi {
     return result;
   }
 
-  std::string encodeJSON(const qi::AutoAnyReference &value, JsonOption jsonPrintOption) {
-    std::stringstream ss;
-    serialize(value, ss, jsonPrintOption, 0);
-    return ss.str();
+
+  namespace
+  {
+    // When writing to a stream, the output is buffered by chunks of this size.
+    const std::size_t jsonStreamChunkSize = 64 * 1024;
   }
 
   class SerializeJSONTypeVisitor
   {
   public:
-    SerializeJSONTypeVisitor(std::stringstream& outd, JsonOption jsonPrintOptiond, unsigned int indentd)
+    SerializeJSONTypeVisitor(std::string& outd, std::ostream* sinkd, JsonOption jsonPrintOptiond)
       : out(outd)
+      , sink(sinkd)
       , jsonPrintOption(jsonPrintOptiond)
-      , indent(indentd)
+      , indent(0)
+    {
+    }
+
+    void serialize(AnyReference val)
     {
-      //force C local, for int and float formatting
-      out.imbue(std::locale("C"));
+      if (val.kind() == TypeKind_Tuple)
+        serializeTuple(val);
+      else
+        qi::typeDispatch(*this, val);
+      if (sink && out.size() >= jsonStreamChunkSize)
+        flush();
+    }
+
+    void flush()
+    {
+      sink->write(out.data(), static_cast<std::streamsize>(out.size()));
+      out.clear();
     }
 
     void printIndent()
     {
       if (jsonPrintOption & qi::JsonOption_PrettyPrint)
       {
-        out << std::endl;
-        for (unsigned int i = 0; i < indent; ++i)
-          out << "  ";
+        out += '\n';
+        out.append(2 * indent, ' ');
       }
     }
 
     void printColon()
     {
       if (jsonPrintOption & qi::JsonOption_PrettyPrint)
-        out << ": ";
+        out += ": ";
       else
-        out << ":";
+        out += ':';
     }
 
+    void printUnsigned(uint64_t value)
+    {
+      char buffer[20];
+      char* const end = buffer + sizeof(buffer);
+      char* begin = end;
+      do
+      {
+        *--begin = static_cast<char>('0' + value % 10);
+        value /= 10;
+      } while (value);
+      out.append(begin, end);
+    }
+
+    void printSigned(int64_t value)
+    {
+      if (value < 0)
+      {
+        out += '-';
+        printUnsigned(0 - static_cast<uint64_t>(value));
+      }
+      else
+        printUnsigned(static_cast<uint64_t>(value));
+    }
+
+    // Same output as an ostream with this precision: "%.<precision>g".
+    void printFloat(double value, int precision)
+    {
+      char buffer[32];
+      const int size = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+      // printf follows the C locale of the process, the decimal point may
+      // not be a dot.
+      for (int i = 0; i < size; ++i)
+      {
+        if (buffer[i] == ',')
+          buffer[i] = '.';
+      }
+      out.append(buffer, size);
+    }
 
     void visitUnknown(AnyReference v)
     {
       qiLogError() << "JSON Error: Type " << v.type()->infoString() <<" not serializable";
-      out << "\"Error: no serialization for unknown type:" << v.type()->infoString() << "\"";
+      out += "\"Error: no serialization for unknown type:";
+      out += v.type()->infoString();
+      out += '"';
     }
 
     void visitVoid()
     {
       // Not an error, makes sense if encapsulated in a Dynamic for instance
-      out << "null";
+      out += "null";
     }
 
     void visitInt(int64_t value, bool isSigned, int byteSize)
@@ -151,19 +206,19 @@ namespace qi {
       case 0: {
         bool v = value != 0;
         if (v)
-          out << "true";
+          out += "true";
         else
-          out << "false";
+          out += "false";
         break;
       }
       case 1:
       case 2:
       case 4:
-      case 8:  out << ((int64_t)value); break;
+      case 8:  printSigned(value); break;
       case -1:
       case -2:
       case -4:
-      case -8: out << ((uint64_t)value);break;
+      case -8: printUnsigned((uint64_t)value); break;
 
       default:
         qiLogError() << "Unknown integer type " << isSigned << " " << byteSize;
@@ -173,15 +228,9 @@ namespace qi {
     void visitFloat(double value, int byteSize)
     {
       if (byteSize == 4)
-      {
-        out.precision(std::numeric_limits<float>::max_digits10);
-        out << ((float)value);
-      }
+        printFloat((float)value, std::numeric_limits<float>::max_digits10);
       else if (byteSize == 8)
-      {
-        out.precision(std::numeric_limits<double>::max_digits10);
-        out << ((double)value);
-      }
+        printFloat(value, std::numeric_limits<double>::max_digits10);
       else
       {
         qiLogError() << "serialize on unknown float type " << byteSize;
@@ -190,30 +239,65 @@ namespace qi {
 
     void visitString(const char* data, size_t size)
     {
+      out += '"';
+      if (!printAsciiString(data, size))
+      {
 #ifdef WITH_BOOST_LOCALE
-      out << "\"" << add_esc_chars(boost::locale::conv::to_utf<wchar_t>(std::string(data, size), "UTF-8"), jsonPrintOption) << "\"";
+        out += add_esc_chars(boost::locale::conv::to_utf<wchar_t>(std::string(data, size), "UTF-8"), jsonPrintOption);
 #else
-      out << "\"" << add_esc_chars(std::wstring(data, data+size), jsonPrintOption) << "\"";
+        out += add_esc_chars(std::wstring(data, data+size), jsonPrintOption);
 #endif
+      }
+      out += '"';
+    }
+
+    // Escape as add_esc_chars does, without the conversion to a wide string.
+    // Return false without writing anything if the string is not ASCII.
+    bool printAsciiString(const char* data, size_t size)
+    {
+      for (size_t i = 0; i < size; ++i)
+      {
+        if (static_cast<unsigned char>(data[i]) >= 0x80)
+          return false;
+      }
+      if (jsonPrintOption & JsonOption_Expand)
+      {
+        out.append(data, size);
+        return true;
+      }
+
+      size_t printed = 0;
+      for (size_t i = 0; i < size; ++i)
+      {
+        const unsigned char c = static_cast<unsigned char>(data[i]);
+        if (c >= 0x20 && c < 0x7F && c != '"' && c != '\\')
+          continue;
+        out.append(data + printed, i - printed);
+        printed = i + 1;
+        if (!add_esc_char(static_cast<char>(c), out, jsonPrintOption))
+          out += non_printable_to_string(c);
+      }
+      out.append(data + printed, size - printed);
+      return true;
     }
 
     void visitList(AnyIterator begin, AnyIterator end)
     {
-      out << "[";
+      out += '[';
       ++indent;
       const bool empty = begin == end;
       while (begin != end)
       {
         printIndent();
-        serialize(*begin, out, jsonPrintOption, indent);
+        serialize(*begin);
         ++begin;
         if (begin != end)
-          out << ",";
+          out += ',';
       }
       --indent;
       if (!empty)
         printIndent();
-      out << "]";
+      out += ']';
     }
 
     void visitVarArgs(AnyIterator begin, AnyIterator end)
@@ -223,83 +307,111 @@ namespace qi {
 
     void visitMap(AnyIterator begin, AnyIterator end)
     {
-      out << "{";
+      out += '{';
       ++indent;
       const bool empty = begin == end;
       while (begin != end)
       {
         printIndent();
         AnyReference e = *begin;
-        serialize(e[0], out, jsonPrintOption, indent);
-        printColon();
-        serialize(e[1], out, jsonPrintOption, indent);
+        if (e.kind() == TypeKind_Tuple)
+        {
+          StructTypeInterface* type = static_cast<StructTypeInterface*>(e.type());
+          const JsonStructInfo& pair = structs.get(type);
+          serialize(AnyReference(pair.types[0], type->get(e.rawValue(), 0)));
+          printColon();
+          serialize(AnyReference(pair.types[1], type->get(e.rawValue(), 1)));
+        }
+        else
+        {
+          serialize(e[0]);
+          printColon();
+          serialize(e[1]);
+        }
         ++begin;
         if (begin != end)
-          out << ",";
+          out += ',';
       }
       --indent;
       if (!empty)
         printIndent();
-      out << "}";
+      out += '}';
     }
 
     void visitObject(GenericObject value)
     {
       // TODO: implement?
       qiLogError() << "JSON Error: Serializing an object without a shared pointer";
-      out << "\"Error: no serialization for object\"";
+      out += "\"Error: no serialization for object\"";
     }
 
     void visitAnyObject(AnyObject& value)
     {
       // TODO: implement?
       qiLogError() << "JSON Error: Serializing an object without a shared pointer";
-      out << "\"Error: no serialization for object\"";
+      out += "\"Error: no serialization for object\"";
     }
 
     void visitPointer(AnyReference pointee)
     {
       qiLogError() << "JSON Error: error a pointer!!!";
-      out << "\"Error: no serialization for pointer\"";
+      out += "\"Error: no serialization for pointer\"";
     }
 
     void visitTuple(const std::string &name, const AnyReferenceVector &vals, const std::vector<std::string> &annotations)
+    {
+      printTuple(annotations, vals.size(), [&](unsigned int i) { return vals[i]; });
+    }
+
+    // Same as visitTuple, without building the vectors of members and names
+    // on each value.
+    void serializeTuple(AnyReference value)
+    {
+      StructTypeInterface* type = static_cast<StructTypeInterface*>(value.type());
+      const JsonStructInfo& info = structs.get(type);
+      printTuple(info.names, info.types.size(), [&](unsigned int i) {
+        return AnyReference(info.types[i], type->get(value.rawValue(), i));
+      });
+    }
+
+    template <typename Member>
+    void printTuple(const std::vector<std::string> &annotations, size_t size, Member&& member)
     {
       //is the tuple is annotated serialize as an object
       if (annotations.size()) {
-        out << "{";
+        out += '{';
         ++indent;
-        for (unsigned i=0; i<vals.size();++i) {
+        for (unsigned i=0; i<size;++i) {
           printIndent();
           visitString(annotations[i].data(), annotations[i].size());
           printColon();
-          serialize(vals[i], out, jsonPrintOption, indent);
-          if (i + 1 < vals.size())
-            out << ",";
+          serialize(member(i));
+          if (i + 1 < size)
+            out += ',';
         }
         --indent;
         printIndent();
-        out << "}";
+        out += '}';
         return;
       }
 
-      out << "[";
+      out += '[';
       ++indent;
-      for (unsigned i=0; i<vals.size();++i) {
+      for (unsigned i=0; i<size;++i) {
         printIndent();
-        serialize(vals[i], out, jsonPrintOption, indent);
-        if (i + 1 < vals.size())
-          out << ",";
+        serialize(member(i));
+        if (i + 1 < size)
+          out += ',';
       }
       --indent;
       printIndent();
-      out << "]";
+      out += ']';
     }
 
     void visitDynamic(AnyReference pointee)
     {
       if (pointee.isValid()) {
-        serialize(pointee, out, jsonPrintOption, indent);
+        serialize(pointee);
       }
     }
 
@@ -307,36 +419,53 @@ namespace qi {
     {
       //TODO: implement buffer support
       qiLogError() << "JSON Error: raw data encoder not implemented!!!";
-      out << "\"Error: no serialization for Buffer\"";
+      out += "\"Error: no serialization for Buffer\"";
     }
 
     void visitIterator(AnyReference)
     {
       qiLogError() << "JSON Error: no serialization for iterator!!!";
-      out << "\"Error: no serialization for iterator\"";
+      out += "\"Error: no serialization for iterator\"";
     }
 
     void visitOptional(AnyReference value)
     {
       if (value.optionalHasValue())
       {
-        serialize(value.content(), out, jsonPrintOption, indent);
+        serialize(value.content());
       }
       else
       {
-        out << "null";
+        out += "null";
       }
     }
 
-    std::stringstream& out;
+    std::string& out;
+    std::ostream* sink;
     JsonOption jsonPrintOption;
     unsigned int indent;
+    JsonStructInfoCache structs;
   };
 
-  static void serialize(AnyReference val, std::stringstream& out, JsonOption jsonPrintOption, unsigned int indent)
+  std::string encodeJSON(const qi::AutoAnyReference &value, JsonOption jsonPrintOption)
+  {
+    std::string out;
+    encodeJSON(value, out, jsonPrintOption);
+    return out;
+  }
+
+  void encodeJSON(const qi::AutoAnyReference &value, std::string& out, JsonOption jsonPrintOption)
+  {
+    SerializeJSONTypeVisitor(out, nullptr, jsonPrintOption).serialize(value);
+  }
+
+  void encodeJSON(const qi::AutoAnyReference &value, std::ostream& out, JsonOption jsonPrintOption)
   {
-    SerializeJSONTypeVisitor stv(out, jsonPrintOption, indent);
-    qi::typeDispatch(stv, val);
+    std::string buffer;
+    buffer.reserve(jsonStreamChunkSize);
+    SerializeJSONTypeVisitor visitor(buffer, &out, jsonPrintOption);
+    visitor.serialize(value);
+    visitor.flush();
   }
 
 };
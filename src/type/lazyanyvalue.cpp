@@ -0,0 +1,117 @@
+/*
+**  Copyright (C) 2018 Softbank Robotics Europe
+**  See COPYING for the license
+*/
+
+#include <atomic>
+#include <sstream>
+#include <stdexcept>
+#include <boost/thread/mutex.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/lazyanyvalue.hpp>
+
+namespace qi
+{
+  struct LazyAnyValue::State
+  {
+    Signature signature;
+    Buffer encoded;
+    bool hasEncoding = false;
+
+    boost::mutex mutex;
+    // Set once `value` is decoded, which never changes afterwards.
+    std::atomic<bool> decoded{false};
+    AnyValue value;
+  };
+
+  namespace
+  {
+    TypeInterface* typeOfSignature(const Signature& signature)
+    {
+      TypeInterface* type = TypeInterface::fromSignature(signature);
+      if (!type)
+      {
+        std::stringstream ss;
+        ss << "Cannot find a type to deserialize signature " << signature.toString()
+           << " within a dynamic value.";
+        throw std::runtime_error(ss.str());
+      }
+      return type;
+    }
+  }
+
+  LazyAnyValue::LazyAnyValue()
+  {
+  }
+
+  LazyAnyValue::LazyAnyValue(const AnyValue& value)
+  {
+    if (!value.isValid())
+      return;
+    _state = std::make_shared<State>();
+    _state->signature = value.signature();
+    _state->value = value;
+    _state->decoded = true;
+  }
+
+  LazyAnyValue::LazyAnyValue(const Signature& signature, Buffer encoded)
+  {
+    if (!signature.isValid())
+      return;
+    _state = std::make_shared<State>();
+    _state->signature = signature;
+    _state->encoded = std::move(encoded);
+    _state->hasEncoding = true;
+  }
+
+  const Signature& LazyAnyValue::signature() const
+  {
+    static const Signature empty;
+    return _state ? _state->signature : empty;
+  }
+
+  bool LazyAnyValue::isValid() const
+  {
+    return _state != nullptr;
+  }
+
+  bool LazyAnyValue::isDecoded() const
+  {
+    return !_state || _state->decoded.load(std::memory_order_acquire);
+  }
+
+  const Buffer* LazyAnyValue::encoded() const
+  {
+    return _state && _state->hasEncoding ? &_state->encoded : nullptr;
+  }
+
+  const AnyValue& LazyAnyValue::value() const
+  {
+    static const AnyValue empty;
+    if (!_state)
+      return empty;
+    State& state = *_state;
+    if (!state.decoded.load(std::memory_order_acquire))
+    {
+      boost::mutex::scoped_lock lock(state.mutex);
+      if (!state.decoded.load(std::memory_order_relaxed))
+      {
+        AnyValue value(typeOfSignature(state.signature));
+        BufferReader reader(state.encoded);
+        decodeBinary(&reader, value.asReference());
+        state.value = std::move(value);
+        state.decoded.store(true, std::memory_order_release);
+      }
+    }
+    return state.value;
+  }
+
+  bool LazyAnyValue::decodeTo(AnyReference target) const
+  {
+    if (isDecoded() || !_state->hasEncoding || target.type()->signature() != _state->signature)
+      return false;
+    BufferReader reader(_state->encoded);
+    decodeBinary(&reader, target);
+    return true;
+  }
+}
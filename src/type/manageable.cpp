@@ -1,3 +1,6 @@
+#include <atomic>
+#include <functional>
+#include <thread>
 #include <qi/type/detail/manageable.hpp>
 #include <qi/type/objecttypebuilder.hpp>
 #include "../type/signal_p.hpp"
@@ -5,11 +8,35 @@
 namespace qi
 {
 
+  namespace
+  {
+    // Statistics pushed by the threads whose id hashes to the same shard.
+    struct StatsShard
+    {
+      boost::mutex mutex;
+      ObjectStatistics stats;
+      ObjectHistograms histograms;
+      // Keeps the mutexes of neighbour shards off the same cache line.
+      char padding[64];
+    };
+
+    const std::size_t statsShardCount = 16;
+
+    StatsShard& threadShard(StatsShard* shards)
+    {
+      return shards[std::hash<std::thread::id>()(std::this_thread::get_id()) % statsShardCount];
+    }
+  }
+
   class ManageablePrivate
   {
   public:
     ManageablePrivate();
     ~ManageablePrivate();
+
+    // The statsShardCount shards, created by the first push as most objects
+    // never gather statistics.
+    StatsShard* statsShards();
     // SignalLinks that target us. Needed to be able to disconnect upon destruction
     std::vector<SignalSubscriber>       registrations;
     mutable boost::mutex                registrationsMutex;
@@ -18,19 +45,34 @@ namespace qi
     boost::shared_ptr<ExecutionContext> executionContext;
     boost::mutex                        initMutex;
 
-    bool statsEnabled;
-    bool traceEnabled;
-    ObjectStatistics stats;
+    std::atomic<bool> statsEnabled;
+    std::atomic<bool> statsCpuTimeEnabled;
+    std::atomic<bool> traceEnabled;
+    std::atomic<StatsShard*> shards;
     qi::Atomic<int> traceId;
   };
 
   ManageablePrivate::ManageablePrivate()
     : dying(false)
     , statsEnabled(false)
+    , statsCpuTimeEnabled(true)
     , traceEnabled(false)
+    , shards(nullptr)
   {
   }
 
+  StatsShard* ManageablePrivate::statsShards()
+  {
+    StatsShard* current = shards.load(std::memory_order_acquire);
+    if (!current)
+    {
+      std::unique_ptr<StatsShard[]> created(new StatsShard[statsShardCount]);
+      if (shards.compare_exchange_strong(current, created.get(), std::memory_order_acq_rel))
+        current = created.release();
+    }
+    return current;
+  }
+
   ManageablePrivate::~ManageablePrivate()
   {
     dying = true;
@@ -44,6 +86,7 @@ namespace qi
       if(auto source = copy[i]._p->source.lock())
         source->disconnect(copy[i]._p->linkId).wait();
     }
+    delete[] shards.load(std::memory_order_relaxed);
   }
 
   Manageable::Manageable()
@@ -91,41 +134,85 @@ namespace qi
 
   bool Manageable::isStatsEnabled() const
   {
-    return _p->statsEnabled;
+    return _p->statsEnabled.load(std::memory_order_relaxed);
   }
 
   void Manageable::enableStats(bool state)
   {
-    _p->statsEnabled = state;
+    _p->statsEnabled.store(state, std::memory_order_relaxed);
+  }
+
+  bool Manageable::isStatsCpuTimeEnabled() const
+  {
+    return _p->statsCpuTimeEnabled.load(std::memory_order_relaxed);
+  }
+
+  void Manageable::enableStatsCpuTime(bool state)
+  {
+    _p->statsCpuTimeEnabled.store(state, std::memory_order_relaxed);
   }
 
   void Manageable::pushStats(int slotId, float wallTime, float userTime, float systemTime)
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    MethodStatistics& ms = _p->stats[slotId];
-    ms.push(wallTime, userTime, systemTime);
+    StatsShard& shard = threadShard(_p->statsShards());
+    boost::mutex::scoped_lock l(shard.mutex);
+    shard.stats[slotId].push(wallTime, userTime, systemTime);
+    shard.histograms[slotId].push(wallTime, userTime, systemTime);
   }
 
   ObjectStatistics Manageable::stats() const
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    return _p->stats;
+    ObjectStatistics result;
+    StatsShard* shards = _p->shards.load(std::memory_order_acquire);
+    if (!shards)
+      return result;
+    for (std::size_t i = 0; i < statsShardCount; ++i)
+    {
+      StatsShard& shard = shards[i];
+      boost::mutex::scoped_lock l(shard.mutex);
+      for (const auto& slot : shard.stats)
+        result[slot.first].merge(slot.second);
+    }
+    return result;
+  }
+
+  ObjectHistograms Manageable::statsHistograms() const
+  {
+    ObjectHistograms result;
+    StatsShard* shards = _p->shards.load(std::memory_order_acquire);
+    if (!shards)
+      return result;
+    for (std::size_t i = 0; i < statsShardCount; ++i)
+    {
+      StatsShard& shard = shards[i];
+      boost::mutex::scoped_lock l(shard.mutex);
+      for (const auto& slot : shard.histograms)
+        result[slot.first].merge(slot.second);
+    }
+    return result;
   }
 
   void Manageable::clearStats()
   {
-    boost::mutex::scoped_lock l(_p->registrationsMutex);
-    _p->stats.clear();
+    StatsShard* shards = _p->shards.load(std::memory_order_acquire);
+    if (!shards)
+      return;
+    for (std::size_t i = 0; i < statsShardCount; ++i)
+    {
+      boost::mutex::scoped_lock l(shards[i].mutex);
+      shards[i].stats.clear();
+      shards[i].histograms.clear();
+    }
   }
 
   bool Manageable::isTraceEnabled() const
   {
-    return _p->traceEnabled;
+    return _p->traceEnabled.load(std::memory_order_relaxed);
   }
 
   void Manageable::enableTrace(bool state)
   {
-    _p->traceEnabled = state;
+    _p->traceEnabled.store(state, std::memory_order_relaxed);
   }
 
   int Manageable::_nextTraceId()
@@ -155,6 +242,9 @@ namespace qi
     builder.advertiseMethod("isTraceEnabled", &Manageable::isTraceEnabled, MetaCallType_Auto, id++);
     builder.advertiseMethod("enableTrace", &Manageable::enableTrace,       MetaCallType_Auto, id++);
     builder.advertiseSignal("traceObject", &Manageable::traceObject, id++);
+    builder.advertiseMethod("isStatsCpuTimeEnabled", &Manageable::isStatsCpuTimeEnabled, MetaCallType_Auto, id++);
+    builder.advertiseMethod("enableStatsCpuTime", &Manageable::enableStatsCpuTime,       MetaCallType_Auto, id++);
+    builder.advertiseMethod("statsHistograms", &Manageable::statsHistograms,             MetaCallType_Auto, id++);
     QI_ASSERT(id <= endId);
     const detail::ObjectTypeData& typeData = builder.typeData();
     *manageable::methodMap = typeData.methodMap;
@@ -26,7 +26,7 @@ namespace qi {
   SignalBasePrivate::~SignalBasePrivate()
   {
     {
-      boost::recursive_mutex::scoped_lock lock(mutex);
+      SignalBasePrivate::Mutex::scoped_lock lock(mutex);
       onSubscribers = SignalBase::OnSubscribers();
     }
     disconnectAll();
@@ -39,7 +39,7 @@ namespace qi {
     SignalBase::OnSubscribers onSubscribersToCall;
     {
       // Acquire signal mutex
-      boost::recursive_mutex::scoped_lock sigLock(mutex);
+      SignalBasePrivate::Mutex::scoped_lock sigLock(mutex);
       SignalSubscriberMap::iterator it = subscriberMap.find(l);
       if (it == subscriberMap.end())
       {
@@ -49,6 +49,7 @@ namespace qi {
       subscriber = it->second;
       // Remove from map (but SignalSubscriber object still good)
       subscriberMap.erase(it);
+      emission.reset();
       if (subscriberMap.empty() && onSubscribers)
         onSubscribersToCall = onSubscribers;
       // Ensure no call on subscriber occurs once this function returns
@@ -72,7 +73,7 @@ namespace qi {
     while (true)
     {
       {
-        boost::recursive_mutex::scoped_lock sl(mutex);
+        SignalBasePrivate::Mutex::scoped_lock sl(mutex);
         SignalSubscriberMap::iterator it = subscriberMap.begin();
         if (it == subscriberMap.end())
           break;
@@ -90,6 +91,19 @@ namespace qi {
     });
   }
 
+  std::shared_ptr<const SignalSubscriberList> SignalBasePrivate::emissionSubscribers()
+  {
+    if (!emission)
+    {
+      auto subscribers = std::make_shared<SignalSubscriberList>();
+      subscribers->reserve(subscriberMap.size());
+      for (const auto& entry : subscriberMap)
+        subscribers->push_back(entry.second);
+      emission = std::move(subscribers);
+    }
+    return emission;
+  }
+
   SignalSubscriberPrivate::SignalSubscriberPrivate() = default;
   SignalSubscriberPrivate::~SignalSubscriberPrivate() = default;
 
@@ -133,7 +147,7 @@ QI_WARNING_POP()
   void SignalBase::setCallType(MetaCallType callType)
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock lock(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
     _p->defaultCallType = callType;
   }
 
@@ -156,7 +170,7 @@ QI_WARNING_POP()
 
     auto mct = [&] () {
       QI_ASSERT(_p);
-      boost::recursive_mutex::scoped_lock lock(_p->mutex);
+      SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
       if (signature != _p->signature)
       {
         qiLogError() << "Dropping emit: signature mismatch: "
@@ -174,7 +188,7 @@ QI_WARNING_POP()
     QI_ASSERT(_p);
     SignalBase::Trigger trigger;
     {
-      boost::recursive_mutex::scoped_lock lock(_p->mutex);
+      SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
       trigger = _p->triggerOverride;
     }
     if (trigger)
@@ -186,26 +200,40 @@ QI_WARNING_POP()
   void SignalBase::setTriggerOverride(Trigger t)
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock lock(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
     _p->triggerOverride = t;
   }
 
   void SignalBase::setOnSubscribers(OnSubscribers onSubscribers)
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock lock(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
     _p->onSubscribers = onSubscribers;
   }
 
   namespace {
+    std::shared_ptr<GenericFunctionParameters> copyParameters(const GenericFunctionParameters& params)
+    {
+      // Parameters owning their values are shared instead of copied.
+      if (params.storage())
+        return std::make_shared<GenericFunctionParameters>(params);
+      return std::shared_ptr<GenericFunctionParameters>{
+        new auto(params.copy()),
+        [](GenericFunctionParameters* object) {
+          object->destroy(); // see GenericFunctionParameters::copy() for details
+          delete object;
+        }
+      };
+    }
+
     template<typename Params>
-    void callSubscribersImpl(const SignalBase& x, SignalSubscriberMap& subscribers,
+    void callSubscribersImpl(const SignalBase& x, const SignalSubscriberList& subscribers,
                              const Params& params, MetaCallType callType)
     {
-      for (auto& i: subscribers)
+      for (const auto& subscriber: subscribers)
       {
         qiLogDebug() << &x << " Invoking signal subscriber";
-        SignalSubscriber s = i.second; // holds the subscription alive
+        SignalSubscriber s = subscriber; // holds the subscription alive
         s.call(params, callType);
       }
     }
@@ -216,15 +244,15 @@ QI_WARNING_POP()
     MetaCallType mct = callType;
     QI_ASSERT(_p);
 
-    SignalSubscriberMap copy;
+    std::shared_ptr<const SignalSubscriberList> subscribers;
     {
-      boost::recursive_mutex::scoped_lock lock(_p->mutex);
+      SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
       if (mct == qi::MetaCallType_Auto)
         mct = _p->defaultCallType;
 
-      copy = _p->subscriberMap;
+      subscribers = _p->emissionSubscribers();
     }
-    qiLogDebug() << this << " Invoking signal subscribers: " << copy.size();
+    qiLogDebug() << this << " Invoking signal subscribers: " << subscribers->size();
 
     // If any subscriber is going to use an execution context, it's going to
     // need a copy of the arguments, so that it can post a task to the execution
@@ -232,28 +260,42 @@ QI_WARNING_POP()
     // because it would be inefficient. We therefore detect here if a copy is
     // needed, and if so make this copy once for all.
 
-    using V = SignalSubscriberMap::value_type;
-    const bool mustCopyParams = std::any_of(copy.begin(), copy.end(), [mct](const V& v) {
-      const SignalSubscriber& s = v.second;
+    const bool mustCopyParams = std::any_of(subscribers->begin(), subscribers->end(),
+                                            [mct](const SignalSubscriber& s) {
       return static_cast<bool>(s.executionContextFor(mct)); // Has a context.
     });
 
     if (mustCopyParams)
-    {
-      std::shared_ptr<GenericFunctionParameters> paramsCopy{
-        new auto(params.copy()),
-        [](GenericFunctionParameters* object) {
-          object->destroy(); // see GenericFunctionParameters::copy() for details
-          delete object;
-        }
-      };
-      callSubscribersImpl(*this, copy, std::move(paramsCopy), mct);
-    }
+      callSubscribersImpl(*this, *subscribers, copyParameters(params), mct);
     else
+      callSubscribersImpl(*this, *subscribers, params, mct);
+    qiLogDebug() << this << " done invoking signal subscribers";
+  }
+
+  std::shared_ptr<const std::vector<SignalSubscriber>> SignalBase::emissionSubscribers(MetaCallType& callType)
+  {
+    QI_ASSERT(_p);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
+    if (_p->triggerOverride)
+      return {};
+    callType = _p->defaultCallType;
+    return _p->emissionSubscribers();
+  }
+
+  void SignalBase::callSubscriber(const SignalSubscriber& subscriber,
+                                  const GenericFunctionParameters& params,
+                                  MetaCallType callType,
+                                  std::shared_ptr<GenericFunctionParameters>& paramsCopy)
+  {
+    SignalSubscriber s = subscriber; // holds the subscription alive
+    if (!s.executionContextFor(callType))
     {
-      callSubscribersImpl(*this, copy, params, mct);
+      s.call(params, callType);
+      return;
     }
-    qiLogDebug() << this << " done invoking signal subscribers";
+    if (!paramsCopy)
+      paramsCopy = copyParameters(params);
+    s.call(paramsCopy, callType);
   }
 
   void SignalSubscriber::callImpl(const GenericFunctionParameters& args)
@@ -262,37 +304,44 @@ QI_WARNING_POP()
       return;
 
     // do not throw
-    bool mustDisconnect = false;
     try
     {
       _p->handler(args);
     }
     catch (const qi::PointerLockException&)
     {
-      qiLogDebug() << "PointerLockFailure excepton, will disconnect";
-      mustDisconnect = true;
+      onPointerLockFailure();
     }
     catch (const std::exception& e)
     {
-      qiLogWarning() << "Exception caught from signal subscriber: " << e.what();
+      onException(e.what());
     }
     catch (...)
     {
-      qiLogWarning() << "Unknown exception caught from signal subscriber";
+      onException(nullptr);
     }
+  }
 
-    if (mustDisconnect)
+  void SignalSubscriber::onPointerLockFailure()
+  {
+    qiLogDebug() << "PointerLockFailure excepton, will disconnect";
+    // if enabled is false, we are already disconnected
+    if (_p->enabled)
     {
-      // if enabled is false, we are already disconnected
-      if (_p->enabled)
-      {
-        auto sbp = _p->source.lock();
-        if(sbp)
-          sbp->disconnect(_p->linkId).wait();
-      }
+      auto sbp = _p->source.lock();
+      if(sbp)
+        sbp->disconnect(_p->linkId).wait();
     }
   }
 
+  void SignalSubscriber::onException(const char* what)
+  {
+    if (what)
+      qiLogWarningLimited(10) << "Exception caught from signal subscriber: " << what;
+    else
+      qiLogWarningLimited(10) << "Unknown exception caught from signal subscriber";
+  }
+
   boost::optional<ExecutionContext*> SignalSubscriber::executionContextFor(MetaCallType callType) const
   {
     if (!_p->handler)
@@ -454,11 +503,12 @@ QI_WARNING_POP()
       }
     }
 
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     bool first = _p->subscriberMap.empty();
     SignalLink res = ++linkUid;
     SignalSubscriber& subscriberInMap = _p->subscriberMap[res];
     subscriberInMap = src;
+    _p->emission.reset();
     subscriberInMap._p->linkId = res;
     subscriberInMap._p->source = this->_p;
     Future<void> callingOnSubscribers{nullptr};
@@ -488,33 +538,34 @@ QI_WARNING_POP()
   {
     id = ++_p->trackId;
     {
-      boost::recursive_mutex::scoped_lock l(_p->mutex);
+      SignalBasePrivate::Mutex::scoped_lock l(_p->mutex);
       pLink = &_p->trackMap[id];
     }
   }
 
   void SignalBase::disconnectTrackLink(int id)
   {
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     TrackMap::iterator it = _p->trackMap.find(id);
     if (it == _p->trackMap.end())
       return;
 
     _p->subscriberMap.erase(it->second);
+    _p->emission.reset();
     _p->trackMap.erase(it);
   }
 
   ExecutionContext* SignalBase::executionContext() const
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     return _p->execContext;
   }
 
   void SignalBase::clearExecutionContext()
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     _p->execContext = nullptr;
   }
 
@@ -562,13 +613,13 @@ QI_WARNING_POP()
   qi::Signature SignalBase::signature() const
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock lock(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
     return _p->signature;
   }
 
   void SignalBase::_setSignature(const qi::Signature& s)
   {
-    boost::recursive_mutex::scoped_lock lock(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock lock(_p->mutex);
     _p->signature = s;
   }
 
@@ -589,7 +640,7 @@ QI_WARNING_POP()
   {
     std::vector<SignalSubscriber> res;
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     for (const auto& i: _p->subscriberMap)
       res.push_back(i.second);
     return res;
@@ -598,7 +649,7 @@ QI_WARNING_POP()
   bool SignalBase::hasSubscribers()
   {
     QI_ASSERT(_p);
-    boost::recursive_mutex::scoped_lock sl(_p->mutex);
+    SignalBasePrivate::Mutex::scoped_lock sl(_p->mutex);
     return !_p->subscriberMap.empty();
   }
 
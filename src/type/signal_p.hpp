@@ -10,15 +10,24 @@
 #include <qi/signal.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <qi/perf/detail/instrumentedmutex.hpp>
 
 namespace qi {
 
   using SignalSubscriberMap = std::map<SignalLink, SignalSubscriber>;
+  using SignalSubscriberList = std::vector<SignalSubscriber>;
   using TrackMap = std::map<int, SignalLink>;
 
+  namespace detail
+  {
+    QI_INSTRUMENTATION_LOCK_NAME(SignalLockName, "qi.signal");
+  }
+
   class SignalBasePrivate
   {
   public:
+    using Mutex = detail::InstrumentedMutex<boost::recursive_mutex, detail::SignalLockName>;
+
     SignalBasePrivate()
       : execContext(nullptr)
       , defaultCallType(MetaCallType_Auto)
@@ -31,14 +40,19 @@ namespace qi {
   private:
     friend class SignalBase;
     Future<bool> disconnectAllStep(bool overallSuccess);
+    // Requires mutex to be locked.
+    std::shared_ptr<const SignalSubscriberList> emissionSubscribers();
+
 
     SignalBase::OnSubscribers      onSubscribers;
     ExecutionContext*              execContext;
     SignalSubscriberMap            subscriberMap;
+    // Copy of subscriberMap shared by the emissions, reset when it changes.
+    std::shared_ptr<const SignalSubscriberList> emission;
     TrackMap                       trackMap;
     qi::Atomic<int>                trackId;
     qi::Signature                  signature;
-    boost::recursive_mutex         mutex;
+    Mutex                          mutex;
     MetaCallType                   defaultCallType;
     SignalBase::Trigger            triggerOverride;
   };
@@ -8,7 +8,9 @@
 #include <qi/signature.hpp>
 #include <qi/type/typeinterface.hpp>
 #include <qi/jsoncodec.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/make_shared.hpp>
+#include "interningtable_p.hpp"
 #include "signatureconvertor.hpp"
 
 qiLogCategory("qitype.signature");
@@ -102,7 +104,7 @@ namespace qi {
   }
 
 
-  float qi::Signature::isConvertibleTo(const qi::Signature& b) const
+  float qi::Signature::computeConvertibility(const qi::Signature& b) const
   {
     /* The returned float is just a basic heuristic, it does not handle:
      * - comparison between integral types
@@ -286,6 +288,10 @@ namespace qi {
 
     std::string            _signature;
     std::vector<Signature> _children;
+    /// Hash of the type and of the children, ignoring the annotations as operator== does.
+    std::size_t            _structureHash = 0;
+    /// Whether this is the instance shared by all the signatures of this string.
+    bool                   _interned = false;
   };
 
   static size_t findNext(const std::string &signature, size_t index) {
@@ -461,31 +467,154 @@ namespace qi {
     }
     parseChildren(signature, begin);
     _signature.assign(signature, begin, end - begin);
+    _structureHash = static_cast<std::size_t>(signature[begin]);
+    for (const Signature& child : _children)
+      boost::hash_combine(_structureHash, child._p->_structureHash);
+  }
+
+  namespace
+  {
+    using SignaturePrivatePtr = boost::shared_ptr<SignaturePrivate>;
+
+    // Signature string looked up in the table without copying it.
+    struct SignatureText
+    {
+      const char* data;
+      std::size_t size;
+    };
+
+    struct SignatureKey
+    {
+      explicit SignatureKey(const SignatureText& text)
+        : signature(text.data, text.size)
+      {}
+
+      std::string signature;
+    };
+
+    struct SignatureTextHash
+    {
+      std::size_t operator()(const SignatureText& text) const
+      {
+        return boost::hash_range(text.data, text.data + text.size);
+      }
+    };
+
+    struct SignatureTextEqual
+    {
+      bool operator()(const SignatureKey& key, const SignatureText& text) const
+      {
+        return key.signature.size() == text.size &&
+               std::memcmp(key.signature.data(), text.data, text.size) == 0;
+      }
+    };
+
+    using SignatureTable =
+        detail::InterningTable<SignatureKey, SignaturePrivatePtr, SignatureTextHash, SignatureTextEqual>;
+
+    // Signatures also come from the network: past this size, new signatures
+    // are parsed at each construction.
+    SignatureTable& signatureTable()
+    {
+      static SignatureTable* table = new SignatureTable(4096, 16384);
+      return *table;
+    }
+
+    // Parsed signatures, shared by all the signatures of the same string.
+    SignaturePrivatePtr internSignature(const std::string& signature, size_t begin, size_t end)
+    {
+      if (begin > end || end > signature.size())
+      {
+        // Out of the string: let the parser report the error.
+        SignaturePrivatePtr invalid = boost::make_shared<SignaturePrivate>();
+        invalid->init(signature, begin, end);
+        return invalid;
+      }
+
+      const SignatureText text{ signature.data() + begin, end - begin };
+      SignatureTable& table = signatureTable();
+      if (const SignaturePrivatePtr* interned = table.find(text))
+        return *interned;
+
+      // Parse out of the table lock, the children are interned as well.
+      SignaturePrivatePtr parsed = boost::make_shared<SignaturePrivate>();
+      parsed->init(signature, begin, end);
+      SignaturePrivatePtr interned = table.findOrInsert(text, [&] {
+        parsed->_interned = true;
+        return parsed;
+      });
+      return interned ? interned : parsed;
+    }
+
+    SignaturePrivatePtr invalidSignature()
+    {
+      static const SignaturePrivatePtr* invalid = [] {
+        auto p = boost::make_shared<SignaturePrivate>();
+        p->_interned = true;
+        return new SignaturePrivatePtr(p);
+      }();
+      return *invalid;
+    }
+
+    using ConvertibilityKey = std::pair<const SignaturePrivate*, const SignaturePrivate*>;
+
+    struct ConvertibilityKeyHash
+    {
+      std::size_t operator()(const ConvertibilityKey& key) const
+      {
+        return boost::hash<ConvertibilityKey>()(key);
+      }
+    };
+
+    using ConvertibilityCache = detail::InterningTable<ConvertibilityKey, float, ConvertibilityKeyHash>;
+
+    ConvertibilityCache& convertibilityCache()
+    {
+      static ConvertibilityCache* cache = new ConvertibilityCache(4096, 65536);
+      return *cache;
+    }
   }
 
   Signature::Signature()
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(invalidSignature())
   {
   }
 
   Signature::Signature(const char *signature)
-    : _p(boost::make_shared<SignaturePrivate>())
   {
-    _p->_signature.assign(signature);
-    _p->init(_p->_signature, 0, _p->_signature.size());
+    const SignatureText text{ signature, std::strlen(signature) };
+    if (const SignaturePrivatePtr* interned = signatureTable().find(text))
+      _p = *interned;
+    else
+    {
+      const std::string str(signature, text.size);
+      _p = internSignature(str, 0, str.size());
+    }
   }
 
 
   Signature::Signature(const std::string &signature)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(internSignature(signature, 0, signature.size()))
   {
-    _p->init(signature, 0, signature.size());
   }
 
   Signature::Signature(const std::string &signature, size_t begin, size_t end)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(internSignature(signature, begin, end))
+  {
+  }
+
+  float qi::Signature::isConvertibleTo(const qi::Signature& b) const
   {
-    _p->init(signature, begin, end);
+    // Only the interned signatures live as long as the cache.
+    if (!_p->_interned || !b._p->_interned)
+      return computeConvertibility(b);
+    const ConvertibilityKey key(_p.get(), b._p.get());
+    ConvertibilityCache& cache = convertibilityCache();
+    if (const float* score = cache.find(key))
+      return *score;
+    const float score = computeConvertibility(b);
+    cache.findOrInsert(key, [&] { return score; });
+    return score;
   }
 
   bool Signature::isValid() const {
@@ -590,6 +719,10 @@ namespace qi {
   //compare signature without taking annotation into account
   bool operator==(const Signature& lhs, const Signature& rhs)
   {
+    if (lhs._p == rhs._p)
+      return true;
+    if (lhs._p->_structureHash != rhs._p->_structureHash)
+      return false;
     if (lhs.type() != rhs.type())
       return false;
     if (lhs.children().size() != rhs.children().size())
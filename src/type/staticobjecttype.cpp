@@ -90,6 +90,7 @@ StaticObjectTypeBase::metaCall(void* instance, AnyObject context, unsigned int m
   p2.reserve(params.size()+1);
   p2.push_back(self);
   p2.insert(p2.end(), params.begin(), params.end());
+  p2.setStorage(params.storage());
 
   return ::qi::metaCall(ec, _data.threadingModel, methodThreadingModel, callType, context, methodId, method, p2, true);
 }
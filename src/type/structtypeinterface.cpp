@@ -42,4 +42,17 @@ namespace qi
     for (unsigned i=0; i<values.size(); ++i)
       set(storage, i, values[i]);
   }
+
+  void StructTypeInterface::encodeBinary(void* storage, detail::BinaryFieldWriter& out)
+  {
+    const std::vector<TypeInterface*> types = memberTypes();
+    const std::vector<void*> values = get(storage);
+    for (unsigned i=0; i<types.size(); ++i)
+      out.write(AnyReference(types[i], values[i]));
+  }
+
+  bool StructTypeInterface::decodeBinary(void** /*storage*/, detail::BinaryFieldReader& /*in*/)
+  {
+    return false;
+  }
 }
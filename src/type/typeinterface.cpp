@@ -3,9 +3,11 @@
 **  See COPYING for the license
 */
 
+#include <cstring>
 #include <boost/thread/mutex.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/core/typeinfo.hpp>
+#include <boost/functional/hash.hpp>
 
 #include <qi/type/typeinterface.hpp>
 #include <qi/signature.hpp>
@@ -14,6 +16,8 @@
 #include <qi/type/typedispatcher.hpp>
 #include <qi/anyfunction.hpp>
 
+#include "interningtable_p.hpp"
+
 #ifdef __GNUC__
 #include <cxxabi.h>
 #endif
@@ -88,6 +92,73 @@ namespace qi {
       return customInfo < b.customInfo;
   }
 
+  namespace
+  {
+    // Equal infos have the same name, see TypeInfo::operator==.
+    std::size_t hashValue(const TypeInfo& info)
+    {
+      const char* name = info.asCString();
+      return boost::hash_range(name, name + std::strlen(name));
+    }
+
+    struct TypeInfoHash
+    {
+      std::size_t operator()(const TypeInfo& info) const
+      {
+        return hashValue(info);
+      }
+    };
+
+    struct TypeInfoPairHash
+    {
+      std::size_t operator()(const std::pair<TypeInfo, TypeInfo>& infos) const
+      {
+        std::size_t seed = hashValue(infos.first);
+        boost::hash_combine(seed, hashValue(infos.second));
+        return seed;
+      }
+    };
+
+    struct TypeAddressHash
+    {
+      std::size_t operator()(const TypeInterface* type) const
+      {
+        return boost::hash<const TypeInterface*>()(type);
+      }
+
+      std::size_t operator()(const std::pair<TypeInterface*, TypeInterface*>& types) const
+      {
+        std::size_t seed = (*this)(types.first);
+        boost::hash_combine(seed, types.second);
+        return seed;
+      }
+    };
+
+    /** Types built once per element type info.
+     *
+     * Distinct TypeInterface instances may have the same info: the types are
+     * interned by info, and first looked up by the address of the element
+     * type, which is cheaper to hash and compare. Type interfaces are never
+     * destroyed, so an address always designates the same type.
+     */
+    template <typename Type>
+    class ElementTypeTable
+    {
+    public:
+      template <typename Make>
+      Type* get(TypeInterface* element, Make&& make)
+      {
+        return _byAddress.findOrInsert(element, [&] {
+          return _byInfo.findOrInsert(element->info(), std::forward<Make>(make));
+        });
+      }
+
+    private:
+      detail::InterningTable<TypeInterface*, Type*, TypeAddressHash> _byAddress;
+      detail::InterningTable<TypeInfo, Type*, TypeInfoHash> _byInfo;
+    };
+  }
+
   using TypeFactory = std::map<TypeInfo, TypeInterface*>;
   static TypeFactory& typeFactory()
   {
@@ -104,11 +175,17 @@ namespace qi {
     return *res;
   }
 
+  namespace
+  {
+    QI_INSTRUMENTATION_LOCK_NAME(TypeRegistryLockName, "qi.type.registry");
+    using TypeRegistryMutex = detail::InstrumentedMutex<boost::mutex, TypeRegistryLockName>;
+  }
+
   QI_API TypeInterface* getType(const TypeIndex& typeId)
   {
-    static boost::mutex* mutex = nullptr;
+    static TypeRegistryMutex* mutex = nullptr;
     QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock sl(*mutex);
+    TypeRegistryMutex::scoped_lock sl(*mutex);
     static bool fallback = !qi::os::getenv("QI_TYPE_RTTI_FALLBACK").empty();
 
     // We create-if-not-exist on purpose: to detect access that occur before
@@ -752,24 +829,11 @@ namespace qi {
   // We want exactly one instance per element type
   static TypeInterface* makeListIteratorType(TypeInterface* element)
   {
-    static boost::mutex* mutex;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-    static std::map<TypeInfo, TypeInterface*>* map = nullptr;
-    if (!map)
-      map = new std::map<TypeInfo, TypeInterface*>();
-    TypeInfo key = element->info();
-    std::map<TypeInfo, TypeInterface*>::iterator it;
-    TypeInterface* result;
-    it = map->find(key);
-    if (it == map->end())
-    {
-      result = new DefaultListIteratorType(element);
-      (*map)[key] = result;
-    }
-    else
-      result = it->second;
-    return result;
+    static ElementTypeTable<TypeInterface>* table = nullptr;
+    QI_THREADSAFE_NEW(table);
+    return table->get(element, [&]() -> TypeInterface* {
+      return new DefaultListIteratorType(element);
+    });
   }
 
   template <typename T>
@@ -835,11 +899,26 @@ namespace qi {
       src.push_back(_elementType->clone(valueStorage));
     }
 
+    void* emplaceBack(void** storage)
+    {
+      std::vector<void*>& src = *(std::vector<void*>*)ptrFromStorage(storage);
+      src.push_back(_elementType->initializeStorage());
+      return src.back();
+    }
+
     void* element(void* storage, int key)
     {
       std::vector<void*>& src = *(std::vector<void*>*)ptrFromStorage(&storage);
       return src[key];
     }
+
+    bool forEach(void* storage, ListTypeInterface::ElementCallback callback, void* context)
+    {
+      std::vector<void*>& src = *(std::vector<void*>*)ptrFromStorage(&storage);
+      for (void* element : src)
+        callback(context, AnyReference(_elementType, element));
+      return true;
+    }
     const TypeInfo& info()
     {
       return _info;
@@ -875,46 +954,20 @@ namespace qi {
 
   TypeInterface* makeVarArgsType(TypeInterface* element)
   {
-    static boost::mutex* mutex = nullptr;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-    static std::map<TypeInfo, TypeInterface*>* map = nullptr;
-    if (!map)
-      map = new std::map<TypeInfo, TypeInterface*>();
-    TypeInfo key(element->info());
-    std::map<TypeInfo, TypeInterface*>::iterator it;
-    TypeInterface* result;
-    it = map->find(key);
-    if (it == map->end())
-    {
-      result = new DefaultVarArgsType(element);
-      (*map)[key] = result;
-    }
-    else
-      result = it->second;
-    return result;
+    static ElementTypeTable<TypeInterface>* table = nullptr;
+    QI_THREADSAFE_NEW(table);
+    return table->get(element, [&]() -> TypeInterface* {
+      return new DefaultVarArgsType(element);
+    });
   }
     // We want exactly one instance per element type
   TypeInterface* makeListType(TypeInterface* element)
   {
-    static boost::mutex* mutex = nullptr;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-    static std::map<TypeInfo, TypeInterface*>* map = nullptr;
-    if (!map)
-      map = new std::map<TypeInfo, TypeInterface*>();
-    TypeInfo key(element->info());
-    std::map<TypeInfo, TypeInterface*>::iterator it;
-    TypeInterface* result;
-    it = map->find(key);
-    if (it == map->end())
-    {
-      result = new DefaultListType(element);
-      (*map)[key] = result;
-    }
-    else
-      result = it->second;
-    return result;
+    static ElementTypeTable<TypeInterface>* table = nullptr;
+    QI_THREADSAFE_NEW(table);
+    return table->get(element, [&]() -> TypeInterface* {
+      return new DefaultListType(element);
+    });
   }
 
   class DefaultTupleType: public StructTypeInterface
@@ -1117,27 +1170,11 @@ namespace qi {
   // We want exactly one instance per element type
   static TypeInterface* makeMapIteratorType(TypeInterface* te)
   {
-    using Map = std::map<TypeInfo, TypeInterface*>;
-    static boost::mutex* mutex = nullptr;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-
-    static Map * map = nullptr;
-    if (!map)
-      map = new Map();
-    TypeInfo ti(te->info());
-    Map::key_type key(ti);
-    Map::iterator it;
-    TypeInterface* result;
-    it = map->find(key);
-    if (it == map->end())
-    {
-      result = new DefaultMapIteratorType(te);
-      (*map)[key] = result;
-    }
-    else
-      result = it->second;
-    return result;
+    static ElementTypeTable<TypeInterface>* table = nullptr;
+    QI_THREADSAFE_NEW(table);
+    return table->get(te, [&]() -> TypeInterface* {
+      return new DefaultMapIteratorType(te);
+    });
   }
 
   class DefaultMapType: public MapTypeInterface
@@ -1249,6 +1286,17 @@ namespace qi {
       DefaultMapStorage& ptr = *(DefaultMapStorage*) ptrFromStorage(&storage);
       return ptr.size();
     }
+
+    bool forEach(void* storage, ElementCallback callback, void* context) override
+    {
+      DefaultMapStorage& ptr = *(DefaultMapStorage*) ptrFromStorage(&storage);
+      for (const auto& entry : ptr)
+      {
+        std::vector<void*>& pair = _pairType->backend(entry.second);
+        callback(context, AnyReference(_keyType, pair[0]), AnyReference(_elementType, pair[1]));
+      }
+      return true;
+    }
     void destroy(void* storage) override
     {
       DefaultMapStorage& ptr = *(DefaultMapStorage*)ptrFromStorage(&storage);
@@ -1292,30 +1340,18 @@ namespace qi {
   // We want exactly one instance per element type
   TypeInterface* makeMapType(TypeInterface* kt, TypeInterface* et)
   {
-    static boost::mutex* mutex = nullptr;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-
-    using Map = std::map<std::pair<TypeInfo, TypeInfo>, MapTypeInterface*>;
-    static Map * map = nullptr;
-    if (!map)
-      map = new Map();
-    TypeInfo kk(kt->info());
-    TypeInfo ek(et->info());
-    Map::key_type key(kk, ek);
-    Map::iterator it;
-    MapTypeInterface* result;
-    it = map->find(key);
-    if (it == map->end())
-    {
-      result = new DefaultMapType(kt, et);
-      (*map)[key] = result;
-    }
-    else
-    {
-      result = it->second;
-    }
-    return result;
+    using TableByAddress = detail::InterningTable<std::pair<TypeInterface*, TypeInterface*>,
+                                                  MapTypeInterface*, TypeAddressHash>;
+    using TableByInfo = detail::InterningTable<std::pair<TypeInfo, TypeInfo>,
+                                               MapTypeInterface*, TypeInfoPairHash>;
+    static TableByAddress* byAddress = nullptr;
+    static TableByInfo* byInfo = nullptr;
+    QI_THREADSAFE_NEW(byAddress, byInfo);
+    return byAddress->findOrInsert(std::make_pair(kt, et), [&] {
+      return byInfo->findOrInsert(std::make_pair(kt->info(), et->info()), [&]() -> MapTypeInterface* {
+        return new DefaultMapType(kt, et);
+      });
+    });
   }
 
   class DefaultOptionalType : public OptionalTypeInterface
@@ -1414,88 +1450,113 @@ namespace qi {
 
   TypeInterface* makeOptionalType(TypeInterface* value)
   {
-    static boost::mutex mutex;
-    boost::mutex::scoped_lock lock(mutex);
-    static std::map<TypeInfo, TypeInterface*> map;
-
-    const auto typeInfo = value->info();
-    auto it = map.find(typeInfo);
-    if (it == map.end())
-    {
-      auto type = new DefaultOptionalType(value);
-      bool inserted = false;
-      std::tie(it, inserted) = map.emplace(typeInfo, type);
-      if (!inserted)
-        return nullptr;
-    }
-    return it->second;
+    static ElementTypeTable<TypeInterface>* table = nullptr;
+    QI_THREADSAFE_NEW(table);
+    return table->get(value, [&]() -> TypeInterface* {
+      return new DefaultOptionalType(value);
+    });
   }
 
   struct InfosKey
   {
   public:
     InfosKey(const std::vector<TypeInterface*>& types, const std::string &name = std::string(), const std::vector<std::string>& elements = std::vector<std::string>())
-      : _types(types)
-      , _name(name)
+      : _name(name)
       , _elements(elements)
-    {}
-
-    bool operator < (const InfosKey& b) const
     {
-      //check for types
-      if (_types.size() != b._types.size())
-        return _types.size() < b._types.size();
-      for (unsigned i = 0; i < _types.size(); ++i)
-      {
-        if ( _types[i]->info() != b._types[i]->info())
-          return _types[i]->info() < b._types[i]->info();
-      }
+      _infos.reserve(types.size());
+      for (TypeInterface* type : types)
+        _infos.push_back(type->info());
+    }
 
-      //check for name
-      if (_name != b._name)
-        return _name < b._name;
+    bool operator == (const InfosKey& b) const
+    {
+      return _infos == b._infos && _name == b._name && _elements == b._elements;
+    }
 
-      //check for elements
-      if (_elements.size() != b._elements.size())
-        return _elements.size() < b._elements.size();
-      for (unsigned i = 0; i < _elements.size(); ++i)
-      {
-        if ( _elements[i] != b._elements[i])
-          return _elements[i] < b._elements[i];
-      }
-      return false;
+    std::size_t hash() const
+    {
+      std::size_t seed = _infos.size();
+      for (const TypeInfo& info : _infos)
+        boost::hash_combine(seed, hashValue(info));
+      boost::hash_combine(seed, _name);
+      for (const std::string& element : _elements)
+        boost::hash_combine(seed, element);
+      return seed;
     }
 
   private:
-    std::vector<TypeInterface*>       _types;
+    std::vector<TypeInfo>    _infos;
     std::string              _name;
     std::vector<std::string> _elements;
   };
 
-  //TODO: not threadsafe
-  TypeInterface* makeTupleType(const std::vector<TypeInterface*>& types, const std::string &name, const std::vector<std::string>& elementNames)
+  struct InfosKeyHash
   {
-    using Map = std::map<InfosKey, StructTypeInterface*>;
-    static boost::mutex* mutex;
-    QI_THREADSAFE_NEW(mutex);
-    boost::mutex::scoped_lock lock(*mutex);
-    static Map* map = nullptr;
-    if (!map)
-      map = new Map;
-    InfosKey key(types, name, elementNames);
-    Map::iterator it = map->find(key);
-    if (it == map->end())
-    {
-      StructTypeInterface* result = new DefaultTupleType(types, name, elementNames);
-      (*map)[key] = result;
-      return result;
+    std::size_t operator()(const InfosKey& key) const
+    {
+      return key.hash();
     }
-    else
+  };
+
+  // Arguments of makeTupleType, to look up a tuple type without copying them.
+  struct TupleArguments
+  {
+    const std::vector<TypeInterface*>& types;
+    const std::string& name;
+    const std::vector<std::string>& elements;
+  };
+
+  // Key of the tuple types by address of their member types.
+  struct TupleAddressKey
+  {
+    explicit TupleAddressKey(const TupleArguments& args)
+      : types(args.types)
+      , name(args.name)
+      , elements(args.elements)
+    {}
+
+    std::vector<TypeInterface*> types;
+    std::string                 name;
+    std::vector<std::string>    elements;
+  };
+
+  struct TupleAddressHash
+  {
+    std::size_t operator()(const TupleArguments& args) const
     {
-      StructTypeInterface* res = it->second;
-      QI_ASSERT(res->memberTypes().size() == types.size());
-      return res;
+      std::size_t seed = boost::hash_range(args.types.begin(), args.types.end());
+      if (!args.name.empty())
+        boost::hash_combine(seed, args.name);
+      for (const std::string& element : args.elements)
+        boost::hash_combine(seed, element);
+      return seed;
     }
+  };
+
+  struct TupleAddressEqual
+  {
+    bool operator()(const TupleAddressKey& key, const TupleArguments& args) const
+    {
+      return key.types == args.types && key.name == args.name && key.elements == args.elements;
+    }
+  };
+
+  TypeInterface* makeTupleType(const std::vector<TypeInterface*>& types, const std::string &name, const std::vector<std::string>& elementNames)
+  {
+    using TableByAddress = detail::InterningTable<TupleAddressKey, StructTypeInterface*,
+                                                  TupleAddressHash, TupleAddressEqual>;
+    using TableByInfo = detail::InterningTable<InfosKey, StructTypeInterface*, InfosKeyHash>;
+    static TableByAddress* byAddress = nullptr;
+    static TableByInfo* byInfo = nullptr;
+    QI_THREADSAFE_NEW(byAddress, byInfo);
+    StructTypeInterface* res = byAddress->findOrInsert(TupleArguments{ types, name, elementNames }, [&] {
+      return byInfo->findOrInsert(InfosKey(types, name, elementNames), [&]() -> StructTypeInterface* {
+        return new DefaultTupleType(types, name, elementNames);
+      });
+    });
+    QI_ASSERT(res->memberTypes().size() == types.size());
+    return res;
   }
 
   void* ListTypeInterface::element(void* storage, int index)
@@ -1515,6 +1576,21 @@ namespace qi {
     return (*it).rawValue();
   }
 
+  void* ListTypeInterface::emplaceBack(void** /*storage*/)
+  {
+    return nullptr;
+  }
+
+  bool ListTypeInterface::forEach(void* /*storage*/, ElementCallback /*callback*/, void* /*context*/)
+  {
+    return false;
+  }
+
+  bool MapTypeInterface::forEach(void* /*storage*/, ElementCallback /*callback*/, void* /*context*/)
+  {
+    return false;
+  }
+
   namespace detail
   {
     void typeFail(const char* typeName, const char* operation)
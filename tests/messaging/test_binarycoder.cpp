@@ -6,9 +6,12 @@
 */
 
 #include <gtest/gtest.h>
+#include <list>
 #include <map>
+#include <set>
 #include <qi/buffer.hpp>
 #include <qi/binarycodec.hpp>
+#include <qi/lazyanyvalue.hpp>
 #include <qi/session.hpp>
 #include <limits.h>
 
@@ -649,3 +652,389 @@ TEST(testSerializable, Value) {
   qi::encodeBinary(&buf, gv);
   qi::decodeBinary(&bufr, &gv2);
 }
+
+namespace
+{
+  template <typename T>
+  T roundTrip(const T& value)
+  {
+    qi::Buffer buf;
+    qi::encodeBinary(&buf, value);
+    qi::BufferReader bufr(buf);
+    T result;
+    qi::decodeBinary(&bufr, &result);
+    return result;
+  }
+
+  std::string encoded(qi::AutoAnyReference value)
+  {
+    qi::Buffer buf;
+    qi::encodeBinary(&buf, value);
+    return std::string(static_cast<const char*>(buf.data()), buf.size());
+  }
+}
+
+TEST(testSerializable, Containers) {
+  const std::vector<TimeStamp> stamps{ TimeStamp(1, 2), TimeStamp(3, 4) };
+  const std::vector<TimeStamp> stamps2 = roundTrip(stamps);
+  ASSERT_EQ(2u, stamps2.size());
+  EXPECT_EQ(3, stamps2[1].i);
+  EXPECT_EQ(4, stamps2[1].j);
+
+  std::map<std::string, qi::AnyValue> values;
+  values["int"] = qi::AnyValue::from(42);
+  values["string"] = qi::AnyValue::from(std::string("forty-two"));
+  const std::map<std::string, qi::AnyValue> values2 = roundTrip(values);
+  ASSERT_EQ(2u, values2.size());
+  EXPECT_EQ(42, values2.at("int").toInt());
+  EXPECT_EQ("forty-two", values2.at("string").toString());
+
+  const std::set<int> ints{ 3, 1, 2 };
+  EXPECT_EQ(ints, roundTrip(ints));
+  const std::list<std::string> strings{ "a", "b" };
+  EXPECT_EQ(strings, roundTrip(strings));
+  const std::map<int, std::vector<std::string>> nested{ { 1, { "a" } }, { 2, { "b", "c" } } };
+  EXPECT_EQ(nested, roundTrip(nested));
+}
+
+TEST(testSerializable, DynamicContainersEncodeAsStaticOnes) {
+  const std::map<std::string, std::vector<TimeStamp>> value{ { "a", { TimeStamp(1, 2) } },
+                                                             { "b", { TimeStamp(3, 4), TimeStamp(5, 6) } } };
+  const std::string expected = encoded(value);
+
+  // The types built from a signature are the dynamic list, map and tuple
+  // types.
+  qi::AnyValue dynamic(qi::TypeInterface::fromSignature(qi::typeOf(value)->signature()));
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, value);
+  qi::BufferReader bufr(buf);
+  qi::decodeBinary(&bufr, dynamic.asReference());
+  EXPECT_NE(qi::typeOf(value)->info(), dynamic.type()->info());
+  EXPECT_EQ(expected, encoded(dynamic.asReference()));
+
+  qi::AnyVarArguments args;
+  args(1)(2);
+  qi::Buffer argsBuf;
+  qi::encodeBinary(&argsBuf, args);
+  qi::BufferReader argsReader(argsBuf);
+  std::vector<qi::AnyValue> decodedArgs;
+  qi::decodeBinary(&argsReader, &decodedArgs);
+  ASSERT_EQ(2u, decodedArgs.size());
+  EXPECT_EQ(2, decodedArgs[1].toInt());
+}
+
+struct AllFields
+{
+  bool b;
+  char c;
+  unsigned char uc;
+  short s;
+  unsigned short us;
+  int i;
+  unsigned int ui;
+  long l;
+  unsigned long ul;
+  long long ll;
+  unsigned long long ull;
+  float f;
+  double d;
+  std::string str;
+  std::vector<int> ints;
+  std::vector<std::string> strings;
+  TimeStamp stamp;
+  std::vector<TimeStamp> stamps;
+  qi::AnyValue any;
+  std::map<std::string, int> counts;
+};
+QI_TYPE_STRUCT(AllFields, b, c, uc, s, us, i, ui, l, ul, ll, ull, f, d, str, ints, strings,
+               stamp, stamps, any, counts);
+
+namespace
+{
+  AllFields makeAllFields()
+  {
+    AllFields value;
+    value.b = true;
+    value.c = 'c';
+    value.uc = UCHAR_MAX;
+    value.s = SHRT_MIN;
+    value.us = USHRT_MAX;
+    value.i = -42;
+    value.ui = UINT_MAX;
+    value.l = LONG_MIN;
+    value.ul = ULONG_MAX;
+    value.ll = LLONG_MIN;
+    value.ull = ULLONG_MAX;
+    value.f = 23.5f;
+    value.d = 42.42;
+    value.str = "string";
+    value.ints = { 1, 2, 3 };
+    value.strings = { "", "a", "bc" };
+    value.stamp = TimeStamp(1, 2);
+    value.stamps = { TimeStamp(3, 4), TimeStamp(5, 6) };
+    value.any = qi::AnyValue::from(std::vector<float>{ 1.5f });
+    value.counts["a"] = 1;
+    return value;
+  }
+}
+
+TEST(testSerializable, StructsEncodeAsDynamicTuples) {
+  const AllFields value = makeAllFields();
+  const std::string expected = encoded(value);
+
+  // The tuple type built from the signature encodes and decodes each field
+  // through the generic codec.
+  qi::AnyValue dynamic(qi::TypeInterface::fromSignature(qi::typeOf(value)->signature()));
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, value);
+  qi::BufferReader bufr(buf);
+  qi::decodeBinary(&bufr, dynamic.asReference());
+  EXPECT_EQ(expected, encoded(dynamic.asReference()));
+
+  const AllFields decoded = roundTrip(value);
+  EXPECT_EQ(value.b, decoded.b);
+  EXPECT_EQ(value.c, decoded.c);
+  EXPECT_EQ(value.uc, decoded.uc);
+  EXPECT_EQ(value.s, decoded.s);
+  EXPECT_EQ(value.us, decoded.us);
+  EXPECT_EQ(value.i, decoded.i);
+  EXPECT_EQ(value.ui, decoded.ui);
+  EXPECT_EQ(value.l, decoded.l);
+  EXPECT_EQ(value.ul, decoded.ul);
+  EXPECT_EQ(value.ll, decoded.ll);
+  EXPECT_EQ(value.ull, decoded.ull);
+  EXPECT_EQ(value.f, decoded.f);
+  EXPECT_EQ(value.d, decoded.d);
+  EXPECT_EQ(value.str, decoded.str);
+  EXPECT_EQ(value.ints, decoded.ints);
+  EXPECT_EQ(value.strings, decoded.strings);
+  EXPECT_EQ(2, decoded.stamp.j);
+  ASSERT_EQ(2u, decoded.stamps.size());
+  EXPECT_EQ(5, decoded.stamps[1].i);
+  EXPECT_EQ(value.any, decoded.any);
+  EXPECT_EQ(value.counts, decoded.counts);
+
+  // And the tuple read by the generic decoder is read back by the struct.
+  qi::Buffer dynamicBuf;
+  qi::encodeBinary(&dynamicBuf, dynamic.asReference());
+  qi::BufferReader dynamicReader(dynamicBuf);
+  AllFields fromDynamic;
+  qi::decodeBinary(&dynamicReader, &fromDynamic);
+  EXPECT_EQ(value.strings, fromDynamic.strings);
+  EXPECT_EQ(value.counts, fromDynamic.counts);
+}
+
+TEST(testSerializable, TruncatedStructsThrow) {
+  const std::string data = encoded(makeAllFields());
+  for (std::size_t size = 0; size < data.size(); ++size)
+  {
+    qi::Buffer buf;
+    buf.write(data.data(), size);
+    qi::BufferReader bufr(buf);
+    AllFields decoded;
+    EXPECT_THROW(qi::decodeBinary(&bufr, &decoded), std::runtime_error) << "size " << size;
+  }
+}
+
+TEST(testSerializable, DecodingReplacesTheFieldsOfStructs) {
+  const AllFields value = makeAllFields();
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, value);
+  qi::BufferReader bufr(buf);
+
+  AllFields decoded = makeAllFields();
+  decoded.ints = { 4 };
+  decoded.counts["b"] = 2;
+  decoded.stamps.clear();
+  qi::decodeBinary(&bufr, &decoded);
+  EXPECT_EQ(value.ints, decoded.ints);
+  EXPECT_EQ(value.counts, decoded.counts);
+  EXPECT_EQ(2u, decoded.stamps.size());
+}
+
+// A temperature without default constructor, registered as a float that
+// starts at 0 degrees.
+class Celsius
+{
+public:
+  explicit Celsius(double degrees)
+    : degrees(degrees)
+  {}
+
+  double degrees;
+};
+
+namespace qi
+{
+  namespace detail
+  {
+    template<>
+    struct TypeManager<Celsius> : public TypeManagerNotConstructible<Celsius>
+    {
+      static void* create() { return new Celsius(0); }
+      static void createInPlace(void* ptr) { new (ptr) Celsius(0); }
+    };
+  }
+
+  template<>
+  class TypeImpl<Celsius> : public FloatTypeInterface
+  {
+  public:
+    using Impl = DefaultTypeImplMethods<Celsius>;
+
+    double get(void* storage) override
+    {
+      return static_cast<Celsius*>(Impl::ptrFromStorage(&storage))->degrees;
+    }
+
+    void set(void** storage, double value) override
+    {
+      static_cast<Celsius*>(Impl::ptrFromStorage(storage))->degrees = value;
+    }
+
+    unsigned int size() override
+    {
+      return sizeof(double);
+    }
+
+    _QI_BOUNCE_TYPE_METHODS(Impl);
+  };
+}
+
+struct Reading
+{
+  Reading()
+    : temperature(0)
+  {}
+
+  std::string sensor;
+  Celsius temperature;
+  std::vector<int> samples;
+};
+QI_TYPE_STRUCT(Reading, sensor, temperature, samples);
+
+TEST(testSerializable, StructsWithFieldsNotDefaultConstructibleUseTheGenericDecoder) {
+  Reading value;
+  value.sensor = "head";
+  value.temperature = Celsius(36.5);
+  value.samples = { 1, 2 };
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, value);
+  qi::BufferReader bufr(buf);
+
+  Reading decoded;
+  decoded.samples = { 3 };
+  qi::decodeBinary(&bufr, &decoded);
+  EXPECT_EQ(value.sensor, decoded.sensor);
+  EXPECT_EQ(36.5, decoded.temperature.degrees);
+  EXPECT_EQ(value.samples, decoded.samples);
+}
+
+TEST(testSerializable, DuplicateMapKeysKeepTheLastValue) {
+  // A list of pairs is encoded as a map with the same keys.
+  using Entries = std::vector<std::pair<std::string, std::vector<int>>>;
+  const Entries entries{ { "a", { 1 } }, { "b", { 2 } }, { "a", { 3, 4 } } };
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, entries);
+
+  using Map = std::map<std::string, std::vector<int>>;
+  qi::BufferReader bufr(buf);
+  Map decoded;
+  qi::decodeBinary(&bufr, &decoded);
+  const Map expected{ { "a", { 3, 4 } }, { "b", { 2 } } };
+  EXPECT_EQ(expected, decoded);
+
+  qi::AnyValue dynamic(qi::TypeInterface::fromSignature(qi::typeOf(decoded)->signature()));
+  qi::BufferReader dynamicReader(buf);
+  qi::decodeBinary(&dynamicReader, dynamic.asReference());
+  EXPECT_EQ(expected, dynamic.to<Map>());
+}
+
+TEST(testSerializable, DynamicValuesInContainers) {
+  std::vector<qi::AnyValue> values;
+  values.push_back(qi::AnyValue::from(42));
+  values.push_back(qi::AnyValue::from(std::vector<TimeStamp>{ TimeStamp(1, 2) }));
+  values.push_back(qi::AnyValue::from(std::vector<qi::AnyValue>{
+      qi::AnyValue::from(std::string("nested")), qi::AnyValue() }));
+  values.push_back(qi::AnyValue());
+  std::vector<qi::AnyValue> values2 = roundTrip(values);
+  ASSERT_EQ(4u, values2.size());
+  EXPECT_EQ(42, values2[0].toInt());
+  EXPECT_EQ("nested", values2[2][0].toString());
+  EXPECT_FALSE(values2[3].isValid());
+  EXPECT_EQ(encoded(values), encoded(values2));
+}
+
+TEST(testSerializable, LazyValuesAreForwardedWithoutDecoding) {
+  const std::map<std::string, std::vector<TimeStamp>> content{ { "a", { TimeStamp(1, 2) } } };
+  const std::pair<std::string, qi::AnyValue> message("topic", qi::AnyValue::from(content));
+  const std::string expected = encoded(message);
+
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, message);
+  qi::BufferReader bufr(buf);
+  std::pair<std::string, qi::LazyAnyValue> lazy;
+  qi::decodeBinary(&bufr, &lazy);
+  EXPECT_EQ("topic", lazy.first);
+  EXPECT_EQ(qi::typeOf(content)->signature(), lazy.second.signature());
+  EXPECT_FALSE(lazy.second.isDecoded());
+  EXPECT_EQ(expected, encoded(lazy));
+  EXPECT_FALSE(lazy.second.isDecoded());
+
+  const qi::LazyAnyValue copy = lazy.second;
+  EXPECT_EQ(expected, encoded(std::make_pair(lazy.first, copy.value())));
+  EXPECT_TRUE(lazy.second.isDecoded());
+  EXPECT_EQ(expected, encoded(lazy));
+
+  // Values built from a value are encoded as dynamic values.
+  const std::pair<std::string, qi::LazyAnyValue> built("topic", qi::LazyAnyValue(message.second));
+  EXPECT_EQ(expected, encoded(built));
+}
+
+TEST(testSerializable, LazyValuesDecodeTheElementsThatAreRead) {
+  std::map<std::string, qi::AnyValue> content;
+  content["int"] = qi::AnyValue::from(42);
+  content["string"] = qi::AnyValue::from(std::string("forty-two"));
+  const std::vector<qi::AnyValue> values{ qi::AnyValue::from(content), qi::AnyValue() };
+
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, values);
+  qi::BufferReader bufr(buf);
+  std::vector<qi::LazyAnyValue> lazy;
+  qi::decodeBinary(&bufr, &lazy);
+  ASSERT_EQ(2u, lazy.size());
+  EXPECT_FALSE(lazy[1].isValid());
+
+  const auto entries = lazy[0].to<std::map<std::string, qi::LazyAnyValue>>();
+  EXPECT_FALSE(lazy[0].isDecoded());
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ(42, entries.at("int").to<int>());
+  EXPECT_FALSE(entries.at("string").isDecoded());
+  EXPECT_EQ("forty-two", entries.at("string").value().toString());
+  EXPECT_EQ(42, qi::AnyValue::from(lazy[0]).content()["int"].toInt());
+  EXPECT_EQ(encoded(values), encoded(lazy));
+}
+
+TEST(testSerializable, LazyValuesThatCannotBeSkippedAreDecoded) {
+  qi::Buffer raw;
+  raw.write("raw", 3);
+  const std::vector<qi::AnyValue> values{ qi::AnyValue::from(raw) };
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, values);
+  qi::BufferReader bufr(buf);
+  std::vector<qi::LazyAnyValue> lazy;
+  qi::decodeBinary(&bufr, &lazy);
+  ASSERT_EQ(1u, lazy.size());
+  EXPECT_TRUE(lazy[0].isDecoded());
+  EXPECT_EQ(3u, lazy[0].value().to<qi::Buffer>().size());
+
+  const std::string data = encoded(std::vector<qi::AnyValue>{ qi::AnyValue::from(std::string("abc")) });
+  for (std::size_t size = 0; size < data.size(); ++size)
+  {
+    qi::Buffer truncated;
+    truncated.write(data.data(), size);
+    qi::BufferReader reader(truncated);
+    std::vector<qi::LazyAnyValue> decoded;
+    EXPECT_THROW(qi::decodeBinary(&reader, &decoded), std::runtime_error) << "size " << size;
+  }
+}
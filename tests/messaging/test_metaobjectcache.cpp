@@ -0,0 +1,131 @@
+/*
+** Copyright (C) 2018 Softbank Robotics Europe
+** See COPYING for the license
+*/
+
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <qi/os.hpp>
+#include <qi/path.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <src/messaging/metaobjectcache.hpp>
+
+namespace
+{
+  int answer()
+  {
+    return 42;
+  }
+
+  std::string echo(const std::string& s)
+  {
+    return s;
+  }
+
+  qi::MetaObject makeMetaObject(bool withEcho)
+  {
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("answer", &answer);
+    if (withEcho)
+      builder.advertiseMethod("echo", &echo);
+    builder.advertiseSignal<int>("changed");
+    return builder.object().metaObject();
+  }
+
+  struct TemporaryDirectory
+  {
+    TemporaryDirectory()
+      : path(qi::os::mktmpdir("metaobjectcache"))
+    {
+    }
+
+    ~TemporaryDirectory()
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove_all(qi::Path(path).bfsPath(), ec);
+    }
+
+    std::string path;
+  };
+}
+
+TEST(TestMetaObjectCache, HashIdentifiesContent)
+{
+  const qi::MetaObject mo = makeMetaObject(true);
+  const std::string hash = qi::MetaObjectCache::hash(mo);
+  EXPECT_EQ(40u, hash.size());
+  EXPECT_EQ(hash, qi::MetaObjectCache::hash(makeMetaObject(true)));
+  EXPECT_NE(hash, qi::MetaObjectCache::hash(makeMetaObject(false)));
+}
+
+TEST(TestMetaObjectCache, MemoryOnly)
+{
+  qi::MetaObjectCache cache;
+  const qi::MetaObject mo = makeMetaObject(true);
+  const std::string hash = qi::MetaObjectCache::hash(mo);
+  EXPECT_FALSE(cache.find(hash));
+  cache.insert(hash, mo);
+  const auto found = cache.find(hash);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(hash, qi::MetaObjectCache::hash(*found));
+}
+
+TEST(TestMetaObjectCache, PersistsOnDisk)
+{
+  TemporaryDirectory dir;
+  const qi::MetaObject mo = makeMetaObject(true);
+  const std::string hash = qi::MetaObjectCache::hash(mo);
+  {
+    qi::MetaObjectCache cache(dir.path);
+    cache.insert(hash, mo);
+  }
+  qi::MetaObjectCache cache(dir.path);
+  const auto found = cache.find(hash);
+  ASSERT_TRUE(found);
+  EXPECT_EQ(hash, qi::MetaObjectCache::hash(*found));
+  EXPECT_TRUE(found->findMethod("echo").size() == 1u);
+}
+
+TEST(TestMetaObjectCache, CorruptedFileIsDiscarded)
+{
+  TemporaryDirectory dir;
+  const std::string hash = qi::MetaObjectCache::hash(makeMetaObject(true));
+  const boost::filesystem::path file = qi::Path(dir.path).bfsPath() / hash;
+  {
+    boost::filesystem::ofstream output(file);
+    output << "not a metaobject";
+  }
+  qi::MetaObjectCache cache(dir.path);
+  EXPECT_FALSE(cache.find(hash));
+  EXPECT_FALSE(boost::filesystem::exists(file));
+}
+
+TEST(TestMetaObjectCache, FileOfAnotherHashIsDiscarded)
+{
+  TemporaryDirectory dir;
+  const std::string hash = qi::MetaObjectCache::hash(makeMetaObject(true));
+  const qi::MetaObject other = makeMetaObject(false);
+  const std::string otherHash = qi::MetaObjectCache::hash(other);
+  {
+    qi::MetaObjectCache cache(dir.path);
+    cache.insert(otherHash, other);
+  }
+  // A valid metaobject, stored under the wrong hash.
+  const boost::filesystem::path file = qi::Path(dir.path).bfsPath() / hash;
+  boost::filesystem::rename(qi::Path(dir.path).bfsPath() / otherHash, file);
+
+  qi::MetaObjectCache cache(dir.path);
+  EXPECT_FALSE(cache.find(hash));
+  EXPECT_FALSE(boost::filesystem::exists(file));
+}
+
+TEST(TestMetaObjectCache, InvalidHashIsIgnored)
+{
+  TemporaryDirectory dir;
+  qi::MetaObjectCache cache(dir.path);
+  const qi::MetaObject mo = makeMetaObject(true);
+  cache.insert("../escape", mo);
+  EXPECT_FALSE(cache.find("../escape"));
+  EXPECT_TRUE(boost::filesystem::is_empty(qi::Path(dir.path).bfsPath()));
+}
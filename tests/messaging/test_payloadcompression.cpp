@@ -0,0 +1,207 @@
+/*
+** Copyright (C) 2018 Softbank Robotics Europe
+** See COPYING for the license
+*/
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <src/messaging/payloadcompression.hpp>
+#include <src/buffer_p.hpp>
+
+namespace
+{
+  // A stream context where both ends advertised the given algorithms.
+  struct CompressionStreamContext : qi::StreamContext
+  {
+    CompressionStreamContext(const std::string& local, const std::string& remote)
+    {
+      _localCapabilityMap[qi::capabilityname::payloadCompression] = qi::AnyValue::from(local);
+      _remoteCapabilityMap[qi::capabilityname::payloadCompression] = qi::AnyValue::from(remote);
+    }
+  };
+
+  std::string makeText(std::size_t size, int seed)
+  {
+    static const std::string words[] = { "robot", "service", "signal", "property", "session" };
+    std::string res;
+    for (int i = seed; res.size() < size; ++i)
+      res += words[i % 5] + std::to_string(i % 17) + ' ';
+    res.resize(size);
+    return res;
+  }
+
+  qi::Message makeMessage(const std::string& text, bool withSubBuffer = false)
+  {
+    qi::Message msg(qi::Message::Type_Call, qi::MessageAddress{1, 2, 3, 100});
+    qi::Buffer payload;
+    if (withSubBuffer)
+    {
+      const std::size_t half = text.size() / 2;
+      payload.write(text.data(), half);
+      qi::Buffer sub;
+      sub.write(text.data() + half, text.size() - half);
+      payload.addSubBuffer(sub);
+    }
+    else
+      payload.write(text.data(), text.size());
+    msg.setBuffer(payload);
+    return msg;
+  }
+
+  std::string payloadOf(const qi::Message& msg)
+  {
+    const qi::Buffer& buffer = msg.buffer();
+    return std::string(static_cast<const char*>(buffer.data()), buffer.size());
+  }
+
+  // The payload as sent on the network, and thus as received.
+  std::string wirePayloadOf(const qi::Message& msg)
+  {
+    std::string res;
+    qi::BufferPrivate::forEachWireChunk(msg.buffer(), [&](const char* data, std::size_t size) {
+      res.append(data, size);
+    });
+    return res;
+  }
+}
+
+TEST(TestPayloadCompression, Negotiation)
+{
+  using Algorithm = qi::PayloadCompressor::Algorithm;
+  EXPECT_EQ(Algorithm::Zlib, qi::PayloadCompressor::negotiate(CompressionStreamContext{"zlib", "zlib"}));
+  EXPECT_EQ(Algorithm::Zlib, qi::PayloadCompressor::negotiate(CompressionStreamContext{"lz4, zlib", "zstd,zlib"}));
+  EXPECT_EQ(Algorithm::None, qi::PayloadCompressor::negotiate(CompressionStreamContext{"zlib", "zstd"}));
+  EXPECT_EQ(Algorithm::None, qi::PayloadCompressor::negotiate(CompressionStreamContext{"zlib", ""}));
+  EXPECT_EQ(Algorithm::None, qi::PayloadCompressor::negotiate(qi::StreamContext{}));
+}
+
+TEST(TestPayloadCompression, SmallMessageIsNotCompressed)
+{
+  qi::PayloadCompressor compressor;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::Message msg = makeMessage("small");
+  const qi::Message original = msg;
+  EXPECT_FALSE(compressor.compress(msg, context));
+  EXPECT_EQ(original, msg);
+}
+
+TEST(TestPayloadCompression, SharedMemoryPayloadIsNotCompressed)
+{
+  qi::PayloadCompressor compressor;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::Message msg = makeMessage(makeText(qi::PayloadCompressor::threshold(), 0));
+  msg.addFlags(qi::Message::TypeFlag_SharedMemoryPayload);
+  EXPECT_FALSE(compressor.compress(msg, context));
+}
+
+TEST(TestPayloadCompression, StreamOfMessages)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::resetPayloadCompressionStats();
+
+  for (int i = 0; i < 10; ++i)
+  {
+    const std::string text = makeText(qi::PayloadCompressor::threshold() + i * 1000, i);
+    qi::Message msg = makeMessage(text, i % 2 == 0);
+    const std::string wire = wirePayloadOf(msg);
+    ASSERT_TRUE(sender.compress(msg, context));
+    EXPECT_TRUE(msg.flags() & qi::Message::TypeFlag_CompressedPayload);
+    EXPECT_LT(msg.buffer().totalSize(), text.size());
+
+    ASSERT_TRUE(receiver.decompress(msg, context));
+    EXPECT_FALSE(msg.flags() & qi::Message::TypeFlag_CompressedPayload);
+    EXPECT_EQ(wire, payloadOf(msg));
+    EXPECT_EQ(wire.size(), msg.header().size);
+  }
+
+  const qi::PayloadCompressionStats stats = qi::payloadCompressionStats();
+  EXPECT_EQ(10u, stats.compressedMessages);
+  EXPECT_EQ(10u, stats.decompressedMessages);
+  EXPECT_LT(stats.ratio(), 0.5);
+}
+
+TEST(TestPayloadCompression, OutOfOrderStreamFails)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+
+  qi::Message first = makeMessage(makeText(qi::PayloadCompressor::threshold(), 0));
+  qi::Message second = makeMessage(makeText(qi::PayloadCompressor::threshold(), 0));
+  ASSERT_TRUE(sender.compress(first, context));
+  ASSERT_TRUE(sender.compress(second, context));
+  // The second message refers to the history of the first one.
+  EXPECT_FALSE(receiver.decompress(second, context));
+}
+
+TEST(TestPayloadCompression, ResetRestartsStreams)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  const std::string text = makeText(qi::PayloadCompressor::threshold(), 3);
+
+  qi::Message lost = makeMessage(text);
+  ASSERT_TRUE(sender.compress(lost, context));
+  sender.reset();
+
+  qi::Message msg = makeMessage(text);
+  ASSERT_TRUE(sender.compress(msg, context));
+  ASSERT_TRUE(receiver.decompress(msg, context));
+  EXPECT_EQ(text, payloadOf(msg));
+}
+
+TEST(TestPayloadCompression, InvalidPayloadFails)
+{
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::Message msg = makeMessage("garbage that is not a compressed payload");
+  msg.addFlags(qi::Message::TypeFlag_CompressedPayload);
+  EXPECT_FALSE(receiver.decompress(msg, context));
+}
+
+TEST(TestPayloadCompression, DecompressionRequiresNegotiation)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::Message msg = makeMessage(makeText(qi::PayloadCompressor::threshold(), 0));
+  ASSERT_TRUE(sender.compress(msg, context));
+  EXPECT_FALSE(receiver.decompress(msg, qi::StreamContext{}));
+  EXPECT_FALSE(receiver.decompress(msg, CompressionStreamContext{"zlib", "zstd"}));
+}
+
+TEST(TestPayloadCompression, DeclaredSizeAboveMaximumFails)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  const std::string text = makeText(qi::PayloadCompressor::threshold(), 0);
+  qi::Message msg = makeMessage(text);
+  ASSERT_TRUE(sender.compress(msg, context));
+  EXPECT_FALSE(receiver.decompress(msg, context, text.size() - 1));
+}
+
+TEST(TestPayloadCompression, DeclaredSizeIsNotTrusted)
+{
+  qi::PayloadCompressor sender;
+  qi::PayloadCompressor receiver;
+  CompressionStreamContext context{"zlib", "zlib"};
+  qi::Message msg = makeMessage(makeText(qi::PayloadCompressor::threshold(), 0));
+  ASSERT_TRUE(sender.compress(msg, context));
+
+  // Declare a much larger original size than the compressed data holds: the
+  // decompression fails without allocating the declared size.
+  std::string payload = payloadOf(msg);
+  const qi::uint64_t declared = std::numeric_limits<qi::uint32_t>::max();
+  std::memcpy(&payload[1], &declared, sizeof(declared));
+  qi::Buffer forged;
+  forged.write(payload.data(), payload.size());
+  msg.setBuffer(forged);
+  EXPECT_FALSE(receiver.decompress(msg, context));
+}
@@ -9,6 +9,7 @@
 #include <qi/session.hpp>
 #include <qi/testutils/testutils.hpp>
 #include <qi/type/dynamicobjectbuilder.hpp>
+#include <src/messaging/servicedirectorychange.hpp>
 
 extern std::string simpleSdPath;
 extern std::string mirrorSdPath;
@@ -276,3 +277,107 @@ TEST(ServiceDirectory, IsNotConnectedAfterClose)
   session->close();
   ASSERT_FALSE(session->isConnected());
 }
+
+TEST(ServiceDirectory, ChangesSinceReturnsDeltas)
+{
+  auto sd = qi::makeSession();
+  sd->listenStandalone("tcp://127.0.0.1:0");
+  auto client = qi::makeSession();
+  client->connect(sd->url());
+  qi::AnyObject sdObject = client->service("ServiceDirectory").value();
+
+  // A client that never synchronized gets all the services.
+  const auto initial = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", qi::uint64_t(0), qi::uint64_t(0));
+  EXPECT_NE(0u, initial.epoch);
+  EXPECT_TRUE(initial.reset);
+  EXPECT_FALSE(initial.changes.empty());
+
+  const auto id = sd->registerService("Serv", boost::make_shared<Serv>()).value();
+  const auto added = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", initial.epoch, initial.version);
+  EXPECT_EQ(initial.epoch, added.epoch);
+  EXPECT_FALSE(added.reset);
+  ASSERT_EQ(1u, added.changes.size());
+  EXPECT_EQ(qi::ServiceDirectoryChange::Kind_Added, added.changes[0].kind);
+  EXPECT_EQ(id, added.changes[0].serviceInfo.serviceId());
+  EXPECT_EQ(added.version, added.changes[0].version);
+
+  sd->unregisterService(id).value();
+  const auto removed = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", added.epoch, added.version);
+  ASSERT_EQ(1u, removed.changes.size());
+  EXPECT_EQ(qi::ServiceDirectoryChange::Kind_Removed, removed.changes[0].kind);
+  EXPECT_EQ("Serv", removed.changes[0].serviceInfo.name());
+  EXPECT_EQ(added.version + 1, removed.version);
+
+  const auto upToDate = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", removed.epoch, removed.version);
+  EXPECT_FALSE(upToDate.reset);
+  EXPECT_TRUE(upToDate.changes.empty());
+}
+
+TEST(ServiceDirectory, ChangesSinceUnknownVersionResets)
+{
+  auto sd = qi::makeSession();
+  sd->listenStandalone("tcp://127.0.0.1:0");
+  sd->registerService("Serv", boost::make_shared<Serv>()).value();
+  qi::AnyObject sdObject = sd->service("ServiceDirectory").value();
+
+  const auto current = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", qi::uint64_t(0), qi::uint64_t(0));
+  const auto snapshot = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", current.epoch, qi::uint64_t(-1));
+  EXPECT_TRUE(snapshot.reset);
+  ASSERT_EQ(sd->services().value().size(), snapshot.changes.size());
+  for (const auto& change : snapshot.changes)
+    EXPECT_EQ(qi::ServiceDirectoryChange::Kind_Added, change.kind);
+}
+
+TEST(ServiceDirectory, ChangesSinceAnotherEpochResets)
+{
+  auto sd = qi::makeSession();
+  sd->listenStandalone("tcp://127.0.0.1:0");
+  qi::AnyObject sdObject = sd->service("ServiceDirectory").value();
+  const auto current = sdObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", qi::uint64_t(0), qi::uint64_t(0));
+
+  // The same version, numbered by a service directory that since restarted.
+  auto restarted = qi::makeSession();
+  restarted->listenStandalone("tcp://127.0.0.1:0");
+  qi::AnyObject restartedObject = restarted->service("ServiceDirectory").value();
+  const auto changes = restartedObject.call<qi::ServiceDirectoryChanges>(
+      "changesSince", current.epoch, current.version);
+  EXPECT_NE(current.epoch, changes.epoch);
+  EXPECT_TRUE(changes.reset);
+  EXPECT_EQ(restarted->services().value().size(), changes.changes.size());
+}
+
+TEST(ServiceDirectory, ServiceChangedIsStreamedInOrder)
+{
+  auto sd = qi::makeSession();
+  sd->listenStandalone("tcp://127.0.0.1:0");
+  auto client = qi::makeSession();
+  client->connect(sd->url());
+  qi::AnyObject sdObject = client->service("ServiceDirectory").value();
+
+  boost::mutex mutex;
+  std::vector<qi::ServiceDirectoryChange> received;
+  qi::Promise<void> done;
+  sdObject.connect("serviceChanged", boost::function<void(qi::ServiceDirectoryChange)>(
+      [&](const qi::ServiceDirectoryChange& change) {
+        boost::mutex::scoped_lock lock(mutex);
+        received.push_back(change);
+        if (received.size() == 2u)
+          done.setValue(nullptr);
+      })).value();
+
+  const auto id = sd->registerService("Serv", boost::make_shared<Serv>()).value();
+  sd->unregisterService(id).value();
+  ASSERT_TRUE(test::finishesWithValue(done.future()));
+
+  boost::mutex::scoped_lock lock(mutex);
+  EXPECT_EQ(qi::ServiceDirectoryChange::Kind_Added, received[0].kind);
+  EXPECT_EQ(qi::ServiceDirectoryChange::Kind_Removed, received[1].kind);
+  EXPECT_EQ(received[0].version + 1, received[1].version);
+}
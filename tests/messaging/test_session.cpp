@@ -5,6 +5,7 @@
  ** Copyright (C) 2010, 2012 Aldebaran Robotics
  */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <future>
@@ -23,6 +24,7 @@
 
 #include <testsession/testsessionpair.hpp>
 #include "objectio.hpp"
+#include "src/messaging/metaobjectcache.hpp"
 
 using namespace qi;
 using namespace test;
@@ -425,6 +427,33 @@ TEST(TestSession, Services)
   ASSERT_EQ(5u, clientServices.value().size());
 }
 
+TEST(TestSession, BatchedServices)
+{
+  TestSessionPair sessionPair;
+  auto& server = *sessionPair.server();
+  auto& client = *sessionPair.client();
+
+  auto obj = dummyDynamicObject();
+  ASSERT_TRUE(finishesWithValue(server.registerService("srv1", obj)));
+  ASSERT_TRUE(finishesWithValue(server.registerService("srv2", obj)));
+
+  const std::vector<std::string> names{ "srv1", "unknown", "srv2", "srv1" };
+  auto futures = client.resolveServices(names);
+  ASSERT_EQ(names.size(), futures.size());
+  AnyObject srv1;
+  AnyObject srv2;
+  ASSERT_TRUE(finishesWithValue(futures[0], willAssignValue(srv1)));
+  ASSERT_TRUE(finishesWithError(futures[1]));
+  ASSERT_TRUE(finishesWithValue(futures[2], willAssignValue(srv2)));
+  ASSERT_TRUE(finishesWithValue(futures[3]));
+
+  // The resolved services are the ones returned by `service`.
+  EXPECT_EQ(srv1.asGenericObject(), futures[3].value().asGenericObject());
+  EXPECT_EQ(srv1.asGenericObject(), client.service("srv1").value().asGenericObject());
+  EXPECT_EQ(srv2.asGenericObject(), client.service("srv2").value().asGenericObject());
+  EXPECT_EQ("ping", srv1.call<std::string>("reply", "ping"));
+}
+
 TEST(TestSession, ServiceDirectoryEndpointsAreValid)
 {
   auto session = qi::makeSession();
@@ -629,3 +658,90 @@ TEST(TestSession, WaitForServiceCanceled)
   future.cancel();
   ASSERT_TRUE(finishesAsCanceled(future));
 }
+
+namespace
+{
+  // The metaobjects are cached on disk across runs: unique method names keep
+  // the tests from finding those of a previous run.
+  std::string uniqueMethodName(const std::string& prefix)
+  {
+    std::string name = prefix + qi::os::generateUuid();
+    std::replace(name.begin(), name.end(), '-', '_');
+    return name;
+  }
+
+  DynamicObjectBuilder& advertiseReplies(DynamicObjectBuilder& builder,
+                                         const std::vector<std::string>& names)
+  {
+    for (const auto& name : names)
+      builder.advertiseMethod(name, &reply);
+    return builder;
+  }
+
+  AnyObject connectedService(const SessionPtr& server, const std::string& name)
+  {
+    auto client = qi::makeSession();
+    if (!finishesWithValue(client->connect(test::url(*server))))
+      return {};
+    return client->service(name).value();
+  }
+}
+
+TEST(TestSession, CachedMetaObjectIsNotFetched)
+{
+  auto server = qi::makeSession();
+  ASSERT_TRUE(finishesWithValue(server->listenStandalone(test::defaultListenUrl())));
+  const std::string method = uniqueMethodName("reply");
+  DynamicObjectBuilder builder;
+  ASSERT_TRUE(finishesWithValue(
+      server->registerService("CachedService", advertiseReplies(builder, { method }).object())));
+
+  // The first client fetches the metaobject, and caches it as its hash matches.
+  const AnyObject first = connectedService(server, "CachedService");
+  ASSERT_TRUE(first);
+  const std::string hash = MetaObjectCache::hash(first.metaObject());
+  ASSERT_TRUE(MetaObjectCache::instance().find(hash));
+
+  // Replace the cached metaobject by a marked one: a client that fetches the
+  // metaobject would not see the mark.
+  const std::string mark = uniqueMethodName("mark");
+  DynamicObjectBuilder marked;
+  advertiseReplies(marked, { method, mark });
+  MetaObjectCache::instance().insert(hash, marked.object().metaObject());
+
+  const AnyObject second = connectedService(server, "CachedService");
+  ASSERT_TRUE(second);
+  EXPECT_EQ(1u, second.metaObject().findMethod(mark).size());
+}
+
+TEST(TestSession, MetaObjectNotMatchingItsAdvertisedHashIsNotCached)
+{
+  auto server = qi::makeSession();
+  ASSERT_TRUE(finishesWithValue(server->listenStandalone(test::defaultListenUrl())));
+  const std::string method = uniqueMethodName("reply");
+  const std::string late = uniqueMethodName("late");
+
+  // The hash is advertised on registration: changing the metaobject afterwards
+  // makes the server advertise the hash of another metaobject.
+  DynamicObjectBuilder original;
+  auto lying = new DynamicObject();
+  lying->setMetaObject(advertiseReplies(original, { method }).object().metaObject());
+  ASSERT_TRUE(finishesWithValue(
+      server->registerService("LyingService", makeDynamicAnyObject(lying))));
+  DynamicObjectBuilder changed;
+  lying->setMetaObject(advertiseReplies(changed, { method, late }).object().metaObject());
+
+  const AnyObject lyingService = connectedService(server, "LyingService");
+  ASSERT_TRUE(lyingService);
+  EXPECT_EQ(1u, lyingService.metaObject().findMethod(late).size());
+
+  // A service whose metaobject really has that hash must not get the one
+  // of the lying service.
+  DynamicObjectBuilder honest;
+  ASSERT_TRUE(finishesWithValue(
+      server->registerService("HonestService", advertiseReplies(honest, { method }).object())));
+  const AnyObject honestService = connectedService(server, "HonestService");
+  ASSERT_TRUE(honestService);
+  EXPECT_EQ(1u, honestService.metaObject().findMethod(method).size());
+  EXPECT_TRUE(honestService.metaObject().findMethod(late).empty());
+}
@@ -0,0 +1,202 @@
+/*
+** Copyright (C) 2018 Softbank Robotics Europe
+** See COPYING for the license
+*/
+
+#include <vector>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/lexical_cast.hpp>
+#include <gtest/gtest.h>
+#include <qi/os.hpp>
+#include <src/messaging/sharedmemorypayload.hpp>
+
+namespace
+{
+  // A stream context whose remote end advertised the given capability value.
+  struct LocalStreamContext : qi::StreamContext
+  {
+    explicit LocalStreamContext(const std::string& remoteMachineId)
+    {
+      _localCapabilityMap[qi::capabilityname::sharedMemoryPayload] =
+          qi::AnyValue::from(qi::os::getMachineId());
+      _remoteCapabilityMap[qi::capabilityname::sharedMemoryPayload] =
+          qi::AnyValue::from(remoteMachineId);
+    }
+  };
+
+  qi::Message makeLargeMessage(std::size_t size)
+  {
+    qi::Message msg(qi::Message::Type_Call, qi::MessageAddress{1, 2, 3, 100});
+    std::vector<char> data(size);
+    for (std::size_t i = 0; i < size; ++i)
+      data[i] = static_cast<char>(i * 7);
+    qi::Buffer payload;
+    payload.write(data.data(), data.size() / 2);
+    qi::Buffer sub;
+    sub.write(data.data() + data.size() / 2, data.size() - data.size() / 2);
+    payload.addSubBuffer(sub);
+    payload.write("tail", 4);
+    msg.setBuffer(payload);
+    return msg;
+  }
+
+  // A message whose descriptor designates the segment `name` of `size` bytes.
+  qi::Message makeDescriptorMessage(const std::string& name, qi::uint64_t size)
+  {
+    qi::Message msg(qi::Message::Type_Call, qi::MessageAddress{1, 2, 3, 100});
+    qi::Buffer descriptor;
+    qi::encodeBinary(&descriptor, qi::AutoAnyReference(name));
+    qi::encodeBinary(&descriptor, qi::AutoAnyReference(size));
+    msg.setBuffer(descriptor);
+    msg.addFlags(qi::Message::TypeFlag_SharedMemoryPayload);
+    return msg;
+  }
+
+  // A segment created by the test, removed at the end of the scope.
+  struct ScopedSegment
+  {
+    ScopedSegment(const std::string& prefix, std::size_t size)
+      : name(prefix + boost::lexical_cast<std::string>(qi::os::getpid()))
+    {
+      namespace bip = boost::interprocess;
+      bip::shared_memory_object shm(bip::create_only, name.c_str(), bip::read_write);
+      shm.truncate(static_cast<bip::offset_t>(size));
+    }
+
+    ~ScopedSegment()
+    {
+      boost::interprocess::shared_memory_object::remove(name.c_str());
+    }
+
+    bool exists() const
+    {
+      namespace bip = boost::interprocess;
+      try
+      {
+        bip::shared_memory_object shm(bip::open_only, name.c_str(), bip::read_only);
+        return true;
+      }
+      catch (const bip::interprocess_exception&)
+      {
+        return false;
+      }
+    }
+
+    const std::string name;
+  };
+
+  std::vector<char> wireContent(const qi::Buffer& buffer)
+  {
+    std::vector<char> res;
+    const char* data = static_cast<const char*>(buffer.data());
+    std::size_t begin = 0;
+    for (const auto& sub : buffer.subBuffers())
+    {
+      const std::size_t end = sub.first + sizeof(qi::Buffer::size_type);
+      res.insert(res.end(), data + begin, data + end);
+      begin = end;
+      const char* subData = static_cast<const char*>(sub.second.data());
+      res.insert(res.end(), subData, subData + sub.second.size());
+    }
+    res.insert(res.end(), data + begin, data + buffer.size());
+    return res;
+  }
+}
+
+TEST(TestSharedMemoryPayload, UsableOnlyOnSameMachine)
+{
+  EXPECT_TRUE(qi::SharedMemoryPayloadChannel::isUsable(LocalStreamContext{qi::os::getMachineId()}));
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::isUsable(LocalStreamContext{"another-machine"}));
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::isUsable(qi::StreamContext{}));
+}
+
+TEST(TestSharedMemoryPayload, SmallMessageIsSentInline)
+{
+  qi::SharedMemoryPayloadChannel channel;
+  LocalStreamContext context{qi::os::getMachineId()};
+  qi::Message msg = makeLargeMessage(16);
+  const qi::Message original = msg;
+  EXPECT_FALSE(channel.exportPayload(msg, context));
+  EXPECT_EQ(original, msg);
+}
+
+TEST(TestSharedMemoryPayload, LargeMessageRoundTrip)
+{
+  qi::SharedMemoryPayloadChannel channel;
+  LocalStreamContext context{qi::os::getMachineId()};
+  qi::Message msg = makeLargeMessage(qi::SharedMemoryPayloadChannel::threshold() + 1);
+  const std::vector<char> expected = wireContent(msg.buffer());
+
+  ASSERT_TRUE(channel.exportPayload(msg, context));
+  EXPECT_TRUE(msg.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+  EXPECT_LT(msg.buffer().totalSize(), 1024u);
+
+  ASSERT_TRUE(qi::SharedMemoryPayloadChannel::importPayload(msg, context));
+  EXPECT_FALSE(msg.flags() & qi::Message::TypeFlag_SharedMemoryPayload);
+  ASSERT_EQ(expected.size(), msg.header().size);
+  const char* data = static_cast<const char*>(msg.buffer().data());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), data));
+
+  // The mapped buffer can still be extended.
+  qi::Buffer buffer = msg.buffer();
+  buffer.write("more", 4);
+  EXPECT_EQ(expected.size() + 4, buffer.size());
+}
+
+TEST(TestSharedMemoryPayload, ImportTwiceFails)
+{
+  qi::SharedMemoryPayloadChannel channel;
+  LocalStreamContext context{qi::os::getMachineId()};
+  qi::Message msg = makeLargeMessage(qi::SharedMemoryPayloadChannel::threshold());
+  ASSERT_TRUE(channel.exportPayload(msg, context));
+  qi::Message copy = msg;
+  ASSERT_TRUE(qi::SharedMemoryPayloadChannel::importPayload(msg, context));
+  // The segment is unlinked once received.
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(copy, context));
+}
+
+TEST(TestSharedMemoryPayload, ReleaseUnlinksPendingSegments)
+{
+  LocalStreamContext context{qi::os::getMachineId()};
+  qi::Message msg = makeLargeMessage(qi::SharedMemoryPayloadChannel::threshold());
+  {
+    qi::SharedMemoryPayloadChannel channel;
+    ASSERT_TRUE(channel.exportPayload(msg, context));
+    channel.release();
+  }
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(msg, context));
+}
+
+TEST(TestSharedMemoryPayload, ImportRequiresTheCapability)
+{
+  qi::SharedMemoryPayloadChannel channel;
+  LocalStreamContext context{qi::os::getMachineId()};
+  qi::Message msg = makeLargeMessage(qi::SharedMemoryPayloadChannel::threshold());
+  ASSERT_TRUE(channel.exportPayload(msg, context));
+  qi::Message copy = msg;
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(msg, qi::StreamContext{}));
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(msg, LocalStreamContext{"another-machine"}));
+  // The segment was left untouched.
+  EXPECT_TRUE(qi::SharedMemoryPayloadChannel::importPayload(copy, context));
+}
+
+TEST(TestSharedMemoryPayload, ImportRejectsForeignSegments)
+{
+  LocalStreamContext context{qi::os::getMachineId()};
+  ScopedSegment foreign("qi-test-foreign-", 64);
+  qi::Message msg = makeDescriptorMessage(foreign.name, 64);
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(msg, context));
+  EXPECT_TRUE(foreign.exists());
+
+  qi::Message withSlash = makeDescriptorMessage("qi-shm-a/" + foreign.name, 64);
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(withSlash, context));
+  EXPECT_TRUE(foreign.exists());
+}
+
+TEST(TestSharedMemoryPayload, ImportRejectsSegmentsSmallerThanDeclared)
+{
+  LocalStreamContext context{qi::os::getMachineId()};
+  ScopedSegment segment("qi-shm-test-", 64);
+  qi::Message msg = makeDescriptorMessage(segment.name, 1024 * 1024);
+  EXPECT_FALSE(qi::SharedMemoryPayloadChannel::importPayload(msg, context));
+}
@@ -171,6 +171,69 @@ TEST_F(TestTransportSocketCache, SameMachinePublicIp)
   client->disconnect();
 }
 
+namespace
+{
+  qi::ServiceInfo makeServiceInfo(unsigned int id, const std::string& name, const qi::UrlVector& endpoints)
+  {
+    qi::ServiceInfo info;
+    info.setServiceId(id);
+    info.setName(name);
+    info.setMachineId(qi::os::getMachineId());
+    info.setEndpoints(endpoints);
+    return info;
+  }
+}
+
+TEST(TestTransportSocketCacheLanes, ServicesAreSpreadOverSockets)
+{
+  qi::TransportServer server;
+  server.newConnection.connect(&newConnection, _1);
+  server.listen("tcp://127.0.0.1:0").wait();
+  const qi::UrlVector endpoints = server.endpoints();
+
+  qi::TransportSocketCache cache(2, {});
+  cache.init();
+  const auto first = cache.socket(makeServiceInfo(2, "a", endpoints), "").value();
+  const auto second = cache.socket(makeServiceInfo(3, "b", endpoints), "").value();
+  const auto firstAgain = cache.socket(makeServiceInfo(4, "c", endpoints), "").value();
+  EXPECT_TRUE(first->isConnected());
+  EXPECT_TRUE(second->isConnected());
+  EXPECT_NE(first, second);
+  EXPECT_EQ(first, firstAgain);
+  // A given service always goes through the same socket.
+  EXPECT_EQ(second, cache.socket(makeServiceInfo(3, "b", endpoints), "").value());
+  cache.close();
+  server.close();
+}
+
+TEST(TestTransportSocketCacheLanes, BulkServicesHaveTheirOwnSocket)
+{
+  qi::TransportServer server;
+  server.newConnection.connect(&newConnection, _1);
+  server.listen("tcp://127.0.0.1:0").wait();
+  const qi::UrlVector endpoints = server.endpoints();
+
+  qi::TransportSocketCache cache(2, {"Camera"});
+  cache.init();
+  EXPECT_EQ(1u, cache.lane(makeServiceInfo(2, "Camera", endpoints)));
+  EXPECT_EQ(0u, cache.lane(makeServiceInfo(3, "b", endpoints)));
+  EXPECT_EQ(0u, cache.lane(makeServiceInfo(4, "c", endpoints)));
+  const auto bulk = cache.socket(makeServiceInfo(2, "Camera", endpoints), "").value();
+  const auto other = cache.socket(makeServiceInfo(3, "b", endpoints), "").value();
+  EXPECT_NE(bulk, other);
+  EXPECT_EQ(other, cache.socket(makeServiceInfo(4, "c", endpoints), "").value());
+  cache.close();
+  server.close();
+}
+
+TEST(TestTransportSocketCacheLanes, SingleSocketByDefault)
+{
+  qi::TransportSocketCache cache(1, {"Camera"});
+  EXPECT_EQ(1u, cache.socketsPerEndpoint());
+  EXPECT_EQ(0u, cache.lane(makeServiceInfo(2, "Camera", {})));
+  EXPECT_EQ(0u, cache.lane(makeServiceInfo(3, "b", {})));
+}
+
 TEST(TestCall, IPV6Accepted)
 {
   // todo: enable whenever qi::Url properly supports ipv6
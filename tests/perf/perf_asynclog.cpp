@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Throughput of asynchronous logs from several threads, and latency of the
+ * logging call site.
+ *
+ * Messages go to a handler that does nothing, so that the cost measured is
+ * the one of the logging system. With --deferred, messages are logged with
+ * qiLogInfoDeferred and are never formatted.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/clock.hpp>
+#include <qi/log.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+
+qiLogCategory("qi.perf.asynclog");
+
+namespace po = boost::program_options;
+
+namespace
+{
+  void nullHandler(qi::LogLevel,
+                   qi::Clock::time_point,
+                   qi::SystemClock::time_point,
+                   const char*,
+                   const char*,
+                   const char*,
+                   const char*,
+                   int)
+  {
+  }
+
+  void nullDeferredHandler(qi::Clock::time_point,
+                           qi::SystemClock::time_point,
+                           const char*,
+                           const qi::log::LogSite&,
+                           const char*,
+                           std::size_t)
+  {
+  }
+
+  double percentile(std::vector<double>& values, double p)
+  {
+    const std::size_t idx = std::min(values.size() - 1,
+                                     static_cast<std::size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,n", po::value<unsigned int>()->default_value(100000), "Number of messages per thread.")
+    ("block", po::bool_switch(), "Block instead of dropping messages when a buffer is full.")
+    ("deferred", po::bool_switch(), "Log with deferred formatting.");
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  qi::log::removeHandler(qi::log::env::QI_DEFAULT_LOGHANDLER::value::stdOut);
+  qi::log::removeHandler(qi::log::env::QI_DEFAULT_LOGHANDLER::value::logger);
+  qi::log::addHandler("null", &nullHandler, &nullDeferredHandler, qi::LogLevel_Info);
+  qi::log::setSynchronousLog(false);
+  qi::log::setAsynchronousLogOverflowPolicy(vm["block"].as<bool>() ? qi::LogOverflowPolicy_Block
+                                                                    : qi::LogOverflowPolicy_Drop);
+
+  qi::DataPerfSuite out("qi", "perf_asynclog", qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+
+  const unsigned int count = vm["count"].as<unsigned int>();
+  const bool deferred = vm["deferred"].as<bool>();
+  const unsigned int maxThreads = std::max(2u, std::thread::hardware_concurrency());
+  for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    std::vector<std::vector<double>> latencies(threads);
+    qi::DataPerf dp;
+    dp.start(std::string(deferred ? "deferred_" : "") + "log_" + std::to_string(threads) + "_threads",
+             count * threads);
+    std::vector<std::thread> loggers;
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+      loggers.emplace_back([&, t] {
+        std::vector<double>& lat = latencies[t];
+        lat.reserve(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+          const auto start = qi::SteadyClock::now();
+          if (deferred)
+            qiLogInfoDeferred("message %d from thread %d", i, t);
+          else
+            qiLogInfo() << "message " << i << " from thread " << t;
+          lat.push_back(static_cast<double>(
+              boost::chrono::duration_cast<qi::NanoSeconds>(qi::SteadyClock::now() - start).count()));
+        }
+      });
+    }
+    for (auto& logger : loggers)
+      logger.join();
+    qi::log::flush();
+    dp.stop();
+    out << dp;
+
+    std::vector<double> all;
+    for (auto& lat : latencies)
+      all.insert(all.end(), lat.begin(), lat.end());
+    std::cout << std::fixed << std::setprecision(0)
+              << threads << " thread(s), call site latency (ns):"
+              << " p50 " << percentile(all, 0.50)
+              << " p99 " << percentile(all, 0.99)
+              << " p99.9 " << percentile(all, 0.999)
+              << " max " << percentile(all, 1.0) << std::endl;
+  }
+  out.close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Cost of the log sites whose level is not visible, which is what most debug
+ * and verbose logs cost in production.
+ *
+ * Each kind of site is called in a loop, with the default category, with a
+ * literal category, and with each macro flavor.
+ */
+
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/log.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+
+qiLogCategory("qi.perf.disabledlog");
+
+namespace po = boost::program_options;
+
+namespace
+{
+  template <typename F>
+  void measure(qi::DataPerfSuite& out, const std::string& name, unsigned int count, F&& f)
+  {
+    qi::DataPerf dp;
+    dp.start(name, count);
+    for (unsigned int i = 0; i < count; ++i)
+      f(i);
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,n", po::value<unsigned int>()->default_value(10000000), "Number of calls per site.");
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  qi::log::setLogLevel(qi::LogLevel_Info);
+
+  qi::DataPerfSuite out("qi", "perf_disabledlog", qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+
+  const unsigned int count = vm["count"].as<unsigned int>();
+  measure(out, "stream", count, [](unsigned int i) {
+    qiLogVerbose() << "message " << i;
+  });
+  measure(out, "stream_category", count, [](unsigned int i) {
+    qiLogVerbose("qi.perf.disabledlog.other") << "message " << i;
+  });
+  measure(out, "format", count, [](unsigned int i) {
+    qiLogVerboseF("message %d", i);
+  });
+  measure(out, "deferred", count, [](unsigned int i) {
+    qiLogVerboseDeferred("message %d", i);
+  });
+  measure(out, "limited", count, [](unsigned int i) {
+    qiLogVerboseLimited(10) << "message " << i;
+  });
+  measure(out, "is_visible_literal", count, [](unsigned int) {
+    volatile bool visible = qi::log::isVisible("qi.perf.disabledlog.other", qi::LogLevel_Verbose);
+    (void)visible;
+  });
+  out.close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Throughput of the JSON codec on a large nested value.
+ *
+ * The fixture is a list of records mixing strings, integers, floats, lists
+ * and maps. It is encoded to a new string, to a reused string and to a
+ * stream, then decoded to a generic value and straight into its C++ type.
+ */
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/jsoncodec.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+
+namespace po = boost::program_options;
+
+struct PerfJsonRecord
+{
+  int id;
+  std::string name;
+  double value;
+  std::vector<int> samples;
+  std::map<std::string, double> attributes;
+};
+QI_TYPE_STRUCT(PerfJsonRecord, id, name, value, samples, attributes);
+
+namespace
+{
+  std::vector<PerfJsonRecord> makeFixture(unsigned int size)
+  {
+    std::vector<PerfJsonRecord> records(size);
+    for (unsigned int i = 0; i < size; ++i)
+    {
+      PerfJsonRecord& record = records[i];
+      record.id = static_cast<int>(i);
+      record.name = "record number " + std::to_string(i);
+      record.value = i / 7.0;
+      for (int j = 0; j < 16; ++j)
+        record.samples.push_back(static_cast<int>(i * j) - 1000);
+      record.attributes["x"] = i * 0.25;
+      record.attributes["y"] = -1.0 / (i + 1);
+      record.attributes["temperature"] = 21.5;
+    }
+    return records;
+  }
+
+  template <typename F>
+  void measure(qi::DataPerfSuite& out, const std::string& name, unsigned int count,
+               unsigned long size, F&& f)
+  {
+    qi::DataPerf dp;
+    dp.start(name, count, size);
+    for (unsigned int i = 0; i < count; ++i)
+      f();
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,n", po::value<unsigned int>()->default_value(20), "Number of runs per benchmark.")
+    ("records,r", po::value<unsigned int>()->default_value(20000), "Number of records of the fixture.");
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  qi::DataPerfSuite out("qi", "perf_json", qi::DataPerfSuite::OutputData_MsgMBPerSecond,
+                        vm["output"].as<std::string>());
+
+  const unsigned int count = vm["count"].as<unsigned int>();
+  const std::vector<PerfJsonRecord> fixture = makeFixture(vm["records"].as<unsigned int>());
+  const std::string json = qi::encodeJSON(fixture);
+  const unsigned long size = json.size();
+
+  measure(out, "encode", count, size, [&] {
+    qi::encodeJSON(fixture);
+  });
+  std::string buffer;
+  measure(out, "encode_reused_buffer", count, size, [&] {
+    buffer.clear();
+    qi::encodeJSON(fixture, buffer);
+  });
+  measure(out, "encode_stream", count, size, [&] {
+    std::ostringstream stream;
+    qi::encodeJSON(fixture, stream);
+  });
+  measure(out, "decode_anyvalue", count, size, [&] {
+    qi::decodeJSON(json);
+  });
+  measure(out, "decode_anyvalue_to_type", count, size, [&] {
+    qi::decodeJSON(json).to<std::vector<PerfJsonRecord>>();
+  });
+  measure(out, "decode_typed", count, size, [&] {
+    std::vector<PerfJsonRecord> records;
+    qi::decodeJSON(json, qi::AnyReference::from(records));
+  });
+  measure(out, "decode_typed_stream", count, size, [&] {
+    std::istringstream stream(json);
+    std::vector<PerfJsonRecord> records;
+    qi::decodeJSON(stream, qi::AnyReference::from(records));
+  });
+  out.close();
+  return EXIT_SUCCESS;
+}
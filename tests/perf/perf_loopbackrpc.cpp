@@ -0,0 +1,255 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Messaging stack over loopback, for each protocol given with --protocols.
+ *
+ * A standalone session acts as the service directory and registers the
+ * PerfRpc service. Clients connect to it and measure:
+ * - call_sync: the latency of one call at a time;
+ * - call_pipelined: the time per call when --pipeline calls are in flight;
+ * - call_concurrent: the time per call when 1 to --clients sessions call
+ *   at the same time, the variable is the number of clients;
+ * - call_payload: the latency of a call echoing 8 B to --max-payload bytes;
+ * - signal_fanout: the time per event received by --subscribers remote
+ *   subscribers;
+ * - property_get and property_set.
+ *
+ * tcps needs the identity installed by the test session library, the
+ * protocol is skipped if it can not be found.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <qi/application.hpp>
+#include <qi/buffer.hpp>
+#include <qi/path.hpp>
+#include <qi/property.hpp>
+#include <qi/session.hpp>
+#include <qi/signal.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <qi/perf/benchmark.hpp>
+
+QI_PERF_COUNT_ALLOCATIONS()
+
+namespace po = boost::program_options;
+
+namespace
+{
+  qi::Buffer echo(const qi::Buffer& buffer)
+  {
+    return buffer;
+  }
+
+  qi::Buffer makeBuffer(std::size_t size)
+  {
+    qi::Buffer buffer;
+    std::vector<char> data(size, 'q');
+    buffer.write(data.data(), data.size());
+    return buffer;
+  }
+
+  struct Parameters
+  {
+    unsigned int pipeline;
+    unsigned int clients;
+    unsigned int subscribers;
+    std::size_t maxPayload;
+  };
+
+  /// Counts the events received by the subscribers, and wakes up the emitter.
+  class EventCounter
+  {
+  public:
+    void reset(unsigned int expected)
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _received = 0;
+      _expected = expected;
+    }
+
+    void received(int)
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (++_received == _expected)
+        _done.notify_all();
+    }
+
+    void wait()
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      while (_received < _expected)
+        _done.wait(lock);
+    }
+
+  private:
+    boost::mutex _mutex;
+    boost::condition_variable _done;
+    unsigned int _received = 0;
+    unsigned int _expected = 0;
+  };
+
+  void runProtocol(qi::BenchmarkSuite& suite, const std::string& protocol, const Parameters& params)
+  {
+    const std::string prefix = protocol + "_";
+    const unsigned int iterations = suite.options().iterations;
+
+    auto server = qi::makeSession();
+    if (protocol == "tcps" &&
+        !server->setIdentity(qi::path::findData("qi", "server.key"),
+                             qi::path::findData("qi", "server.crt")))
+    {
+      std::cerr << "No identity to listen on tcps, skipped." << std::endl;
+      return;
+    }
+    server->listenStandalone(protocol + "://127.0.0.1:0");
+
+    qi::Signal<int> event;
+    qi::Property<int> property;
+    {
+      qi::DynamicObjectBuilder builder;
+      builder.advertiseMethod("echo", &echo);
+      builder.advertiseSignal("event", &event);
+      builder.advertiseProperty("value", &property);
+      server->registerService("PerfRpc", builder.object());
+    }
+
+    std::vector<qi::SessionPtr> clients;
+    std::vector<qi::AnyObject> services;
+    const unsigned int sessions = std::max({params.clients, params.subscribers, 1u});
+    for (unsigned int i = 0; i < sessions; ++i)
+    {
+      clients.push_back(qi::makeSession());
+      clients.back()->connect(server->endpoints()[0]);
+      services.push_back(clients.back()->service("PerfRpc").value());
+    }
+    qi::AnyObject service = services.front();
+    const qi::Buffer small = makeBuffer(8);
+
+    suite.run(prefix + "call_sync", "", 8, iterations, 1, [&] {
+      service.call<qi::Buffer>("echo", small);
+    });
+
+    std::vector<qi::Future<qi::Buffer>> inFlight(params.pipeline);
+    suite.run(prefix + "call_pipelined", std::to_string(params.pipeline), 8,
+              iterations, params.pipeline, [&] {
+      for (auto& call : inFlight)
+        call = service.async<qi::Buffer>("echo", small);
+      for (auto& call : inFlight)
+        call.value();
+    });
+
+    const unsigned int callsPerClient = 10;
+    for (unsigned int count = 1; count <= params.clients; count *= 2)
+    {
+      std::vector<qi::Future<void>> callers(count);
+      suite.run(prefix + "call_concurrent", std::to_string(count), 8,
+                std::max(iterations / count, 1u), count * callsPerClient, [&] {
+        for (unsigned int c = 0; c < count; ++c)
+        {
+          qi::AnyObject client = services[c];
+          callers[c] = qi::async([client, &small] {
+            for (unsigned int i = 0; i < callsPerClient; ++i)
+              client.call<qi::Buffer>("echo", small);
+          });
+        }
+        for (auto& caller : callers)
+          caller.value();
+      });
+    }
+
+    for (std::size_t size = 8; size <= params.maxPayload; size *= 8)
+    {
+      const qi::Buffer payload = makeBuffer(size);
+      // Bound each size to about 256 MiB of echoed data.
+      const unsigned int payloadIterations = static_cast<unsigned int>(
+          std::max<std::size_t>(std::min<std::size_t>(iterations, (256u << 20) / size), 5u));
+      suite.run(prefix + "call_payload", std::to_string(size), size,
+                payloadIterations, 1, [&] {
+        service.call<qi::Buffer>("echo", payload);
+      });
+    }
+
+    EventCounter counter;
+    std::vector<qi::SignalLink> links;
+    for (unsigned int i = 0; i < params.subscribers; ++i)
+    {
+      links.push_back(services[i].connect("event",
+          boost::function<void(int)>([&counter](int v) { counter.received(v); })).value());
+    }
+    const unsigned int events = 100;
+    suite.run(prefix + "signal_fanout", std::to_string(params.subscribers), 0,
+              std::max(iterations / events, 1u), events * params.subscribers, [&] {
+      counter.reset(events * params.subscribers);
+      for (unsigned int i = 0; i < events; ++i)
+        event(static_cast<int>(i));
+      counter.wait();
+    });
+    for (unsigned int i = 0; i < links.size(); ++i)
+      services[i].disconnect(links[i]).value();
+
+    int value = 0;
+    suite.run(prefix + "property_set", "", 0, iterations, 1, [&] {
+      service.setProperty("value", ++value).value();
+    });
+    suite.run(prefix + "property_get", "", 0, iterations, 1, [&] {
+      service.property<int>("value").value();
+    });
+
+    services.clear();
+    service = qi::AnyObject();
+    for (auto& client : clients)
+      client->close();
+    server->close();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("protocols", po::value<std::string>()->default_value("tcp,tcps"),
+     "Comma separated protocols to measure.")
+    ("pipeline", po::value<unsigned int>()->default_value(32), "Calls in flight of call_pipelined.")
+    ("clients", po::value<unsigned int>()->default_value(8), "Maximum number of concurrent clients.")
+    ("subscribers", po::value<unsigned int>()->default_value(4), "Subscribers of signal_fanout.")
+    ("max-payload", po::value<std::size_t>()->default_value(16u << 20), "Largest payload, in bytes.");
+  desc.add(qi::detail::getBenchmarkOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  Parameters params;
+  params.pipeline = std::max(vm["pipeline"].as<unsigned int>(), 1u);
+  params.clients = std::max(vm["clients"].as<unsigned int>(), 1u);
+  params.subscribers = std::max(vm["subscribers"].as<unsigned int>(), 1u);
+  params.maxPayload = vm["max-payload"].as<std::size_t>();
+
+  std::vector<std::string> protocols;
+  boost::split(protocols, vm["protocols"].as<std::string>(), boost::is_any_of(","));
+
+  qi::BenchmarkSuite suite("qimessaging", "perf_loopbackrpc", qi::detail::getBenchmarkOptions(vm));
+  for (const std::string& protocol : protocols)
+    if (!protocol.empty())
+      runProtocol(suite, protocol, params);
+  return suite.close() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
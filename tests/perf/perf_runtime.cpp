@@ -0,0 +1,375 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Latency distribution, CPU time and heap allocations of the building blocks
+ * of the runtime: futures, strands, signals, the binary codec, signatures,
+ * calls of a type-erased function, queued calls of a local object and calls
+ * through a loopback session.
+ *
+ * Write the results with --output results.json, and compare a later run
+ * with --baseline results.json: the process fails if a median slowed down
+ * more than --tolerance percent.
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/future.hpp>
+#include <qi/lazyanyvalue.hpp>
+#include <qi/session.hpp>
+#include <qi/signal.hpp>
+#include <qi/signature.hpp>
+#include <qi/strand.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <qi/perf/benchmark.hpp>
+
+QI_PERF_COUNT_ALLOCATIONS()
+
+namespace po = boost::program_options;
+
+struct PerfRuntimeRecord
+{
+  int id;
+  std::string name;
+  std::vector<double> values;
+};
+QI_TYPE_STRUCT(PerfRuntimeRecord, id, name, values);
+
+namespace
+{
+  std::vector<PerfRuntimeRecord> makeRecords(unsigned int size)
+  {
+    std::vector<PerfRuntimeRecord> records(size);
+    for (unsigned int i = 0; i < size; ++i)
+    {
+      records[i].id = static_cast<int>(i);
+      records[i].name = "record " + std::to_string(i);
+      records[i].values.assign(8, i * 0.5);
+    }
+    return records;
+  }
+
+  std::string echo(const std::string& s)
+  {
+    return s;
+  }
+
+  std::size_t count(const std::vector<float>& values)
+  {
+    return values.size();
+  }
+
+  double scale(double value, qi::int64_t factor)
+  {
+    return value * static_cast<double>(factor);
+  }
+
+  void runFutures(qi::BenchmarkSuite& suite)
+  {
+    suite.run("future_set_value", [] {
+      qi::Promise<int> promise;
+      promise.setValue(42);
+      promise.future().value();
+    }, 0, 100);
+    suite.run("future_then", [] {
+      qi::Promise<int> promise;
+      qi::Future<int> next = promise.future().andThen([](int v) { return v + 1; });
+      promise.setValue(42);
+      next.value();
+    }, 0, 10);
+  }
+
+  void runStrands(qi::BenchmarkSuite& suite)
+  {
+    qi::Strand strand;
+    suite.run("strand_async", [&] {
+      strand.async([] {}).wait();
+    }, 0, 10);
+  }
+
+  void runSignals(qi::BenchmarkSuite& suite)
+  {
+    qi::Signal<int> signal;
+    signal.setCallType(qi::MetaCallType_Direct);
+    int received = 0;
+    signal.connect([&](int v) { received += v; });
+    suite.run("signal_emit_direct", [&] { signal(1); }, 0, 100);
+
+    // Direct emissions to 1 to 16 subscribers, connected with a callable of
+    // the signal's type (typed) or as an AnyFunction (generic).
+    const std::vector<float> floats(256, 1.f);
+    for (unsigned int count = 1; count <= 16; count *= 2)
+    {
+      const std::string variable = std::to_string(count);
+      qi::Signal<int> typedInt;
+      qi::Signal<int> genericInt;
+      qi::Signal<std::vector<float>> typedVector;
+      qi::Signal<std::vector<float>> genericVector;
+      for (auto* s : {&typedInt, &genericInt})
+        s->setCallType(qi::MetaCallType_Direct);
+      for (auto* s : {&typedVector, &genericVector})
+        s->setCallType(qi::MetaCallType_Direct);
+      std::size_t sum = 0;
+      for (unsigned int i = 0; i < count; ++i)
+      {
+        typedInt.connect([&](int v) { sum += v; });
+        genericInt.connect(qi::AnyFunction::from(
+            boost::function<void(int)>([&](int v) { sum += v; })));
+        typedVector.connect([&](const std::vector<float>& v) { sum += v.size(); });
+        genericVector.connect(qi::AnyFunction::from(
+            boost::function<void(const std::vector<float>&)>(
+                [&](const std::vector<float>& v) { sum += v.size(); })));
+      }
+      suite.run("signal_emit_int_typed", [&] { typedInt(1); }, 0, 100, variable);
+      suite.run("signal_emit_int_generic", [&] { genericInt(1); }, 0, 100, variable);
+      const unsigned long size = floats.size() * sizeof(float);
+      suite.run("signal_emit_vector_typed", [&] { typedVector(floats); }, size, 100, variable);
+      suite.run("signal_emit_vector_generic", [&] { genericVector(floats); }, size, 100, variable);
+    }
+  }
+
+  void runBinaryCodec(qi::BenchmarkSuite& suite)
+  {
+    const std::vector<PerfRuntimeRecord> records = makeRecords(1000);
+    qi::Buffer encoded;
+    qi::encodeBinary(&encoded, records);
+    const unsigned long size = encoded.size();
+
+    suite.run("binary_encode", [&] {
+      qi::Buffer buffer;
+      qi::encodeBinary(&buffer, records);
+    }, size);
+    suite.run("binary_decode", [&] {
+      qi::BufferReader reader(encoded);
+      std::vector<PerfRuntimeRecord> decoded;
+      qi::decodeBinary(&reader, &decoded);
+    }, size);
+
+    std::map<std::string, qi::AnyValue> values;
+    for (const PerfRuntimeRecord& record : records)
+      values[record.name] = qi::AnyValue::from(record.values);
+    qi::Buffer encodedValues;
+    qi::encodeBinary(&encodedValues, values);
+    suite.run("binary_encode_map", [&] {
+      qi::Buffer buffer;
+      qi::encodeBinary(&buffer, values);
+    }, encodedValues.size());
+    suite.run("binary_decode_map", [&] {
+      qi::BufferReader reader(encodedValues);
+      std::map<std::string, qi::AnyValue> decoded;
+      qi::decodeBinary(&reader, &decoded);
+    }, encodedValues.size());
+
+    // A message whose dynamic payload is forwarded, or of which one entry is
+    // read, decoded in an AnyValue or kept encoded in a LazyAnyValue.
+    const std::pair<std::string, qi::AnyValue> message("topic", qi::AnyValue::from(values));
+    qi::Buffer encodedMessage;
+    qi::encodeBinary(&encodedMessage, message);
+    suite.run("binary_forward_dynamic", [&] {
+      qi::BufferReader reader(encodedMessage);
+      std::pair<std::string, qi::AnyValue> decoded;
+      qi::decodeBinary(&reader, &decoded);
+      qi::Buffer buffer;
+      qi::encodeBinary(&buffer, decoded);
+    }, encodedMessage.size());
+    suite.run("binary_forward_lazy", [&] {
+      qi::BufferReader reader(encodedMessage);
+      std::pair<std::string, qi::LazyAnyValue> decoded;
+      qi::decodeBinary(&reader, &decoded);
+      qi::Buffer buffer;
+      qi::encodeBinary(&buffer, decoded);
+    }, encodedMessage.size());
+    suite.run("binary_read_dynamic", [&] {
+      qi::BufferReader reader(encodedMessage);
+      std::pair<std::string, qi::AnyValue> decoded;
+      qi::decodeBinary(&reader, &decoded);
+      decoded.second["record 1"].content().size();
+    }, encodedMessage.size());
+    suite.run("binary_read_lazy", [&] {
+      qi::BufferReader reader(encodedMessage);
+      std::pair<std::string, qi::LazyAnyValue> decoded;
+      qi::decodeBinary(&reader, &decoded);
+      decoded.second.to<std::map<std::string, qi::LazyAnyValue>>().at("record 1").value().size();
+    }, encodedMessage.size());
+
+    // The same records held by the dynamic types built from their signature.
+    qi::AnyValue dynamic(qi::TypeInterface::fromSignature(qi::typeOf(records)->signature()));
+    qi::BufferReader reader(encoded);
+    qi::decodeBinary(&reader, dynamic.asReference());
+    suite.run("binary_encode_dynamic", [&] {
+      qi::Buffer buffer;
+      qi::encodeBinary(&buffer, dynamic.asReference());
+    }, size);
+    suite.run("binary_decode_dynamic", [&] {
+      qi::BufferReader reader(encoded);
+      qi::AnyValue decoded(dynamic.type());
+      qi::decodeBinary(&reader, decoded.asReference());
+    }, size);
+  }
+
+  // Construction from a string, comparison and convertibility of a struct
+  // signature and of a method parameters signature.
+  void runSignatures(qi::BenchmarkSuite& suite)
+  {
+    const std::string record = qi::typeOf<PerfRuntimeRecord>()->signature().toString();
+    const std::string params = "(" + record + "[" + record + "]{sm})";
+    for (const std::string& str : { record, params })
+    {
+      const std::string variable = std::to_string(str.size());
+      suite.run("signature_parse", [&] { qi::Signature s(str); }, 0, 100, variable);
+
+      const qi::Signature signature(str);
+      const qi::Signature same(str);
+      const qi::Signature other("(" + str + "i)");
+      bool equal = false;
+      suite.run("signature_compare", [&] {
+        equal = (signature == same) && !(signature == other);
+      }, 0, 100, variable);
+      if (!equal)
+        std::cerr << "Unexpected signature comparison." << std::endl;
+
+      const qi::Signature dynamic("m");
+      suite.run("signature_convertible", [&] {
+        signature.isConvertibleTo(same);
+        signature.isConvertibleTo(dynamic);
+      }, 0, 100, variable);
+    }
+  }
+
+  // The arguments are of the expected types, or converted from float and int.
+  void runFunctionCalls(qi::BenchmarkSuite& suite)
+  {
+    qi::AnyFunction function = qi::AnyFunction::from(&scale);
+    const double exactValue = 2.0;
+    const qi::int64_t exactFactor = 3;
+    const float convertedValue = 2.f;
+    const int convertedFactor = 3;
+
+    const auto call = [&](const qi::AnyReferenceVector& args) {
+      qi::AnyReference result = function.call(args);
+      result.destroy();
+    };
+
+    const qi::AnyReferenceVector exact{ qi::AnyReference::from(exactValue),
+                                        qi::AnyReference::from(exactFactor) };
+    suite.run("function_call_exact", [&] { call(exact); }, 0, 100);
+
+    const qi::AnyReferenceVector converted{ qi::AnyReference::from(convertedValue),
+                                            qi::AnyReference::from(convertedFactor) };
+    suite.run("function_call_converted", [&] { call(converted); }, 0, 100);
+
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("scale", &scale);
+    qi::AnyObject object = builder.object();
+    suite.run("object_call_converted", [&] {
+      object.call<double>("scale", convertedValue, convertedFactor);
+    }, 0, 100);
+
+    // The same calls gathering statistics, with or without the CPU time.
+    for (bool cpuTime : { true, false })
+    {
+      qi::AnyObject observed = builder.object();
+      observed.enableStats(true);
+      observed.enableStatsCpuTime(cpuTime);
+      suite.run("object_call_stats", [&] {
+        observed.call<double>("scale", convertedValue, convertedFactor);
+      }, 0, 100, cpuTime ? "cputime" : "wall");
+    }
+  }
+
+  // Queued calls of a local object with a large vector, with arguments
+  // cloned for the call (copy) or handed over to it (owned), as the remote
+  // calls do.
+  void runQueuedCalls(qi::BenchmarkSuite& suite)
+  {
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("count", &count);
+    qi::AnyObject object = builder.object();
+
+    for (std::size_t size : {1024u, 64u * 1024u, 1024u * 1024u})
+    {
+      const std::string variable = std::to_string(size);
+      const unsigned long bytes = size * sizeof(float);
+      auto values = std::make_shared<std::vector<float>>(size, 1.f);
+
+      qi::GenericFunctionParameters copied;
+      copied.push_back(qi::AnyReference::from(*values));
+      suite.run("queued_call_vector_copy", [&] {
+        qi::AnyReference result = object.metaCall("count", copied, qi::MetaCallType_Queued).value();
+        result.destroy();
+      }, bytes, 1, variable);
+
+      qi::GenericFunctionParameters owned = copied;
+      owned.setStorage(values);
+      suite.run("queued_call_vector_owned", [&] {
+        qi::AnyReference result = object.metaCall("count", owned, qi::MetaCallType_Queued).value();
+        result.destroy();
+      }, bytes, 1, variable);
+    }
+  }
+
+  void runLoopbackCalls(qi::BenchmarkSuite& suite)
+  {
+    auto server = qi::makeSession();
+    server->listenStandalone("tcp://127.0.0.1:0");
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("echo", &echo);
+    server->registerService("PerfRuntime", builder.object());
+
+    auto client = qi::makeSession();
+    client->connect(server->endpoints()[0]);
+    qi::AnyObject service = client->service("PerfRuntime").value();
+
+    for (std::size_t size : {8u, 1024u, 64u * 1024u})
+    {
+      const std::string payload(size, 'q');
+      suite.run("call_echo", [&] {
+        service.call<std::string>("echo", payload);
+      }, size, 1, std::to_string(size));
+    }
+    client->close();
+    server->close();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("no-session", "Skip the calls through a loopback session.");
+  desc.add(qi::detail::getBenchmarkOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  qi::BenchmarkSuite suite("qi", "perf_runtime", qi::detail::getBenchmarkOptions(vm));
+  runFutures(suite);
+  runStrands(suite);
+  runSignals(suite);
+  runBinaryCodec(suite);
+  runSignatures(suite);
+  runFunctionCalls(suite);
+  runQueuedCalls(suite);
+  if (!vm.count("no-session"))
+    runLoopbackCalls(suite);
+  return suite.close() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Throughput of large messages between two sessions of the same machine.
+ *
+ * Large payloads go through shared memory when both ends advertise the
+ * SharedMemoryPayload capability. To measure the inline path, run with
+ * QI_TRANSPORT_CAPABILITIES=-SharedMemoryPayload.
+ */
+
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/buffer.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <src/messaging/streamcontext.hpp>
+
+namespace po = boost::program_options;
+
+namespace
+{
+  unsigned int bufferSize(const qi::Buffer& buffer)
+  {
+    return static_cast<unsigned int>(buffer.totalSize());
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,n", po::value<unsigned int>()->default_value(50), "Number of calls per message size.");
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const bool shm = qi::StreamContext::defaultCapabilities().count(
+        qi::capabilityname::sharedMemoryPayload) != 0;
+  qi::DataPerfSuite out("qimessaging", "perf_sharedmemorypayload",
+                        qi::DataPerfSuite::OutputData_MsgMBPerSecond,
+                        vm["output"].as<std::string>());
+
+  auto server = qi::makeSession();
+  server->listenStandalone("tcp://127.0.0.1:0");
+  qi::DynamicObjectBuilder builder;
+  builder.advertiseMethod("bufferSize", &bufferSize);
+  server->registerService("PerfSharedMemory", builder.object());
+
+  auto client = qi::makeSession();
+  client->connect(server->endpoints()[0]);
+  qi::AnyObject service = client->service("PerfSharedMemory").value();
+
+  const unsigned int count = vm["count"].as<unsigned int>();
+  for (unsigned long size = 1024 * 1024; size <= 16 * 1024 * 1024; size *= 2)
+  {
+    qi::Buffer buffer;
+    std::vector<char> data(size, 'q');
+    buffer.write(data.data(), data.size());
+
+    // Warm up the connection and the metaobject cache.
+    service.call<unsigned int>("bufferSize", buffer);
+
+    qi::DataPerf dp;
+    dp.start(shm ? "shm_call" : "inline_call", count, size);
+    for (unsigned int i = 0; i < count; ++i)
+      service.call<unsigned int>("bufferSize", buffer);
+    dp.stop();
+    out << dp;
+  }
+  out.close();
+
+  client->close();
+  server->close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+/*
+ * Latency of small calls while large replies are being transferred from
+ * the same endpoint.
+ *
+ * With a single socket per endpoint, each small reply waits behind the
+ * large replies queued before it. Run with --sockets 2 to give the large
+ * payload service a socket of its own.
+ *
+ * Large payloads between processes of the same machine do not go through
+ * the socket when shared memory is used, so it is disabled unless
+ * QI_TRANSPORT_CAPABILITIES is set.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <boost/program_options.hpp>
+#include <qi/application.hpp>
+#include <qi/buffer.hpp>
+#include <qi/clock.hpp>
+#include <qi/os.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+
+namespace po = boost::program_options;
+
+namespace
+{
+  const std::size_t largeSize = 4 * 1024 * 1024;
+  const std::size_t smallSize = 100;
+
+  qi::Buffer makeBuffer(std::size_t size)
+  {
+    qi::Buffer buffer;
+    std::vector<char> data(size, 'q');
+    buffer.write(data.data(), data.size());
+    return buffer;
+  }
+
+  qi::Buffer largeReply()
+  {
+    static const qi::Buffer buffer = makeBuffer(largeSize);
+    return buffer;
+  }
+
+  std::string smallReply(const std::string& s)
+  {
+    return s;
+  }
+
+  double percentile(std::vector<double> values, double p)
+  {
+    std::sort(values.begin(), values.end());
+    const std::size_t idx = std::min(values.size() - 1,
+                                     static_cast<std::size_t>(p * values.size()));
+    return values[idx];
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  qi::Application app(argc, argv);
+
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,n", po::value<unsigned int>()->default_value(500), "Number of small calls.")
+    ("sockets,s", po::value<unsigned int>()->default_value(1), "Sockets per endpoint.")
+    ("bulk-callers", po::value<unsigned int>()->default_value(2), "Number of concurrent large calls.");
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const unsigned int sockets = vm["sockets"].as<unsigned int>();
+  // The socket cache of the client session reads its configuration when it
+  // is created.
+  qi::os::setenv("QI_SOCKETS_PER_ENDPOINT", std::to_string(sockets).c_str());
+  qi::os::setenv("QI_BULK_SERVICES", "PerfBulk");
+  if (qi::os::getenv("QI_TRANSPORT_CAPABILITIES").empty())
+    qi::os::setenv("QI_TRANSPORT_CAPABILITIES", "-SharedMemoryPayload");
+
+  qi::DataPerfSuite out("qimessaging", "perf_socketlanes",
+                        qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+
+  auto server = qi::makeSession();
+  server->listenStandalone("tcp://127.0.0.1:0");
+  {
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("get", &largeReply);
+    server->registerService("PerfBulk", builder.object());
+  }
+  {
+    qi::DynamicObjectBuilder builder;
+    builder.advertiseMethod("echo", &smallReply);
+    server->registerService("PerfSmall", builder.object());
+  }
+
+  auto client = qi::makeSession();
+  client->connect(server->endpoints()[0]);
+  qi::AnyObject bulk = client->service("PerfBulk").value();
+  qi::AnyObject small = client->service("PerfSmall").value();
+  const std::string payload(smallSize, 's');
+  small.call<std::string>("echo", payload);
+  bulk.call<qi::Buffer>("get");
+
+  // Keep large replies in flight during the whole measure.
+  std::atomic<bool> running{true};
+  std::vector<qi::Future<void>> bulkCallers;
+  for (unsigned int i = 0; i < vm["bulk-callers"].as<unsigned int>(); ++i)
+  {
+    bulkCallers.push_back(qi::async([&] {
+      while (running)
+        bulk.call<qi::Buffer>("get");
+    }));
+  }
+
+  const unsigned int count = vm["count"].as<unsigned int>();
+  std::vector<double> latencies;
+  latencies.reserve(count);
+  qi::DataPerf dp;
+  dp.start("small_call_" + std::to_string(sockets) + "_sockets", count, smallSize);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    const auto start = qi::SteadyClock::now();
+    small.call<std::string>("echo", payload);
+    const auto elapsed = boost::chrono::duration_cast<qi::MicroSeconds>(qi::SteadyClock::now() - start);
+    latencies.push_back(elapsed.count() / 1000.0);
+  }
+  dp.stop();
+  out << dp;
+
+  running = false;
+  for (auto& caller : bulkCallers)
+    caller.wait();
+
+  std::cout << std::fixed << std::setprecision(3)
+            << sockets << " socket(s) per endpoint, small call latency (ms):"
+            << " p50 " << percentile(latencies, 0.50)
+            << " p99 " << percentile(latencies, 0.99)
+            << " max " << percentile(latencies, 1.0) << std::endl;
+  out.close();
+
+  client->close();
+  server->close();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+#include <qi/os.hpp>
+#include <qi/perf/benchmark.hpp>
+
+namespace
+{
+  // Samples of 1 to `count` microseconds, shuffled.
+  std::vector<qi::Duration> makeSamples(int count, int factor = 1)
+  {
+    std::vector<qi::Duration> samples;
+    for (int i = 0; i < count; ++i)
+      samples.push_back(qi::MicroSeconds(((i * 7) % count + 1) * factor));
+    return samples;
+  }
+
+  std::string tmpFile(const std::string& name)
+  {
+    return (boost::filesystem::path(qi::os::mktmpdir("test_benchmark")) / name).string();
+  }
+
+  std::string readFile(const std::string& filename)
+  {
+    std::ifstream in(filename);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+}
+
+TEST(TestBenchmark, Statistics)
+{
+  qi::BenchmarkSuite suite("qi", "test_benchmark");
+  const qi::BenchmarkResult& r =
+      suite.add("bench", "", 0, makeSamples(1000), qi::MilliSeconds(10), -1);
+  EXPECT_EQ(1000u, r.iterations);
+  EXPECT_DOUBLE_EQ(500.5, r.mean);
+  EXPECT_DOUBLE_EQ(1., r.min);
+  EXPECT_DOUBLE_EQ(500., r.p50);
+  EXPECT_DOUBLE_EQ(990., r.p99);
+  EXPECT_DOUBLE_EQ(999., r.p999);
+  EXPECT_DOUBLE_EQ(1000., r.max);
+  EXPECT_DOUBLE_EQ(10., r.cpu);
+  EXPECT_DOUBLE_EQ(-1., r.allocations);
+  EXPECT_EQ(-1., r.megaBytePerSecond());
+}
+
+TEST(TestBenchmark, StatisticsArePerCallOfABatch)
+{
+  qi::BenchmarkSuite suite("qi", "test_benchmark");
+  const qi::BenchmarkResult& r =
+      suite.add("bench", "", 1024 * 1024, makeSamples(10, 4), qi::MicroSeconds(80), 120, 4);
+  EXPECT_EQ(40u, r.iterations);
+  EXPECT_DOUBLE_EQ(5.5, r.mean);
+  EXPECT_DOUBLE_EQ(1., r.min);
+  EXPECT_DOUBLE_EQ(10., r.max);
+  EXPECT_DOUBLE_EQ(2., r.cpu);
+  EXPECT_DOUBLE_EQ(3., r.allocations);
+  EXPECT_NEAR(1e6 / 5.5, r.megaBytePerSecond(), 1e-6);
+}
+
+TEST(TestBenchmark, RunCountsIterations)
+{
+  qi::BenchmarkOptions options;
+  options.warmup = 3;
+  options.iterations = 20;
+  qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+  int calls = 0;
+  const qi::BenchmarkResult& r = suite.run("bench", [&] { ++calls; }, 0, 2);
+  EXPECT_EQ(46, calls);
+  EXPECT_EQ(40u, r.iterations);
+  EXPECT_LE(r.min, r.p50);
+  EXPECT_LE(r.p50, r.p99);
+  EXPECT_LE(r.p99, r.max);
+}
+
+TEST(TestBenchmark, RunGivenIterations)
+{
+  qi::BenchmarkOptions options;
+  options.warmup = 3;
+  options.iterations = 20;
+  qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+  int calls = 0;
+  const qi::BenchmarkResult& r = suite.run("bench", "", 0, 5, 4, [&] { calls += 4; });
+  EXPECT_EQ(32, calls);
+  EXPECT_EQ(20u, r.iterations);
+
+  // The warm-up is bounded by the iterations.
+  calls = 0;
+  suite.run("short", "", 0, 2, 1, [&] { ++calls; });
+  EXPECT_EQ(4, calls);
+}
+
+TEST(TestBenchmark, JSONRoundTrip)
+{
+  qi::BenchmarkOptions options;
+  options.output = tmpFile("results.json");
+  {
+    qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+    suite.add("first", "8", 8, makeSamples(100), qi::MilliSeconds(1), 200);
+    suite.add("second", "", 0, makeSamples(10), qi::MilliSeconds(1), -1);
+    EXPECT_EQ(0u, suite.close());
+  }
+
+  const std::vector<qi::BenchmarkResult> results = qi::readBenchmarkResults(options.output);
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ("first", results[0].name);
+  EXPECT_EQ("8", results[0].variable);
+  EXPECT_EQ(8u, results[0].msgSize);
+  EXPECT_EQ(100u, results[0].iterations);
+  EXPECT_DOUBLE_EQ(50., results[0].p50);
+  EXPECT_DOUBLE_EQ(2., results[0].allocations);
+  EXPECT_EQ("second", results[1].name);
+  EXPECT_DOUBLE_EQ(-1., results[1].allocations);
+}
+
+TEST(TestBenchmark, CSVOutput)
+{
+  qi::BenchmarkOptions options;
+  options.output = tmpFile("results.csv");
+  {
+    qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+    suite.add("bench", "var", 16, makeSamples(10), qi::MicroSeconds(10), 10);
+  }
+
+  EXPECT_EQ("project,executable,name,variable,msg_size,iterations,"
+            "mean_us,min_us,p50_us,p99_us,p999_us,max_us,cpu_us,allocations\n"
+            "qi,test_benchmark,bench,var,16,10,5.5,1,5,10,10,10,1,1\n",
+            readFile(options.output));
+}
+
+TEST(TestBenchmark, BaselineRegressions)
+{
+  qi::BenchmarkOptions options;
+  options.output = tmpFile("baseline.json");
+  {
+    qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+    suite.add("stable", "", 0, makeSamples(100), qi::MilliSeconds(1), -1);
+    suite.add("slower", "", 0, makeSamples(100), qi::MilliSeconds(1), -1);
+    suite.add("faster", "", 0, makeSamples(100), qi::MilliSeconds(1), -1);
+  }
+
+  options.baseline = options.output;
+  options.output.clear();
+  options.tolerance = 10.;
+  qi::BenchmarkSuite suite("qi", "test_benchmark", options);
+  suite.add("stable", "", 0, makeSamples(100), qi::MilliSeconds(1), -1);
+  suite.add("slower", "", 0, makeSamples(100, 2), qi::MilliSeconds(1), -1);
+  suite.add("faster", "", 0, makeSamples(100, 1), qi::MilliSeconds(1), -1, 2);
+  suite.add("new", "", 0, makeSamples(100, 3), qi::MilliSeconds(1), -1);
+  EXPECT_EQ(1u, suite.close());
+  EXPECT_EQ(0u, suite.close());
+}
+
+TEST(TestBenchmark, MissingBaselineThrows)
+{
+  EXPECT_ANY_THROW(qi::readBenchmarkResults(tmpFile("missing.json")));
+}
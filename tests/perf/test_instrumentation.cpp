@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ *  Use of this source code is governed by a BSD-style license that can be
+ *  found in the COPYING file.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <qi/buffer.hpp>
+#include <qi/future.hpp>
+#include <qi/signal.hpp>
+#include <qi/strand.hpp>
+#include <qi/perf/instrumentation.hpp>
+
+namespace
+{
+  const qi::instrumentation::LockStats* findLock(const qi::instrumentation::Snapshot& snapshot,
+                                                 const std::string& name)
+  {
+    const auto it = std::find_if(snapshot.locks.begin(), snapshot.locks.end(),
+        [&](const qi::instrumentation::LockStats& s) { return s.name == name; });
+    return it == snapshot.locks.end() ? nullptr : &*it;
+  }
+
+  qi::uint64_t allocations(const qi::instrumentation::Snapshot& snapshot,
+                           qi::instrumentation::AllocationSubsystem subsystem)
+  {
+    return snapshot.allocations.at(subsystem).count;
+  }
+
+  class TestInstrumentation : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      _wasEnabled = qi::instrumentation::isEnabled();
+      qi::instrumentation::setEnabled(true);
+      qi::instrumentation::reset();
+    }
+
+    void TearDown() override
+    {
+      qi::instrumentation::setEnabled(_wasEnabled);
+    }
+
+    bool _wasEnabled;
+  };
+}
+
+TEST_F(TestInstrumentation, SnapshotListsAllSubsystems)
+{
+  const qi::instrumentation::Snapshot snapshot = qi::instrumentation::snapshot();
+  ASSERT_EQ(static_cast<std::size_t>(qi::instrumentation::AllocationSubsystem_Count),
+            snapshot.allocations.size());
+  EXPECT_EQ("Buffer", snapshot.allocations[qi::instrumentation::AllocationSubsystem_Buffer].subsystem);
+  EXPECT_EQ("StrandCallback",
+            snapshot.allocations[qi::instrumentation::AllocationSubsystem_StrandCallback].subsystem);
+  EXPECT_EQ(qi::instrumentation::isCompiled(), snapshot.enabled);
+}
+
+#ifdef QI_WITH_INSTRUMENTATION
+
+TEST_F(TestInstrumentation, CountsLocksAndAllocations)
+{
+  {
+    qi::Promise<int> promise;
+    promise.setValue(1);
+    promise.future().value();
+  }
+  {
+    qi::Buffer buffer;
+    const std::vector<char> data(4096, 'q');
+    buffer.write(data.data(), data.size());
+  }
+  {
+    qi::Strand strand;
+    strand.async([] {}).wait();
+  }
+  {
+    qi::Signal<int> signal;
+    signal.connect([](int) {});
+    signal(1);
+  }
+
+  const qi::instrumentation::Snapshot snapshot = qi::instrumentation::snapshot();
+  EXPECT_TRUE(snapshot.enabled);
+  for (const char* name : {"qi.future", "qi.strand", "qi.signal"})
+  {
+    const qi::instrumentation::LockStats* stats = findLock(snapshot, name);
+    ASSERT_TRUE(stats) << name;
+    EXPECT_GT(stats->acquisitions, 0u) << name;
+    ASSERT_EQ(qi::instrumentation::waitHistogramSize, stats->waitHistogram.size());
+  }
+  EXPECT_GE(allocations(snapshot, qi::instrumentation::AllocationSubsystem_Future), 1u);
+  EXPECT_GE(allocations(snapshot, qi::instrumentation::AllocationSubsystem_Buffer), 1u);
+  EXPECT_GE(snapshot.allocations[qi::instrumentation::AllocationSubsystem_Buffer].bytes, 4096u);
+  EXPECT_GE(allocations(snapshot, qi::instrumentation::AllocationSubsystem_StrandCallback), 1u);
+}
+
+TEST_F(TestInstrumentation, MeasuresContention)
+{
+  qi::Promise<void> promise;
+  qi::Future<void> future = promise.future();
+  qi::detail::FutureMutex mutex;
+  std::thread holder;
+  {
+    qi::detail::FutureMutex::scoped_lock lock(mutex);
+    holder = std::thread([&] {
+      promise.setValue(nullptr);
+      qi::detail::FutureMutex::scoped_lock contended(mutex);
+    });
+    future.wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  holder.join();
+
+  const qi::instrumentation::Snapshot snapshot = qi::instrumentation::snapshot();
+  const qi::instrumentation::LockStats* stats = findLock(snapshot, "qi.future");
+  ASSERT_TRUE(stats);
+  EXPECT_GE(stats->contentions, 1u);
+  EXPECT_GE(stats->waitMax, 10u * 1000 * 1000);
+  EXPECT_GE(stats->holdMax, 10u * 1000 * 1000);
+}
+
+TEST_F(TestInstrumentation, DisabledCountsNothing)
+{
+  qi::instrumentation::setEnabled(false);
+  {
+    qi::Promise<int> promise;
+    promise.setValue(1);
+  }
+  const qi::instrumentation::Snapshot snapshot = qi::instrumentation::snapshot();
+  EXPECT_FALSE(snapshot.enabled);
+  EXPECT_EQ(0u, allocations(snapshot, qi::instrumentation::AllocationSubsystem_Future));
+  if (const qi::instrumentation::LockStats* stats = findLock(snapshot, "qi.future"))
+    EXPECT_EQ(0u, stats->acquisitions);
+}
+
+#else
+
+TEST_F(TestInstrumentation, NotCompiledCountsNothing)
+{
+  EXPECT_FALSE(qi::instrumentation::isCompiled());
+  EXPECT_FALSE(qi::instrumentation::isEnabled());
+  {
+    qi::Promise<int> promise;
+    promise.setValue(1);
+  }
+  EXPECT_EQ(0u, allocations(qi::instrumentation::snapshot(),
+                            qi::instrumentation::AllocationSubsystem_Future));
+}
+
+#endif
@@ -28,3 +28,18 @@ TEST(TestMeasure, DISABLED_TestNumFD)
   ASSERT_EQ(numFD + 1, qi::measure::getNumFD());
 #endif
 }
+
+TEST(TestMeasure, ProcessCpuTimeIncreases)
+{
+  const qi::Duration start = qi::measure::getProcessCpuTime();
+  volatile unsigned long sum = 0;
+  const qi::SteadyClock::time_point deadline = qi::SteadyClock::now() + qi::MilliSeconds(20);
+  while (qi::SteadyClock::now() < deadline)
+    sum = sum + 1;
+  EXPECT_GT(qi::measure::getProcessCpuTime(), start);
+}
+
+TEST(TestMeasure, AllocationsNotCountedByDefault)
+{
+  EXPECT_EQ(-1, qi::measure::getAllocationCount());
+}
@@ -0,0 +1,143 @@
+/*
+** Copyright (C) 2018 Softbank Robotics Europe
+** See COPYING for the license
+*/
+
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+#include <qi/log.hpp>
+#include "../../src/logring_p.hpp"
+
+namespace
+{
+  qi::log::CategoryType testCategory()
+  {
+    return qi::log::addCategory("qi.test.logring");
+  }
+
+  bool push(qi::log::detail::LogRing& ring, const std::string& message, int line = 0)
+  {
+    return ring.tryPush(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(),
+                        testCategory(), __FILE__, "push", line, message.c_str())
+        == qi::log::detail::LogRing::PushResult_Pushed;
+  }
+}
+
+TEST(LogRing, PushAndPop)
+{
+  qi::log::detail::LogRing ring(4096);
+  EXPECT_TRUE(ring.empty());
+  qi::log::detail::LogRing::Record record;
+  EXPECT_FALSE(ring.front(record));
+
+  ASSERT_TRUE(push(ring, "first", 1));
+  ASSERT_TRUE(push(ring, "second", 2));
+  EXPECT_FALSE(ring.empty());
+
+  ASSERT_TRUE(ring.front(record));
+  EXPECT_EQ(std::string("first"), record.message);
+  EXPECT_EQ(std::string(__FILE__), record.file);
+  EXPECT_EQ(std::string("push"), record.function);
+  EXPECT_EQ(1, record.line);
+  EXPECT_EQ(qi::LogLevel_Info, record.level);
+  EXPECT_EQ(testCategory(), record.category);
+  ring.pop();
+
+  ASSERT_TRUE(ring.front(record));
+  EXPECT_EQ(std::string("second"), record.message);
+  ring.pop();
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(LogRing, FullRingRejectsRecords)
+{
+  qi::log::detail::LogRing ring(4096);
+  const std::string message(200, 'x');
+  int pushed = 0;
+  while (push(ring, message))
+    ++pushed;
+  EXPECT_GT(pushed, 0);
+  EXPECT_LT(pushed * message.size(), ring.capacity());
+
+  // Popping one record makes room for another one.
+  ring.pop();
+  EXPECT_TRUE(push(ring, message));
+}
+
+TEST(LogRing, WrapsAround)
+{
+  qi::log::detail::LogRing ring(4096);
+  qi::log::detail::LogRing::Record record;
+  for (int i = 0; i < 1000; ++i)
+  {
+    const std::string message = "message " + std::to_string(i) + std::string(i % 97, '.');
+    ASSERT_TRUE(push(ring, message, i));
+    ASSERT_TRUE(ring.front(record));
+    EXPECT_EQ(message, record.message);
+    EXPECT_EQ(i, record.line);
+    ring.pop();
+  }
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(LogRing, LargeMessagesAreTruncated)
+{
+  qi::log::detail::LogRing ring(4096);
+  const std::string message(ring.capacity(), 'x');
+  ASSERT_TRUE(push(ring, message));
+  qi::log::detail::LogRing::Record record;
+  ASSERT_TRUE(ring.front(record));
+  const std::string received = record.message;
+  EXPECT_FALSE(received.empty());
+  EXPECT_LT(received.size(), ring.capacity() / 4);
+  EXPECT_EQ(std::string(received.size(), 'x'), received);
+}
+
+TEST(LogRing, RecordsThatCannotFitAreTooBig)
+{
+  qi::log::detail::LogRing ring(4096);
+  const std::string function(ring.capacity(), 'f');
+  EXPECT_EQ(qi::log::detail::LogRing::PushResult_TooBig,
+            ring.tryPush(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(),
+                         testCategory(), __FILE__, function.c_str(), 0, "message"));
+  EXPECT_TRUE(ring.empty());
+
+  // A full ring rejects the records that would fit once drained.
+  const std::string message(200, 'x');
+  while (push(ring, message))
+    ;
+  EXPECT_EQ(qi::log::detail::LogRing::PushResult_Full,
+            ring.tryPush(qi::LogLevel_Info, qi::Clock::now(), qi::SystemClock::now(),
+                         testCategory(), __FILE__, "push", 0, message.c_str()));
+}
+
+TEST(LogRing, ProducerAndConsumerThreads)
+{
+  qi::log::detail::LogRing ring(1024);
+  const int count = 100000;
+  std::thread producer([&] {
+    for (int i = 0; i < count; ++i)
+    {
+      const std::string message = std::to_string(i);
+      while (!push(ring, message, i))
+        std::this_thread::yield();
+    }
+  });
+
+  qi::log::detail::LogRing::Record record;
+  for (int expected = 0; expected < count;)
+  {
+    if (!ring.front(record))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(expected, record.line);
+    ASSERT_EQ(std::to_string(expected), record.message);
+    ring.pop();
+    ++expected;
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
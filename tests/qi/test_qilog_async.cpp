@@ -46,6 +46,38 @@ public:
   }
 };
 
+// Counts the messages of the test category, and the reports of dropped
+// messages.
+class CountingHandler
+{
+public:
+  std::atomic<int> count{0};
+  std::atomic<int> droppedReports{0};
+  qi::Promise<void> start;
+  LogHandler handler;
+
+  explicit CountingHandler(const std::string& name)
+    : handler(name, std::ref(*this), qi::LogLevel_Verbose)
+  {
+  }
+
+  void operator()(const qi::LogLevel,
+                  const qi::Clock::time_point,
+                  const qi::SystemClock::time_point,
+                  const std::string category,
+                  const char* msg,
+                  const char*,
+                  const char*,
+                  int)
+  {
+    start.future().wait();
+    if (category == testCategory)
+      ++count;
+    else if (category == "qi.log" && std::string(msg).find("dropped") != std::string::npos)
+      ++droppedReports;
+  }
+};
+
 }
 
 class AsyncLog : public ::testing::Test
@@ -79,3 +111,53 @@ TEST_F(AsyncLog, cats)
   qiLogCategory("pan");
   qiLogWarningF("canard %s", 12);
 }
+
+TEST_F(AsyncLog, overflowDropsAndReports)
+{
+  CountingHandler handler("CountingHandler");
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Drop);
+  qiLogCategory(testCategory);
+  const std::string payload(4096, 'x');
+  // Far more than the default buffer of a thread while the handler blocks.
+  for (int i = 0; i < iterations; i++)
+    qiLogVerbose() << payload;
+
+  handler.start.setValue(0);
+  qi::log::flush();
+  EXPECT_LT(handler.count.load(), iterations);
+  EXPECT_GT(handler.count.load(), 0);
+  EXPECT_EQ(1, handler.droppedReports.load());
+}
+
+TEST_F(AsyncLog, overflowBlocks)
+{
+  CountingHandler handler("CountingHandler");
+  handler.start.setValue(0);
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Block);
+  qiLogCategory(testCategory);
+  const std::string payload(4096, 'x');
+  for (int i = 0; i < iterations; i++)
+    qiLogVerbose() << payload;
+
+  qi::log::flush();
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Drop);
+  EXPECT_EQ(iterations, handler.count.load());
+  EXPECT_EQ(0, handler.droppedReports.load());
+}
+
+TEST_F(AsyncLog, recordsLargerThanTheBufferDoNotBlock)
+{
+  CountingHandler handler("CountingHandler");
+  handler.start.setValue(0);
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Block);
+  // Far more than the default buffer of a thread: the message is truncated,
+  // and a function name that cannot fit is dispatched synchronously.
+  const std::string huge(1024 * 1024, 'x');
+  qi::log::log(qi::LogLevel_Info, testCategory, huge.c_str(), __FILE__, __FUNCTION__, __LINE__);
+  qi::log::log(qi::LogLevel_Info, testCategory, "message", __FILE__, huge.c_str(), __LINE__);
+
+  qi::log::flush();
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Drop);
+  EXPECT_EQ(2, handler.count.load());
+  EXPECT_EQ(0, handler.droppedReports.load());
+}
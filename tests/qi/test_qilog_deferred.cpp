@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#include "test_qilog.hpp"
+#include "qi/testutils/mockutils.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <gmock/gmock.h>
+
+#include <qi/log.hpp>
+#include <qi/log/binaryfileloghandler.hpp>
+#include <qi/os.hpp>
+
+using ::testing::StrEq;
+
+qiLogCategory("qi.test.logdeferred");
+
+namespace
+{
+  struct Streamable
+  {
+    int value;
+  };
+
+  std::ostream& operator<<(std::ostream& o, const Streamable& s)
+  {
+    return o << "Streamable(" << s.value << ")";
+  }
+
+  template <typename... Args>
+  std::string encodeAndFormat(const char* format, const Args&... values)
+  {
+    qi::log::detail::DeferredArgs args;
+    qi::log::detail::encodeDeferredArgs(args, values...);
+    return qi::log::formatDeferred(format, args.data(), args.size());
+  }
+
+  // Keeps the last message of the qiLog*Deferred macros, before formatting.
+  class DeferredHandler
+  {
+  public:
+    std::string format;
+    std::string args;
+    int count = 0;
+
+    DeferredHandler()
+    {
+      qi::log::addHandler("deferredhandler", &dummyHandler,
+                          [this](qi::Clock::time_point,
+                                 qi::SystemClock::time_point,
+                                 const char*,
+                                 const qi::log::LogSite& site,
+                                 const char* a,
+                                 std::size_t size) {
+                            format = site.format;
+                            args.assign(a, size);
+                            ++count;
+                          });
+    }
+
+    ~DeferredHandler()
+    {
+      qi::log::removeHandler("deferredhandler");
+    }
+  };
+
+  class DeferredLog : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      qi::log::setSynchronousLog(true);
+    }
+
+    void TearDown() override
+    {
+      qi::log::flush();
+    }
+  };
+}
+
+TEST(FormatDeferred, FormatsEncodedArguments)
+{
+  const std::string str = "string";
+  const char* cstr = "c string";
+  EXPECT_EQ("no argument", encodeAndFormat("no argument"));
+  EXPECT_EQ("int -42 unsigned 42 char c bool 1",
+            encodeAndFormat("int %s unsigned %s char %s bool %s", -42, 42u, 'c', true));
+  EXPECT_EQ("double 1.5 float 0.25", encodeAndFormat("double %s float %s", 1.5, 0.25f));
+  EXPECT_EQ("literal string c string",
+            encodeAndFormat("%s %s %s", "literal", str, cstr));
+  EXPECT_EQ("Streamable(3)", encodeAndFormat("%s", Streamable{3}));
+  EXPECT_EQ("2 1", encodeAndFormat("%2% %1%", 1, 2));
+}
+
+TEST(FormatDeferred, KeepsLargeArguments)
+{
+  const std::string large(1000, 'x');
+  EXPECT_EQ(large + " " + large, encodeAndFormat("%s %s", large, large));
+}
+
+TEST(FormatDeferred, ReportsInvalidArguments)
+{
+  qi::log::detail::DeferredArgs args;
+  qi::log::detail::encodeDeferredArgs(args, std::string("truncated"));
+  const std::string formatted = qi::log::formatDeferred("%s", args.data(), args.size() - 1);
+  EXPECT_NE(std::string::npos, formatted.find("invalid"));
+}
+
+TEST_F(DeferredLog, TextHandlersReceiveFormattedMessages)
+{
+  MockLogHandler handler("deferredmock");
+  const auto _u = scopeMockExpectations(handler);
+  EXPECT_CALL(handler, log(qi::LogLevel_Warning, StrEq("qi.test.logdeferred"),
+                           StrEq("value 42 name foo")));
+  qiLogWarningDeferred("value %d name %s", 42, "foo");
+}
+
+TEST_F(DeferredLog, DeferredHandlersReceiveEncodedArguments)
+{
+  DeferredHandler handler;
+  qiLogInfoDeferred("value %d name %s", 12, std::string("bar"));
+  ASSERT_EQ(1, handler.count);
+  EXPECT_EQ("value %d name %s", handler.format);
+  EXPECT_EQ("value 12 name bar",
+            qi::log::formatDeferred(handler.format.c_str(), handler.args.data(), handler.args.size()));
+}
+
+TEST_F(DeferredLog, Asynchronous)
+{
+  MockLogHandler handler("deferredmock");
+  const auto _u = scopeMockExpectations(handler);
+  EXPECT_CALL(handler, log(qi::LogLevel_Info, StrEq("qi.test.logdeferred"), StrEq("async 1")));
+  qi::log::setSynchronousLog(false);
+  qiLogInfoDeferred("async %d", 1);
+  qi::log::flush();
+  qi::log::setSynchronousLog(true);
+}
+
+TEST_F(DeferredLog, AsynchronousArgumentsLargerThanTheBuffer)
+{
+  // Far more than the default buffer of a thread: waiting for room would
+  // block forever, the message is dispatched synchronously instead.
+  const std::string huge(1024 * 1024, 'x');
+  MockLogHandler handler("deferredmock");
+  const auto _u = scopeMockExpectations(handler);
+  EXPECT_CALL(handler, log(qi::LogLevel_Info, StrEq("qi.test.logdeferred"),
+                           StrEq("large " + huge)));
+  qi::log::setSynchronousLog(false);
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Block);
+  qiLogInfoDeferred("large %s", huge);
+  qi::log::flush();
+  qi::log::setAsynchronousLogOverflowPolicy(qi::LogOverflowPolicy_Drop);
+  qi::log::setSynchronousLog(true);
+}
+
+TEST_F(DeferredLog, BinaryFileKeepsFormatAndArguments)
+{
+  const std::string path = qi::os::mktmpdir("test_qilog_deferred") + "/log.qilog";
+  {
+    qi::log::BinaryFileLogHandler binary(path);
+    qi::log::addHandler("binaryfile",
+                        boost::bind(&qi::log::BinaryFileLogHandler::log, &binary,
+                                    _1, _2, _3, _4, _5, _6, _7, _8),
+                        boost::bind(&qi::log::BinaryFileLogHandler::logDeferred, &binary,
+                                    _1, _2, _3, _4, _5, _6));
+    qiLogInfoDeferred("deferred %s", "argument");
+    qiLogInfo() << "text message";
+    qi::log::removeHandler("binaryfile");
+  }
+
+  std::ifstream in(path.c_str(), std::ios::binary);
+  const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(0u, content.find(qi::log::binarylog::magic));
+  EXPECT_NE(std::string::npos, content.find("qi.test.logdeferred"));
+  EXPECT_NE(std::string::npos, content.find("deferred %s"));
+  EXPECT_NE(std::string::npos, content.find("argument"));
+  EXPECT_EQ(std::string::npos, content.find("deferred argument"));
+  EXPECT_NE(std::string::npos, content.find("text message"));
+  boost::filesystem::remove_all(boost::filesystem::path(path).parent_path());
+}
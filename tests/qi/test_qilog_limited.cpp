@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#include "test_qilog.hpp"
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <gtest/gtest.h>
+
+#include <qi/log.hpp>
+
+qiLogCategory("qi.test.loglimited");
+
+namespace
+{
+  struct Record
+  {
+    qi::LogLevel level;
+    std::string category;
+    std::string message;
+  };
+
+  class LimitedLog : public ::testing::Test
+  {
+  protected:
+    LimitedLog()
+      : handler("limitedhandler",
+                [this](qi::LogLevel level,
+                       qi::Clock::time_point,
+                       qi::SystemClock::time_point,
+                       const char* category,
+                       const char* message,
+                       const char*,
+                       const char*,
+                       int) {
+                  records.push_back(Record{level, category, message});
+                })
+    {
+    }
+
+    void SetUp() override
+    {
+      qi::log::setSynchronousLog(true);
+      // Summaries of previous tests.
+      qi::log::flush();
+      records.clear();
+    }
+
+    std::size_t count(const std::string& message) const
+    {
+      std::size_t n = 0;
+      for (const auto& record : records)
+        n += record.message == message ? 1 : 0;
+      return n;
+    }
+
+    std::vector<Record> records;
+    LogHandler handler;
+  };
+}
+
+TEST_F(LimitedLog, SampledKeepsOneMessageOutOfPeriod)
+{
+  for (int i = 0; i < 100; ++i)
+    qiLogWarningSampled(10) << "sampled";
+  EXPECT_EQ(10u, count("sampled"));
+
+  qi::log::flush();
+  ASSERT_EQ(1u, count("90 log message(s) suppressed"));
+  EXPECT_EQ(qi::LogLevel_Warning, records.back().level);
+  EXPECT_EQ("qi.test.loglimited", records.back().category);
+}
+
+TEST_F(LimitedLog, LimitedKeepsAtMostMaxPerSecond)
+{
+  for (int i = 0; i < 1000; ++i)
+    qiLogWarningLimited(5) << "limited";
+  const std::size_t logged = count("limited");
+  // The loop may run across two seconds.
+  EXPECT_GE(logged, 5u);
+  EXPECT_LE(logged, 10u);
+
+  qi::log::flush();
+  EXPECT_EQ(1u, count(std::to_string(1000 - logged) + " log message(s) suppressed"));
+}
+
+TEST_F(LimitedLog, LimitedResumesAfterOneSecond)
+{
+  for (int i = 0; i < 10; ++i)
+    qiLogInfoLimited(1) << "resumed";
+  const std::size_t logged = count("resumed");
+  qi::os::msleep(1100);
+  qiLogInfoLimited(1) << "resumed";
+  EXPECT_EQ(logged + 1u, count("resumed"));
+}
+
+TEST_F(LimitedLog, WithCategory)
+{
+  for (int i = 0; i < 3; ++i)
+    qiLogErrorSampled(3, "qi.test.loglimited.other", "value %d", i);
+  ASSERT_EQ(1u, count("value 0"));
+
+  qi::log::flush();
+  ASSERT_EQ(1u, count("2 log message(s) suppressed"));
+  EXPECT_EQ(qi::LogLevel_Error, records.back().level);
+  EXPECT_EQ("qi.test.loglimited.other", records.back().category);
+}
+
+TEST_F(LimitedLog, NothingSuppressedNothingReported)
+{
+  qiLogInfoLimited(10) << "single";
+  qi::log::flush();
+  ASSERT_EQ(1u, records.size());
+  EXPECT_EQ("single", records.front().message);
+}
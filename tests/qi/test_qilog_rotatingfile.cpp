@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include <qi/log.hpp>
+#include <qi/log/rotatingfileloghandler.hpp>
+#include <qi/os.hpp>
+
+namespace
+{
+  std::string readFile(const std::string& path)
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  }
+
+  class RotatingFileLog : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      dir = qi::os::mktmpdir("test_qilog_rotatingfile");
+      path = dir + "/log.txt";
+      options.flushInterval = qi::Duration::zero();
+    }
+
+    void TearDown() override
+    {
+      boost::filesystem::remove_all(dir);
+    }
+
+    void log(qi::log::RotatingFileLogHandler& handler,
+             qi::LogLevel level,
+             const std::string& message)
+    {
+      handler.log(level, qi::Clock::now(), qi::SystemClock::now(), "qi.test.rotatingfile",
+                  message.c_str(), __FILE__, __FUNCTION__, __LINE__);
+    }
+
+    std::string dir;
+    std::string path;
+    qi::log::RotatingFileLogOptions options;
+  };
+}
+
+TEST_F(RotatingFileLog, BuffersUntilFlush)
+{
+  qi::log::RotatingFileLogHandler handler(path, options);
+  log(handler, qi::LogLevel_Info, "buffered");
+  EXPECT_EQ(std::string::npos, readFile(path).find("buffered"));
+  handler.flush();
+  EXPECT_NE(std::string::npos, readFile(path).find("buffered"));
+}
+
+TEST_F(RotatingFileLog, ErrorsAreWrittenRightAway)
+{
+  qi::log::RotatingFileLogHandler handler(path, options);
+  log(handler, qi::LogLevel_Info, "before");
+  log(handler, qi::LogLevel_Error, "failure");
+  const std::string content = readFile(path);
+  EXPECT_NE(std::string::npos, content.find("before"));
+  EXPECT_NE(std::string::npos, content.find("failure"));
+}
+
+TEST_F(RotatingFileLog, FlushesWhenBufferIsFull)
+{
+  options.bufferSize = 1024;
+  qi::log::RotatingFileLogHandler handler(path, options);
+  for (int i = 0; i < 100; ++i)
+    log(handler, qi::LogLevel_Info, "message " + std::to_string(i));
+  EXPECT_NE(std::string::npos, readFile(path).find("message 0"));
+}
+
+TEST_F(RotatingFileLog, FlushesPeriodically)
+{
+  options.flushInterval = qi::MilliSeconds(10);
+  qi::log::RotatingFileLogHandler handler(path, options);
+  log(handler, qi::LogLevel_Info, "periodic");
+  for (int i = 0; i < 100 && readFile(path).find("periodic") == std::string::npos; ++i)
+    qi::os::msleep(10);
+  EXPECT_NE(std::string::npos, readFile(path).find("periodic"));
+}
+
+TEST_F(RotatingFileLog, RotatesOnSizeAndKeepsMaxFiles)
+{
+  options.maxFileSize = 1024;
+  options.maxFiles = 2;
+  {
+    qi::log::RotatingFileLogHandler handler(path, options);
+    for (int i = 0; i < 200; ++i)
+      log(handler, qi::LogLevel_Info, "message " + std::to_string(i));
+  }
+  EXPECT_TRUE(boost::filesystem::exists(path));
+  EXPECT_TRUE(boost::filesystem::exists(path + ".1"));
+  EXPECT_TRUE(boost::filesystem::exists(path + ".2"));
+  EXPECT_FALSE(boost::filesystem::exists(path + ".3"));
+  EXPECT_LE(boost::filesystem::file_size(path + ".1"), 2 * options.maxFileSize);
+  EXPECT_NE(std::string::npos, readFile(path).find("message 199"));
+}
+
+TEST_F(RotatingFileLog, CompressesRotatedFiles)
+{
+  options.maxFileSize = 1024;
+  options.maxFiles = 2;
+  options.compress = true;
+  {
+    qi::log::RotatingFileLogHandler handler(path, options);
+    for (int i = 0; i < 200; ++i)
+      log(handler, qi::LogLevel_Info, "message " + std::to_string(i));
+  }
+  EXPECT_TRUE(boost::filesystem::exists(path));
+  EXPECT_TRUE(boost::filesystem::exists(path + ".1.gz"));
+  EXPECT_TRUE(boost::filesystem::exists(path + ".2.gz"));
+  EXPECT_FALSE(boost::filesystem::exists(path + ".1"));
+  EXPECT_FALSE(boost::filesystem::exists(path + ".3.gz"));
+}
+
+TEST_F(RotatingFileLog, CompressingDoesNotLeaveOtherFiles)
+{
+  options.maxFileSize = 256;
+  options.maxFiles = 3;
+  options.compress = true;
+  {
+    qi::log::RotatingFileLogHandler handler(path, options);
+    // Rotations faster than the compression: the oldest files are dropped.
+    for (int i = 0; i < 1000; ++i)
+      log(handler, qi::LogLevel_Info, "message " + std::to_string(i));
+  }
+  std::vector<std::string> files;
+  for (boost::filesystem::directory_iterator it(dir), end; it != end; ++it)
+    files.push_back(it->path().filename().string());
+  std::sort(files.begin(), files.end());
+  EXPECT_EQ((std::vector<std::string>{"log.txt", "log.txt.1.gz", "log.txt.2.gz", "log.txt.3.gz"}),
+            files);
+}
@@ -523,6 +523,37 @@ TEST_F(SyncLog, emptyLogWithCat)
   qiLogFatal("log.test1");
 }
 
+TEST_F(SyncLog, invisibleLogWithCatIsNotEvaluated)
+{
+  MockLogHandler handler("brownies");
+  // Previous tests left subscribers with other levels.
+  for (log::SubscriberId sub = 0; sub <= handler.id; ++sub)
+    log::addFilter("log.test.invisible", LogLevel_Info, sub);
+  int evaluated = 0;
+  const auto evaluate = [&] { return ++evaluated; };
+
+  qiLogVerbose("log.test.invisible") << evaluate(); // will not log
+  EXPECT_EQ(0, evaluated);
+
+  EXPECT_CALL(handler, log(_, _, _));
+  qiLogWarning("log.test.invisible") << evaluate();
+  EXPECT_EQ(1, evaluated);
+}
+
+TEST_F(SyncLog, categoryNamesReusingAnAddress)
+{
+  MockLogHandler handler("eclairs");
+  char name[32];
+
+  const auto _u = scopeMockExpectations(handler);
+  EXPECT_CALL(handler, log(_, StrEq("log.test.first"), StrEq("first")));
+  EXPECT_CALL(handler, log(_, StrEq("log.test.second"), StrEq("second")));
+  std::strcpy(name, "log.test.first");
+  qiLogWarning(name) << "first";
+  std::strcpy(name, "log.test.second");
+  qiLogWarning(name) << "second";
+}
+
 TEST_F(SyncLog, emptyLog)
 {
   MockLogHandler handler("cookies again");
@@ -7,6 +7,8 @@
 #include <cmath>
 #include <gtest/gtest.h>
 #include <map>
+#include <sstream>
+#include <boost/optional.hpp>
 #include <qi/anyvalue.hpp>
 #include <qi/application.hpp>
 #include <qi/type/typeinterface.hpp>
@@ -456,3 +458,145 @@ TEST(DecodeJSON, StructWithDifferentSizedFields)
   EXPECT_EQ(val,
             res) << qi::encodeJSON(val) << "\n" << qi::encodeJSON(res);
 }
+
+TEST(EncodeJSON, AppendsToStringAndWritesToStream)
+{
+  std::map<std::string, std::vector<int>> value;
+  value["a"] = std::vector<int>{1, -2, 3};
+  value["b\xc3\xa9"] = std::vector<int>();
+  const std::string expected = qi::encodeJSON(value, qi::JsonOption_PrettyPrint);
+
+  std::string out = "prefix";
+  qi::encodeJSON(value, out, qi::JsonOption_PrettyPrint);
+  EXPECT_EQ("prefix" + expected, out);
+
+  std::ostringstream stream;
+  qi::encodeJSON(value, stream, qi::JsonOption_PrettyPrint);
+  EXPECT_EQ(expected, stream.str());
+}
+
+TEST(EncodeJSON, IntegerLimits)
+{
+  EXPECT_EQ("-9223372036854775808", qi::encodeJSON(std::numeric_limits<int64_t>::min()));
+  EXPECT_EQ("18446744073709551615", qi::encodeJSON(std::numeric_limits<uint64_t>::max()));
+  EXPECT_EQ("0", qi::encodeJSON(0u));
+}
+
+TEST(EncodeJSON, ControlCharacters)
+{
+  EXPECT_EQ("\"a\\u0001\\u007F\\\"\\\\\"", qi::encodeJSON(std::string("a\x01\x7f\"\\")));
+}
+
+TEST(DecodeJSON, Stream)
+{
+  std::istringstream in("{\"a\": [1, 2.5, \"x\"]} 42");
+  qi::AnyValue value = qi::decodeJSON(in);
+  ASSERT_EQ(qi::TypeKind_Map, value.kind());
+  EXPECT_EQ(2.5, value["a"].content()[1].content().toDouble());
+
+  // The stream is not read past the value.
+  int next = 0;
+  in >> next;
+  EXPECT_EQ(42, next);
+}
+
+TEST(DecodeJSON, LargeIntegersAndSurrogatePairs)
+{
+  EXPECT_EQ(std::numeric_limits<uint64_t>::max(), qi::decodeJSON("18446744073709551615").asUInt64());
+  EXPECT_EQ(1e20, qi::decodeJSON("100000000000000000000").toDouble());
+  EXPECT_EQ("\xf0\x9f\x98\x80", qi::decodeJSON("\"\\uD83D\\uDE00\"").toString());
+}
+
+struct JsonInner
+{
+  std::string name;
+  std::vector<double> values;
+};
+QI_TYPE_STRUCT(JsonInner, name, values);
+
+struct JsonOuter
+{
+  int id;
+  boost::optional<std::string> comment;
+  std::map<std::string, JsonInner> inners;
+  std::map<int, bool> flags;
+};
+QI_TYPE_STRUCT(JsonOuter, id, comment, inners, flags);
+
+TEST(DecodeJSON, IntoTypedTarget)
+{
+  JsonOuter outer;
+  outer.id = 3;
+  outer.comment = std::string("hello");
+  outer.inners["first"].name = "one";
+  outer.inners["first"].values = std::vector<double>{0.1, -2.5e-3};
+  outer.inners["second"].name = "two";
+  outer.flags[4] = true;
+
+  // Unknown members are skipped.
+  std::string json = qi::encodeJSON(outer);
+  json.insert(1, "\"unknown\": [1, {\"a\": null}], ");
+  // Non-string keys are encoded without quotes.
+  ASSERT_NE(std::string::npos, json.find("{4:true}"));
+
+  JsonOuter result;
+  qi::decodeJSON(json, qi::AnyReference::from(result));
+  EXPECT_EQ(3, result.id);
+  EXPECT_EQ(std::string("hello"), *result.comment);
+  ASSERT_EQ(2u, result.inners.size());
+  EXPECT_EQ("one", result.inners["first"].name);
+  EXPECT_EQ(outer.inners["first"].values, result.inners["first"].values);
+  EXPECT_EQ(outer.flags, result.flags);
+
+  qi::decodeJSON("{\"comment\": null, \"flags\": {\"5\": false}}", qi::AnyReference::from(result));
+  EXPECT_FALSE(result.comment);
+  EXPECT_EQ(2u, result.flags.size());
+
+  MPoint point;
+  qi::decodeJSON("[1, 2]", qi::AnyReference::from(point));
+  EXPECT_EQ(1, point.x);
+  EXPECT_EQ(2, point.y);
+
+  std::istringstream in("[[1, 2], [3]]");
+  std::vector<std::vector<int>> lists;
+  qi::decodeJSON(in, qi::AnyReference::from(lists));
+  ASSERT_EQ(2u, lists.size());
+  EXPECT_EQ(std::vector<int>({3}), lists[1]);
+}
+
+TEST(DecodeJSON, IntoTypedTargetMismatch)
+{
+  int i = 0;
+  EXPECT_ANY_THROW(qi::decodeJSON("\"1\"", qi::AnyReference::from(i)));
+  EXPECT_ANY_THROW(qi::decodeJSON("1.5e12", qi::AnyReference::from(i)));
+  std::string s;
+  EXPECT_ANY_THROW(qi::decodeJSON("[]", qi::AnyReference::from(s)));
+  EXPECT_ANY_THROW(qi::decodeJSON("\"abc", qi::AnyReference::from(s)));
+  MPoint point;
+  EXPECT_ANY_THROW(qi::decodeJSON("[1, 2, 3]", qi::AnyReference::from(point)));
+}
+
+TEST(DecodeJSON, IntoRegisteredType)
+{
+  const std::string json =
+      "{\"values\": [1.5, 2], \"extra\": {\"a\": [true, null, \"x\"]}, \"name\": \"n\\u00e9\"}";
+
+  JsonInner inner;
+  qi::decodeJSON(json, inner);
+  EXPECT_EQ("n\xc3\xa9", inner.name);
+  EXPECT_EQ(std::vector<double>({1.5, 2.}), inner.values);
+
+  qi::AnyValue value = qi::decodeJSON(json, qi::typeOf<JsonInner>());
+  EXPECT_EQ(qi::typeOf<JsonInner>()->info(), value.type()->info());
+  EXPECT_EQ("n\xc3\xa9", value.as<JsonInner>().name);
+
+  std::vector<Qiqi> qiqis;
+  qi::decodeJSON("[{\"fint\": 4, \"ffloat\": 0.5}, {\"fdouble\": -1e300}]", qiqis);
+  ASSERT_EQ(2u, qiqis.size());
+  EXPECT_EQ(4, qiqis[0].fint);
+  EXPECT_EQ(0.5f, qiqis[0].ffloat);
+  EXPECT_EQ(-1e300, qiqis[1].fdouble);
+
+  EXPECT_ANY_THROW(qi::decodeJSON("{\"name\": 42}", inner));
+  EXPECT_ANY_THROW(qi::decodeJSON("{\"extra\": [1, }", inner));
+}
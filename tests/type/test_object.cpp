@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <thread>
 #include <chrono>
+#include <limits>
 
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
@@ -328,6 +329,62 @@ TEST(TestFunction, ABI)
   EXPECT_EQ("bar", f.call(convert(fooPtr, "bar")).toString());
 }
 
+namespace
+{
+  double scale(double value, qi::int64_t factor)
+  {
+    return value * static_cast<double>(factor);
+  }
+}
+
+TEST(TestFunction, ConvertsArgumentsOfEachTypeCombination)
+{
+  using namespace qi;
+  AnyFunction f = AnyFunction::from(&scale);
+  const double d = 1.5; const qi::int64_t i64 = 2;
+  const float fl = 1.5f; const int i = 2;
+  const qi::uint8_t u8 = 2; const qi::int16_t i16 = 2;
+  const std::string s = "2";
+  const AnyValue dynamicValue = AnyValue::from(d);
+  const AnyValue dynamicFactor = AnyValue::from(i);
+
+  // Each combination of argument types is converted the same way on the
+  // first call and on the following ones, including when there are more
+  // combinations than the function type keeps conversions for.
+  for (int repeat = 0; repeat < 2; ++repeat)
+  {
+    EXPECT_EQ(3.0, f.call(convert(d, i64)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(fl, i)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(d, i)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(fl, i64)).toDouble());
+    EXPECT_EQ(4.0, f.call(convert(i, u8)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(d, u8)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(d, i16)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(fl, u8)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(fl, i16)).toDouble());
+    EXPECT_EQ(3.0, f.call(convert(dynamicValue, dynamicFactor)).toDouble());
+    EXPECT_ANY_THROW(f.call(convert(d, s)));
+  }
+}
+
+TEST(TestFunction, ConvertsBoundArguments)
+{
+  using namespace qi;
+  Foo foo;
+  const float floatArg = 42.42f;
+  const int intArg = 42;
+  AnyFunction f = AnyFunction::from(&Foo::pingDouble, &foo);
+  for (int repeat = 0; repeat < 2; ++repeat)
+  {
+    EXPECT_NEAR(45.42, f.call(convert(floatArg)).toDouble(), 1e-5);
+    EXPECT_EQ(45.0, f.call(convert(intArg)).toDouble());
+  }
+  f = AnyFunction::from(&Foo::pingDouble);
+  auto* const fooPtr = &foo;
+  for (int repeat = 0; repeat < 2; ++repeat)
+    EXPECT_EQ(45.0, f.call(convert(fooPtr, intArg)).toDouble());
+}
+
 int summ(int p1, short p2, char p3, const char* s)
 {
   return p1 + p2 + p3 + strlen(s);
@@ -838,8 +895,7 @@ TEST(TestObject, FutureSync)
   std::cerr << "ERR " << f.error() << std::endl;
 }
 
-// TODO: fix races in ObjectStatistics to reenable this test
-TEST(TestObject, DISABLED_statisticsGeneric)
+TEST(TestObject, statisticsGeneric)
 {
   qi::DynamicObjectBuilder gob;
   const auto mid = gob.advertiseMethod("sleep", [](qi::MilliSeconds dura) {
@@ -878,8 +934,7 @@ TEST(TestObject, DISABLED_statisticsGeneric)
   EXPECT_EQ(1u, m.count());
 }
 
-// TODO: fix races in ObjectStatistics to reenable this test
-TEST(TestObject, DISABLED_statisticsType)
+TEST(TestObject, statisticsType)
 {
   qi::ObjectTypeBuilder<Adder> builder;
   const auto mid = builder.advertiseMethod("add", &Adder::add);
@@ -900,6 +955,119 @@ TEST(TestObject, DISABLED_statisticsType)
   EXPECT_EQ(2u, stats[mid].count());
 }
 
+TEST(TestObject, statisticsWithoutCpuTime)
+{
+  qi::DynamicObjectBuilder gob;
+  const auto mid = gob.advertiseMethod("spin", [](qi::MilliSeconds dura) {
+    const auto end = qi::SteadyClock::now() + dura;
+    while (qi::SteadyClock::now() < end);
+  });
+  qi::AnyObject obj = gob.object();
+  EXPECT_TRUE(obj.isStatsCpuTimeEnabled());
+  obj.enableStats(true);
+  obj.call<void>("enableStatsCpuTime", false);
+  EXPECT_FALSE(obj.isStatsCpuTimeEnabled());
+  obj.call<void>("spin", qi::MilliSeconds{ 10 });
+  const qi::MethodStatistics m = obj.stats()[mid];
+  EXPECT_EQ(1u, m.count());
+  EXPECT_LE(0.009f, m.wall().maxValue());
+  EXPECT_EQ(0.f, m.user().maxValue());
+  EXPECT_EQ(0.f, m.system().maxValue());
+}
+
+TEST(TestObject, statisticsOfConcurrentCalls)
+{
+  qi::DynamicObjectBuilder gob;
+  const auto mid = gob.advertiseMethod("f", []{});
+  qi::AnyObject obj = gob.object();
+
+  // Durations from 1ms to 100ms, pushed once by each thread.
+  const int threadCount = 8;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+    threads.emplace_back([&]{
+      for (int i = 1; i <= 100; ++i)
+        obj.asGenericObject()->pushStats(mid, i / 1000.f, i / 2000.f, 0.f);
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  const qi::ObjectStatistics called = obj.call<qi::ObjectStatistics>("stats");
+  for (const qi::ObjectStatistics& stats : { obj.stats(), called })
+  {
+    ASSERT_EQ(1u, stats.size());
+    const qi::MethodStatistics& m = stats.at(mid);
+    EXPECT_EQ(800u, m.count());
+    EXPECT_FLOAT_EQ(0.001f, m.wall().minValue());
+    EXPECT_FLOAT_EQ(0.1f, m.wall().maxValue());
+    EXPECT_NEAR(40.4f, m.wall().cumulatedValue(), 0.01f);
+  }
+
+  const qi::ObjectHistograms calledHistograms =
+      obj.call<qi::ObjectHistograms>("statsHistograms");
+  for (const qi::ObjectHistograms& histograms : { obj.statsHistograms(), calledHistograms })
+  {
+    ASSERT_EQ(1u, histograms.size());
+    const qi::MethodHistograms& h = histograms.at(mid);
+    EXPECT_EQ(800u, h.wall().count());
+    // The percentiles are estimated within an eighth of their value.
+    EXPECT_NEAR(0.050f, h.wall().percentile(0.5f), 0.050f / 8);
+    EXPECT_NEAR(0.099f, h.wall().percentile(0.99f), 0.099f / 8);
+    EXPECT_NEAR(0.025f, h.user().percentile(0.5f), 0.025f / 8);
+    EXPECT_EQ(0.f, h.system().percentile(0.99f));
+  }
+
+  obj.clearStats();
+  EXPECT_TRUE(obj.stats().empty());
+  EXPECT_TRUE(obj.statsHistograms().empty());
+}
+
+TEST(TestObject, durationHistogram)
+{
+  qi::DurationHistogram histogram;
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0.f, histogram.percentile(0.5f));
+
+  histogram.push(0.f);
+  histogram.push(-1.f);
+  histogram.push(1e9f);
+  EXPECT_EQ(0.f, histogram.percentile(0.f));
+  EXPECT_EQ(0.f, histogram.percentile(0.5f));
+  // Durations beyond the last bucket are reported at its lower bound.
+  EXPECT_FLOAT_EQ(4294.967296f, histogram.percentile(1.f));
+
+  qi::DurationHistogram other;
+  for (int i = 0; i < 7; ++i)
+    other.push(0.003f);
+  histogram.merge(other);
+  EXPECT_EQ(10u, histogram.count());
+  // 3ms is in the bucket [2.56ms, 3.072ms), the second quarter above 2.048ms.
+  EXPECT_FLOAT_EQ(0.002816f, histogram.percentile(0.5f));
+
+  histogram.reset();
+  EXPECT_EQ(0u, histogram.count());
+}
+
+TEST(TestObject, durationHistogramBounds)
+{
+  qi::DurationHistogram histogram;
+  histogram.push(std::numeric_limits<float>::quiet_NaN());
+  histogram.push(std::numeric_limits<float>::infinity());
+  histogram.push(std::numeric_limits<float>::max());
+  EXPECT_EQ(1u, histogram.counts().front());
+  EXPECT_EQ(2u, histogram.counts().back());
+
+  // The extra buckets of counts received from a peer are counted in the last
+  // one.
+  const std::size_t bucketCount = qi::DurationHistogram::bucketCount;
+  std::vector<qi::uint64_t> counts(bucketCount + 64, 1);
+  const qi::DurationHistogram received(counts);
+  ASSERT_EQ(bucketCount, received.counts().size());
+  EXPECT_EQ(counts.size(), received.count());
+  EXPECT_EQ(65u, received.counts().back());
+  EXPECT_FLOAT_EQ(4294.967296f, received.percentile(1.f));
+}
+
 void pushTrace(std::vector<qi::EventTrace>& target,
     boost::mutex& mutex,
     const qi::EventTrace& trace)
@@ -6,6 +6,8 @@
 // Test that calls happen in the correct event loop
 
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -199,3 +201,47 @@ TEST(TestThreadModelStatic, MethodModel)
   f1.wait();
   ASSERT_LT(qi::os::ustime() - start, 270000);
 }
+
+namespace
+{
+  qi::uint64_t dataAddress(const std::vector<int>& values)
+  {
+    return reinterpret_cast<std::uintptr_t>(values.data());
+  }
+
+  qi::uint64_t queuedDataAddress(const qi::GenericFunctionParameters& params)
+  {
+    qi::DynamicObjectBuilder ob;
+    ob.advertiseMethod("dataAddress", &dataAddress);
+    qi::AnyObject object = ob.object();
+    qi::AnyReference result = object.metaCall("dataAddress", params, qi::MetaCallType_Queued).value();
+    const qi::uint64_t address = result.to<qi::uint64_t>();
+    result.destroy();
+    return address;
+  }
+}
+
+TEST(TestQueuedCall, ClonesArguments)
+{
+  std::vector<int> values{ 1, 2, 3 };
+  qi::GenericFunctionParameters params;
+  params.push_back(qi::AnyReference::from(values));
+  EXPECT_NE(reinterpret_cast<std::uintptr_t>(values.data()), queuedDataAddress(params));
+}
+
+TEST(TestQueuedCall, KeepsOwnedArguments)
+{
+  auto values = std::make_shared<std::vector<int>>(std::vector<int>{ 1, 2, 3 });
+  std::weak_ptr<std::vector<int>> weakValues = values;
+  const auto address = reinterpret_cast<std::uintptr_t>(values->data());
+  {
+    qi::GenericFunctionParameters params;
+    params.push_back(qi::AnyReference::from(*values));
+    params.setStorage(std::move(values));
+    EXPECT_EQ(address, queuedDataAddress(params));
+  }
+  // The call task may still be releasing its copy of the parameters.
+  for (int i = 0; i < 100 && !weakValues.expired(); ++i)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  EXPECT_TRUE(weakValues.expired());
+}
@@ -555,6 +555,88 @@ TEST(TestSignal, WithExecutionContext)
   ASSERT_TRUE(prom.future().value());
 }
 
+TEST(TestSignal, TypedAndGenericSubscribersAreCalledInConnectionOrder)
+{
+  qi::Signal<int> signal;
+  signal.setCallType(qi::MetaCallType_Direct);
+  std::vector<int> calls;
+  signal.connect([&](int v) { calls.push_back(v); });
+  signal.connect(qi::AnyFunction::from(
+      boost::function<void(int)>([&](int v) { calls.push_back(v * 10); })));
+  signal.connect([&](int v) { calls.push_back(v * 100); });
+  signal(2);
+  EXPECT_EQ((std::vector<int>{ 2, 20, 200 }), calls);
+}
+
+namespace
+{
+  // Keeps its count in itself: each copy counts on its own.
+  struct CountingSubscriber
+  {
+    int* total;
+    int count;
+
+    void operator()(int v)
+    {
+      count += v;
+      *total = count;
+    }
+  };
+}
+
+TEST(TestSignal, TypedAndGenericEmissionsShareTheSubscriber)
+{
+  qi::Signal<int> signal;
+  signal.setCallType(qi::MetaCallType_Direct);
+  int total = 0;
+  signal.connect(CountingSubscriber{ &total, 0 });
+  signal(1);
+  int two = 2;
+  qi::GenericFunctionParameters params;
+  params.push_back(qi::AnyReference::from(two));
+  signal.trigger(params);
+  signal(3);
+  // A single instance of the callable saw all the emissions.
+  EXPECT_EQ(6, total);
+}
+
+TEST(TestSignal, TypedSubscriberReceivesACopyWhenAsynchronous)
+{
+  qi::Signal<std::vector<float>> signal;
+  qi::Promise<std::vector<float>> received;
+  signal.connect([=](const std::vector<float>& v) mutable { received.setValue(v); });
+  {
+    std::vector<float> values{ 1.f, 2.f, 3.f };
+    signal(values);
+  }
+  auto future = received.future();
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, future.waitFor(usualTimeout));
+  EXPECT_EQ((std::vector<float>{ 1.f, 2.f, 3.f }), future.value());
+}
+
+TEST(TestSignal, TypedSubscriberThrowingDoesNotStopEmission)
+{
+  qi::Signal<int> signal;
+  signal.setCallType(qi::MetaCallType_Direct);
+  int received = 0;
+  signal.connect([](int) { throw std::runtime_error("subscriber failure"); });
+  signal.connect([&](int v) { received = v; });
+  ASSERT_NO_THROW(signal(42));
+  EXPECT_EQ(42, received);
+}
+
+TEST(TestSignal, DisconnectedTypedSubscriberIsNotCalled)
+{
+  qi::Signal<int> signal;
+  signal.setCallType(qi::MetaCallType_Direct);
+  int received = 0;
+  const qi::SignalLink link = signal.connect([&](int v) { received += v; });
+  signal(1);
+  signal.disconnect(link);
+  signal(1);
+  EXPECT_EQ(1, received);
+}
+
 // ===========================================================
 // Signal Spy
 // -----------------------------------------------------------
@@ -678,6 +678,60 @@ TEST(TestSignature, ObjectAndSeveralAnnotatedStructsCompatibleWithObjectAndSever
   EXPECT_EQ(0., s.isConvertibleTo("(o{ss}{si})"));
 }
 
+TEST(TestSignature, EqualityIgnoresAnnotations)
+{
+  const std::string str = "(i[s]{sd})";
+  EXPECT_EQ(qi::Signature(str), qi::Signature(str.c_str()));
+  EXPECT_EQ(qi::Signature(str), qi::Signature("(i[s]{sd})<Foo,a,b,c>"));
+  EXPECT_EQ(qi::Signature("[i<Bar>]"), qi::Signature("[i]<Baz>"));
+  EXPECT_NE(qi::Signature(str), qi::Signature("(i[s]{sf})"));
+  EXPECT_NE(qi::Signature(str), qi::Signature("(i[s]{sd}i)"));
+  EXPECT_NE(qi::Signature("[i]"), qi::Signature("#i"));
+  EXPECT_NE(qi::Signature("i"), qi::Signature());
+  EXPECT_EQ(qi::Signature(), qi::Signature());
+}
+
+TEST(TestSignature, SameStringsGiveSameSignatures)
+{
+  const qi::Signature first("((s)<Phrase,text>[d])");
+  const qi::Signature second(std::string("((s)<Phrase,text>[d])"));
+  EXPECT_EQ(first.toString(), second.toString());
+  EXPECT_EQ(first.annotation(), second.annotation());
+  ASSERT_EQ(2u, second.children().size());
+  EXPECT_EQ("(s)<Phrase,text>", second.children()[0].toString());
+  EXPECT_EQ("Phrase,text", second.children()[0].annotation());
+  EXPECT_EQ("[d]", second.children()[1].toString());
+  EXPECT_EQ(&first.children(), &second.children());
+}
+
+TEST(TestSignature, ConvertibilityIsTheSameOnEachCall)
+{
+  const std::vector<std::pair<std::string, std::string>> pairs{
+    { "i", "d" }, { "d", "i" }, { "i", "b" }, { "[i]", "[m]" }, { "[i]", "m" },
+    { "{si}", "{sd}" }, { "(s)<Phrase,text>", "{ss}" }, { "+i", "i" }, { "i", "+m" },
+    { "(is)", "(isi)" }, { "s", "i" }
+  };
+  for (const auto& pair : pairs)
+  {
+    const float first = qi::Signature(pair.first).isConvertibleTo(qi::Signature(pair.second));
+    for (int i = 0; i < 3; ++i)
+      EXPECT_EQ(first, qi::Signature(pair.first).isConvertibleTo(qi::Signature(pair.second)))
+          << pair.first << " -> " << pair.second;
+  }
+  EXPECT_EQ(0.f, qi::Signature("s").isConvertibleTo(qi::Signature("i")));
+  EXPECT_EQ(1.f, qi::Signature("[i]").isConvertibleTo(qi::Signature("[i]<Foo>")));
+}
+
+TEST(TestSignature, InvalidStringsThrowOnEachConstruction)
+{
+  for (int i = 0; i < 2; ++i)
+  {
+    EXPECT_THROW(qi::Signature("(i"), std::runtime_error);
+    EXPECT_THROW(qi::Signature(std::string("[i]]")), std::runtime_error);
+    EXPECT_THROW(qi::Signature(""), std::runtime_error);
+  }
+}
+
 std::string trimall(const std::string& s)
 {
   std::string res;
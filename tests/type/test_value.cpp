@@ -6,7 +6,9 @@
 
 #include <map>
 #include <functional>
+#include <thread>
 #include <tuple>
+#include <vector>
 #include <gtest/gtest.h>
 #include <boost/optional.hpp>
 #include <boost/lambda/lambda.hpp>
@@ -1306,6 +1308,52 @@ TEST(Value, OptionalAnyValue)
   EXPECT_ANY_THROW(v.toOptional<std::string>());
 }
 
+TEST(Value, MakeTypeReturnsOneInstancePerElementTypes)
+{
+  EXPECT_EQ(makeListType(typeOf<int>()), makeListType(typeOf<int>()));
+  EXPECT_NE(makeListType(typeOf<int>()), makeListType(typeOf<float>()));
+  EXPECT_EQ(makeMapType(typeOf<int>(), typeOf<std::string>()),
+            makeMapType(typeOf<int>(), typeOf<std::string>()));
+  EXPECT_NE(makeMapType(typeOf<int>(), typeOf<std::string>()),
+            makeMapType(typeOf<std::string>(), typeOf<int>()));
+  EXPECT_EQ(makeOptionalType(typeOf<int>()), makeOptionalType(typeOf<int>()));
+  EXPECT_NE(makeOptionalType(typeOf<int>()), makeOptionalType(typeOf<float>()));
+
+  const std::vector<TypeInterface*> members{ typeOf<int>(), typeOf<std::string>() };
+  EXPECT_EQ(makeTupleType(members), makeTupleType(members));
+  EXPECT_EQ(makeTupleType(members, "Point", { "x", "name" }),
+            makeTupleType(members, "Point", { "x", "name" }));
+  EXPECT_NE(makeTupleType(members), makeTupleType(members, "Point", { "x", "name" }));
+  EXPECT_NE(makeTupleType(members, "Point", { "x", "name" }),
+            makeTupleType(members, "Point", { "y", "name" }));
+  EXPECT_NE(makeTupleType(members), makeTupleType({ typeOf<std::string>(), typeOf<int>() }));
+}
+
+TEST(Value, MakeTypeConcurrentlyReturnsOneInstance)
+{
+  const int threadCount = 8;
+  const std::vector<TypeInterface*> elements{ typeOf<qi::int8_t>(), typeOf<qi::uint16_t>(),
+                                              typeOf<qi::int64_t>(), typeOf<double>() };
+  std::vector<std::vector<TypeInterface*>> results(threadCount);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (TypeInterface* element : elements)
+      {
+        TypeInterface* list = makeListType(makeOptionalType(element));
+        results[t].push_back(list);
+        results[t].push_back(makeMapType(element, list));
+        results[t].push_back(makeTupleType({ element, list }, "ConcurrentTuple", { "e", "l" }));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (int t = 1; t < threadCount; ++t)
+    EXPECT_EQ(results[0], results[t]);
+}
+
 class TypeParameterizedAutoAnyReference : public ::testing::TestWithParam<TypeInterface*> {};
 INSTANTIATE_TEST_CASE_P(
     MostCommonInterfaces,
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2018 Softbank Robotics Europe. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Print as text the logs written by qi::log::BinaryFileLogHandler.
+ */
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/log.hpp>
+#include <qi/log/binaryfileloghandler.hpp>
+
+namespace po = boost::program_options;
+
+namespace
+{
+  struct Site
+  {
+    qi::LogLevel level;
+    int          line;
+    std::string  file;
+    std::string  function;
+    std::string  format;
+  };
+
+  class Reader
+  {
+  public:
+    explicit Reader(std::istream& in)
+      : _in(in)
+    {
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+      return static_cast<bool>(_in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    bool readString(std::string& str)
+    {
+      qi::uint32_t size;
+      if (!read(size))
+        return false;
+      str.resize(size);
+      return size == 0 || static_cast<bool>(_in.read(&str[0], size));
+    }
+
+  private:
+    std::istream& _in;
+  };
+
+  std::string dateToString(qi::int64_t nanoseconds)
+  {
+    std::ostringstream ss;
+    ss << nanoseconds / 1000000000 << "."
+       << std::setw(6) << std::setfill('0') << (nanoseconds % 1000000000) / 1000;
+    return ss.str();
+  }
+
+  // Same layout as the text log handlers.
+  void print(std::ostream& out,
+             int context,
+             qi::LogLevel level,
+             qi::int64_t date,
+             qi::int64_t systemDate,
+             const std::string& category,
+             const std::string& file,
+             int line,
+             const std::string& function,
+             const std::string& message)
+  {
+    if (context & qi::LogContextAttr_Verbosity)
+      out << qi::log::logLevelToString(level) << " ";
+    if (context & qi::LogContextAttr_ShortVerbosity)
+      out << qi::log::logLevelToString(level, false) << " ";
+    if (context & qi::LogContextAttr_Date)
+      out << dateToString(date) << " ";
+    if (context & qi::LogContextAttr_SystemDate)
+      out << dateToString(systemDate) << " ";
+    if (context & qi::LogContextAttr_Category)
+      out << category << ": ";
+    if (context & qi::LogContextAttr_File)
+    {
+      out << file;
+      if (line != 0)
+        out << "(" << line << ")";
+      out << " ";
+    }
+    if (context & qi::LogContextAttr_Function)
+      out << function << "() ";
+    if (context & qi::LogContextAttr_Return)
+      out << std::endl;
+    std::size_t size = message.size();
+    while (size > 0 && (message[size - 1] == '\n' || message[size - 1] == '\r'))
+      --size;
+    out.write(message.data(), static_cast<std::streamsize>(size));
+    out << std::endl;
+  }
+
+  bool decode(std::istream& in, std::ostream& out, int context)
+  {
+    namespace binarylog = qi::log::binarylog;
+
+    char magic[binarylog::magicSize];
+    qi::uint32_t version;
+    qi::uint32_t byteOrderMark;
+    Reader reader(in);
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, binarylog::magic, sizeof(magic)) != 0
+        || !reader.read(version) || !reader.read(byteOrderMark))
+    {
+      std::cerr << "qilog-decode: not a binary log file" << std::endl;
+      return false;
+    }
+    if (version != binarylog::version)
+    {
+      std::cerr << "qilog-decode: unsupported version " << version << std::endl;
+      return false;
+    }
+    if (byteOrderMark != binarylog::byteOrderMark)
+    {
+      std::cerr << "qilog-decode: the file was written on a machine with another byte order"
+                << std::endl;
+      return false;
+    }
+
+    std::vector<std::string> categories;
+    std::vector<Site> sites;
+    qi::uint8_t type;
+    while (reader.read(type))
+    {
+      bool ok = false;
+      switch (type)
+      {
+      case binarylog::RecordType_Category:
+      {
+        qi::uint32_t id;
+        std::string name;
+        ok = reader.read(id) && reader.readString(name) && id == categories.size();
+        categories.push_back(name);
+        break;
+      }
+      case binarylog::RecordType_Site:
+      {
+        qi::uint32_t id;
+        qi::uint8_t level;
+        qi::int32_t line;
+        Site site;
+        ok = reader.read(id) && reader.read(level) && reader.read(line)
+             && reader.readString(site.file) && reader.readString(site.function)
+             && reader.readString(site.format) && id == sites.size();
+        site.level = static_cast<qi::LogLevel>(level);
+        site.line = line;
+        sites.push_back(site);
+        break;
+      }
+      case binarylog::RecordType_Text:
+      {
+        qi::int64_t date, systemDate;
+        qi::uint32_t category;
+        qi::uint8_t level;
+        qi::int32_t line;
+        std::string file, function, message;
+        ok = reader.read(date) && reader.read(systemDate) && reader.read(category)
+             && reader.read(level) && reader.read(line) && reader.readString(file)
+             && reader.readString(function) && reader.readString(message)
+             && category < categories.size();
+        if (ok)
+          print(out, context, static_cast<qi::LogLevel>(level), date, systemDate,
+                categories[category], file, line, function, message);
+        break;
+      }
+      case binarylog::RecordType_Deferred:
+      {
+        qi::int64_t date, systemDate;
+        qi::uint32_t category, site;
+        std::string args;
+        ok = reader.read(date) && reader.read(systemDate) && reader.read(category)
+             && reader.read(site) && reader.readString(args)
+             && category < categories.size() && site < sites.size();
+        if (ok)
+        {
+          const Site& s = sites[site];
+          print(out, context, s.level, date, systemDate, categories[category], s.file, s.line,
+                s.function, qi::log::formatDeferred(s.format.c_str(), args.data(), args.size()));
+        }
+        break;
+      }
+      }
+      if (!ok)
+      {
+        // The last record may be incomplete if the program is still running.
+        std::cerr << "qilog-decode: truncated or invalid record" << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  po::options_description desc("qilog-decode [options] FILE...");
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("context,c", po::value<int>()->default_value(qi::os::getEnvParam<int>("QI_LOG_CONTEXT", 30)),
+     "Context to print, as for QI_LOG_CONTEXT.")
+    ("file", po::value<std::vector<std::string>>(), "Binary log files.");
+  po::positional_options_description positional;
+  positional.add("file", -1);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (vm.count("help") || !vm.count("file"))
+  {
+    std::cout << desc << std::endl;
+    return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const int context = vm["context"].as<int>();
+  int ret = EXIT_SUCCESS;
+  for (const auto& path : vm["file"].as<std::vector<std::string>>())
+  {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+    {
+      std::cerr << "qilog-decode: cannot open " << path << std::endl;
+      ret = EXIT_FAILURE;
+      continue;
+    }
+    if (!decode(in, std::cout, context))
+      ret = EXIT_FAILURE;
+  }
+  return ret;
+}